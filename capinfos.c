@@ -1084,14 +1084,12 @@ process_cap_file(const char *filename, bool need_separator)
     int                   err;
     char                 *err_info;
     int64_t               size;
-    int64_t               data_offset;
 
     uint32_t              packet = 0;
     int64_t               bytes  = 0;
     uint32_t              snaplen_min_inferred = 0xffffffff;
     uint32_t              snaplen_max_inferred =          0;
-    wtap_rec              rec;
-    Buffer                buf;
+    wtap_rec_batch        batch;
     capture_info          cf_info;
     bool                  have_times = true;
     nstime_t              start_time;
@@ -1158,118 +1156,118 @@ process_cap_file(const char *filename, bool need_separator)
     wtap_set_cb_new_secrets(cf_info.wth, count_decryption_secret);
 
     /* Tally up data that we need to parse through the file to find */
-    wtap_rec_init(&rec);
-    ws_buffer_init(&buf, 1514);
-    while (wtap_read(cf_info.wth, &rec, &buf, &err, &err_info, &data_offset))  {
-        if (rec.presence_flags & WTAP_HAS_TS) {
-            prev_time = cur_time;
-            cur_time = rec.ts;
-            if (packet == 0) {
-                start_time = rec.ts;
-                start_time_tsprec = rec.tsprec;
-                stop_time  = rec.ts;
-                stop_time_tsprec = rec.tsprec;
-                prev_time  = rec.ts;
-            }
-            if (nstime_cmp(&cur_time, &prev_time) < 0) {
-                order = NOT_IN_ORDER;
-            }
-            if (nstime_cmp(&cur_time, &start_time) < 0) {
-                start_time = cur_time;
-                start_time_tsprec = rec.tsprec;
-            }
-            if (nstime_cmp(&cur_time, &stop_time) > 0) {
-                stop_time = cur_time;
-                stop_time_tsprec = rec.tsprec;
-            }
-        } else {
-            have_times = false; /* at least one packet has no time stamp */
-            if (order != NOT_IN_ORDER)
-                order = ORDER_UNKNOWN;
-        }
-
-        if (rec.rec_type == REC_TYPE_PACKET) {
-            bytes += rec.rec_header.packet_header.len;
-            packet++;
-            /* packet comments */
-            if (pkt_comments && wtap_block_count_option(rec.block, OPT_COMMENT) > 0) {
-              char *cmt_buff;
-              for (i = 0; wtap_block_get_nth_string_option_value(rec.block, OPT_COMMENT, i, &cmt_buff) == WTAP_OPTTYPE_SUCCESS; i++) {
-                pc = g_new0(pkt_cmt, 1);
-
-                pc->recno = packet;
-                pc->cmt = g_strdup(cmt_buff);
-                pc->next = NULL;
-
-                if (prev == NULL)
-                  cf_info.pkt_cmts = pc;
-                else
-                  prev->next = pc;
-
-                prev = pc;
-              }
-            }
-
-            /* If caplen < len for a rcd, then presumably           */
-            /* 'Limit packet capture length' was done for this rcd. */
-            /* Keep track as to the min/max actual snapshot lengths */
-            /*  seen for this file.                                 */
-            if (rec.rec_header.packet_header.caplen < rec.rec_header.packet_header.len) {
-                if (rec.rec_header.packet_header.caplen < snaplen_min_inferred)
-                    snaplen_min_inferred = rec.rec_header.packet_header.caplen;
-                if (rec.rec_header.packet_header.caplen > snaplen_max_inferred)
-                    snaplen_max_inferred = rec.rec_header.packet_header.caplen;
-            }
-
-            if ((rec.rec_header.packet_header.pkt_encap > 0) &&
-                    (rec.rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-                cf_info.encap_counts[rec.rec_header.packet_header.pkt_encap] += 1;
+    wtap_rec_batch_init(&batch, 256, 256 * 1024);
+    while (wtap_read_batch(cf_info.wth, &batch, &err, &err_info)) {
+        for (unsigned r = 0; r < batch.num_recs; r++) {
+            const wtap_rec *rec = &batch.recs[r];
+
+            if (rec->presence_flags & WTAP_HAS_TS) {
+                prev_time = cur_time;
+                cur_time = rec->ts;
+                if (packet == 0) {
+                    start_time = rec->ts;
+                    start_time_tsprec = rec->tsprec;
+                    stop_time  = rec->ts;
+                    stop_time_tsprec = rec->tsprec;
+                    prev_time  = rec->ts;
+                }
+                if (nstime_cmp(&cur_time, &prev_time) < 0) {
+                    order = NOT_IN_ORDER;
+                }
+                if (nstime_cmp(&cur_time, &start_time) < 0) {
+                    start_time = cur_time;
+                    start_time_tsprec = rec->tsprec;
+                }
+                if (nstime_cmp(&cur_time, &stop_time) > 0) {
+                    stop_time = cur_time;
+                    stop_time_tsprec = rec->tsprec;
+                }
             } else {
-                fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
-                        rec.rec_header.packet_header.pkt_encap, packet, filename);
+                have_times = false; /* at least one packet has no time stamp */
+                if (order != NOT_IN_ORDER)
+                    order = ORDER_UNKNOWN;
             }
 
-            /* Packet interface_id info */
-            if (rec.presence_flags & WTAP_HAS_INTERFACE_ID) {
-                /* cf_info.num_interfaces is size, not index, so it's one more than max index */
-                if (rec.rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
-                    /*
-                     * OK, re-fetch the number of interfaces, as there might have
-                     * been an interface that was in the middle of packets, and
-                     * grow the array to be big enough for the new number of
-                     * interfaces.
-                     */
-                    idb_info = wtap_file_get_idb_info(cf_info.wth);
-
-                    cf_info.num_interfaces = idb_info->interface_data->len;
-                    g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
-
-                    g_free(idb_info);
-                    idb_info = NULL;
+            if (rec->rec_type == REC_TYPE_PACKET) {
+                bytes += rec->rec_header.packet_header.len;
+                packet++;
+                /* packet comments */
+                if (pkt_comments && wtap_block_count_option(rec->block, OPT_COMMENT) > 0) {
+                  char *cmt_buff;
+                  for (i = 0; wtap_block_get_nth_string_option_value(rec->block, OPT_COMMENT, i, &cmt_buff) == WTAP_OPTTYPE_SUCCESS; i++) {
+                    pc = g_new0(pkt_cmt, 1);
+
+                    pc->recno = packet;
+                    pc->cmt = g_strdup(cmt_buff);
+                    pc->next = NULL;
+
+                    if (prev == NULL)
+                      cf_info.pkt_cmts = pc;
+                    else
+                      prev->next = pc;
+
+                    prev = pc;
+                  }
                 }
-                if (rec.rec_header.packet_header.interface_id < cf_info.num_interfaces) {
-                    g_array_index(cf_info.interface_packet_counts, guint32,
-                            rec.rec_header.packet_header.interface_id) += 1;
+
+                /* If caplen < len for a rcd, then presumably           */
+                /* 'Limit packet capture length' was done for this rcd. */
+                /* Keep track as to the min/max actual snapshot lengths */
+                /*  seen for this file.                                 */
+                if (rec->rec_header.packet_header.caplen < rec->rec_header.packet_header.len) {
+                    if (rec->rec_header.packet_header.caplen < snaplen_min_inferred)
+                        snaplen_min_inferred = rec->rec_header.packet_header.caplen;
+                    if (rec->rec_header.packet_header.caplen > snaplen_max_inferred)
+                        snaplen_max_inferred = rec->rec_header.packet_header.caplen;
                 }
-                else {
-                    cf_info.pkt_interface_id_unknown += 1;
+
+                if ((rec->rec_header.packet_header.pkt_encap > 0) &&
+                        (rec->rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
+                    cf_info.encap_counts[rec->rec_header.packet_header.pkt_encap] += 1;
+                } else {
+                    fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
+                            rec->rec_header.packet_header.pkt_encap, packet, filename);
                 }
-            }
-            else {
-                /* it's for interface_id 0 */
-                if (cf_info.num_interfaces != 0) {
-                    g_array_index(cf_info.interface_packet_counts, guint32, 0) += 1;
+
+                /* Packet interface_id info */
+                if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
+                    /* cf_info.num_interfaces is size, not index, so it's one more than max index */
+                    if (rec->rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
+                        /*
+                         * OK, re-fetch the number of interfaces, as there might have
+                         * been an interface that was in the middle of packets, and
+                         * grow the array to be big enough for the new number of
+                         * interfaces.
+                         */
+                        idb_info = wtap_file_get_idb_info(cf_info.wth);
+
+                        cf_info.num_interfaces = idb_info->interface_data->len;
+                        g_array_set_size(cf_info.interface_packet_counts, cf_info.num_interfaces);
+
+                        g_free(idb_info);
+                        idb_info = NULL;
+                    }
+                    if (rec->rec_header.packet_header.interface_id < cf_info.num_interfaces) {
+                        g_array_index(cf_info.interface_packet_counts, guint32,
+                                rec->rec_header.packet_header.interface_id) += 1;
+                    }
+                    else {
+                        cf_info.pkt_interface_id_unknown += 1;
+                    }
                 }
                 else {
-                    cf_info.pkt_interface_id_unknown += 1;
+                    /* it's for interface_id 0 */
+                    if (cf_info.num_interfaces != 0) {
+                        g_array_index(cf_info.interface_packet_counts, guint32, 0) += 1;
+                    }
+                    else {
+                        cf_info.pkt_interface_id_unknown += 1;
+                    }
                 }
             }
         }
-
-        wtap_rec_reset(&rec);
     } /* while */
-    wtap_rec_cleanup(&rec);
-    ws_buffer_free(&buf);
+    wtap_rec_batch_cleanup(&batch);
 
     /*
      * Get IDB info strings.
@@ -1158,12 +1158,22 @@ capture_opts_add_opt(capture_options *capture_opts, int opt, const char *optarg_
             cmdarg_err("'gzip' compression is not supported");
             return 1;
 #endif
-        } else {
-#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
-            cmdarg_err("parameter of --compress-type can be 'none' or 'gzip'");
+        } else if (strcmp(optarg_str_p, "zstd") == 0) {
+#ifdef HAVE_ZSTD
+            ;
 #else
-            cmdarg_err("parameter of --compress-type can only be 'none'");
+            cmdarg_err("'zstd' compression is not supported");
+            return 1;
 #endif
+        } else if (strcmp(optarg_str_p, "lz4") == 0) {
+#ifdef HAVE_LZ4FRAME_H
+            ;
+#else
+            cmdarg_err("'lz4' compression is not supported");
+            return 1;
+#endif
+        } else {
+            cmdarg_err("parameter of --compress-type can be 'none', 'gzip', 'zstd' or 'lz4'");
             return 1;
         }
         capture_opts->compress_type = g_strdup(optarg_str_p);
@@ -45,6 +45,20 @@ if( LZ4_FOUND )
   cmake_push_check_state()
   set( CMAKE_REQUIRED_INCLUDES ${LZ4_INCLUDE_DIRS} )
   check_include_file( lz4frame.h HAVE_LZ4FRAME_H )
+  if( HAVE_LZ4FRAME_H )
+    # We only use the frame API from lz4 1.7.3 on; treat older
+    # versions as not having it.
+    include( CheckCSourceCompiles )
+    check_c_source_compiles( "
+      #include <lz4.h>
+      #if LZ4_VERSION_NUMBER < 10703
+      #error lz4 is too old
+      #endif
+      int main(void) { return 0; }" LZ4_HAVE_FRAME_API )
+    if( NOT LZ4_HAVE_FRAME_API )
+      set( HAVE_LZ4FRAME_H FALSE CACHE INTERNAL "lz4frame.h of lz4 1.7.3 or later" FORCE )
+    endif()
+  endif()
   cmake_pop_check_state()
 
   if (WIN32)
@@ -141,6 +141,7 @@ static struct select_item     selectfrm[MAX_SELECTIONS];
 static guint                  max_selected;
 static gboolean               keep_em;
 static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE_UNKNOWN;
+static wtap_compression_type  out_compression_type      = WTAP_UNCOMPRESSED;
 static int                    out_frame_type            = -2; /* Leave frame type alone */
 static gboolean               verbose; /* Not so verbose         */
 static struct time_adjustment time_adj; /* no adjustment */
@@ -892,6 +893,8 @@ print_usage(FILE *output)
     fprintf(output, "  -T <encap type>        set the output file encapsulation type; default is the\n");
     fprintf(output, "                         same as the input file. An empty \"-T\" option will\n");
     fprintf(output, "                         list the encapsulation types.\n");
+    fprintf(output, "  --compress <type>      compress the output file(s) with <type>. An unknown\n");
+    fprintf(output, "                         <type> will list the compression types.\n");
     fprintf(output, "  --inject-secrets <type>,<file>  Insert decryption secrets from <file>. List\n");
     fprintf(output, "                         supported secret types with \"--inject-secrets help\".\n");
     fprintf(output, "  --discard-all-secrets  Discard all decryption secrets from the input file\n");
@@ -953,6 +956,18 @@ list_capture_types(FILE *stream) {
     g_array_free(writable_type_subtypes, TRUE);
 }
 
+static void
+list_output_compression_types(FILE *stream) {
+    GSList *output_compression_types;
+
+    fprintf(stream, "editcap: The available output compression types for the \"--compress\" option are:\n");
+    output_compression_types = wtap_get_all_output_compression_type_names_list();
+    for (GSList *item = output_compression_types; item != NULL; item = g_slist_next(item)) {
+        fprintf(stream, "    %s\n", (const char *)item->data);
+    }
+    g_slist_free(output_compression_types);
+}
+
 static void
 list_encap_types(FILE *stream) {
     int i;
@@ -1051,10 +1066,10 @@ editcap_dump_open(const char *filename, const wtap_dump_params *params,
 
     if (strcmp(filename, "-") == 0) {
         /* Write to the standard output. */
-        pdh = wtap_dump_open_stdout(out_file_type_subtype, WTAP_UNCOMPRESSED,
+        pdh = wtap_dump_open_stdout(out_file_type_subtype, out_compression_type,
                                     params, err, err_info);
     } else {
-        pdh = wtap_dump_open(filename, out_file_type_subtype, WTAP_UNCOMPRESSED,
+        pdh = wtap_dump_open(filename, out_file_type_subtype, out_compression_type,
                              params, err, err_info);
     }
     if (pdh == NULL)
@@ -1204,6 +1219,7 @@ main(int argc, char *argv[])
 #define LONGOPT_DISCARD_CAPTURE_COMMENT LONGOPT_BASE_APPLICATION+7
 #define LONGOPT_SET_UNUSED           LONGOPT_BASE_APPLICATION+8
 #define LONGOPT_DISCARD_PACKET_COMMENTS LONGOPT_BASE_APPLICATION+9
+#define LONGOPT_COMPRESS             LONGOPT_BASE_APPLICATION+10
 
     static const struct ws_option long_options[] = {
         {"novlan", ws_no_argument, NULL, LONGOPT_NO_VLAN},
@@ -1217,6 +1233,7 @@ main(int argc, char *argv[])
         {"discard-capture-comment", ws_no_argument, NULL, LONGOPT_DISCARD_CAPTURE_COMMENT},
         {"set-unused", ws_no_argument, NULL, LONGOPT_SET_UNUSED},
         {"discard-packet-comments", ws_no_argument, NULL, LONGOPT_DISCARD_PACKET_COMMENTS},
+        {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
         {0, 0, 0, 0 }
     };
 
@@ -1407,6 +1424,20 @@ main(int argc, char *argv[])
             break;
         }
 
+        case LONGOPT_COMPRESS:
+        {
+            out_compression_type = wtap_name_to_compression_type(ws_optarg);
+            if (out_compression_type == WTAP_UNCOMPRESSED ||
+                !wtap_can_write_compression_type(out_compression_type)) {
+                fprintf(stderr, "editcap: \"%s\" isn't a valid output compression type\n\n",
+                        ws_optarg);
+                list_output_compression_types(stderr);
+                ret = WS_EXIT_INVALID_OPTION;
+                goto clean_exit;
+            }
+            break;
+        }
+
         case 'a':
         {
             guint frame_number;
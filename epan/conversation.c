@@ -555,7 +555,7 @@ conversation_init(void)
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
     char *exact_map_key = conversation_element_list_name(wmem_epan_scope(), exact_elements);
-    conversation_hashtable_exact_addr_port = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+    conversation_hashtable_exact_addr_port = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
     wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), exact_map_key),
@@ -567,7 +567,7 @@ conversation_init(void)
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
     char *addrs_map_key = conversation_element_list_name(wmem_epan_scope(), addrs_elements);
-    conversation_hashtable_exact_addr = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+    conversation_hashtable_exact_addr = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
     wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), addrs_map_key),
@@ -580,7 +580,7 @@ conversation_init(void)
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
     char *no_addr2_map_key = conversation_element_list_name(wmem_epan_scope(), no_addr2_elements);
-    conversation_hashtable_no_addr2 = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+    conversation_hashtable_no_addr2 = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                        conversation_hash_element_list,
                                                        conversation_match_element_list);
     wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), no_addr2_map_key),
@@ -593,7 +593,7 @@ conversation_init(void)
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
     char *no_port2_map_key = conversation_element_list_name(wmem_epan_scope(), no_port2_elements);
-    conversation_hashtable_no_port2 = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+    conversation_hashtable_no_port2 = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                        conversation_hash_element_list,
                                                        conversation_match_element_list);
     wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), no_port2_map_key),
@@ -605,7 +605,7 @@ conversation_init(void)
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
     char *no_addr2_or_port2_map_key = conversation_element_list_name(wmem_epan_scope(), no_addr2_or_port2_elements);
-    conversation_hashtable_no_addr2_or_port2 = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+    conversation_hashtable_no_addr2_or_port2 = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
     wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), no_addr2_or_port2_map_key),
@@ -616,7 +616,7 @@ conversation_init(void)
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
     char *id_map_key = conversation_element_list_name(wmem_epan_scope(), id_elements);
-    conversation_hashtable_id = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+    conversation_hashtable_id = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                        conversation_hash_element_list,
                                                        conversation_match_element_list);
     wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), id_map_key),
@@ -645,7 +645,7 @@ conversation_init(void)
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
     char *deinterlacer_map_key = conversation_element_list_name(wmem_epan_scope(), deinterlacer_elements);
-    conversation_hashtable_deinterlacer = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+    conversation_hashtable_deinterlacer = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
     wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), deinterlacer_map_key),
@@ -669,7 +669,7 @@ conversation_init(void)
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
     char *exact_anc_map_key = conversation_element_list_name(wmem_epan_scope(), exact_elements_anc);
-    conversation_hashtable_exact_addr_port_anc = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+    conversation_hashtable_exact_addr_port_anc = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
     wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), exact_anc_map_key),
@@ -682,7 +682,7 @@ conversation_init(void)
         { CE_CONVERSATION_TYPE, .conversation_type_val = CONVERSATION_NONE }
     };
     char *addrs_anc_map_key = conversation_element_list_name(wmem_epan_scope(), addrs_elements_anc);
-    conversation_hashtable_exact_addr_anc = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),
+    conversation_hashtable_exact_addr_anc = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(),
                                                                     conversation_hash_element_list,
                                                                     conversation_match_element_list);
     wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), addrs_anc_map_key),
@@ -828,7 +828,7 @@ conversation_t *conversation_new_full(const guint32 setup_frame, conversation_el
     char *el_list_map_key = conversation_element_list_name(wmem_epan_scope(), elements);
     wmem_map_t *el_list_map = (wmem_map_t *) wmem_map_lookup(conversation_hashtable_element_list, el_list_map_key);
     if (!el_list_map) {
-        el_list_map = wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), conversation_hash_element_list,
+        el_list_map = wmem_map_new_flat_autoreset(wmem_epan_scope(), wmem_file_scope(), conversation_hash_element_list,
                 conversation_match_element_list);
         wmem_map_insert(conversation_hashtable_element_list, wmem_strdup(wmem_epan_scope(), el_list_map_key), el_list_map);
     }
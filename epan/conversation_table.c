@@ -647,8 +647,64 @@ add_conversation_table_data(conv_hash_t *ch, const address *src, const address *
     add_conversation_table_data_with_conv_id(ch, src, dst, src_port, dst_port, CONV_ID_UNSET, num_frames, num_bytes, ts, abs_ts, ct_info, ctype);
 }
 
-conv_item_t *
-add_conversation_table_data_with_conv_id(
+/* A call to add_conversation_table_data*() or add_endpoint_table_data()
+ * recorded by conversation_table_snapshot(), with copies of what the
+ * packet function passed by reference */
+typedef struct {
+    gboolean endpoint;
+    address src;                /* the endpoint's address for endpoints */
+    address dst;
+    guint32 src_port;           /* the endpoint's port for endpoints */
+    guint32 dst_port;
+    conv_id_t conv_id;
+    gboolean sender;
+    int num_frames;
+    int num_bytes;
+    gboolean has_ts;
+    nstime_t ts;
+    nstime_t abs_ts;
+    ct_dissector_info_t *ct_info;
+    et_dissector_info_t *et_info;
+    conversation_type ctype;
+    endpoint_type etype;
+    gboolean has_ext_tcp;
+    conv_extension_tcp_t ext_tcp;
+} ct_update_t;
+
+typedef struct {
+    tap_packet_status status;
+    GArray *updates;
+} ct_record_t;
+
+static ct_update_t *
+record_conversation_table_data(conv_hash_t *ch, const address *src, const address *dst,
+        guint32 src_port, guint32 dst_port, conv_id_t conv_id, int num_frames, int num_bytes,
+        nstime_t *ts, nstime_t *abs_ts, ct_dissector_info_t *ct_info, conversation_type ctype)
+{
+    ct_update_t update;
+
+    memset(&update, 0, sizeof(update));
+    copy_address(&update.src, src);
+    copy_address(&update.dst, dst);
+    update.src_port = src_port;
+    update.dst_port = dst_port;
+    update.conv_id = conv_id;
+    update.num_frames = num_frames;
+    update.num_bytes = num_bytes;
+    if (ts) {
+        update.has_ts = TRUE;
+        update.ts = *ts;
+        update.abs_ts = *abs_ts;
+    }
+    update.ct_info = ct_info;
+    update.ctype = ctype;
+    g_array_append_val(ch->updates, update);
+
+    return &g_array_index(ch->updates, ct_update_t, ch->updates->len - 1);
+}
+
+static conv_item_t *
+conversation_table_add(
     conv_hash_t *ch,
     const address *src,
     const address *dst,
@@ -791,6 +847,28 @@ add_conversation_table_data_with_conv_id(
     return conv_item;
 }
 
+conv_item_t *
+add_conversation_table_data_with_conv_id(
+    conv_hash_t *ch,
+    const address *src,
+    const address *dst,
+    guint32 src_port,
+    guint32 dst_port,
+    conv_id_t conv_id,
+    int num_frames,
+    int num_bytes,
+    nstime_t *ts,
+    nstime_t *abs_ts,
+    ct_dissector_info_t *ct_info,
+    conversation_type ctype)
+{
+    if (ch->updates) {
+        record_conversation_table_data(ch, src, dst, src_port, dst_port, conv_id, num_frames, num_bytes, ts, abs_ts, ct_info, ctype);
+        return NULL;
+    }
+    return conversation_table_add(ch, src, dst, src_port, dst_port, conv_id, num_frames, num_bytes, ts, abs_ts, ct_info, ctype);
+}
+
 void
 add_conversation_table_data_extended(
     conv_hash_t *ch,
@@ -808,8 +886,7 @@ add_conversation_table_data_extended(
     guint32 frameid,
     int (*proto_conv_cb)(conversation_t *) )
 {
-    /* delegate the conversation_table update to the decorated function */
-    conv_item_t *conv_item = add_conversation_table_data_with_conv_id(ch, src, dst, src_port, dst_port, conv_id, num_frames, num_bytes, ts, abs_ts, ct_info, ctype);
+    conv_item_t *conv_item;
 
     /*
      * Relies heavily on frameid to identify the conversation.
@@ -829,6 +906,17 @@ add_conversation_table_data_extended(
         ext_tcp.flows = 0;
     }
 
+    if (ch->updates) {
+        ct_update_t *update = record_conversation_table_data(ch, src, dst, src_port, dst_port, conv_id, num_frames, num_bytes, ts, abs_ts, ct_info, ctype);
+
+        update->has_ext_tcp = TRUE;
+        update->ext_tcp = ext_tcp;
+        return;
+    }
+
+    /* delegate the conversation_table update to the decorated function */
+    conv_item = conversation_table_add(ch, src, dst, src_port, dst_port, conv_id, num_frames, num_bytes, ts, abs_ts, ct_info, ctype);
+
     // update conv_item accordingly
     memcpy(&conv_item->ext_tcp, &ext_tcp, sizeof(conv_item->ext_tcp));
 }
@@ -868,8 +956,8 @@ endpoint_match(gconstpointer v, gconstpointer w)
     return 0;
 }
 
-void
-add_endpoint_table_data(conv_hash_t *ch, const address *addr, guint32 port, gboolean sender, int num_frames, int num_bytes, et_dissector_info_t *et_info, endpoint_type etype)
+static void
+endpoint_table_add(conv_hash_t *ch, const address *addr, guint32 port, gboolean sender, int num_frames, int num_bytes, et_dissector_info_t *et_info, endpoint_type etype)
 {
     endpoint_item_t *endpoint_item = NULL;
 
@@ -953,6 +1041,27 @@ add_endpoint_table_data(conv_hash_t *ch, const address *addr, guint32 port, gboo
     }
 }
 
+void
+add_endpoint_table_data(conv_hash_t *ch, const address *addr, guint32 port, gboolean sender, int num_frames, int num_bytes, et_dissector_info_t *et_info, endpoint_type etype)
+{
+    if (ch->updates) {
+        ct_update_t update;
+
+        memset(&update, 0, sizeof(update));
+        update.endpoint = TRUE;
+        copy_address(&update.src, addr);
+        update.src_port = port;
+        update.sender = sender;
+        update.num_frames = num_frames;
+        update.num_bytes = num_bytes;
+        update.et_info = et_info;
+        update.etype = etype;
+        g_array_append_val(ch->updates, update);
+        return;
+    }
+    endpoint_table_add(ch, addr, port, sender, num_frames, num_bytes, et_info, etype);
+}
+
 /* For backwards source and binary compatibility */
 void
 add_hostlist_table_data(conv_hash_t *ch, const address *addr, guint32 port, gboolean sender, int num_frames, int num_bytes, et_dissector_info_t *et_info, endpoint_type etype)
@@ -960,6 +1069,66 @@ add_hostlist_table_data(conv_hash_t *ch, const address *addr, guint32 port, gboo
     add_endpoint_table_data(ch, addr, port, sender, num_frames, num_bytes, et_info, etype);
 }
 
+void *
+conversation_table_snapshot(conv_hash_t *ch, tap_packet_cb packet_func,
+        packet_info *pinfo, epan_dissect_t *edt, const void *data, tap_flags_t flags)
+{
+    ct_record_t *record;
+    tap_packet_status status;
+
+    ch->updates = g_array_new(FALSE, FALSE, sizeof(ct_update_t));
+    status = packet_func(ch, pinfo, edt, data, flags);
+
+    if (ch->updates->len == 0 && status != TAP_PACKET_FAILED) {
+        g_array_free(ch->updates, TRUE);
+        ch->updates = NULL;
+        return NULL;
+    }
+
+    record = g_new(ct_record_t, 1);
+    record->status = status;
+    record->updates = ch->updates;
+    ch->updates = NULL;
+
+    return record;
+}
+
+tap_packet_status
+conversation_table_consume(void *arg, void *precord)
+{
+    conv_hash_t *ch = (conv_hash_t *)arg;
+    ct_record_t *record = (ct_record_t *)precord;
+    tap_packet_status status = record->status;
+    conv_item_t *conv_item;
+    guint i;
+
+    for (i = 0; i < record->updates->len; i++) {
+        ct_update_t *update = &g_array_index(record->updates, ct_update_t, i);
+
+        if (update->endpoint) {
+            endpoint_table_add(ch, &update->src, update->src_port, update->sender,
+                    update->num_frames, update->num_bytes, update->et_info, update->etype);
+        } else {
+            conv_item = conversation_table_add(ch, &update->src, &update->dst,
+                    update->src_port, update->dst_port, update->conv_id,
+                    update->num_frames, update->num_bytes,
+                    update->has_ts ? &update->ts : NULL,
+                    update->has_ts ? &update->abs_ts : NULL,
+                    update->ct_info, update->ctype);
+            if (update->has_ext_tcp) {
+                memcpy(&conv_item->ext_tcp, &update->ext_tcp, sizeof(conv_item->ext_tcp));
+            }
+        }
+        free_address(&update->src);
+        free_address(&update->dst);
+    }
+
+    g_array_free(record->updates, TRUE);
+    g_free(record);
+
+    return status;
+}
+
 /*
  * Editor modelines
  *
@@ -55,6 +55,7 @@ typedef struct _conversation_hash_t {
     GArray      *conv_array;      /**< array of conversation values */
     void        *user_data;       /**< "GUI" specifics (if necessary) */
     guint       flags;            /**< flags given to the tap packet */
+    GArray      *updates;         /**< updates recorded by conversation_table_snapshot(), NULL otherwise */
 } conv_hash_t;
 
 /** Key for hash lookups */
@@ -411,6 +412,29 @@ G_DEPRECATED_FOR(add_endpoint_table_data)
 WS_DLL_PUBLIC void add_hostlist_table_data(conv_hash_t *ch, const address *addr,
     guint32 port, gboolean sender, int num_frames, int num_bytes, et_dissector_info_t *et_info, endpoint_type etype);
 
+/** Run a conversation or endpoint tap packet function for a listener
+ *  registered with register_tap_listener_threaded(), recording the data it
+ *  adds to the table instead of adding it. While recording,
+ *  add_conversation_table_data_with_conv_id() returns NULL.
+ *
+ * @param ch the table the packet function adds data to
+ * @param packet_func the packet function, as returned by
+ *   get_conversation_packet_func() or get_endpoint_packet_func()
+ * @param pinfo, edt, data, flags as passed to the tap snapshot routine
+ * @return a record for conversation_table_consume(), or NULL if nothing was added
+ */
+WS_DLL_PUBLIC void *conversation_table_snapshot(conv_hash_t *ch, tap_packet_cb packet_func,
+    packet_info *pinfo, epan_dissect_t *edt, const void *data, tap_flags_t flags);
+
+/** Add the data recorded by conversation_table_snapshot() to the table,
+ *  and free the record. Can be used as the tap consume routine.
+ *
+ * @param ch the table the data was recorded for
+ * @param record the record
+ * @return the status returned by the packet function
+ */
+WS_DLL_PUBLIC tap_packet_status conversation_table_consume(void *ch, void *record);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
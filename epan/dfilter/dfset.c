@@ -0,0 +1,369 @@
+/*
+ * Precompiled membership sets for the "in" operator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define WS_LOG_DOMAIN LOG_DOMAIN_DFILTER
+
+#include "dfset.h"
+
+#include <wsutil/ws_assert.h>
+
+/* Maximum number of members shown by df_set_tostr(). */
+#define DF_SET_MAX_DUMP_MEMBERS	8
+
+typedef struct {
+	const fvalue_t	*low;
+	const fvalue_t	*high;
+} df_set_range_t;
+
+struct _df_set {
+	/* Type of every member, or FT_NONE if the members have mixed types. */
+	ftenum_t	ftype;
+	/* Owns all the fvalues in the set. */
+	GPtrArray	*owned;
+	/* All the discrete members, in insertion order. */
+	GPtrArray	*values;
+	/* Discrete members that can be looked up by hash. */
+	GHashTable	*hashed;
+	/* Discrete members that must be compared one by one. */
+	GPtrArray	*unhashed;
+	/* Ranges (df_set_range_t). Sorted by lower bound and merged if
+	 * ranges_sorted is true. */
+	GArray		*ranges;
+	bool		ranges_sorted;
+	bool		finalized;
+};
+
+/* True if fvalue_hash()/fvalue_equal() are consistent with the "==" used
+ * by the "in" operator for this value. IP networks match any address in the
+ * network and floating point equality isn't reflexive, so those values
+ * cannot be looked up by hash. */
+static bool
+value_is_hashable(const fvalue_t *fv)
+{
+	ftenum_t ftype = fvalue_type_ftenum(fv);
+
+	if (FT_IS_INTEGER(ftype) || FT_IS_STRING(ftype))
+		return true;
+
+	switch (ftype) {
+		case FT_BOOLEAN:
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_ETHER:
+		case FT_GUID:
+			return true;
+		case FT_IPv4:
+			return fvalue_get_ipv4((fvalue_t *)fv)->nmask == 0xffffffff;
+		case FT_IPv6:
+			return fvalue_get_ipv6((fvalue_t *)fv)->prefix == 128;
+		default:
+			break;
+	}
+	return false;
+}
+
+static unsigned
+set_value_hash(const void *key)
+{
+	return fvalue_hash(key);
+}
+
+static gboolean
+set_value_equal(const void *a, const void *b)
+{
+	return fvalue_equal(a, b);
+}
+
+/* True if the order of this type is total, so that ranges can be sorted
+ * and searched with a binary search. */
+static bool
+type_is_ordered(ftenum_t ftype)
+{
+	return FT_IS_INTEGER(ftype) || FT_IS_TIME(ftype);
+}
+
+df_set_t *
+df_set_new(void)
+{
+	df_set_t *set = g_new0(df_set_t, 1);
+
+	set->ftype = FT_NONE;
+	set->owned = g_ptr_array_new_with_free_func((GDestroyNotify)fvalue_free);
+	set->values = g_ptr_array_new();
+	set->unhashed = g_ptr_array_new();
+	set->ranges = g_array_new(false, false, sizeof(df_set_range_t));
+	return set;
+}
+
+void
+df_set_free(df_set_t *set)
+{
+	if (set->hashed)
+		g_hash_table_destroy(set->hashed);
+	g_ptr_array_free(set->values, true);
+	g_ptr_array_free(set->unhashed, true);
+	g_array_free(set->ranges, true);
+	/* Free the fvalues last, the hash table may still reference them. */
+	g_ptr_array_free(set->owned, true);
+	g_free(set);
+}
+
+static void
+set_track_type(df_set_t *set, const fvalue_t *fv)
+{
+	ftenum_t ftype = fvalue_type_ftenum(fv);
+
+	if (set->owned->len == 0) {
+		set->ftype = ftype;
+	}
+	else if (set->ftype != ftype) {
+		set->ftype = FT_NONE;
+	}
+}
+
+void
+df_set_add(df_set_t *set, fvalue_t *fv)
+{
+	ws_assert(!set->finalized);
+
+	set_track_type(set, fv);
+	g_ptr_array_add(set->owned, fv);
+	g_ptr_array_add(set->values, fv);
+}
+
+void
+df_set_add_range(df_set_t *set, fvalue_t *low, fvalue_t *high)
+{
+	df_set_range_t range;
+
+	ws_assert(!set->finalized);
+
+	set_track_type(set, low);
+	g_ptr_array_add(set->owned, low);
+	set_track_type(set, high);
+	g_ptr_array_add(set->owned, high);
+
+	range.low = low;
+	range.high = high;
+	g_array_append_val(set->ranges, range);
+}
+
+static int
+compare_ranges(const void *a, const void *b)
+{
+	const df_set_range_t *ra = a;
+	const df_set_range_t *rb = b;
+
+	if (fvalue_lt(ra->low, rb->low) == FT_TRUE)
+		return -1;
+	if (fvalue_gt(ra->low, rb->low) == FT_TRUE)
+		return 1;
+	return 0;
+}
+
+/* Sort the ranges by their lower bound and merge the overlapping ones,
+ * so that at most one range can contain any given value. */
+static void
+sort_ranges(df_set_t *set)
+{
+	df_set_range_t *ranges, *last;
+	unsigned count = 0;
+
+	if (set->ranges->len == 0)
+		return;
+
+	g_array_sort(set->ranges, compare_ranges);
+
+	ranges = (df_set_range_t *)(void *)set->ranges->data;
+	last = &ranges[0];
+	count = 1;
+	for (unsigned i = 1; i < set->ranges->len; i++) {
+		if (fvalue_le(ranges[i].low, last->high) == FT_TRUE) {
+			/* Overlapping, extend the last range. */
+			if (fvalue_gt(ranges[i].high, last->high) == FT_TRUE) {
+				last->high = ranges[i].high;
+			}
+		}
+		else {
+			last = &ranges[count++];
+			*last = ranges[i];
+		}
+	}
+	g_array_set_size(set->ranges, count);
+}
+
+void
+df_set_finalize(df_set_t *set)
+{
+	const fvalue_t *fv;
+
+	ws_assert(!set->finalized);
+	set->finalized = true;
+
+	/* Mixed types can only be compared with the generic functions. */
+	if (set->ftype == FT_NONE) {
+		for (unsigned i = 0; i < set->values->len; i++) {
+			g_ptr_array_add(set->unhashed, set->values->pdata[i]);
+		}
+		return;
+	}
+
+	for (unsigned i = 0; i < set->values->len; i++) {
+		fv = set->values->pdata[i];
+		if (value_is_hashable(fv)) {
+			if (set->hashed == NULL) {
+				set->hashed = g_hash_table_new(set_value_hash,
+							set_value_equal);
+			}
+			g_hash_table_add(set->hashed, (void *)fv);
+		}
+		else {
+			g_ptr_array_add(set->unhashed, (void *)fv);
+		}
+	}
+
+	if (type_is_ordered(set->ftype)) {
+		sort_ranges(set);
+		set->ranges_sorted = true;
+	}
+}
+
+static bool
+range_contains(const df_set_range_t *range, const fvalue_t *fv)
+{
+	return fvalue_ge(fv, range->low) == FT_TRUE &&
+				fvalue_le(fv, range->high) == FT_TRUE;
+}
+
+static bool
+ranges_contain_sorted(const df_set_t *set, const fvalue_t *fv)
+{
+	const df_set_range_t *ranges = (const df_set_range_t *)(void *)set->ranges->data;
+	unsigned lo = 0, hi = set->ranges->len, mid;
+
+	/* Find the last range with a lower bound <= fv. */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (fvalue_le(ranges[mid].low, fv) == FT_TRUE)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return false;
+	return fvalue_le(fv, ranges[lo - 1].high) == FT_TRUE;
+}
+
+static bool
+values_contain(GPtrArray *values, const fvalue_t *fv)
+{
+	for (unsigned i = 0; i < values->len; i++) {
+		if (fvalue_eq(fv, values->pdata[i]) == FT_TRUE)
+			return true;
+	}
+	return false;
+}
+
+bool
+df_set_contains(const df_set_t *set, const fvalue_t *fv)
+{
+	bool same_type;
+
+	ws_assert(set->finalized);
+
+	same_type = (set->ftype != FT_NONE && fvalue_type_ftenum(fv) == set->ftype);
+
+	if (set->hashed) {
+		if (same_type && value_is_hashable(fv)) {
+			if (g_hash_table_contains(set->hashed, fv))
+				return true;
+		}
+		else {
+			/* Cannot use the hash for this value. */
+			if (values_contain(set->values, fv))
+				return true;
+			/* The unhashed values were already tested. */
+			goto test_ranges;
+		}
+	}
+	if (values_contain(set->unhashed, fv))
+		return true;
+
+test_ranges:
+	if (set->ranges->len == 0)
+		return false;
+
+	if (same_type && set->ranges_sorted)
+		return ranges_contain_sorted(set, fv);
+
+	for (unsigned i = 0; i < set->ranges->len; i++) {
+		if (range_contains(&g_array_index(set->ranges, df_set_range_t, i), fv))
+			return true;
+	}
+	return false;
+}
+
+unsigned
+df_set_count_values(const df_set_t *set)
+{
+	return set->values->len;
+}
+
+unsigned
+df_set_count_ranges(const df_set_t *set)
+{
+	return set->ranges->len;
+}
+
+char *
+df_set_tostr(const df_set_t *set)
+{
+	wmem_strbuf_t *buf;
+	const df_set_range_t *range;
+	unsigned shown = 0;
+	char *s1, *s2;
+
+	buf = wmem_strbuf_new(NULL, "{");
+
+	for (unsigned i = 0; i < set->values->len && shown < DF_SET_MAX_DUMP_MEMBERS; i++, shown++) {
+		s1 = fvalue_to_debug_repr(NULL, set->values->pdata[i]);
+		wmem_strbuf_append_printf(buf, "%s%s", shown > 0 ? " " : "", s1);
+		g_free(s1);
+	}
+	for (unsigned i = 0; i < set->ranges->len && shown < DF_SET_MAX_DUMP_MEMBERS; i++, shown++) {
+		range = &g_array_index(set->ranges, df_set_range_t, i);
+		s1 = fvalue_to_debug_repr(NULL, range->low);
+		s2 = fvalue_to_debug_repr(NULL, range->high);
+		wmem_strbuf_append_printf(buf, "%s%s..%s", shown > 0 ? " " : "", s1, s2);
+		g_free(s1);
+		g_free(s2);
+	}
+	if (shown < set->values->len + set->ranges->len) {
+		wmem_strbuf_append_printf(buf, " ...(%u values, %u ranges)",
+					set->values->len, set->ranges->len);
+	}
+	wmem_strbuf_append_c(buf, '}');
+
+	return wmem_strbuf_finalize(buf);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
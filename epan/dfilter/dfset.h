@@ -0,0 +1,62 @@
+/** @file
+ *
+ * Precompiled membership sets for the "in" operator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DFSET_H
+#define DFSET_H
+
+#include <wireshark.h>
+
+#include <epan/ftypes/ftypes.h>
+
+/*
+ * A df_set_t is an immutable set of constant values built once when the
+ * filter is compiled. Discrete members whose equality is exact are kept
+ * in a hash table and ranges of ordered types are kept in a sorted,
+ * non-overlapping interval array, so that testing membership is O(1)
+ * or O(log n) instead of a linear scan over every member.
+ *
+ * Members that cannot be indexed (CIDR networks, floating point values,
+ * ranges of unordered types, ...) are kept in a list and tested one by
+ * one, with the same semantics as the generic "in" implementation.
+ */
+typedef struct _df_set df_set_t;
+
+df_set_t *
+df_set_new(void);
+
+void
+df_set_free(df_set_t *set);
+
+/* Takes ownership of fv. */
+void
+df_set_add(df_set_t *set, fvalue_t *fv);
+
+/* Takes ownership of low and high. */
+void
+df_set_add_range(df_set_t *set, fvalue_t *low, fvalue_t *high);
+
+/* Must be called once after all the members have been added. */
+void
+df_set_finalize(df_set_t *set);
+
+bool
+df_set_contains(const df_set_t *set, const fvalue_t *fv);
+
+unsigned
+df_set_count_values(const df_set_t *set);
+
+unsigned
+df_set_count_ranges(const df_set_t *set);
+
+char *
+df_set_tostr(const df_set_t *set);
+
+#endif
@@ -89,6 +89,9 @@ dfvm_value_free(dfvm_value_t *v)
 		case PCRE:
 			ws_regex_free(v->value.pcre);
 			break;
+		case FVALUE_SET:
+			df_set_free(v->value.set);
+			break;
 		case EMPTY:
 		case HFINFO:
 		case RAW_HFINFO:
@@ -240,6 +243,14 @@ dfvm_value_new_guint(unsigned num)
 	return v;
 }
 
+dfvm_value_t*
+dfvm_value_new_set(df_set_t *set)
+{
+	dfvm_value_t *v = dfvm_value_new(FVALUE_SET);
+	v->value.set = set;
+	return v;
+}
+
 static char *
 dfvm_value_tostr(dfvm_value_t *v)
 {
@@ -279,6 +290,9 @@ dfvm_value_tostr(dfvm_value_t *v)
 		case INSN_NUMBER:
 			s = ws_strdup_printf("INSN(%"PRIu32")", v->value.numeric);
 			break;
+		case FVALUE_SET:
+			s = df_set_tostr(v->value.set);
+			break;
 	}
 	return s;
 }
@@ -551,8 +565,14 @@ append_op_args(wmem_strbuf_t *buf, dfvm_insn_t *insn, GSList **stack_print,
 		case DFVM_SET_ANY_IN:
 		case DFVM_SET_ALL_NOT_IN:
 		case DFVM_SET_ANY_NOT_IN:
-			wmem_strbuf_append_printf(buf, "%s%s",
+			if (arg2) {
+				wmem_strbuf_append_printf(buf, "%s%s in %s",
+						arg1_str, arg1_str_type, arg2_str);
+			}
+			else {
+				wmem_strbuf_append_printf(buf, "%s%s",
 						arg1_str, arg1_str_type);
+			}
 			break;
 
 		case DFVM_SET_ADD:
@@ -1184,28 +1204,41 @@ test_in_internal(fvalue_t *fv, GPtrArray *range[2])
 }
 
 static bool
-any_in(dfilter_t *df, dfvm_value_t *arg1)
+set_stack_contains(dfilter_t *df, fvalue_t *fv)
+{
+	GSList *stack;
+
+	for (stack = df->set_stack; stack != NULL; stack = stack->next) {
+		if (test_in_internal(fv, stack->data)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* The set is either precompiled in arg2 (if all the members are constants)
+ * or was pushed to the set stack by SET_ADD/SET_ADD_RANGE. */
+static inline bool
+set_contains(dfilter_t *df, dfvm_value_t *arg2, fvalue_t *fv)
+{
+	if (arg2) {
+		return df_set_contains(arg2->value.set, fv);
+	}
+	return set_stack_contains(df, fv);
+}
+
+static bool
+any_in(dfilter_t *df, dfvm_value_t *arg1, dfvm_value_t *arg2)
 {
 	df_cell_t *rp = &df->registers[arg1->value.numeric];
 	GPtrArray *value;
-	GSList *stack;
-	bool ok;
 
 	/* If the read failed we jump over the membership test. */
 	ws_assert(!df_cell_is_empty(rp));
 	value = df_cell_ptr(rp);
 
 	for (size_t i = 0; i < value->len; i++) {
-		stack = df->set_stack;
-		ok = false;
-		while (stack) {
-			if (test_in_internal(value->pdata[i], stack->data)) {
-				ok = true;
-				break;
-			}
-			stack = stack->next;
-		}
-		if (ok) {
+		if (set_contains(df, arg2, value->pdata[i])) {
 			return true;
 		}
 	}
@@ -1213,28 +1246,17 @@ any_in(dfilter_t *df, dfvm_value_t *arg1)
 }
 
 static bool
-all_in(dfilter_t *df, dfvm_value_t *arg1)
+all_in(dfilter_t *df, dfvm_value_t *arg1, dfvm_value_t *arg2)
 {
 	df_cell_t *rp = &df->registers[arg1->value.numeric];
 	GPtrArray *value;
-	GSList *stack;
-	bool ok;
 
 	/* If the read failed we jump over the membership test. */
 	ws_assert(!df_cell_is_empty(rp));
 	value = df_cell_ptr(rp);
 
 	for (size_t i = 0; i < value->len; i++) {
-		stack = df->set_stack;
-		ok = false;
-		while (stack) {
-			if (test_in_internal(value->pdata[i], stack->data)) {
-				ok = true;
-				break;
-			}
-			stack = stack->next;
-		}
-		if (!ok) {
+		if (!set_contains(df, arg2, value->pdata[i])) {
 			return false;
 		}
 	}
@@ -1826,19 +1848,19 @@ dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
 				break;
 
 			case DFVM_SET_ALL_IN:
-				accum = all_in(df, arg1);
+				accum = all_in(df, arg1, arg2);
 				break;
 
 			case DFVM_SET_ANY_IN:
-				accum = any_in(df, arg1);
+				accum = any_in(df, arg1, arg2);
 				break;
 
 			case DFVM_SET_ALL_NOT_IN:
-				accum = !all_in(df, arg1);
+				accum = !all_in(df, arg1, arg2);
 				break;
 
 			case DFVM_SET_ANY_NOT_IN:
-				accum = !any_in(df, arg1);
+				accum = !any_in(df, arg1, arg2);
 				break;
 
 			case DFVM_SET_CLEAR:
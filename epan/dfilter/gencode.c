@@ -15,6 +15,7 @@
 #include "sttype-slice.h"
 #include "sttype-op.h"
 #include "sttype-set.h"
+#include "dfset.h"
 #include "sttype-function.h"
 #include "ftypes/ftypes.h"
 #include <wsutil/ws_assert.h>
@@ -459,8 +460,52 @@ fixup_jumps(void *data, void *user_data)
 	}
 }
 
-/* Generate the code for the in operator. Pushes set values into a stack
- * and then evaluates membership in a single instruction. */
+/* True if all the members of the set are constants, so that the set can be
+ * built once at compile time. */
+static bool
+set_is_constant(GSList *nodelist)
+{
+	stnode_t	*node;
+
+	while (nodelist) {
+		node = nodelist->data;
+		if (node && stnode_type_id(node) != STTYPE_FVALUE)
+			return false;
+		nodelist = g_slist_next(nodelist);
+	}
+	return true;
+}
+
+static dfvm_value_t *
+gen_constant_set(GSList *nodelist)
+{
+	df_set_t	*set;
+	stnode_t	*node1, *node2;
+
+	set = df_set_new();
+	while (nodelist) {
+		node1 = nodelist->data;
+		nodelist = g_slist_next(nodelist);
+		node2 = nodelist->data;
+		nodelist = g_slist_next(nodelist);
+
+		if (node2) {
+			/* Range element. */
+			df_set_add_range(set, stnode_steal_data(node1),
+						stnode_steal_data(node2));
+		} else {
+			/* Normal element. */
+			df_set_add(set, stnode_steal_data(node1));
+		}
+	}
+	df_set_finalize(set);
+	return dfvm_value_new_set(set);
+}
+
+/* Generate the code for the in operator. If every set member is a constant
+ * the set is precompiled into an indexed structure that is passed to the
+ * membership instruction. Otherwise pushes set values into a stack and then
+ * evaluates membership in a single instruction. */
 static void
 gen_relation_in(dfwork_t *dfw, dfvm_opcode_t op, stmatch_t how,
 				stnode_t *st_arg1, stnode_t *st_arg2)
@@ -475,8 +520,24 @@ gen_relation_in(dfwork_t *dfw, dfvm_opcode_t op, stmatch_t how,
 	/* Create code for the LHS of the relation */
 	val1 = gen_entity(dfw, st_arg1, &jumps);
 
-	/* Create code to populate the set stack */
 	nodelist_head = nodelist = stnode_steal_data(st_arg2);
+
+	if (set_is_constant(nodelist_head)) {
+		val2 = gen_constant_set(nodelist_head);
+		set_nodelist_free(nodelist_head);
+
+		insn = dfvm_insn_new(select_opcode(op, how));
+		insn->arg1 = dfvm_value_ref(val1);
+		insn->arg2 = dfvm_value_ref(val2);
+		dfw_append_insn(dfw, insn);
+
+		/* Jump here if the LHS entity was not present */
+		g_slist_foreach(jumps, fixup_jumps, dfw);
+		g_slist_free(jumps);
+		return;
+	}
+
+	/* Create code to populate the set stack */
 	while (nodelist) {
 		node1 = nodelist->data;
 		nodelist = g_slist_next(nodelist);
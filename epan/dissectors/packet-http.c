@@ -588,46 +588,43 @@ static tap_packet_status
 http_reqs_stats_tree_packet(stats_tree* st, packet_info* pinfo, epan_dissect_t* edt _U_, const void* p, tap_flags_t flags _U_)
 {
 	const http_info_value_t* v = (const http_info_value_t*)p;
-	int reqs_by_this_host;
-	int reqs_by_this_addr;
-	int resps_by_this_addr;
+	stat_node *reqs_by_this_host;
+	stat_node *reqs_by_this_addr;
+	stat_node *resps_by_this_addr;
+	stat_node *node;
 	int i = v->response_code;
-	gchar *ip_str;
 
 
 	if (v->request_method) {
-		ip_str = address_to_str(NULL, &pinfo->dst);
-
-		tick_stat_node(st, st_str_reqs, 0, false);
-		tick_stat_node(st, st_str_reqs_by_srv_addr, st_node_reqs, true);
-		tick_stat_node(st, st_str_reqs_by_http_host, st_node_reqs, true);
-		reqs_by_this_addr = tick_stat_node(st, ip_str, st_node_reqs_by_srv_addr, true);
+		stats_tree_tick_node(stats_tree_get_node(st, st_node_reqs));
+		node = stats_tree_get_node(st, st_node_reqs_by_srv_addr);
+		stats_tree_tick_node(node);
+		stats_tree_tick_node(stats_tree_get_node(st, st_node_reqs_by_http_host));
+		reqs_by_this_addr = stats_tree_get_addr_node(node, &pinfo->dst, true);
+		stats_tree_tick_node(reqs_by_this_addr);
 
 		if (v->http_host) {
-			reqs_by_this_host = tick_stat_node(st, v->http_host, st_node_reqs_by_http_host, true);
-			tick_stat_node(st, ip_str, reqs_by_this_host, false);
+			reqs_by_this_host = stats_tree_get_node(st,
+				tick_stat_node(st, v->http_host, st_node_reqs_by_http_host, true));
+			stats_tree_tick_node(stats_tree_get_addr_node(reqs_by_this_host, &pinfo->dst, false));
 
-			tick_stat_node(st, v->http_host, reqs_by_this_addr, false);
+			tick_stat_node(st, v->http_host, stats_tree_node_id(reqs_by_this_addr), false);
 		}
 
-		wmem_free(NULL, ip_str);
-
 		return TAP_PACKET_REDRAW;
 
 	} else if (i != 0) {
-		ip_str = address_to_str(NULL, &pinfo->src);
-
-		tick_stat_node(st, st_str_resps_by_srv_addr, 0, false);
-		resps_by_this_addr = tick_stat_node(st, ip_str, st_node_resps_by_srv_addr, true);
+		node = stats_tree_get_node(st, st_node_resps_by_srv_addr);
+		stats_tree_tick_node(node);
+		resps_by_this_addr = stats_tree_get_addr_node(node, &pinfo->src, true);
+		stats_tree_tick_node(resps_by_this_addr);
 
 		if ( (i>=100)&&(i<400) ) {
-			tick_stat_node(st, "OK", resps_by_this_addr, false);
+			stats_tree_tick_node(stats_tree_get_str_node(resps_by_this_addr, "OK", false));
 		} else {
-			tick_stat_node(st, "Error", resps_by_this_addr, false);
+			stats_tree_tick_node(stats_tree_get_str_node(resps_by_this_addr, "Error", false));
 		}
 
-		wmem_free(NULL, ip_str);
-
 		return TAP_PACKET_REDRAW;
 	}
 
@@ -715,39 +712,30 @@ http_stats_tree_packet(stats_tree* st, packet_info* pinfo _U_, epan_dissect_t* e
 	const http_info_value_t* v = (const http_info_value_t*)p;
 	guint i = v->response_code;
 	int resp_grp;
-	const gchar *resp_str;
-	gchar str[64];
+	stat_node *resp_node;
 
-	tick_stat_node(st, st_str_packets, 0, false);
+	stats_tree_tick_node(stats_tree_get_node(st, st_node_packets));
 
 	if (i) {
-		tick_stat_node(st, st_str_responses, st_node_packets, false);
+		stats_tree_tick_node(stats_tree_get_node(st, st_node_responses));
 
 		if ( (i<100)||(i>=600) ) {
 			resp_grp = st_node_resp_broken;
-			resp_str = st_str_resp_broken;
 		} else if (i<200) {
 			resp_grp = st_node_resp_100;
-			resp_str = st_str_resp_100;
 		} else if (i<300) {
 			resp_grp = st_node_resp_200;
-			resp_str = st_str_resp_200;
 		} else if (i<400) {
 			resp_grp = st_node_resp_300;
-			resp_str = st_str_resp_300;
 		} else if (i<500) {
 			resp_grp = st_node_resp_400;
-			resp_str = st_str_resp_400;
 		} else {
 			resp_grp = st_node_resp_500;
-			resp_str = st_str_resp_500;
 		}
 
-		tick_stat_node(st, resp_str, st_node_responses, false);
-
-		snprintf(str, sizeof(str), "%u %s", i,
-			   val_to_str(i, vals_http_status_code, "Unknown (%d)"));
-		tick_stat_node(st, str, resp_grp, false);
+		resp_node = stats_tree_get_node(st, resp_grp);
+		stats_tree_tick_node(resp_node);
+		stats_tree_tick_node(stats_tree_get_int_node(resp_node, i, vals_http_status_code, false));
 	} else if (v->request_method) {
 		stats_tree_tick_pivot(st,st_node_requests,v->request_method);
 	} else {
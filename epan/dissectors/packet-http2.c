@@ -4915,6 +4915,8 @@ proto_register_http2(void)
 
     reassembly_table_register(&http2_body_reassembly_table,
                               &addresses_ports_reassembly_table_functions);
+    /* Bodies can be large and span many DATA frames; don't copy them. */
+    reassembly_table_set_composite(&http2_body_reassembly_table, TRUE);
     reassembly_table_register(&http2_streaming_reassembly_table,
                               &addresses_ports_reassembly_table_functions);
 
@@ -13,6 +13,7 @@
 #include <glib.h>
 
 #include <epan/packet.h>
+#include <wsutil/ws_assert.h>
 
 #include "frame_data_sequence.h"
 
@@ -29,9 +30,51 @@
 #define LOG2_NODES_PER_LEVEL    10
 #define NODES_PER_LEVEL         (1<<LOG2_NODES_PER_LEVEL)
 
+/*
+ * A packed sequence keeps the frames in blocks of NODES_PER_LEVEL frames.
+ * Each block holds the fields of its frames as a stream of variable-length
+ * integers, most of them the difference from the previous frame, so that
+ * a typical frame takes about 16 bytes instead of sizeof(frame_data).
+ * The pointer fields and the time shift are rarely set; they're kept in
+ * per-block arrays that are only allocated once one of the frames in the
+ * block has a value for them.
+ *
+ * frame_data_sequence_find() and frame_data_sequence_add() unpack the
+ * block of the frame into a cache slot and return a pointer into it. The
+ * least recently used slot that isn't pinned is packed back into its block
+ * when another block has to be unpacked, so the pointer is only valid
+ * until frames from FRAME_DATA_CACHE_BLOCKS other blocks are looked up,
+ * unless the frame is pinned with frame_data_sequence_pin(). If all the
+ * slots are pinned, another one is added; slots are never moved or freed
+ * before the sequence is.
+ */
+#define FRAME_DATA_CACHE_BLOCKS 8
+
+typedef struct {
+  guint32      count;           /* Number of frames in the block */
+  guint8      *data;            /* Packed fields */
+  gsize        data_len;
+  GSList     **pfd;             /* Side tables, NULL if unused */
+  GHashTable **dependent_frames;
+  const struct _color_filter **color_filter;
+  nstime_t    *shift_offset;
+} frame_data_block;
+
+typedef struct {
+  guint32      block;           /* Index of the block, or G_MAXUINT32 */
+  guint32      last_used;
+  guint32      pins;            /* Number of pins on frames in the slot */
+  frame_data   frames[NODES_PER_LEVEL];
+} frame_data_cache_slot;
+
 struct _frame_data_sequence {
   guint32      count;           /* Total number of frames */
   void        *ptree_root;      /* Pointer to the root node */
+  /* Only used by packed sequences. */
+  GPtrArray   *blocks;          /* frame_data_block, NULL if not packed */
+  GPtrArray   *cache;           /* frame_data_cache_slot */
+  guint32      cache_clock;
+  GByteArray  *scratch;         /* Used to pack a block */
 };
 
 /*
@@ -52,12 +95,292 @@ new_frame_data_sequence(void)
 {
   frame_data_sequence *fds;
 
-  fds = (frame_data_sequence *)g_malloc(sizeof *fds);
+  fds = g_new0(frame_data_sequence, 1);
   fds->count = 0;
   fds->ptree_root = NULL;
   return fds;
 }
 
+static frame_data_cache_slot *
+new_cache_slot(void)
+{
+  frame_data_cache_slot *slot;
+
+  slot = g_new(frame_data_cache_slot, 1);
+  slot->block = G_MAXUINT32;
+  slot->last_used = 0;
+  slot->pins = 0;
+  return slot;
+}
+
+frame_data_sequence *
+new_packed_frame_data_sequence(void)
+{
+  frame_data_sequence *fds;
+
+  fds = new_frame_data_sequence();
+  fds->blocks = g_ptr_array_new();
+  fds->cache = g_ptr_array_new_with_free_func(g_free);
+  for (guint i = 0; i < FRAME_DATA_CACHE_BLOCKS; i++) {
+    g_ptr_array_add(fds->cache, new_cache_slot());
+  }
+  fds->scratch = g_byte_array_new();
+  return fds;
+}
+
+/*
+ * Bits of the packed flags of a frame. The time stamp precision and the
+ * flags that are usually set come first, so that they fit in one byte.
+ */
+#define PACKED_TSPREC_MASK              0x0000000F
+#define PACKED_HAS_TS                   0x00000010
+#define PACKED_PASSED_DFILTER           0x00000020
+#define PACKED_VISITED                  0x00000040
+#define PACKED_DEPENDENT_OF_DISPLAYED   0x00000080
+#define PACKED_ENCODING                 0x00000100
+#define PACKED_MARKED                   0x00000200
+#define PACKED_REF_TIME                 0x00000400
+#define PACKED_IGNORED                  0x00000800
+#define PACKED_HAS_MODIFIED_BLOCK       0x00001000
+#define PACKED_NEED_COLORIZE            0x00002000
+#define PACKED_TCP_SND_SHIFT            14
+
+static void
+put_varint(GByteArray *buf, guint64 val)
+{
+  guint8 byte;
+
+  while (val >= 0x80) {
+    byte = (guint8)(val | 0x80);
+    g_byte_array_append(buf, &byte, 1);
+    val >>= 7;
+  }
+  byte = (guint8)val;
+  g_byte_array_append(buf, &byte, 1);
+}
+
+static void
+put_svarint(GByteArray *buf, gint64 val)
+{
+  /* Zigzag encoding, so that small negative values stay short. */
+  put_varint(buf, ((guint64)val << 1) ^ (guint64)(val >> 63));
+}
+
+static guint64
+get_varint(const guint8 **p)
+{
+  guint64 val = 0;
+  guint shift = 0;
+
+  while (**p & 0x80) {
+    val |= (guint64)(**p & 0x7f) << shift;
+    shift += 7;
+    (*p)++;
+  }
+  val |= (guint64)**p << shift;
+  (*p)++;
+  return val;
+}
+
+static gint64
+get_svarint(const guint8 **p)
+{
+  guint64 val = get_varint(p);
+
+  return (gint64)(val >> 1) ^ -(gint64)(val & 1);
+}
+
+/* Pack the frames of a cache slot into their block. */
+static void
+pack_block(frame_data_sequence *fds, frame_data_cache_slot *slot)
+{
+  frame_data_block *blk = (frame_data_block *)g_ptr_array_index(fds->blocks, slot->block);
+  const frame_data *fd, *prev = NULL;
+  guint32 flags;
+
+  g_byte_array_set_size(fds->scratch, 0);
+  for (guint32 i = 0; i < blk->count; i++) {
+    fd = &slot->frames[i];
+
+    flags = fd->tsprec |
+      (fd->has_ts ? PACKED_HAS_TS : 0) |
+      (fd->passed_dfilter ? PACKED_PASSED_DFILTER : 0) |
+      (fd->visited ? PACKED_VISITED : 0) |
+      (fd->dependent_of_displayed ? PACKED_DEPENDENT_OF_DISPLAYED : 0) |
+      (fd->encoding ? PACKED_ENCODING : 0) |
+      (fd->marked ? PACKED_MARKED : 0) |
+      (fd->ref_time ? PACKED_REF_TIME : 0) |
+      (fd->ignored ? PACKED_IGNORED : 0) |
+      (fd->has_modified_block ? PACKED_HAS_MODIFIED_BLOCK : 0) |
+      (fd->need_colorize ? PACKED_NEED_COLORIZE : 0) |
+      ((guint32)fd->tcp_snd_manual_analysis << PACKED_TCP_SND_SHIFT);
+    put_varint(fds->scratch, flags);
+    put_varint(fds->scratch, fd->pkt_len);
+    put_svarint(fds->scratch, (gint64)fd->pkt_len - fd->cap_len);
+    put_svarint(fds->scratch, (gint32)(fd->cum_bytes - (prev ? prev->cum_bytes : 0)));
+    put_svarint(fds->scratch, fd->file_off - (prev ? prev->file_off : 0));
+    put_svarint(fds->scratch, (gint64)fd->abs_ts.secs - (prev ? (gint64)prev->abs_ts.secs : 0));
+    put_svarint(fds->scratch, (gint64)fd->abs_ts.nsecs - (prev ? prev->abs_ts.nsecs : 0));
+    put_svarint(fds->scratch, (gint64)fd->frame_ref_num - (prev ? prev->frame_ref_num : 0));
+    put_svarint(fds->scratch, (gint64)fd->num - fd->prev_dis_num);
+
+    if (fd->pfd != NULL && blk->pfd == NULL)
+      blk->pfd = g_new0(GSList *, NODES_PER_LEVEL);
+    if (blk->pfd != NULL)
+      blk->pfd[i] = fd->pfd;
+    if (fd->dependent_frames != NULL && blk->dependent_frames == NULL)
+      blk->dependent_frames = g_new0(GHashTable *, NODES_PER_LEVEL);
+    if (blk->dependent_frames != NULL)
+      blk->dependent_frames[i] = fd->dependent_frames;
+    if (fd->color_filter != NULL && blk->color_filter == NULL)
+      blk->color_filter = g_new0(const struct _color_filter *, NODES_PER_LEVEL);
+    if (blk->color_filter != NULL)
+      blk->color_filter[i] = fd->color_filter;
+    if (!nstime_is_zero(&fd->shift_offset) && blk->shift_offset == NULL)
+      blk->shift_offset = g_new0(nstime_t, NODES_PER_LEVEL);
+    if (blk->shift_offset != NULL)
+      blk->shift_offset[i] = fd->shift_offset;
+
+    prev = fd;
+  }
+
+  g_free(blk->data);
+  blk->data = (guint8 *)g_memdup2(fds->scratch->data, fds->scratch->len);
+  blk->data_len = fds->scratch->len;
+}
+
+/* Unpack a block into a cache slot. */
+static void
+unpack_block(frame_data_sequence *fds, frame_data_cache_slot *slot, guint32 block)
+{
+  frame_data_block *blk = (frame_data_block *)g_ptr_array_index(fds->blocks, block);
+  const guint8 *p = blk->data;
+  frame_data *fd, *prev = NULL;
+  guint32 flags;
+
+  slot->block = block;
+  for (guint32 i = 0; i < blk->count; i++) {
+    fd = &slot->frames[i];
+
+    fd->num = (block << LOG2_NODES_PER_LEVEL) + i + 1;
+    flags = (guint32)get_varint(&p);
+    fd->tsprec = flags & PACKED_TSPREC_MASK;
+    fd->has_ts = (flags & PACKED_HAS_TS) ? 1 : 0;
+    fd->passed_dfilter = (flags & PACKED_PASSED_DFILTER) ? 1 : 0;
+    fd->visited = (flags & PACKED_VISITED) ? 1 : 0;
+    fd->dependent_of_displayed = (flags & PACKED_DEPENDENT_OF_DISPLAYED) ? 1 : 0;
+    fd->encoding = (flags & PACKED_ENCODING) ? 1 : 0;
+    fd->marked = (flags & PACKED_MARKED) ? 1 : 0;
+    fd->ref_time = (flags & PACKED_REF_TIME) ? 1 : 0;
+    fd->ignored = (flags & PACKED_IGNORED) ? 1 : 0;
+    fd->has_modified_block = (flags & PACKED_HAS_MODIFIED_BLOCK) ? 1 : 0;
+    fd->need_colorize = (flags & PACKED_NEED_COLORIZE) ? 1 : 0;
+    fd->tcp_snd_manual_analysis = (guint8)(flags >> PACKED_TCP_SND_SHIFT);
+    fd->pkt_len = (guint32)get_varint(&p);
+    fd->cap_len = (guint32)((gint64)fd->pkt_len - get_svarint(&p));
+    fd->cum_bytes = (prev ? prev->cum_bytes : 0) + (guint32)get_svarint(&p);
+    fd->file_off = (prev ? prev->file_off : 0) + get_svarint(&p);
+    fd->abs_ts.secs = (time_t)((prev ? (gint64)prev->abs_ts.secs : 0) + get_svarint(&p));
+    fd->abs_ts.nsecs = (int)((prev ? prev->abs_ts.nsecs : 0) + get_svarint(&p));
+    fd->frame_ref_num = (guint32)((prev ? prev->frame_ref_num : 0) + get_svarint(&p));
+    fd->prev_dis_num = (guint32)(fd->num - get_svarint(&p));
+
+    fd->pfd = blk->pfd ? blk->pfd[i] : NULL;
+    fd->dependent_frames = blk->dependent_frames ? blk->dependent_frames[i] : NULL;
+    fd->color_filter = blk->color_filter ? blk->color_filter[i] : NULL;
+    if (blk->shift_offset != NULL)
+      fd->shift_offset = blk->shift_offset[i];
+    else
+      nstime_set_zero(&fd->shift_offset);
+
+    prev = fd;
+  }
+}
+
+/* Get the cache slot holding a block, unpacking it if necessary. */
+static frame_data_cache_slot *
+get_cached_block(frame_data_sequence *fds, guint32 block)
+{
+  frame_data_cache_slot *slot, *lru = NULL;
+
+  for (guint i = 0; i < fds->cache->len; i++) {
+    slot = (frame_data_cache_slot *)g_ptr_array_index(fds->cache, i);
+    if (slot->block == block) {
+      slot->last_used = ++fds->cache_clock;
+      return slot;
+    }
+    if (slot->pins != 0)
+      continue;
+    if (lru == NULL || slot->block == G_MAXUINT32 ||
+        (lru->block != G_MAXUINT32 && slot->last_used < lru->last_used))
+      lru = slot;
+  }
+
+  if (lru == NULL) {
+    /* Every slot has pinned frames. */
+    lru = new_cache_slot();
+    g_ptr_array_add(fds->cache, lru);
+  }
+  if (lru->block != G_MAXUINT32)
+    pack_block(fds, lru);
+  unpack_block(fds, lru, block);
+  lru->last_used = ++fds->cache_clock;
+  return lru;
+}
+
+static frame_data *
+packed_frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
+{
+  guint32 block = fds->count >> LOG2_NODES_PER_LEVEL;
+  frame_data_block *blk;
+  frame_data_cache_slot *slot;
+  frame_data *node;
+
+  if (LEAF_INDEX(fds->count) == 0)
+    g_ptr_array_add(fds->blocks, g_new0(frame_data_block, 1));
+  slot = get_cached_block(fds, block);
+  blk = (frame_data_block *)g_ptr_array_index(fds->blocks, block);
+  node = &slot->frames[blk->count];
+  *node = *fdata;
+  blk->count++;
+  fds->count++;
+  return node;
+}
+
+static void
+free_packed_frame_data_sequence(frame_data_sequence *fds)
+{
+  frame_data_block *blk;
+
+  /* Make the blocks up to date, so that the side tables have every
+     pointer we have to free. */
+  for (guint i = 0; i < fds->cache->len; i++) {
+    frame_data_cache_slot *slot = (frame_data_cache_slot *)g_ptr_array_index(fds->cache, i);
+
+    if (slot->block != G_MAXUINT32)
+      pack_block(fds, slot);
+  }
+
+  for (guint i = 0; i < fds->blocks->len; i++) {
+    blk = (frame_data_block *)g_ptr_array_index(fds->blocks, i);
+    for (guint32 j = 0; j < blk->count; j++) {
+      if (blk->pfd && blk->pfd[j])
+        g_slist_free(blk->pfd[j]);
+      if (blk->dependent_frames && blk->dependent_frames[j])
+        g_hash_table_destroy(blk->dependent_frames[j]);
+    }
+    g_free(blk->data);
+    g_free(blk->pfd);
+    g_free(blk->dependent_frames);
+    g_free(blk->color_filter);
+    g_free(blk->shift_offset);
+    g_free(blk);
+  }
+  g_ptr_array_free(fds->blocks, TRUE);
+  g_ptr_array_free(fds->cache, TRUE);
+  g_byte_array_free(fds->scratch, TRUE);
+}
+
 /*
  * Add a new frame_data structure to a frame_data_sequence.
  */
@@ -70,6 +393,9 @@ frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
   frame_data ****level3;
   frame_data *node;
 
+  if (fds->blocks != NULL)
+    return packed_frame_data_sequence_add(fds, fdata);
+
   /*
    * The current value of fds->count is the index value for the new frame,
    * because the index value for a frame is the frame number - 1, and
@@ -195,6 +521,13 @@ frame_data_sequence_find(frame_data_sequence *fds, guint32 num)
     return NULL;
   }
 
+  if (fds->blocks != NULL) {
+    frame_data_cache_slot *slot;
+
+    slot = get_cached_block(fds, num >> LOG2_NODES_PER_LEVEL);
+    return &slot->frames[LEAF_INDEX(num)];
+  }
+
   if (fds->count <= NODES_PER_LEVEL) {
     /* It's a 1-level tree. */
     leaf = (frame_data *)fds->ptree_root;
@@ -284,6 +617,12 @@ free_frame_data_sequence(frame_data_sequence *fds)
 {
   guint   levels;
 
+  if (fds->blocks != NULL) {
+    free_packed_frame_data_sequence(fds);
+    g_free(fds);
+    return;
+  }
+
   /* calculate how many levels we have */
   if (fds->count == 0) {
     /* The tree is empty; there are no levels. */
@@ -314,6 +653,48 @@ free_frame_data_sequence(frame_data_sequence *fds)
   g_free(fds);
 }
 
+/* Get the cache slot holding a frame found in a packed sequence. */
+static frame_data_cache_slot *
+get_pinnable_slot(frame_data_sequence *fds, const frame_data *fdata)
+{
+  frame_data_cache_slot *slot;
+
+  for (guint i = 0; i < fds->cache->len; i++) {
+    slot = (frame_data_cache_slot *)g_ptr_array_index(fds->cache, i);
+    if (fdata >= &slot->frames[0] && fdata < &slot->frames[NODES_PER_LEVEL]) {
+      /* The frame must not have been evicted since it was found. */
+      ws_assert(slot->block == (fdata->num - 1) >> LOG2_NODES_PER_LEVEL);
+      return slot;
+    }
+  }
+  ws_assert_not_reached();
+  return NULL;
+}
+
+/*
+ * Keep a frame_data returned by frame_data_sequence_find() or
+ * frame_data_sequence_add() valid until it's unpinned.
+ */
+void
+frame_data_sequence_pin(frame_data_sequence *fds, const frame_data *fdata)
+{
+  if (fds->blocks == NULL)
+    return;
+  get_pinnable_slot(fds, fdata)->pins++;
+}
+
+void
+frame_data_sequence_unpin(frame_data_sequence *fds, const frame_data *fdata)
+{
+  frame_data_cache_slot *slot;
+
+  if (fds->blocks == NULL)
+    return;
+  slot = get_pinnable_slot(fds, fdata);
+  ws_assert(slot->pins > 0);
+  slot->pins--;
+}
+
 void
 find_and_mark_frame_depended_upon(gpointer key, gpointer value _U_, gpointer user_data)
 {
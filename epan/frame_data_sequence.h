@@ -19,6 +19,20 @@ typedef struct _frame_data_sequence frame_data_sequence;
 
 WS_DLL_PUBLIC frame_data_sequence *new_frame_data_sequence(void);
 
+/*
+ * Create a frame_data_sequence that keeps the frames packed, using a
+ * fraction of the memory. The frame_data pointers returned by
+ * frame_data_sequence_add() and frame_data_sequence_find() for such a
+ * sequence are only valid until frames from a few other blocks of
+ * frames have been looked up, unless they're pinned with
+ * frame_data_sequence_pin(); a frame being dissected must be pinned, as
+ * dissecting it may look up other frames. This is meant for programs
+ * that process the frames in order and keep no pointers to them, such
+ * as the two-pass analysis of TShark and TFShark; the GUI and sharkd,
+ * which keep frame_data pointers, use new_frame_data_sequence().
+ */
+WS_DLL_PUBLIC frame_data_sequence *new_packed_frame_data_sequence(void);
+
 WS_DLL_PUBLIC frame_data *frame_data_sequence_add(frame_data_sequence *fds,
     frame_data *fdata);
 
@@ -28,6 +42,17 @@ WS_DLL_PUBLIC frame_data *frame_data_sequence_add(frame_data_sequence *fds,
 WS_DLL_PUBLIC frame_data *frame_data_sequence_find(frame_data_sequence *fds,
     guint32 num);
 
+/*
+ * Keep a frame_data of a packed sequence valid until it's unpinned; pins
+ * are counted. They do nothing for sequences that aren't packed, whose
+ * frame_data pointers are always valid.
+ */
+WS_DLL_PUBLIC void frame_data_sequence_pin(frame_data_sequence *fds,
+    const frame_data *fdata);
+
+WS_DLL_PUBLIC void frame_data_sequence_unpin(frame_data_sequence *fds,
+    const frame_data *fdata);
+
 /*
  * Free a frame_data_sequence and all the frame_data structures in it.
  */
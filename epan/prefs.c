@@ -3697,11 +3697,12 @@ prefs_register_modules(void)
                                    "To prevent sorting by mistake (which can take some time to calculate), it can be disabled",
                                    &prefs.gui_packet_list_sortable);
 
-    prefs_register_uint_preference(gui_module, "packet_list_cached_rows_max",
-                                   "Maximum cached rows",
-                                   "Maximum number of rows that can be sorted by columns that require dissection. Increasing this increases memory consumption by caching column text",
+    prefs_register_uint_preference(gui_module, "packet_list_cache_size",
+                                   "Packet list cache size (MB)",
+                                   "Maximum amount of memory, in megabytes, used to cache the column text of packet list rows. Increasing this increases memory consumption, but rows that were recently displayed or sorted need not be dissected again",
                                    10,
-                                   &prefs.gui_packet_list_cached_rows_max);
+                                   &prefs.gui_packet_list_cache_size);
+    prefs_register_obsolete_preference(gui_module, "packet_list_cached_rows_max");
 
     prefs_register_bool_preference(gui_module, "interfaces_show_hidden",
                                    "Show hidden interfaces",
@@ -4380,7 +4381,7 @@ pre_init_prefs(void)
     prefs.gui_packet_list_show_related = true;
     prefs.gui_packet_list_show_minimap = true;
     prefs.gui_packet_list_sortable     = true;
-    prefs.gui_packet_list_cached_rows_max = 10000;
+    prefs.gui_packet_list_cache_size = 32;
     g_free (prefs.gui_interfaces_hide_types);
     prefs.gui_interfaces_hide_types = g_strdup("");
     prefs.gui_interfaces_show_hidden = false;
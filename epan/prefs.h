@@ -239,7 +239,7 @@ typedef struct _e_prefs {
   bool         gui_packet_list_show_related;
   bool         gui_packet_list_show_minimap;
   bool         gui_packet_list_sortable;
-  unsigned     gui_packet_list_cached_rows_max;
+  unsigned     gui_packet_list_cache_size; /* MB */
   int          gui_decimal_places1; /* Used for type 1 calculations */
   int          gui_decimal_places2; /* Used for type 2 calculations */
   int          gui_decimal_places3; /* Used for type 3 calculations */
@@ -28,6 +28,7 @@
 #include <epan/print.h>
 #include <epan/charsets.h>
 #include <wsutil/array.h>
+#include <wsutil/arrow_writer.h>
 #include <wsutil/json_dumper.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/utf8_entities.h>
@@ -84,6 +85,9 @@ struct _output_fields {
     gchar         quote;
     gboolean      escape;
     gboolean      includes_col_fields;
+    arrow_writer *arrow;
+    arrow_type   *arrow_types;
+    GPtrArray   **arrow_finfos;
 };
 
 static gchar *get_field_hex_value(GSList *src_list, field_info *fi);
@@ -2062,6 +2066,14 @@ void output_fields_free(output_fields_t* fields)
             g_free(fields->field_values);
         }
 
+        if (NULL != fields->arrow_finfos) {
+            for (i = 0; i < fields->fields->len; ++i) {
+                g_ptr_array_free(fields->arrow_finfos[i], TRUE);
+            }
+            g_free(fields->arrow_finfos);
+            g_free(fields->arrow_types);
+        }
+
         for (i = 0; i < fields->fields->len; ++i) {
             gchar* field = (gchar *)g_ptr_array_index(fields->fields,i);
             g_free(field);
@@ -2481,6 +2493,29 @@ static void proto_tree_get_node_field_values(proto_node *node, gpointer data)
     }
 }
 
+/* Prepare a lookup table from string abbreviation for field to its index. */
+static void output_fields_index(output_fields_t *fields)
+{
+    gsize i;
+
+    if (NULL != fields->field_indicies) {
+        return;
+    }
+    fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
+
+    i = 0;
+    while (i < fields->fields->len) {
+        gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
+        /* Store field indicies +1 so that zero is not a valid value,
+         * and can be distinguished from NULL as a pointer.
+         */
+        ++i;
+        if (proto_registrar_get_byname(field)) {
+            g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
+        }
+    }
+}
+
 static void write_specified_fields(fields_format format, output_fields_t *fields, epan_dissect_t *edt, column_info *cinfo _U_, FILE *fh, json_dumper *dumper)
 {
     gsize     i;
@@ -2500,22 +2535,7 @@ static void write_specified_fields(fields_format format, output_fields_t *fields
     data.fields = fields;
     data.edt = edt;
 
-    if (NULL == fields->field_indicies) {
-        /* Prepare a lookup table from string abbreviation for field to its index. */
-        fields->field_indicies = g_hash_table_new(g_str_hash, g_str_equal);
-
-        i = 0;
-        while (i < fields->fields->len) {
-            gchar *field = (gchar *)g_ptr_array_index(fields->fields, i);
-            /* Store field indicies +1 so that zero is not a valid value,
-             * and can be distinguished from NULL as a pointer.
-             */
-            ++i;
-            if (proto_registrar_get_byname(field)) {
-                g_hash_table_insert(fields->field_indicies, field, GUINT_TO_POINTER(i));
-            }
-        }
-    }
+    output_fields_index(fields);
 
     /* Array buffer to store values for this packet              */
     /*  Allocate an array for the 'GPtrarray *' the first time   */
@@ -2674,6 +2694,274 @@ void write_fields_finale(output_fields_t* fields _U_ , FILE *fh _U_)
     /* Nothing to do */
 }
 
+/*
+ * -T arrow: the fields as the columns of an Apache Arrow stream. Fields
+ * get a column of the type of their values where there is one, and
+ * strings, as printed with -T fields, otherwise. With occurrence=a, a
+ * column holds the list of all the occurrences of the field.
+ */
+static arrow_type ftenum_arrow_type(enum ftenum type, unsigned *byte_width)
+{
+    *byte_width = 0;
+    switch (type) {
+    case FT_BOOLEAN:
+        return ARROW_BOOL;
+    case FT_CHAR:
+    case FT_UINT8:
+        return ARROW_UINT8;
+    case FT_UINT16:
+        return ARROW_UINT16;
+    case FT_UINT24:
+    case FT_UINT32:
+    case FT_FRAMENUM:
+        return ARROW_UINT32;
+    case FT_UINT40:
+    case FT_UINT48:
+    case FT_UINT56:
+    case FT_UINT64:
+        return ARROW_UINT64;
+    case FT_INT8:
+        return ARROW_INT8;
+    case FT_INT16:
+        return ARROW_INT16;
+    case FT_INT24:
+    case FT_INT32:
+        return ARROW_INT32;
+    case FT_INT40:
+    case FT_INT48:
+    case FT_INT56:
+    case FT_INT64:
+        return ARROW_INT64;
+    case FT_FLOAT:
+    case FT_DOUBLE:
+        return ARROW_DOUBLE;
+    case FT_ABSOLUTE_TIME:
+        return ARROW_TIMESTAMP;
+    case FT_RELATIVE_TIME:
+        return ARROW_DURATION;
+    case FT_IPv4:
+        *byte_width = 4;
+        return ARROW_FIXED_BINARY;
+    case FT_IPv6:
+        *byte_width = 16;
+        return ARROW_FIXED_BINARY;
+    case FT_ETHER:
+        *byte_width = FT_ETHER_LEN;
+        return ARROW_FIXED_BINARY;
+    default:
+        return ARROW_STRING;
+    }
+}
+
+/* Fields with the same name must all have the same type to get a column
+ * of that type. Columns and expressions are strings. */
+static arrow_type output_field_arrow_type(const gchar *field, unsigned *byte_width)
+{
+    header_field_info *hfinfo = proto_registrar_get_byname(field);
+    arrow_type type;
+    unsigned width;
+
+    *byte_width = 0;
+    if (!hfinfo) {
+        return ARROW_STRING;
+    }
+    while (hfinfo->same_name_prev_id != -1) {
+        hfinfo = proto_registrar_get_nth(hfinfo->same_name_prev_id);
+    }
+    type = ftenum_arrow_type(hfinfo->type, byte_width);
+    for (hfinfo = hfinfo->same_name_next; hfinfo; hfinfo = hfinfo->same_name_next) {
+        if (ftenum_arrow_type(hfinfo->type, &width) != type || width != *byte_width) {
+            *byte_width = 0;
+            return ARROW_STRING;
+        }
+    }
+    return type;
+}
+
+void write_arrow_preamble(output_fields_t* fields, FILE *fh)
+{
+    gsize i;
+    unsigned byte_width;
+
+    ws_assert(fields);
+    ws_assert(fh);
+    ws_assert(fields->fields);
+
+    output_fields_index(fields);
+    fields->arrow = arrow_writer_new(fh, 0);
+    fields->arrow_types = g_new(arrow_type, fields->fields->len);
+    fields->arrow_finfos = g_new(GPtrArray *, fields->fields->len);
+    for (i = 0; i < fields->fields->len; ++i) {
+        const gchar *field = (const gchar *)g_ptr_array_index(fields->fields, i);
+
+        fields->arrow_types[i] = output_field_arrow_type(field, &byte_width);
+        fields->arrow_finfos[i] = g_ptr_array_new();
+        arrow_writer_add_column(fields->arrow, field, fields->arrow_types[i], byte_width,
+                                fields->occurrence == 'a');
+    }
+}
+
+static void proto_tree_get_node_field_infos(proto_node *node, gpointer data)
+{
+    write_field_data_t *call_data;
+    field_info *fi;
+    gpointer    field_index;
+
+    call_data = (write_field_data_t *)data;
+    fi = PNODE_FINFO(node);
+
+    /* dissection with an invisible proto tree? */
+    ws_assert(fi);
+
+    field_index = g_hash_table_lookup(call_data->fields->field_indicies, fi->hfinfo->abbrev);
+    if (NULL != field_index) {
+        GPtrArray *fv_p = call_data->fields->arrow_finfos[GPOINTER_TO_UINT(field_index) - 1];
+
+        switch (call_data->fields->occurrence) {
+        case 'f':
+            if (g_ptr_array_len(fv_p) == 0) {
+                g_ptr_array_add(fv_p, fi);
+            }
+            break;
+        case 'l':
+            g_ptr_array_set_size(fv_p, 0);
+            g_ptr_array_add(fv_p, fi);
+            break;
+        default:
+            g_ptr_array_add(fv_p, fi);
+            break;
+        }
+    }
+
+    /* Recurse here. */
+    if (node->first_child != NULL) {
+        proto_tree_children_foreach(node, proto_tree_get_node_field_infos,
+                                    call_data);
+    }
+}
+
+static void write_arrow_field_value(output_fields_t *fields, unsigned column, field_info *fi, epan_dissect_t *edt)
+{
+    arrow_writer *writer = fields->arrow;
+    enum ftenum type = fi->hfinfo->type;
+    const nstime_t *ts;
+    guint32 ipv4;
+    gchar *str;
+
+    switch (fields->arrow_types[column]) {
+    case ARROW_INT8:
+    case ARROW_INT16:
+    case ARROW_INT32:
+    case ARROW_INT64:
+        if (FT_IS_INT32(type)) {
+            arrow_writer_append_int(writer, column, fvalue_get_sinteger(fi->value));
+        } else {
+            arrow_writer_append_int(writer, column, fvalue_get_sinteger64(fi->value));
+        }
+        break;
+    case ARROW_UINT8:
+    case ARROW_UINT16:
+    case ARROW_UINT32:
+    case ARROW_UINT64:
+    case ARROW_BOOL:
+        if (FT_IS_UINT32(type)) {
+            arrow_writer_append_uint(writer, column, fvalue_get_uinteger(fi->value));
+        } else {
+            arrow_writer_append_uint(writer, column, fvalue_get_uinteger64(fi->value));
+        }
+        break;
+    case ARROW_DOUBLE:
+        arrow_writer_append_double(writer, column, fvalue_get_floating(fi->value));
+        break;
+    case ARROW_TIMESTAMP:
+    case ARROW_DURATION:
+        ts = fvalue_get_time(fi->value);
+        arrow_writer_append_int(writer, column, (int64_t)ts->secs * 1000000000 + ts->nsecs);
+        break;
+    case ARROW_FIXED_BINARY:
+        switch (type) {
+        case FT_IPv4:
+            ipv4 = g_htonl(fvalue_get_ipv4(fi->value)->addr);
+            arrow_writer_append_bytes(writer, column, (const uint8_t *)&ipv4);
+            break;
+        case FT_IPv6:
+            arrow_writer_append_bytes(writer, column, fvalue_get_ipv6(fi->value)->addr.bytes);
+            break;
+        default:
+            arrow_writer_append_bytes(writer, column, (const uint8_t *)fvalue_get_bytes_data(fi->value));
+            break;
+        }
+        break;
+    case ARROW_STRING:
+        str = get_node_field_value(fi, edt);
+        if (str) {
+            arrow_writer_append_string(writer, column, str);
+            g_free(str);
+        }
+        break;
+    }
+}
+
+void write_arrow_proto_tree(output_fields_t* fields, epan_dissect_t *edt, column_info *cinfo _U_, FILE *fh _U_)
+{
+    write_field_data_t data;
+    gsize i;
+
+    ws_assert(fields);
+    ws_assert(fields->arrow);
+    ws_assert(edt);
+
+    for (i = 0; i < fields->fields->len; ++i) {
+        dfilter_t *dfilter = (dfilter_t *)g_ptr_array_index(fields->field_dfilters, i);
+
+        if (dfilter != NULL) {
+            GPtrArray *fvals = NULL;
+            bool passed = dfilter_apply_full(dfilter, edt->tree, &fvals);
+            char *str;
+            if (fvals != NULL) {
+                int len = g_ptr_array_len(fvals);
+                int first = fields->occurrence == 'l' ? len - 1 : 0;
+                for (int j = first; j < len; ++j) {
+                    str = fvalue_to_string_repr(NULL, fvals->pdata[j], FTREPR_DISPLAY, BASE_NONE);
+                    arrow_writer_append_string(fields->arrow, (unsigned)i, str);
+                    wmem_free(NULL, str);
+                }
+                g_ptr_array_unref(fvals);
+            } else if (passed) {
+                arrow_writer_append_string(fields->arrow, (unsigned)i, UTF8_CHECK_MARK);
+            }
+        }
+    }
+
+    data.fields = fields;
+    data.edt = edt;
+    proto_tree_children_foreach(edt->tree, proto_tree_get_node_field_infos,
+                                &data);
+
+    for (i = 0; i < fields->fields->len; ++i) {
+        GPtrArray *fv_p = fields->arrow_finfos[i];
+
+        for (guint j = 0; j < g_ptr_array_len(fv_p); j++) {
+            write_arrow_field_value(fields, (unsigned)i, (field_info *)g_ptr_array_index(fv_p, j), edt);
+        }
+        g_ptr_array_set_size(fv_p, 0);  /* get ready for the next packet */
+    }
+    arrow_writer_end_row(fields->arrow);
+}
+
+bool write_arrow_finale(output_fields_t* fields, FILE *fh _U_)
+{
+    bool ok = true;
+
+    ws_assert(fields);
+
+    if (fields->arrow) {
+        ok = arrow_writer_finish(fields->arrow);
+        fields->arrow = NULL;
+    }
+    return ok;
+}
+
 /* Returns an g_malloced string */
 gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
 {
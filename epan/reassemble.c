@@ -351,7 +351,7 @@ free_all_fragments(gpointer key_arg _U_, gpointer value, gpointer user_data _U_)
 }
 
 /* ------------------------- */
-static fragment_head *new_head(const guint32 flags)
+static fragment_head *new_head(const reassembly_table *table, const guint32 flags)
 {
 	fragment_head *fd_head;
 	/* If head/first structure in list only holds no other data than
@@ -361,6 +361,8 @@ static fragment_head *new_head(const guint32 flags)
 	fd_head=g_slice_new0(fragment_head);
 
 	fd_head->flags=flags;
+	if (table->composite)
+		fd_head->flags |= FD_COMPOSITE_TVB;
 	return fd_head;
 }
 
@@ -457,6 +459,14 @@ reassembly_table_register(reassembly_table *table,
 	reassembly_table_list = g_list_prepend(reassembly_table_list, reg_table);
 }
 
+void
+reassembly_table_set_composite(reassembly_table *table, gboolean composite)
+{
+	DISSECTOR_ASSERT(table);
+
+	table->composite = composite;
+}
+
 /*
  * Initialize a reassembly table, with specified functions.
  */
@@ -1173,6 +1183,31 @@ MERGE_FRAG(fragment_head *fd_head, fragment_item *fd)
 	update_first_gap(fd_head, inserted, multi_insert);
 }
 
+/*
+ * Add length bytes of a fragment's data, from offset on, to the composite
+ * tvbuff holding a reassembly's data. The composite takes the fragment's
+ * data over if all of it is used and it isn't a subset of data that may go
+ * away; otherwise that part of it is copied.
+ */
+static void
+fragment_composite_add(tvbuff_t *composite, fragment_item *fd_i,
+		       const guint32 offset, const guint32 length)
+{
+	if (offset == 0 && length == tvb_captured_length(fd_i->tvb_data) &&
+	    !(fd_i->flags & FD_SUBSET_TVB)) {
+		tvb_composite_append_chain(composite, fd_i->tvb_data);
+		fd_i->tvb_data = NULL;
+	} else {
+		tvb_composite_append_chain(composite,
+		    tvb_clone_offset_len(fd_i->tvb_data, offset, length));
+	}
+}
+
+typedef struct {
+	fragment_item *fd;
+	guint32 cmp_len;
+} fragment_overlap_t;
+
 /*
  * This function adds a new fragment to the fragment hash table.
  * If this is the first fragment seen for this datagram, a new entry
@@ -1205,6 +1240,8 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	guint32 dfpos, fraglen, overlap;
 	tvbuff_t *old_tvb_data;
 	guint8 *data;
+	gboolean composite;
+	GArray *overlaps = NULL;
 
 	/* create new fd describing this fragment */
 	fd = g_slice_new(fragment_item);
@@ -1377,9 +1414,17 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
-	data = (guint8 *) g_malloc(fd_head->datalen);
-	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	composite = (fd_head->flags & FD_COMPOSITE_TVB) && fd_head->datalen != 0;
+	if (composite) {
+		/* The data is checked for overlap conflicts once it's all there. */
+		data = NULL;
+		overlaps = g_array_new(FALSE, FALSE, sizeof(fragment_overlap_t));
+		fd_head->tvb_data = tvb_new_composite();
+	} else {
+		data = (guint8 *) g_malloc(fd_head->datalen);
+		fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+	}
 
 	/* add all data fragments */
 	for (dfpos=0,fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
@@ -1459,7 +1504,10 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 
 					fd_i->flags    |= FD_OVERLAP;
 					fd_head->flags |= FD_OVERLAP;
-					if ( memcmp(data + fd_i->offset,
+					if (composite) {
+						fragment_overlap_t ov = { fd_i, cmp_len };
+						g_array_append_val(overlaps, ov);
+					} else if ( memcmp(data + fd_i->offset,
 							tvb_get_ptr(fd_i->tvb_data, 0, cmp_len),
 							cmp_len)
 							 ) {
@@ -1487,13 +1535,22 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 				 * out rather than mixed with the new ones?
 				 */
 				if (fd_i->offset + fraglen > dfpos) {
-					memcpy(data+dfpos,
-						tvb_get_ptr(fd_i->tvb_data, overlap, fraglen-overlap),
-						fraglen-overlap);
+					if (composite)
+						fragment_composite_add(fd_head->tvb_data, fd_i,
+							overlap, fraglen-overlap);
+					else
+						memcpy(data+dfpos,
+							tvb_get_ptr(fd_i->tvb_data, overlap, fraglen-overlap),
+							fraglen-overlap);
 					dfpos = fd_i->offset + fraglen;
 				}
 			}
 
+			/* Keep the data of overlapping fragments until it's been compared. */
+			if (composite && overlaps->len != 0 &&
+			    g_array_index(overlaps, fragment_overlap_t, overlaps->len - 1).fd == fd_i)
+				continue;
+
 			if (fd_i->flags & FD_SUBSET_TVB)
 				fd_i->flags &= ~FD_SUBSET_TVB;
 			else if (fd_i->tvb_data)
@@ -1503,6 +1560,37 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		}
 	}
 
+	if (composite) {
+		if (dfpos == 0) {
+			/* Nothing could be added; see the errors above. */
+			tvb_free(fd_head->tvb_data);
+			fd_head->tvb_data = tvb_new_real_data(NULL, 0, 0);
+		} else {
+			tvb_composite_finalize(fd_head->tvb_data);
+		}
+
+		/* Compare the overlapping parts without flattening the composite. */
+		for (guint i = 0; i < overlaps->len; i++) {
+			fragment_overlap_t *ov = &g_array_index(overlaps, fragment_overlap_t, i);
+			fd_i = ov->fd;
+
+			data = (guint8 *) tvb_memdup(NULL, fd_head->tvb_data, fd_i->offset, ov->cmp_len);
+			if (tvb_memeql(fd_i->tvb_data, 0, data, ov->cmp_len)) {
+				fd_i->flags    |= FD_OVERLAPCONFLICT;
+				fd_head->flags |= FD_OVERLAPCONFLICT;
+			}
+			wmem_free(NULL, data);
+
+			if (fd_i->flags & FD_SUBSET_TVB)
+				fd_i->flags &= ~FD_SUBSET_TVB;
+			else if (fd_i->tvb_data)
+				tvb_free(fd_i->tvb_data);
+
+			fd_i->tvb_data=NULL;
+		}
+		g_array_free(overlaps, TRUE);
+	}
+
 	if (old_tvb_data)
 		tvb_add_to_chain(tvb, old_tvb_data);
 	/* mark this packet as defragmented.
@@ -1688,7 +1776,7 @@ fragment_add_common(reassembly_table *table, tvbuff_t *tvb, const int offset,
 		/* not found, this must be the first snooped fragment for this
 		 * packet. Create list-head.
 		 */
-		fd_head = new_head(0);
+		fd_head = new_head(table, 0);
 
 		/*
 		 * Insert it into the hash table.
@@ -1802,7 +1890,7 @@ fragment_add_check_with_fallback(reassembly_table *table, tvbuff_t *tvb, const i
 		/* not found, this must be the first snooped fragment for this
 		 * packet. Create list-head.
 		 */
-		fd_head = new_head(0);
+		fd_head = new_head(table, 0);
 
 		/*
 		 * Save the key, for unhashing it later.
@@ -1867,7 +1955,9 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 	fragment_item *last_fd = NULL;
 	guint32  dfpos = 0, size = 0;
 	tvbuff_t *old_tvb_data = NULL;
-	guint8 *data;
+	tvbuff_t *last_data = NULL;
+	guint8 *data = NULL;
+	gboolean composite;
 
 	for(fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
 		if(!last_fd || last_fd->offset!=fd_i->offset){
@@ -1878,9 +1968,14 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 
 	/* store old data in case the fd_i->data pointers refer to it */
 	old_tvb_data=fd_head->tvb_data;
-	data = (guint8 *) g_malloc(size);
-	fd_head->tvb_data = tvb_new_real_data(data, size, size);
-	tvb_set_free_cb(fd_head->tvb_data, g_free);
+	composite = (fd_head->flags & FD_COMPOSITE_TVB) && size != 0;
+	if (composite) {
+		fd_head->tvb_data = tvb_new_composite();
+	} else {
+		data = (guint8 *) g_malloc(size);
+		fd_head->tvb_data = tvb_new_real_data(data, size, size);
+		tvb_set_free_cb(fd_head->tvb_data, g_free);
+	}
 	fd_head->len = size;		/* record size for caller	*/
 
 	/* add all data fragments */
@@ -1889,21 +1984,30 @@ fragment_defragment_and_free (fragment_head *fd_head, const packet_info *pinfo)
 		if (fd_i->len) {
 			if(!last_fd || last_fd->offset != fd_i->offset) {
 				/* First fragment or in-sequence fragment */
-				memcpy(data+dfpos, tvb_get_ptr(fd_i->tvb_data, 0, fd_i->len), fd_i->len);
+				last_data = fd_i->tvb_data;
+				if (composite)
+					fragment_composite_add(fd_head->tvb_data, fd_i, 0, fd_i->len);
+				else
+					memcpy(data+dfpos, tvb_get_ptr(fd_i->tvb_data, 0, fd_i->len), fd_i->len);
 				dfpos += fd_i->len;
 			} else {
 				/* duplicate/retransmission/overlap */
 				fd_i->flags    |= FD_OVERLAP;
 				fd_head->flags |= FD_OVERLAP;
+				/* The earlier fragment's data may belong to the composite
+				 * by now, but it's still there. */
 				if(last_fd->len != fd_i->len
-				   || tvb_memeql(last_fd->tvb_data, 0, tvb_get_ptr(fd_i->tvb_data, 0, last_fd->len), last_fd->len) ) {
+				   || tvb_memeql(last_data, 0, tvb_get_ptr(fd_i->tvb_data, 0, last_fd->len), last_fd->len) ) {
 					fd_i->flags    |= FD_OVERLAPCONFLICT;
 					fd_head->flags |= FD_OVERLAPCONFLICT;
 				}
+				last_data = fd_i->tvb_data;
 			}
 		}
 		last_fd=fd_i;
 	}
+	if (composite)
+		tvb_composite_finalize(fd_head->tvb_data);
 
 	/* we have defragmented the pdu, now free all fragments*/
 	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
@@ -2211,7 +2315,7 @@ fragment_add_seq_common(reassembly_table *table, tvbuff_t *tvb,
 		/* not found, this must be the first snooped fragment for this
 		 * packet. Create list-head.
 		 */
-		fd_head= new_head(FD_BLOCKSEQUENCE);
+		fd_head= new_head(table, FD_BLOCKSEQUENCE);
 
 		if((flags & (REASSEMBLE_FLAGS_NO_FRAG_NUMBER|REASSEMBLE_FLAGS_802_11_HACK))
 		   && !more_frags) {
@@ -2515,7 +2619,7 @@ fragment_add_seq_single_work(reassembly_table *table, tvbuff_t *tvb,
 		}
 		if (fh == NULL) {
 			/* Not found. Create list-head. */
-			fh = new_head(FD_BLOCKSEQUENCE);
+			fh = new_head(table, FD_BLOCKSEQUENCE);
 			insert_fd_head(table, fh, pinfo, id-frag_number, data);
 		}
 		/* As this is the first fragment, we might have added segments
@@ -2601,7 +2705,7 @@ fragment_add_seq_single_work(reassembly_table *table, tvbuff_t *tvb,
 		if (fh == NULL) { /* Didn't find location, use default */
 			frag_number = 1;
 			/* Already looked for frag_number 1, so just create */
-			fh = new_head(FD_BLOCKSEQUENCE);
+			fh = new_head(table, FD_BLOCKSEQUENCE);
 			insert_fd_head(table, fh, pinfo, id-frag_number, data);
 		}
 	}
@@ -2648,7 +2752,7 @@ fragment_add_seq_single_work(reassembly_table *table, tvbuff_t *tvb,
 			new_fh = lookup_fd_head(table, pinfo, id+1, data, NULL);
 			if (new_fh==NULL) {
 				/* Not found. Create list-head. */
-				new_fh = new_head(FD_BLOCKSEQUENCE);
+				new_fh = new_head(table, FD_BLOCKSEQUENCE);
 				insert_fd_head(table, new_fh, pinfo, id+1, data);
 			}
 			tmp_offset = 0;
@@ -2767,6 +2871,8 @@ fragment_start_seq_check(reassembly_table *table, const packet_info *pinfo,
 		fd_head->reassembled_in = 0;
 		fd_head->reas_in_layer_num = 0;
 		fd_head->flags = FD_BLOCKSEQUENCE|FD_DATALEN_SET;
+		if (table->composite)
+			fd_head->flags |= FD_COMPOSITE_TVB;
 		fd_head->tvb_data = NULL;
 		fd_head->error = NULL;
 
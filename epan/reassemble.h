@@ -49,6 +49,11 @@
  */
 #define FD_DATALEN_SET		0x0400
 
+/* only in fd_head: the reassembled data is a composite tvbuff holding the
+ * fragments' data, rather than a copy of it (see reassembly_table_set_composite())
+ */
+#define FD_COMPOSITE_TVB	0x0800
+
 typedef struct _fragment_item {
 	struct _fragment_item *next;
 	guint32 frame;			/**< frame number where the fragment is from */
@@ -141,6 +146,7 @@ typedef struct {
 	fragment_temporary_key temporary_key_func;
 	fragment_persistent_key persistent_key_func;
 	GDestroyNotify free_temporary_key_func;		/* temporary key destruction function */
+	gboolean composite;				/* reassemble into composite tvbuffs */
 } reassembly_table;
 
 /*
@@ -173,6 +179,19 @@ WS_DLL_PUBLIC void
 reassembly_table_register(reassembly_table *table,
 		      const reassembly_table_functions *funcs);
 
+/*
+ * Have the reassemblies of a table, once complete, hold their data as a
+ * composite tvbuff of the fragments' data instead of copying it into a
+ * single buffer. This saves a copy of the data, and the time to make it,
+ * for large reassemblies, but getting a pointer to a range of the
+ * reassembled data that spans fragments (e.g. with tvb_get_ptr()) makes
+ * that copy after all, so it suits dissectors that read the reassembled
+ * data piecemeal or hand it on as a tvbuff. A copy made while dissecting
+ * a packet is freed at the end of that packet.
+ */
+WS_DLL_PUBLIC void
+reassembly_table_set_composite(reassembly_table *table, gboolean composite);
+
 /*
  * Initialize/destroy a reassembly table.
  *
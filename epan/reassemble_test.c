@@ -104,6 +104,7 @@ static struct _fd_flags {
     {FD_OVERLAPCONFLICT      ,"OC"},
     {FD_MULTIPLETAILS        ,"MT"},
     {FD_TOOLONGFRAGMENT      ,"TL"},
+    {FD_COMPOSITE_TVB        ,"CT"},
 };
 #define N_FD_FLAGS array_length(fd_flags)
 
@@ -2332,6 +2333,158 @@ test_fragment_add_duplicate_conflict(void)
     }
 }
 
+/* Test case for fragment_add with a table that reassembles into composite
+ * tvbuffs. Adds overlapping fragments, one of them conflicting, and checks
+ * that the fragments' data is taken over and reassembled correctly.
+ */
+/*   visit  id  frame  frag_offset  len  more  tvb_offset
+       0    12     1       0        50   T      10
+       0    12     2       0        20   T       0
+       0    12     3      40        30   T      50
+       0    12     4      70        40   F       5
+*/
+static void
+test_fragment_add_composite(void)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+
+    printf("Starting test test_fragment_add_composite\n");
+
+    reassembly_table_set_composite(&test_reassembly_table, TRUE);
+
+    pinfo.num = 1;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                         0, 50, TRUE);
+
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    /* A conflicting copy of the start of the 1st segment */
+    pinfo.num = 2;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 0, &pinfo, 12, NULL,
+                         0, 20, TRUE);
+
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    /* A segment overlapping the end of the 1st one with the same data */
+    pinfo.num = 3;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 50, &pinfo, 12, NULL,
+                         40, 30, TRUE);
+
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    /* finally, add the last fragment */
+    pinfo.num = 4;
+    fd_head=fragment_add(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
+                         70, 40, FALSE);
+
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_NE_POINTER(NULL,fd_head);
+
+    /* check the contents of the structure */
+    ASSERT_EQ(4,fd_head->frame);  /* max frame we have */
+    ASSERT_EQ(110,fd_head->datalen);
+    ASSERT_EQ(4,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_OVERLAP|FD_OVERLAPCONFLICT|FD_COMPOSITE_TVB,fd_head->flags);
+    ASSERT_NE_POINTER(NULL,fd_head->tvb_data);
+    ASSERT_EQ(110,tvb_captured_length(fd_head->tvb_data));
+
+    fd = fd_head->next;
+    ASSERT_EQ(1,fd->frame);
+    ASSERT_EQ(0,fd->flags);
+    ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+
+    fd = fd->next;
+    ASSERT_EQ(2,fd->frame);
+    ASSERT_EQ(FD_OVERLAP|FD_OVERLAPCONFLICT,fd->flags);
+    ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+
+    fd = fd->next;
+    ASSERT_EQ(3,fd->frame);
+    ASSERT_EQ(FD_OVERLAP,fd->flags);
+    ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+
+    fd = fd->next;
+    ASSERT_EQ(4,fd->frame);
+    ASSERT_EQ(0,fd->flags);
+    ASSERT_EQ_POINTER(NULL,fd->tvb_data);
+    ASSERT_EQ_POINTER(NULL,fd->next);
+
+    /* test the actual reassembly */
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,data+10,50));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,50,data+60,20));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,70,data+5,40));
+
+    if (debug) {
+        print_fragment_table();
+    }
+
+    reassembly_table_set_composite(&test_reassembly_table, FALSE);
+}
+
+/* Test case for fragment_add_seq with a table that reassembles into
+ * composite tvbuffs, with a duplicated fragment.
+ */
+/*   visit  id  frame  frag  len  more  tvb_offset
+       0    12     1     0    50   T      10
+       0    12     2     1    60   T      5
+       0    12     3     1    60   T      5
+       0    12     4     2    40   F      5
+*/
+static void
+test_fragment_add_seq_composite(void)
+{
+    fragment_head *fd_head;
+
+    printf("Starting test test_fragment_add_seq_composite\n");
+
+    reassembly_table_set_composite(&test_reassembly_table, TRUE);
+
+    pinfo.num = 1;
+    fd_head=fragment_add_seq(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
+                             0, 50, TRUE, 0);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 2;
+    fd_head=fragment_add_seq(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
+                             1, 60, TRUE, 0);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 3;
+    fd_head=fragment_add_seq(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
+                             1, 60, TRUE, 0);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 4;
+    fd_head=fragment_add_seq(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
+                             2, 40, FALSE, 0);
+
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_NE_POINTER(NULL,fd_head);
+
+    /* check the contents of the structure */
+    ASSERT_EQ(150,fd_head->len); /* the length of data we have */
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_BLOCKSEQUENCE|FD_DATALEN_SET|FD_OVERLAP|FD_COMPOSITE_TVB,fd_head->flags);
+    ASSERT_EQ(150,tvb_captured_length(fd_head->tvb_data));
+    ASSERT_EQ(FD_OVERLAP,fd_head->next->next->next->flags);
+    ASSERT_EQ_POINTER(NULL,fd_head->next->tvb_data);
+    ASSERT_EQ_POINTER(NULL,fd_head->next->next->next->tvb_data);
+
+    /* test the actual reassembly */
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,data+10,50));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,50,data+5,60));
+    ASSERT(!tvb_memeql(fd_head->tvb_data,110,data+5,40));
+
+    if (debug) {
+        print_fragment_table();
+    }
+
+    reassembly_table_set_composite(&test_reassembly_table, FALSE);
+}
+
 /**********************************************************************************
  *
  * fragment_add_check
@@ -3241,6 +3394,8 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_duplicate_middle,
         test_fragment_add_duplicate_last,
         test_fragment_add_duplicate_conflict,
+        test_fragment_add_composite,
+        test_fragment_add_seq_composite,
         test_simple_fragment_add_check,              /* frag table only   */
 #if 0
         test_fragment_add_check_partial_reassembly,
@@ -25,6 +25,7 @@
 
 #include <epan/stats_tree_priv.h>
 #include <epan/prefs.h>
+#include <epan/to_str.h>
 #include <math.h>
 #include <string.h>
 
@@ -48,6 +49,26 @@ enum _stat_tree_columns {
 /* used to contain the registered stat trees */
 static GHashTable *registry;
 
+/* A counter update made by a packet callback while stats_tree_snapshot()
+ * runs it. Nodes are still looked up and created on the dissection thread,
+ * so that the callback gets its node ids back; only the counting is left
+ * to stats_tree_consume(). */
+typedef struct {
+    stat_node *node;
+    manip_node_mode mode;
+    bool is_float;
+    union {
+        int int_value;
+        float float_value;
+    } value;
+} st_update_t;
+
+typedef struct {
+    tap_packet_status status;
+    double now;
+    GArray *updates;
+} st_record_t;
+
 /* a text representation of a node
 if buffer is NULL returns a newly allocated string */
 extern char*
@@ -92,6 +113,22 @@ stats_tree_branch_max_namelen(const stat_node *node, unsigned indent)
     return maxlen;
 }
 
+/* frees the indexes of the children of a node by typed key */
+static void
+free_stat_node_indexes(stat_node *node)
+{
+    if (node->int_hash) g_hash_table_destroy(node->int_hash);
+    if (node->addr_hash) g_hash_table_destroy(node->addr_hash);
+    if (node->str_hash) g_hash_table_destroy(node->str_hash);
+    g_free(node->int_children);
+    node->int_hash = NULL;
+    node->addr_hash = NULL;
+    node->str_hash = NULL;
+    node->int_children = NULL;
+    node->int_children_len = 0;
+    node->int_children_count = 0;
+}
+
 /* frees the resources allocated by a stat_tree node */
 static void
 // NOLINTNEXTLINE(misc-no-recursion)
@@ -111,6 +148,8 @@ free_stat_node(stat_node *node)
     }
 
     if (node->hash) g_hash_table_destroy(node->hash);
+    free_stat_node_indexes(node);
+    free_address(&node->addr_key);
 
     while (node->bh) {
         bucket = node->bh;
@@ -142,6 +181,7 @@ stats_tree_free(stats_tree *st)
         next = child->next;
         free_stat_node(child);
     }
+    free_stat_node_indexes(&st->root);
 
     if (st->cfg->free_tree_pr)
         st->cfg->free_tree_pr(st);
@@ -222,6 +262,7 @@ stats_tree_reinit(void *p)
     }
 
     st->root.children = NULL;
+    free_stat_node_indexes(&st->root);
     st->root.counter = 0;
     switch (st->root.datatype)
     {
@@ -574,7 +615,7 @@ stats_tree_create_node_by_pname(stats_tree *st, const char *name,
 
 /* Internal function to update the burst calculation data - add entry to bucket */
 static void
-update_burst_calc(stat_node *node, int value)
+update_burst_calc(stat_node *node, double now, int value)
 {
     double current_bucket;
     double burstwin;
@@ -587,14 +628,14 @@ update_burst_calc(stat_node *node, int value)
 
     /* NB thebucket list should always contain at least one node - even if it is */
     /* the dummy created at init time. Head and tail should never be NULL!       */
-    current_bucket = floor(node->st->now/prefs.st_burst_resolution);
+    current_bucket = floor(now/prefs.st_burst_resolution);
     burstwin = prefs.st_burst_windowlen/prefs.st_burst_resolution;
     if (current_bucket>node->bt->bucket_no) {
         /* Must add a new bucket at the burst list tail */
         bn = g_new0(burst_bucket, 1);
         bn->count = value;
         bn->bucket_no = current_bucket;
-        bn->start_time = node->st->now;
+        bn->start_time = now;
         bn->prev = node->bt;
         node->bt->next = bn;
         node->bt = bn;
@@ -617,7 +658,7 @@ update_burst_calc(stat_node *node, int value)
             bn = g_new0(burst_bucket, 1);
             bn->count = value;
             bn->bucket_no = current_bucket;
-            bn->start_time = node->st->now;
+            bn->start_time = now;
             bn->next = node->bh;
             node->bh->prev = bn;
             node->bh = bn;
@@ -635,8 +676,8 @@ update_burst_calc(stat_node *node, int value)
         if (current_bucket==search->bucket_no) {
             /* found existing bucket, increase value */
             search->count += value;
-            if (search->start_time>node->st->now) {
-                search->start_time = node->st->now;
+            if (search->start_time>now) {
+                search->start_time = now;
             }
         }
         else {
@@ -644,7 +685,7 @@ update_burst_calc(stat_node *node, int value)
             bn = g_new0(burst_bucket, 1);
             bn->count = value;
             bn->bucket_no = current_bucket;
-            bn->start_time = node->st->now;
+            bn->start_time = now;
             bn->prev = search;
             bn->next = search->next;
             search->next = bn;
@@ -685,17 +726,28 @@ stats_tree_manip_node_int(manip_node_mode mode, stats_tree *st, const char *name
     if ( node == NULL )
         node = new_stat_node(st,name,parent_id,STAT_DT_INT,with_hash,with_hash);
 
+    stats_tree_node_manip_int(mode, node, value);
+
+    if (node)
+        return node->id;
+    else
+        return -1;
+}
+
+static void
+node_manip_int(stat_node *node, double now, manip_node_mode mode, int value)
+{
     switch (mode) {
         case MN_INCREASE:
             node->counter += value;
-            update_burst_calc(node, value);
+            update_burst_calc(node, now, value);
             break;
         case MN_SET:
             node->counter = value;
             break;
         case MN_AVERAGE:
             node->counter++;
-            update_burst_calc(node, 1);
+            update_burst_calc(node, now, 1);
             /* fall through */ /*to average code */
         case MN_AVERAGE_NOTICK:
             node->total.int_total += value;
@@ -714,11 +766,101 @@ stats_tree_manip_node_int(manip_node_mode mode, stats_tree *st, const char *name
             node->st_flags &= ~value;
             break;
     }
+}
 
-    if (node)
-        return node->id;
-    else
-        return -1;
+static void
+node_manip_float(stat_node *node, double now, manip_node_mode mode, float value)
+{
+    switch (mode) {
+    case MN_AVERAGE:
+        node->counter++;
+        update_burst_calc(node, now, 1);
+        /* fall through */ /*to average code */
+    case MN_AVERAGE_NOTICK:
+        node->total.float_total += value;
+        if (node->minvalue.float_min > value) {
+            node->minvalue.float_min = value;
+        }
+        if (node->maxvalue.float_max < value) {
+            node->maxvalue.float_max = value;
+        }
+        node->st_flags |= ST_FLG_AVERAGE;
+        break;
+    default:
+        //only average is currently supported
+        ws_assert_not_reached();
+        break;
+    }
+}
+
+void
+stats_tree_node_manip_int(manip_node_mode mode, stat_node *node, int value)
+{
+    if (node->st->updates) {
+        st_update_t update = { node, mode, false, { .int_value = value } };
+        g_array_append_val(node->st->updates, update);
+    } else {
+        node_manip_int(node, node->st->now, mode, value);
+    }
+}
+
+static void
+stats_tree_node_manip_float(manip_node_mode mode, stat_node *node, float value)
+{
+    if (node->st->updates) {
+        st_update_t update = { node, mode, true, { .float_value = value } };
+        g_array_append_val(node->st->updates, update);
+    } else {
+        node_manip_float(node, node->st->now, mode, value);
+    }
+}
+
+extern void *
+stats_tree_snapshot(void *p, packet_info *pinfo, epan_dissect_t *edt, const void *pri, tap_flags_t flags)
+{
+    stats_tree *st = (stats_tree *)p;
+    st_record_t *record;
+    tap_packet_status status;
+
+    st->updates = g_array_new(false, false, sizeof(st_update_t));
+    status = stats_tree_packet(st, pinfo, edt, pri, flags);
+
+    if (st->updates->len == 0 && status != TAP_PACKET_FAILED) {
+        g_array_free(st->updates, true);
+        st->updates = NULL;
+        return NULL;
+    }
+
+    record = g_new(st_record_t, 1);
+    record->status = status;
+    record->now = st->now;
+    record->updates = st->updates;
+    st->updates = NULL;
+
+    return record;
+}
+
+extern tap_packet_status
+stats_tree_consume(void *p _U_, void *precord)
+{
+    st_record_t *record = (st_record_t *)precord;
+    tap_packet_status status = record->status;
+    unsigned i;
+
+    for (i = 0; i < record->updates->len; i++) {
+        st_update_t *update = &g_array_index(record->updates, st_update_t, i);
+
+        if (update->is_float) {
+            node_manip_float(update->node, record->now, update->mode, update->value.float_value);
+        } else {
+            node_manip_int(update->node, record->now, update->mode, update->value.int_value);
+        }
+    }
+
+    g_array_free(record->updates, true);
+    g_free(record);
+
+    return status;
 }
 
 /*
@@ -748,26 +890,7 @@ stats_tree_manip_node_float(manip_node_mode mode, stats_tree *st, const char *na
     if (node == NULL)
         node = new_stat_node(st, name, parent_id, STAT_DT_FLOAT, with_hash, with_hash);
 
-    switch (mode) {
-    case MN_AVERAGE:
-        node->counter++;
-        update_burst_calc(node, 1);
-        /* fall through */ /*to average code */
-    case MN_AVERAGE_NOTICK:
-        node->total.float_total += value;
-        if (node->minvalue.float_min > value) {
-            node->minvalue.float_min = value;
-        }
-        if (node->maxvalue.float_max < value) {
-            node->maxvalue.float_max = value;
-        }
-        node->st_flags |= ST_FLG_AVERAGE;
-        break;
-    default:
-        //only average is currently supported
-        ws_assert_not_reached();
-        break;
-    }
+    stats_tree_node_manip_float(mode, node, value);
 
     if (node)
         return node->id;
@@ -775,6 +898,178 @@ stats_tree_manip_node_float(manip_node_mode mode, stats_tree *st, const char *na
         return -1;
 }
 
+stat_node *
+stats_tree_get_node(stats_tree *st, int node_id)
+{
+    ws_assert(node_id >= 0 && node_id < (int) st->parents->len);
+
+    return (stat_node *)g_ptr_array_index(st->parents, node_id);
+}
+
+int
+stats_tree_node_id(const stat_node *node)
+{
+    return node->id;
+}
+
+/* Returns the child with the given name, creating it if it doesn't exist,
+ * just as stats_tree_manip_node_int() would. */
+static stat_node *
+get_named_child(stat_node *parent, const char *name, bool with_children)
+{
+    stat_node *node;
+
+    ws_assert(parent->id >= 0);
+
+    if (parent->hash) {
+        node = (stat_node *)g_hash_table_lookup(parent->hash, name);
+    } else {
+        node = (stat_node *)g_hash_table_lookup(parent->st->names, name);
+    }
+
+    if (node == NULL)
+        node = new_stat_node(parent->st, name, parent->id, STAT_DT_INT, with_children, with_children);
+
+    return node;
+}
+
+/* Integer keys are looked up in an array as long as it has no more than
+ * ST_DENSE_INT_KEYS entries and no more than ST_DENSE_INT_RATIO per child
+ * with an integer key, so that sparse keys such as ports don't cost more
+ * than a few pointers each; other keys are looked up in a hash table. */
+#define ST_DENSE_INT_KEYS 1024
+#define ST_DENSE_INT_RATIO 4
+
+/* Makes the array of children by integer key len entries long, and moves
+ * the children with keys it now covers out of the hash table. */
+static void
+grow_int_children(stat_node *parent, unsigned len)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    parent->int_children = g_renew(stat_node *, parent->int_children, len);
+    memset(parent->int_children + parent->int_children_len, 0,
+           (len - parent->int_children_len) * sizeof (stat_node *));
+    parent->int_children_len = len;
+
+    if (!parent->int_hash)
+        return;
+    g_hash_table_iter_init(&iter, parent->int_hash);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        if (GPOINTER_TO_UINT(key) < len) {
+            parent->int_children[GPOINTER_TO_UINT(key)] = (stat_node *)value;
+            g_hash_table_iter_remove(&iter);
+        }
+    }
+}
+
+stat_node *
+stats_tree_get_int_node(stat_node *parent, uint32_t key, const value_string *vs, bool with_children)
+{
+    stat_node *node;
+    char *name;
+
+    if (key < parent->int_children_len) {
+        node = parent->int_children[key];
+        if (node)
+            return node;
+    } else if (parent->int_hash) {
+        node = (stat_node *)g_hash_table_lookup(parent->int_hash, GUINT_TO_POINTER(key));
+        if (node)
+            return node;
+    }
+
+    if (vs) {
+        char *desc = val_to_str_wmem(NULL, key, vs, "Unknown (%d)");
+        name = ws_strdup_printf("%u %s", key, desc);
+        wmem_free(NULL, desc);
+    } else {
+        name = ws_strdup_printf("%u", key);
+    }
+    node = get_named_child(parent, name, with_children);
+    g_free(name);
+
+    parent->int_children_count++;
+    if (key >= parent->int_children_len && key < ST_DENSE_INT_KEYS) {
+        unsigned len = parent->int_children_len ? parent->int_children_len : 16;
+
+        while (len <= key)
+            len *= 2;
+        if (len <= ST_DENSE_INT_RATIO * parent->int_children_count)
+            grow_int_children(parent, len);
+    }
+
+    if (key < parent->int_children_len) {
+        parent->int_children[key] = node;
+    } else {
+        if (!parent->int_hash)
+            parent->int_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+        g_hash_table_insert(parent->int_hash, GUINT_TO_POINTER(key), node);
+    }
+
+    return node;
+}
+
+static unsigned
+stat_node_addr_hash(const void *key)
+{
+    return add_address_to_hash(0, (const address *)key);
+}
+
+static gboolean
+stat_node_addr_equal(const void *a, const void *b)
+{
+    return addresses_equal((const address *)a, (const address *)b);
+}
+
+stat_node *
+stats_tree_get_addr_node(stat_node *parent, const address *addr, bool with_children)
+{
+    stat_node *node;
+    char *name;
+
+    if (parent->addr_hash) {
+        node = (stat_node *)g_hash_table_lookup(parent->addr_hash, addr);
+        if (node)
+            return node;
+    } else {
+        parent->addr_hash = g_hash_table_new(stat_node_addr_hash, stat_node_addr_equal);
+    }
+
+    name = address_to_str(NULL, addr);
+    node = get_named_child(parent, name, with_children);
+    wmem_free(NULL, name);
+
+    /* A node found by name may already be in the index under another,
+     * equally named, address; leave that one be. */
+    if (node->addr_key.type == AT_NONE) {
+        copy_address(&node->addr_key, addr);
+        g_hash_table_insert(parent->addr_hash, &node->addr_key, node);
+    }
+
+    return node;
+}
+
+stat_node *
+stats_tree_get_str_node(stat_node *parent, const char *name, bool with_children)
+{
+    stat_node *node;
+
+    if (parent->str_hash) {
+        node = (stat_node *)g_hash_table_lookup(parent->str_hash, name);
+        if (node)
+            return node;
+    } else {
+        parent->str_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
+    }
+
+    node = get_named_child(parent, name, with_children);
+    g_hash_table_insert(parent->str_hash, (void *)name, node);
+
+    return node;
+}
+
 extern char*
 stats_tree_get_abbr(const char *opt_arg)
 {
@@ -954,30 +1249,14 @@ stats_tree_tick_range(stats_tree *st, const char *name, int parent_id,
         ws_assert_not_reached();
 
     /* update stats for container node. counter should already be ticked so we only update total and min/max */
-    node->total.int_total += value_in_range;
-    if (node->minvalue.int_min > value_in_range) {
-        node->minvalue.int_min = value_in_range;
-    }
-    if (node->maxvalue.int_max < value_in_range) {
-        node->maxvalue.int_max = value_in_range;
-    }
-    node->st_flags |= ST_FLG_AVERAGE;
+    stats_tree_node_manip_int(MN_AVERAGE_NOTICK, node, value_in_range);
 
     for ( child = node->children; child; child = child->next) {
         stat_floor =  child->rng->floor;
         stat_ceil = child->rng->ceil;
 
         if ( value_in_range >= stat_floor && value_in_range <= stat_ceil ) {
-            child->counter++;
-            child->total.int_total += value_in_range;
-            if (child->minvalue.int_min > value_in_range) {
-                child->minvalue.int_min = value_in_range;
-            }
-            if (child->maxvalue.int_max < value_in_range) {
-                child->maxvalue.int_max = value_in_range;
-            }
-            child->st_flags |= ST_FLG_AVERAGE;
-            update_burst_calc(child, 1);
+            stats_tree_node_manip_int(MN_AVERAGE, child, value_in_range);
             return node->id;
         }
     }
@@ -1016,8 +1295,7 @@ stats_tree_tick_pivot(stats_tree *st, int pivot_id, const char *pivot_value)
 {
     stat_node *parent = (stat_node *)g_ptr_array_index(st->parents,pivot_id);
 
-    parent->counter++;
-    update_burst_calc(parent, 1);
+    stats_tree_node_manip_int(MN_INCREASE, parent, 1);
     stats_tree_manip_node_int( MN_INCREASE, st, pivot_value, pivot_id, false, 1);
 
     return pivot_id;
@@ -16,6 +16,7 @@
 #include <epan/packet_info.h>
 #include <epan/tap.h>
 #include <epan/stat_groups.h>
+#include <epan/value_string.h>
 #include "ws_symbol_export.h"
 
 #ifdef __cplusplus
@@ -212,6 +213,61 @@ WS_DLL_PUBLIC int stats_tree_manip_node_float(manip_node_mode mode,
                                         bool with_children,
                                         float value);
 
+/*
+ * Node handles, for trees that tick many nodes per packet.
+ *
+ * Rather than looking a node up by a name that has to be formatted for
+ * every packet, get a handle on it by a typed key and tick it directly.
+ * Looking up a child by an integer, an address or a string with a fixed
+ * address is a lookup in an index of the parent; a child that doesn't
+ * exist yet is created, named after the key. Children that were created
+ * by name are found as well, so both APIs can be mixed.
+ *
+ * Handles are valid until the tree is reinitialized or freed, like node
+ * IDs. A node can only be a parent if it was created with children.
+ */
+typedef struct _stat_node stat_node;
+
+/* Returns the handle of the node with the given ID; 0 is the root. */
+WS_DLL_PUBLIC stat_node *stats_tree_get_node(stats_tree *st, int node_id);
+
+/* Returns the ID of a node created with children, to pass to the
+ * functions that take a parent ID. */
+WS_DLL_PUBLIC int stats_tree_node_id(const stat_node *node);
+
+/* Child with an integer key, named "<key>", or "<key> <description>" if vs
+ * is non-NULL. Small, dense keys are looked up in an array. */
+WS_DLL_PUBLIC stat_node *stats_tree_get_int_node(stat_node *parent,
+                                                 uint32_t key,
+                                                 const value_string *vs,
+                                                 bool with_children);
+
+/* Child with an address key, named after the address. */
+WS_DLL_PUBLIC stat_node *stats_tree_get_addr_node(stat_node *parent,
+                                                  const address *addr,
+                                                  bool with_children);
+
+/* Child with the given name, looked up by the address of the string, which
+ * must stay valid and unchanged as long as the tree, e.g. a string literal
+ * or one returned by g_intern_string(). */
+WS_DLL_PUBLIC stat_node *stats_tree_get_str_node(stat_node *parent,
+                                                 const char *name,
+                                                 bool with_children);
+
+/* Manipulates the value of a node, like stats_tree_manip_node_int(). */
+WS_DLL_PUBLIC void stats_tree_node_manip_int(manip_node_mode mode,
+                                             stat_node *node,
+                                             int value);
+
+#define stats_tree_tick_node(node)                                      \
+    (stats_tree_node_manip_int(MN_INCREASE,(node),1))
+
+#define stats_tree_increase_node(node,value)                            \
+    (stats_tree_node_manip_int(MN_INCREASE,(node),(value)))
+
+#define stats_tree_avg_node_add_value_int(node,value)                   \
+    (stats_tree_node_manip_int(MN_AVERAGE,(node),(value)))
+
 #define increase_stat_node(st,name,parent_id,with_children,value)       \
     (stats_tree_manip_node_int(MN_INCREASE,(st),(name),(parent_id),(with_children),(value)))
 
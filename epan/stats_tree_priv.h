@@ -84,6 +84,19 @@ struct _stat_node {
 	/** children nodes by name */
 	GHashTable		*hash;
 
+	/** children nodes by typed key, filled in by the node handle API:
+	 *  integer keys by index while that's dense enough, others by value,
+	 *  addresses, and names by their address */
+	stat_node		**int_children;
+	unsigned		int_children_len;
+	unsigned		int_children_count;
+	GHashTable		*int_hash;
+	GHashTable		*addr_hash;
+	GHashTable		*str_hash;
+
+	/** the key of this node in its parent's addr_hash */
+	address			addr_key;
+
 	/** the owner of this node */
 	stats_tree		*st;
 
@@ -182,6 +195,15 @@ WS_DLL_PUBLIC stats_tree *stats_tree_new(stats_tree_cfg *cfg, tree_pres *pr, con
 /** callback for taps */
 WS_DLL_PUBLIC tap_packet_status stats_tree_packet(void*, packet_info*, epan_dissect_t*, const void *, tap_flags_t flags);
 
+/** snapshot callback for register_tap_listener_threaded(): runs the
+ *  packet callback, looking up and creating nodes as it goes, but records
+ *  the counter updates instead of making them */
+WS_DLL_PUBLIC void *stats_tree_snapshot(void*, packet_info*, epan_dissect_t*, const void *, tap_flags_t flags);
+
+/** consume callback for register_tap_listener_threaded(): makes the
+ *  counter updates recorded by stats_tree_snapshot() */
+WS_DLL_PUBLIC tap_packet_status stats_tree_consume(void *p_st, void *record);
+
 /** callback for reset */
 WS_DLL_PUBLIC void stats_tree_reset(void *p_st);
 
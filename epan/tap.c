@@ -78,23 +78,94 @@ typedef struct _tap_packet_t {
 static tap_packet_t tap_packet_array[TAP_PACKET_QUEUE_LEN];
 static guint tap_packet_index;
 
+/*
+ * Listeners with the same filter string share one compiled filter, so that
+ * it is only run once per packet however many listeners use it.
+ */
+typedef struct _tap_filter_t {
+	gchar *fstring;
+	dfilter_t *code;
+	guint refcount;
+	guint index;		/* index in active_tap_filters, or
+				   TAP_FILTER_NO_INDEX if it was added since
+				   that was built */
+} tap_filter_t;
+
+#define TAP_FILTER_NO_INDEX	G_MAXUINT
+
+/*
+ * The queue between the dissection thread and the thread running the
+ * consume routine of a threaded listener: a ring with a single producer
+ * and a single consumer, which only take the mutex to sleep when the ring
+ * is full or empty. "write" and "read" count the records pushed and
+ * consumed; a record's slot is only reused once it has been consumed.
+ */
+#define TAP_WORKER_RING_LEN	4096	/* must be a power of 2 */
+
+typedef struct _tap_worker_t {
+	GThread *thread;
+	void *records[TAP_WORKER_RING_LEN];
+	gint write;
+	gint read;
+	gint stop;
+	gint waiters;		/* threads sleeping, or about to, on cond */
+	gint needs_redraw;	/* set by the worker, collected by the main thread */
+	gint failed;
+	GMutex mutex;
+	GCond cond;
+} tap_worker_t;
+
 typedef struct _tap_listener_t {
 	struct _tap_listener_t *next;
 	int tap_id;
 	gboolean needs_redraw;
 	gboolean failed;
 	guint flags;
-	gchar *fstring;
-	dfilter_t *code;
+	tap_filter_t *filter;
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
+	tap_snapshot_cb snapshot;	/* threaded listeners only */
+	tap_consume_cb consume;
+	tap_worker_t *worker;		/* NULL unless consume runs in a thread */
 	tap_draw_cb draw;
 	tap_finish_cb finish;
+	gboolean removed;		/* removed while the queue was pushed */
 } tap_listener_t;
 
 static tap_listener_t *tap_listener_queue;
 
+static gboolean tap_listener_threads_enabled;
+
+/* Shared filters, by filter string. */
+static GHashTable *tap_filters;
+
+/*
+ * The listeners of each tap, indexed by tap_id, in the order of
+ * tap_listener_queue, and the filters they use; rebuilt from
+ * tap_listener_queue when it or the filters have changed.
+ */
+static GPtrArray *tap_listeners_by_tap_id;
+static GPtrArray *active_tap_filters;
+static gboolean tap_listeners_changed = TRUE;
+
+/*
+ * Listeners may be registered, removed or given another filter by the
+ * callbacks that tap_push_tapped_queue() calls. While it runs, the index
+ * above isn't rebuilt, and listeners and filters that are no longer used
+ * are only freed once it's done, so that the buckets and filters it goes
+ * through stay valid.
+ */
+static gboolean tap_pushing_queue;
+static GSList *tap_removed_listeners;
+static GSList *tap_unused_filters;
+
+/* Filter results cached for a packet; see tap_push_tapped_queue(). */
+#define TAP_FILTER_UNKNOWN	0
+#define TAP_FILTER_PASSED	1
+#define TAP_FILTER_FAILED	2
+#define TAP_FILTER_RESULTS_LEN	64
+
 static GSList *tap_plugins;
 
 #ifdef HAVE_PLUGINS
@@ -153,6 +224,337 @@ tap_init(void)
 	tap_packet_index=0;
 }
 
+/* Get the shared filter for a filter string, compiling it if no other
+   listener uses it. *filterp is set to NULL if the string is empty. */
+static gboolean
+tap_filter_get(const char *fstring, tap_filter_t **filterp, df_error_t **df_err)
+{
+	tap_filter_t *filter;
+	dfilter_t *code=NULL;
+
+	*filterp=NULL;
+	if(!tap_filters){
+		tap_filters=g_hash_table_new(g_str_hash, g_str_equal);
+	}
+	filter=(tap_filter_t *)g_hash_table_lookup(tap_filters, fstring);
+	if(filter){
+		filter->refcount++;
+		*filterp=filter;
+		return TRUE;
+	}
+
+	if(!dfilter_compile(fstring, &code, df_err)){
+		return FALSE;
+	}
+	if(!code){
+		return TRUE;
+	}
+	filter=g_new0(tap_filter_t, 1);
+	filter->fstring=g_strdup(fstring);
+	filter->code=code;
+	filter->refcount=1;
+	filter->index=TAP_FILTER_NO_INDEX;
+	g_hash_table_insert(tap_filters, filter->fstring, filter);
+	tap_listeners_changed=TRUE;
+	*filterp=filter;
+	return TRUE;
+}
+
+static void
+tap_filter_free(tap_filter_t *filter)
+{
+	dfilter_free(filter->code);
+	g_free(filter->fstring);
+	g_free(filter);
+}
+
+static void
+tap_filter_unref(tap_filter_t *filter)
+{
+	if(!filter || --filter->refcount > 0){
+		return;
+	}
+	g_hash_table_remove(tap_filters, filter->fstring);
+	tap_listeners_changed=TRUE;
+	if(tap_pushing_queue){
+		tap_unused_filters=g_slist_prepend(tap_unused_filters, filter);
+		return;
+	}
+	tap_filter_free(filter);
+}
+
+static void
+free_tap_listener_index(void)
+{
+	GPtrArray *bucket;
+
+	if(tap_listeners_by_tap_id){
+		for(guint i=0;i<tap_listeners_by_tap_id->len;i++){
+			bucket=(GPtrArray *)g_ptr_array_index(tap_listeners_by_tap_id, i);
+			if(bucket){
+				g_ptr_array_free(bucket, TRUE);
+			}
+		}
+		g_ptr_array_free(tap_listeners_by_tap_id, TRUE);
+		tap_listeners_by_tap_id=NULL;
+	}
+	if(active_tap_filters){
+		g_ptr_array_free(active_tap_filters, TRUE);
+		active_tap_filters=NULL;
+	}
+	tap_listeners_changed=TRUE;
+}
+
+/* Bucket the listeners by tap_id and number the filters they use. */
+static void
+tap_listeners_index(void)
+{
+	tap_listener_t *tl;
+	GPtrArray *bucket;
+	GHashTableIter iter;
+	gpointer value;
+
+	if(!tap_listeners_changed || tap_pushing_queue){
+		return;
+	}
+
+	free_tap_listener_index();
+	tap_listeners_by_tap_id=g_ptr_array_new();
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		if((guint)tl->tap_id >= tap_listeners_by_tap_id->len){
+			g_ptr_array_set_size(tap_listeners_by_tap_id, tl->tap_id + 1);
+		}
+		bucket=(GPtrArray *)g_ptr_array_index(tap_listeners_by_tap_id, tl->tap_id);
+		if(!bucket){
+			bucket=g_ptr_array_new();
+			g_ptr_array_index(tap_listeners_by_tap_id, tl->tap_id)=bucket;
+		}
+		g_ptr_array_add(bucket, tl);
+	}
+
+	active_tap_filters=g_ptr_array_new();
+	if(tap_filters){
+		g_hash_table_iter_init(&iter, tap_filters);
+		while(g_hash_table_iter_next(&iter, NULL, &value)){
+			((tap_filter_t *)value)->index=active_tap_filters->len;
+			g_ptr_array_add(active_tap_filters, value);
+		}
+	}
+
+	tap_listeners_changed=FALSE;
+}
+
+/* **********************************************************************
+ * Threads running the consume routine of threaded tap listeners
+ * ********************************************************************** */
+static gboolean
+tap_worker_has_records(tap_worker_t *w)
+{
+	return g_atomic_int_get(&w->read) != g_atomic_int_get(&w->write) ||
+	    g_atomic_int_get(&w->stop);
+}
+
+static gboolean
+tap_worker_has_room(tap_worker_t *w)
+{
+	return (guint)(g_atomic_int_get(&w->write) - g_atomic_int_get(&w->read)) < TAP_WORKER_RING_LEN;
+}
+
+static gboolean
+tap_worker_is_idle(tap_worker_t *w)
+{
+	return g_atomic_int_get(&w->read) == g_atomic_int_get(&w->write);
+}
+
+/* Sleep until ready(w) holds. Whoever changes what ready() looks at must
+   call tap_worker_wake() afterwards. */
+static void
+tap_worker_wait(tap_worker_t *w, gboolean (*ready)(tap_worker_t *))
+{
+	g_atomic_int_inc(&w->waiters);
+	g_mutex_lock(&w->mutex);
+	while(!ready(w)){
+		g_cond_wait(&w->cond, &w->mutex);
+	}
+	g_mutex_unlock(&w->mutex);
+	g_atomic_int_add(&w->waiters, -1);
+}
+
+static void
+tap_worker_wake(tap_worker_t *w)
+{
+	if(g_atomic_int_get(&w->waiters)){
+		g_mutex_lock(&w->mutex);
+		g_cond_broadcast(&w->cond);
+		g_mutex_unlock(&w->mutex);
+	}
+}
+
+static gpointer
+tap_worker_thread(gpointer data)
+{
+	tap_listener_t *tl=(tap_listener_t *)data;
+	tap_worker_t *w=tl->worker;
+	guint read;
+
+	for(;;){
+		read=(guint)g_atomic_int_get(&w->read);
+		if(read == (guint)g_atomic_int_get(&w->write)){
+			if(g_atomic_int_get(&w->stop)){
+				break;
+			}
+			tap_worker_wait(w, tap_worker_has_records);
+			continue;
+		}
+
+		switch (tl->consume(tl->tapdata, w->records[read & (TAP_WORKER_RING_LEN-1)])) {
+
+		case TAP_PACKET_DONT_REDRAW:
+			break;
+
+		case TAP_PACKET_REDRAW:
+			g_atomic_int_set(&w->needs_redraw, TRUE);
+			break;
+
+		case TAP_PACKET_FAILED:
+			g_atomic_int_set(&w->failed, TRUE);
+			break;
+		}
+
+		g_atomic_int_set(&w->read, (gint)(read + 1));
+		tap_worker_wake(w);
+	}
+	return NULL;
+}
+
+static void
+tap_worker_start(tap_listener_t *tl)
+{
+	tap_worker_t *w;
+
+	w=g_new0(tap_worker_t, 1);
+	g_mutex_init(&w->mutex);
+	g_cond_init(&w->cond);
+	tl->worker=w;
+	w->thread=g_thread_new("tap_listener_worker", tap_worker_thread, tl);
+}
+
+static void
+tap_worker_push(tap_worker_t *w, void *record)
+{
+	guint write=(guint)g_atomic_int_get(&w->write);
+
+	if(!tap_worker_has_room(w)){
+		tap_worker_wait(w, tap_worker_has_room);
+	}
+	w->records[write & (TAP_WORKER_RING_LEN-1)]=record;
+	g_atomic_int_set(&w->write, (gint)(write + 1));
+	tap_worker_wake(w);
+}
+
+/* Wait until the worker has consumed everything queued to it, and pick
+   up the results, so that the main thread may use the listener's state. */
+static void
+tap_worker_flush(tap_listener_t *tl)
+{
+	tap_worker_t *w=tl->worker;
+
+	if(!w){
+		return;
+	}
+	if(!tap_worker_is_idle(w)){
+		tap_worker_wait(w, tap_worker_is_idle);
+	}
+	if(g_atomic_int_get(&w->needs_redraw)){
+		g_atomic_int_set(&w->needs_redraw, FALSE);
+		tl->needs_redraw=TRUE;
+	}
+	if(g_atomic_int_get(&w->failed)){
+		g_atomic_int_set(&w->failed, FALSE);
+		tl->failed=TRUE;
+	}
+}
+
+static void
+tap_worker_stop(tap_listener_t *tl)
+{
+	tap_worker_t *w=tl->worker;
+
+	if(!w){
+		return;
+	}
+	tap_worker_flush(tl);
+	g_atomic_int_set(&w->stop, TRUE);
+	g_mutex_lock(&w->mutex);
+	g_cond_broadcast(&w->cond);
+	g_mutex_unlock(&w->mutex);
+	g_thread_join(w->thread);
+	g_mutex_clear(&w->mutex);
+	g_cond_clear(&w->cond);
+	g_free(w);
+	tl->worker=NULL;
+}
+
+static void
+tap_workers_flush(void)
+{
+	tap_listener_t *tl;
+
+	for(tl=tap_listener_queue;tl;tl=tl->next){
+		tap_worker_flush(tl);
+	}
+}
+
+/* Hand a packet to a threaded listener. */
+static void
+tap_listener_queue_snapshot(tap_listener_t *tl, packet_info *pinfo, epan_dissect_t *edt,
+    const void *tap_specific_data, tap_flags_t flags)
+{
+	void *record;
+
+	if(tl->worker && g_atomic_int_get(&tl->worker->failed)){
+		return;
+	}
+	record=tl->snapshot(tl->tapdata, pinfo, edt, tap_specific_data, flags);
+	if(!record){
+		return;
+	}
+	if(tap_listener_threads_enabled){
+		if(!tl->worker){
+			tap_worker_start(tl);
+		}
+		tap_worker_push(tl->worker, record);
+		return;
+	}
+
+	switch (tl->consume(tl->tapdata, record)) {
+
+	case TAP_PACKET_DONT_REDRAW:
+		break;
+
+	case TAP_PACKET_REDRAW:
+		tl->needs_redraw=TRUE;
+		break;
+
+	case TAP_PACKET_FAILED:
+		tl->failed=TRUE;
+		break;
+	}
+}
+
+void
+set_tap_listener_threads(gboolean enable)
+{
+	tap_listener_t *tl;
+
+	if(!enable){
+		for(tl=tap_listener_queue;tl;tl=tl->next){
+			tap_worker_stop(tl);
+		}
+	}
+	tap_listener_threads_enabled=enable;
+}
+
 /* **********************************************************************
  * Functions called from dissector when made tappable
  * ********************************************************************** */
@@ -262,19 +664,20 @@ tap_queue_packet(int tap_id, packet_info *pinfo, const void *tap_specific_data)
 
 void tap_build_interesting (epan_dissect_t *edt)
 {
-	tap_listener_t *tl;
+	tap_filter_t *filter;
+	guint i;
 
 	/* nothing to do, just return */
 	if(!tap_listener_queue){
 		return;
 	}
 
-	/* loop over all tap listeners and build the list of all
-	   interesting hf_fields */
-	for(tl=tap_listener_queue;tl;tl=tl->next){
-		if(tl->code){
-			epan_dissect_prime_with_dfilter(edt, tl->code);
-		}
+	/* loop over all the filters of the tap listeners and build the
+	   list of all interesting hf_fields */
+	tap_listeners_index();
+	for(i=0;i<active_tap_filters->len;i++){
+		filter=(tap_filter_t *)g_ptr_array_index(active_tap_filters, i);
+		epan_dissect_prime_with_dfilter(edt, filter->code);
 	}
 }
 
@@ -305,7 +708,12 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 {
 	tap_packet_t *tp;
 	tap_listener_t *tl;
-	guint i;
+	GPtrArray *bucket;
+	guint i, j;
+	guint8 results_buf[TAP_FILTER_RESULTS_LEN];
+	guint8 *results;
+	guint results_len;
+	gboolean passed;
 
 	/* nothing to do, just return */
 	if(!tapping_is_active){
@@ -319,69 +727,123 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 		return;
 	}
 
-	/* loop over all tap listeners and call the listener callback
-	   for all packets that match the filter. */
+	/* Every queued packet was dissected into the same edt, so each
+	   filter needs to be run at most once; remember its result. */
+	tap_listeners_index();
+	results_len=active_tap_filters->len;
+	if(results_len <= TAP_FILTER_RESULTS_LEN){
+		results=results_buf;
+	} else {
+		results=(guint8 *)g_malloc(results_len);
+	}
+	memset(results, TAP_FILTER_UNKNOWN, results_len);
+	tap_pushing_queue=TRUE;
+
+	/* loop over all queued packets and call the callback of the
+	   listeners to their tap for the packets that match the filter. */
 	for(i=0;i<tap_packet_index;i++){
-		for(tl=tap_listener_queue;tl;tl=tl->next){
-			tp=&tap_packet_array[i];
+		tp=&tap_packet_array[i];
+		if((guint)tp->tap_id >= tap_listeners_by_tap_id->len){
+			continue;
+		}
+		bucket=(GPtrArray *)g_ptr_array_index(tap_listeners_by_tap_id, tp->tap_id);
+		if(!bucket){
+			continue;
+		}
+		for(j=0;j<bucket->len;j++){
+			tl=(tap_listener_t *)g_ptr_array_index(bucket, j);
 			/* Don't tap the packet if it's an "error packet"
 			 * unless the listener has requested that we do so.
 			 */
-			if (!(tp->flags & TAP_PACKET_IS_ERROR_PACKET) || (tl->flags & TL_REQUIRES_ERROR_PACKETS))
-			{
-				if(tp->tap_id==tl->tap_id){
-					if(!tl->packet){
-						/* There isn't a per-packet
-						 * routine for this tap.
-						 */
-						continue;
+			if ((tp->flags & TAP_PACKET_IS_ERROR_PACKET) && !(tl->flags & TL_REQUIRES_ERROR_PACKETS))
+				continue;
+			if(tl->removed){
+				continue;
+			}
+			if(!tl->packet && !tl->consume){
+				/* There isn't a per-packet
+				 * routine for this tap.
+				 */
+				continue;
+			}
+			if(tl->failed){
+				/* A previous call failed,
+				 * meaning "stop running this
+				 * tap", so don't call the
+				 * packet routine.
+				 */
+				continue;
+			}
+
+			/* If we have a filter, see if the
+			 * packet passes.
+			 */
+			guint flags = tl->flags;
+			if(tl->filter){
+				if(tl->filter->index >= results_len){
+					/* Added by a callback; not numbered yet. */
+					passed = dfilter_apply_edt(tl->filter->code, edt);
+				} else {
+					guint8 *result = &results[tl->filter->index];
+
+					if(*result == TAP_FILTER_UNKNOWN){
+						*result = dfilter_apply_edt(tl->filter->code, edt) ?
+						    TAP_FILTER_PASSED : TAP_FILTER_FAILED;
 					}
-					if(tl->failed){
-						/* A previous call failed,
-						 * meaning "stop running this
-						 * tap", so don't call the
-						 * packet routine.
-						 */
+					passed = *result == TAP_FILTER_PASSED;
+				}
+				if(!passed){
+					/* The packet didn't
+					 * pass the filter. */
+					if (tl->flags & TL_IGNORE_DISPLAY_FILTER)
+						flags |= TL_DISPLAY_FILTER_IGNORED;
+					else
 						continue;
-					}
+				}
+			}
 
-					/* If we have a filter, see if the
-					 * packet passes.
-					 */
-					guint flags = tl->flags;
-					if(tl->code){
-						if (!dfilter_apply_edt(tl->code, edt)){
-							/* The packet didn't
-							 * pass the filter. */
-							if (tl->flags & TL_IGNORE_DISPLAY_FILTER)
-								flags |= TL_DISPLAY_FILTER_IGNORED;
-							else
-								continue;
-						}
-					}
+			if(tl->consume){
+				tap_listener_queue_snapshot(tl, tp->pinfo, edt, tp->tap_specific_data, flags);
+				continue;
+			}
 
-					/* So call the per-packet routine. */
-					tap_packet_status status;
+			/* So call the per-packet routine. */
+			tap_packet_status status;
 
-					status = tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data, flags);
+			status = tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data, flags);
 
-					switch (status) {
+			switch (status) {
 
-					case TAP_PACKET_DONT_REDRAW:
-						break;
+			case TAP_PACKET_DONT_REDRAW:
+				break;
 
-					case TAP_PACKET_REDRAW:
-						tl->needs_redraw=TRUE;
-						break;
+			case TAP_PACKET_REDRAW:
+				tl->needs_redraw=TRUE;
+				break;
 
-					case TAP_PACKET_FAILED:
-						tl->failed=TRUE;
-						break;
-					}
-				}
+			case TAP_PACKET_FAILED:
+				tl->failed=TRUE;
+				break;
 			}
 		}
 	}
+
+	tap_pushing_queue=FALSE;
+	while(tap_removed_listeners){
+		tl=(tap_listener_t *)tap_removed_listeners->data;
+		tap_removed_listeners=g_slist_delete_link(tap_removed_listeners, tap_removed_listeners);
+		free_tap_listener(tl);
+	}
+	while(tap_unused_filters){
+		tap_filter_t *filter=(tap_filter_t *)tap_unused_filters->data;
+
+		tap_unused_filters=g_slist_delete_link(tap_unused_filters, tap_unused_filters);
+		tap_filter_free(filter);
+	}
+
+	if(results != results_buf){
+		g_free(results);
+	}
 }
 
 
@@ -436,6 +898,7 @@ reset_tap_listeners(void)
 {
 	tap_listener_t *tl;
 
+	tap_workers_flush();
 	for(tl=tap_listener_queue;tl;tl=tl->next){
 		if(tl->reset){
 			tl->reset(tl->tapdata);
@@ -459,6 +922,7 @@ draw_tap_listeners(gboolean draw_all)
 {
 	tap_listener_t *tl;
 
+	tap_workers_flush();
 	for(tl=tap_listener_queue;tl;tl=tl->next){
 		if(tl->needs_redraw || draw_all){
 			if(tl->draw){
@@ -518,11 +982,11 @@ free_tap_listener(tap_listener_t *tl)
 	 * If this is changed make sure the finish callback is not called
 	 * twice to prevent double-free errors.
 	 */
+	tap_worker_stop(tl);
 	if (tl->finish) {
 		tl->finish(tl->tapdata);
 	}
-	dfilter_free(tl->code);
-	g_free(tl->fstring);
+	tap_filter_unref(tl->filter);
 	g_free(tl);
 }
 
@@ -539,7 +1003,6 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 {
 	tap_listener_t *tl;
 	int tap_id;
-	dfilter_t *code=NULL;
 	GString *error_string;
 	df_error_t *df_err;
 
@@ -555,7 +1018,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->failed=FALSE;
 	tl->flags=flags;
 	if(fstring && *fstring){
-		if(!dfilter_compile(fstring, &code, &df_err)){
+		if(!tap_filter_get(fstring, &tl->filter, &df_err)){
 			error_string = g_string_new("");
 			g_string_printf(error_string,
 			    "Filter \"%s\" is invalid - %s",
@@ -564,8 +1027,6 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 			free_tap_listener(tl);
 			return error_string;
 		}
-		tl->fstring=g_strdup(fstring);
-		tl->code=code;
 	}
 
 	tl->tap_id=tap_id;
@@ -577,7 +1038,27 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->next=tap_listener_queue;
 
 	tap_listener_queue=tl;
+	tap_listeners_changed=TRUE;
+
+	return NULL;
+}
+
+GString *
+register_tap_listener_threaded(const char *tapname, void *tapdata, const char *fstring,
+			       guint flags, tap_reset_cb reset, tap_snapshot_cb snapshot,
+			       tap_consume_cb consume, tap_draw_cb draw, tap_finish_cb finish)
+{
+	GString *error_string;
+
+	error_string=register_tap_listener(tapname, tapdata, fstring, flags,
+	    reset, NULL, draw, finish);
+	if(error_string){
+		return error_string;
+	}
 
+	/* register_tap_listener() puts the new listener at the head */
+	tap_listener_queue->snapshot=snapshot;
+	tap_listener_queue->consume=consume;
 	return NULL;
 }
 
@@ -587,7 +1068,6 @@ GString *
 set_tap_dfilter(void *tapdata, const char *fstring)
 {
 	tap_listener_t *tl=NULL,*tl2;
-	dfilter_t *code=NULL;
 	GString *error_string;
 	df_error_t *df_err;
 
@@ -608,15 +1088,11 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	}
 
 	if(tl){
-		if(tl->code){
-			dfilter_free(tl->code);
-			tl->code=NULL;
-		}
+		tap_filter_unref(tl->filter);
+		tl->filter=NULL;
 		tl->needs_redraw=TRUE;
-		g_free(tl->fstring);
 		if(fstring){
-			if(!dfilter_compile(fstring, &code, &df_err)){
-				tl->fstring=NULL;
+			if(!tap_filter_get(fstring, &tl->filter, &df_err)){
 				error_string = g_string_new("");
 				g_string_printf(error_string,
 						 "Filter \"%s\" is invalid - %s",
@@ -625,8 +1101,6 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 				return error_string;
 			}
 		}
-		tl->fstring=g_strdup(fstring);
-		tl->code=code;
 	}
 
 	return NULL;
@@ -638,22 +1112,28 @@ void
 tap_listeners_dfilter_recompile(void)
 {
 	tap_listener_t *tl;
+	tap_filter_t *filter;
 	dfilter_t *code;
+	GHashTableIter iter;
+	gpointer value;
 
 	for(tl=tap_listener_queue;tl;tl=tl->next){
-		if(tl->code){
-			dfilter_free(tl->code);
-			tl->code=NULL;
-		}
 		tl->needs_redraw=TRUE;
+	}
+
+	if(!tap_filters){
+		return;
+	}
+	g_hash_table_iter_init(&iter, tap_filters);
+	while(g_hash_table_iter_next(&iter, NULL, &value)){
+		filter=(tap_filter_t *)value;
+		dfilter_free(filter->code);
 		code=NULL;
-		if(tl->fstring){
-			if(!dfilter_compile(tl->fstring, &code, NULL)){
-				/* Not valid, make a dfilter matching no packets */
-				dfilter_compile("frame.number == 0", &code, NULL);
-			}
+		if(!dfilter_compile(filter->fstring, &code, NULL)){
+			/* Not valid, make a dfilter matching no packets */
+			dfilter_compile("frame.number == 0", &code, NULL);
 		}
-		tl->code=code;
+		filter->code=code;
 	}
 }
 
@@ -671,11 +1151,13 @@ remove_tap_listener(void *tapdata)
 	if(tap_listener_queue->tapdata==tapdata){
 		tl=tap_listener_queue;
 		tap_listener_queue=tap_listener_queue->next;
+		tap_listeners_changed=TRUE;
 	} else {
 		for(tl2=tap_listener_queue;tl2->next;tl2=tl2->next){
 			if(tl2->next->tapdata==tapdata){
 				tl=tl2->next;
 				tl2->next=tl2->next->next;
+				tap_listeners_changed=TRUE;
 				break;
 			}
 
@@ -685,6 +1167,11 @@ remove_tap_listener(void *tapdata)
 			return;
 		}
 	}
+	if(tap_pushing_queue){
+		tl->removed=TRUE;
+		tap_removed_listeners=g_slist_prepend(tap_removed_listeners, tl);
+		return;
+	}
 	free_tap_listener(tl);
 }
 
@@ -721,7 +1208,7 @@ tap_listeners_require_columns(void)
 		if(tap_queue->flags & TL_REQUIRES_COLUMNS)
 			return TRUE;
 
-		if(dfilter_requires_columns(tap_queue->code))
+		if(tap_queue->filter && dfilter_requires_columns(tap_queue->filter->code))
 			return TRUE;
 
 		tap_queue = tap_queue->next;
@@ -756,7 +1243,7 @@ have_filtering_tap_listeners(void)
 	tap_listener_t *tl;
 
 	for(tl=tap_listener_queue;tl;tl=tl->next){
-		if(tl->code)
+		if(tl->filter)
 			return TRUE;
 	}
 	return FALSE;
@@ -765,11 +1252,12 @@ have_filtering_tap_listeners(void)
 void
 tap_listeners_load_field_references(epan_dissect_t *edt)
 {
-	tap_listener_t *tl;
+	tap_filter_t *filter;
 
-	for(tl=tap_listener_queue;tl;tl=tl->next){
-		if(tl->code)
-			dfilter_load_field_references_edt(tl->code, edt);
+	tap_listeners_index();
+	for(guint i=0;i<active_tap_filters->len;i++){
+		filter=(tap_filter_t *)g_ptr_array_index(active_tap_filters, i);
+		dfilter_load_field_references_edt(filter->code, edt);
 	}
 }
 
@@ -804,6 +1292,12 @@ void tap_cleanup(void)
 	}
 	tap_listener_queue = NULL;
 
+	free_tap_listener_index();
+	if(tap_filters){
+		g_hash_table_destroy(tap_filters);
+		tap_filters = NULL;
+	}
+
 	while(head_dl){
 		elem_dl = head_dl;
 		head_dl = head_dl->next;
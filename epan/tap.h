@@ -34,6 +34,8 @@ typedef void (*tap_reset_cb)(void *tapdata);
 typedef tap_packet_status (*tap_packet_cb)(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data, tap_flags_t flags);
 typedef void (*tap_draw_cb)(void *tapdata);
 typedef void (*tap_finish_cb)(void *tapdata);
+typedef void *(*tap_snapshot_cb)(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data, tap_flags_t flags);
+typedef tap_packet_status (*tap_consume_cb)(void *tapdata, void *record);
 
 /**
  * Flags to indicate what a tap listener's packet routine requires.
@@ -233,6 +235,37 @@ WS_DLL_PUBLIC GString *register_tap_listener(const char *tapname, void *tapdata,
     tap_packet_cb tap_packet, tap_draw_cb tap_draw,
     tap_finish_cb tap_finish) G_GNUC_WARN_UNUSED_RESULT;
 
+/** This function attaches a thread-safe tap listener to the named tap.
+ * Its arguments and return value are as for register_tap_listener(),
+ * except that the packet routine is split in two:
+ *
+ * @param tap_snapshot void *(*snapshot)(void *tapdata, packet_info *pinfo, epan_dissect_t *edt, const void *data, tap_flags_t flags)
+ *                   Called like (*packet), on the dissection thread, for every packet
+ *                   that has passed the filter. It must copy whatever the listener needs
+ *                   out of pinfo, edt and data, none of which outlive the packet, into a
+ *                   record allocated with g_malloc() or similar, and return it; or
+ *                   return NULL if the packet is of no interest. It must not touch
+ *                   *tapdata other than to read settings that don't change while tapping.
+ * @param tap_consume tap_packet_status (*consume)(void *tapdata, void *record)
+ *                   Called with every record returned by (*snapshot), in order, to
+ *                   update *tapdata, and returns what (*packet) would have. It owns
+ *                   the record and must free it. When listener threads are enabled
+ *                   (see set_tap_listener_threads()) it runs on a thread of its own,
+ *                   so it may only use *tapdata and the record; otherwise it is called
+ *                   right after (*snapshot). (*reset), (*draw) and (*finish) are
+ *                   only called once all pending records have been consumed.
+ */
+WS_DLL_PUBLIC GString *register_tap_listener_threaded(const char *tapname,
+    void *tapdata, const char *fstring, guint flags, tap_reset_cb tap_reset,
+    tap_snapshot_cb tap_snapshot, tap_consume_cb tap_consume,
+    tap_draw_cb tap_draw, tap_finish_cb tap_finish) G_GNUC_WARN_UNUSED_RESULT;
+
+/** Enable or disable running the (*consume) routine of each listener
+ * registered with register_tap_listener_threaded() on a thread of its own,
+ * fed through a queue, so that heavy statistics don't hold up dissection.
+ * Disabled by default. */
+WS_DLL_PUBLIC void set_tap_listener_threads(gboolean enable);
+
 /** This function sets a new dfilter to a tap listener */
 WS_DLL_PUBLIC GString *set_tap_dfilter(void *tapdata, const char *fstring);
 
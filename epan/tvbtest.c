@@ -609,6 +609,105 @@ run_tests(void)
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
+#define COMPOSITE_SEGMENT_MEMBERS	300
+
+typedef struct {
+	guint8	*data;
+	guint	 length;
+	guint	 calls;
+} segment_collect_t;
+
+static gboolean
+segment_collect_cb(const guint8 *data, guint length, void *user_data)
+{
+	segment_collect_t *collect = (segment_collect_t *)user_data;
+
+	memcpy(collect->data + collect->length, data, length);
+	collect->length += length;
+	collect->calls++;
+	return TRUE;
+}
+
+/* Tests a composite of many members, searching and walking it without
+ * making it contiguous first. */
+static void
+composite_segment_tests(void)
+{
+	tvbuff_t	*tvb_parent, *tvb_comp, *member;
+	guint8		*expected;
+	guint		 total = 0, i, offset, length;
+	guint8		 buf[64];
+	gint		 found;
+	const guint8	*result;
+	segment_collect_t collect;
+
+	tvb_parent = tvb_new_real_data((const guint8*)"", 0, 0);
+	tvb_comp = tvb_new_composite();
+	expected = g_new(guint8, COMPOSITE_SEGMENT_MEMBERS * 7);
+
+	/* Members of 1 to 7 bytes, with each byte value appearing a few times. */
+	for (i = 0; i < COMPOSITE_SEGMENT_MEMBERS; i++) {
+		guint8 *data;
+
+		length = 1 + i % 7;
+		data = g_new(guint8, length);
+		for (guint j = 0; j < length; j++) {
+			data[j] = (guint8)(total + j) % 251;
+			expected[total + j] = data[j];
+		}
+		member = tvb_new_child_real_data(tvb_parent, data, length, length);
+		tvb_set_free_cb(member, g_free);
+		tvb_composite_append(tvb_comp, member);
+		total += length;
+	}
+	tvb_composite_finalize(tvb_comp);
+
+	/* Searches crossing members, from various starting points. */
+	for (offset = 0; offset < total; offset += 37) {
+		for (i = 0; i < 251; i += 50) {
+			result = (const guint8 *)memchr(expected + offset, (int)i, total - offset);
+			found = tvb_find_guint8(tvb_comp, offset, -1, (guint8)i);
+			if (found != (result ? (gint)(result - expected) : -1)) {
+				printf("Composite segments: Failed find of %u from %u: got %d\n", i, offset, found);
+				failed = TRUE;
+				goto done;
+			}
+		}
+	}
+
+	/* Copies crossing members. */
+	for (offset = 0; offset + sizeof buf <= total; offset += 13) {
+		tvb_memcpy(tvb_comp, buf, offset, sizeof buf);
+		if (memcmp(buf, expected + offset, sizeof buf) != 0) {
+			printf("Composite segments: Failed copy from %u\n", offset);
+			failed = TRUE;
+			goto done;
+		}
+	}
+
+	/* Walk everything but the first and last bytes; the first member is
+	 * a single byte, so that's one piece per remaining member. */
+	collect.data = g_new(guint8, total);
+	collect.length = 0;
+	collect.calls = 0;
+	if (!tvb_foreach_segment(tvb_comp, 1, total - 2, segment_collect_cb, &collect) ||
+	    collect.length != total - 2 ||
+	    collect.calls != COMPOSITE_SEGMENT_MEMBERS - 1 ||
+	    memcmp(collect.data, expected + 1, total - 2) != 0) {
+		printf("Composite segments: Failed walk: %u bytes in %u calls\n", collect.length, collect.calls);
+		failed = TRUE;
+		g_free(collect.data);
+		goto done;
+	}
+	g_free(collect.data);
+
+	printf("Passed composite segments\n");
+
+done:
+	g_free(expected);
+	tvb_free_chain(tvb_parent);  /* frees the members and the composite */
+}
+
 typedef struct
 {
 	// Raw bytes
@@ -814,6 +913,7 @@ main(void)
 
 	except_init();
 	run_tests();
+	composite_segment_tests();
 	varint_tests();
 	zstd_tests ();
 	except_deinit();
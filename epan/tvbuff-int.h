@@ -25,12 +25,17 @@ struct tvb_ops {
 	gint (*tvb_ws_mempbrk_pattern_guint8)(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern* pattern, guchar *found_needle);
 
 	tvbuff_t *(*tvb_clone)(tvbuff_t *tvb, guint abs_offset, guint abs_length);
+
+	gboolean (*tvb_foreach_segment)(tvbuff_t *tvb, guint abs_offset, guint abs_length, tvb_segment_func func, void *user_data);
 };
 
 /*
  * Tvbuff flags.
  */
 #define TVBUFF_FRAGMENT		0x00000001	/* this is a fragment */
+#define TVBUFF_TRANSIENT_DATA	0x00000002	/* real_data may be freed before
+						   the tvbuff is; don't point
+						   into it */
 
 struct tvbuff {
 	/* Doubly linked list pointers */
@@ -2550,6 +2550,27 @@ tvb_ws_mempbrk_pattern_guint8(tvbuff_t *tvb, const gint offset, const gint maxle
 	return tvb_ws_mempbrk_guint8_generic(tvb, abs_offset, limit, pattern, found_needle);
 }
 
+gboolean
+tvb_foreach_segment(tvbuff_t *tvb, const gint offset, const gint length,
+		    tvb_segment_func func, void *user_data)
+{
+	guint abs_offset = 0, abs_length = 0;
+
+	DISSECTOR_ASSERT(tvb && tvb->initialized);
+
+	check_offset_length(tvb, offset, length, &abs_offset, &abs_length);
+	if (abs_length == 0)
+		return TRUE;
+
+	if (tvb->real_data)
+		return func(tvb->real_data + abs_offset, abs_length, user_data);
+
+	if (tvb->ops->tvb_foreach_segment)
+		return tvb->ops->tvb_foreach_segment(tvb, abs_offset, abs_length, func, user_data);
+
+	return func(ensure_contiguous(tvb, abs_offset, abs_length), abs_length, user_data);
+}
+
 /* Find size of stringz (NUL-terminated string) by looking for terminating
  * NUL.  The size of the string includes the terminating NUL.
  *
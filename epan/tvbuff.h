@@ -225,6 +225,13 @@ WS_DLL_PUBLIC void tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member);
 /** Prepend to the list of tvbuffs that make up this composite tvbuff */
 extern void tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member);
 
+/** Append to the list of tvbuffs that make up this composite tvbuff,
+ * handing the member, and the chain it heads, over to the composite: they
+ * are freed when the composite is freed, rather than the composite being
+ * freed along with the chain of its first member. Either all or none of
+ * the members of a composite must be added this way. */
+WS_DLL_PUBLIC void tvb_composite_append_chain(tvbuff_t *tvb, tvbuff_t *member);
+
 /** Create an empty composite tvbuff. */
 WS_DLL_PUBLIC tvbuff_t *tvb_new_composite(void);
 
@@ -584,6 +591,19 @@ WS_DLL_PUBLIC gint tvb_find_guint16(tvbuff_t *tvb, const gint offset,
 WS_DLL_PUBLIC gint tvb_ws_mempbrk_pattern_guint8(tvbuff_t *tvb, const gint offset,
     const gint maxlength, const ws_mempbrk_pattern* pattern, guchar *found_needle);
 
+/** Callback for tvb_foreach_segment(), called with each contiguous piece
+ * of the range in turn. Return FALSE to stop. */
+typedef gboolean (*tvb_segment_func)(const guint8 *data, guint length, void *user_data);
+
+/** Call func on the length bytes at offset (the rest of the tvbuff if
+ * length is -1) as a series of contiguous pieces, in order. Unlike
+ * tvb_get_ptr(), this doesn't copy the data of a composite tvbuff, such as
+ * a reassembled PDU, into a single buffer first.
+ * Returns FALSE if func stopped the walk, TRUE otherwise.
+ * Throws an exception if the range goes beyond the captured data. */
+WS_DLL_PUBLIC gboolean tvb_foreach_segment(tvbuff_t *tvb, const gint offset,
+    const gint length, tvb_segment_func func, void *user_data);
+
 
 /** Find size of stringz (NUL-terminated string) by looking for terminating
  * NUL.  The size of the string includes the terminating NUL.
@@ -16,7 +16,21 @@
 #include "proto.h"	/* XXX - only used for DISSECTOR_ASSERT, probably a new header file? */
 
 typedef struct {
-	GSList		*tvbs;
+	/* The members while the composite is being built. */
+	GPtrArray	*tvbs;
+
+	/* The members once it's finalized, in order. */
+	tvbuff_t	**members;
+	guint		num_members;
+
+	/* The members were handed over with tvb_composite_append_chain(). */
+	gboolean	owns_members;
+
+	/* The packet scope that frees real_data, and the ID of the
+	 * callback doing that, if the composite was flattened while
+	 * dissecting a packet. */
+	wmem_allocator_t *flat_scope;
+	guint		flat_cb_id;
 
 	/* Used for quick testing to see if this
 	 * is the tvbuff that a COMPOSITE is
@@ -38,50 +52,117 @@ composite_free(tvbuff_t *tvb)
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
 
-	g_slist_free(composite->tvbs);
+	if (composite->tvbs)
+		g_ptr_array_free(composite->tvbs, TRUE);
 
+	g_free(composite->members);
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
+	if (composite->flat_scope)
+		wmem_unregister_callback(composite->flat_scope, composite->flat_cb_id);
 	g_free((gpointer)tvb->real_data);
 }
 
+static bool
+composite_free_flat_data(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_, void *user_data)
+{
+	tvbuff_t *tvb = (tvbuff_t *) user_data;
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+
+	g_free((gpointer)tvb->real_data);
+	tvb->real_data = NULL;
+	tvb->flags &= ~TVBUFF_TRANSIENT_DATA;
+	composite_tvb->composite.flat_scope = NULL;
+
+	return false;
+}
+
 static guint
 composite_offset(const tvbuff_t *tvb _U_, const guint counter)
 {
 	return counter;
 }
 
+/* Return the index of the member holding abs_offset, or num_members if
+ * abs_offset is at (or past) the end of the composite. */
+static guint
+composite_find_member(const tvb_comp_t *composite, guint abs_offset)
+{
+	guint lo = 0, hi = composite->num_members, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (composite->end_offsets[mid] < abs_offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void *
+composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_length)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint8 *target = (guint8 *) _target;
+	guint	    i;
+	tvbuff_t   *member_tvb;
+	guint	    member_offset, member_length;
+
+	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
+
+	i = composite_find_member(composite, abs_offset);
+
+	/* special case */
+	if (i == composite->num_members) {
+		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
+		return target;
+	}
+
+	/* Copy the part that's in each member tvb in turn, until we
+	 * have copied all data. */
+	member_offset = abs_offset - composite->start_offsets[i];
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_tvb = composite->members[i];
+		member_length = MIN((guint)tvb_captured_length_remaining(member_tvb, member_offset), abs_length);
+
+		/* Members can't be of zero length. */
+		DISSECTOR_ASSERT(member_length > 0);
+
+		tvb_memcpy(member_tvb, target, member_offset, member_length);
+		target		+= member_length;
+		abs_length	-= member_length;
+		member_offset	 = 0;
+		i++;
+	}
+
+	return _target;
+}
+
 static const guint8*
 composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint	    i, num_members;
-	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset;
-	GSList	   *slist;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
-	composite = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -94,77 +175,95 @@ composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 	else {
 		/* Use a temporary variable as tvb_memcpy is also checking tvb->real_data pointer */
 		void *real_data = g_malloc(tvb->length);
-		tvb_memcpy(tvb, real_data, 0, tvb->length);
+		composite_memcpy(tvb, real_data, 0, tvb->length);
 		tvb->real_data = (const guint8 *)real_data;
+
+		/* A composite that owns its members, such as reassembled
+		 * data, may be kept for as long as the file is open; don't
+		 * keep a flat copy of it along with the members for that
+		 * long. Outside of dissection (e.g. when the GUI shows the
+		 * bytes) the copy is kept until the composite is freed. */
+		if (composite->owns_members && wmem_in_packet_scope()) {
+			composite->flat_scope = wmem_packet_scope();
+			composite->flat_cb_id = wmem_register_callback(composite->flat_scope,
+			    composite_free_flat_data, tvb);
+			tvb->flags |= TVBUFF_TRANSIENT_DATA;
+		}
 		return tvb->real_data + abs_offset;
 	}
-
-	DISSECTOR_ASSERT_NOT_REACHED();
 }
 
-static void *
-composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_length)
+static gint
+composite_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint8 *target = (guint8 *) _target;
-
-	guint	    i, num_members;
-	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
 	guint	    member_offset, member_length;
-	GSList	   *slist;
-
-	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
-
-	/* Maybe the range specified by offset/length
-	 * is contiguous inside one of the member tvbuffs */
-	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
+	gint	    result;
+
+	/* Search each member in turn instead of flattening the composite. */
+	i = composite_find_member(composite, abs_offset);
+	member_offset = (i < composite->num_members) ? abs_offset - composite->start_offsets[i] : 0;
+	while (limit > 0 && i < composite->num_members) {
+		member_length = MIN((guint)tvb_captured_length_remaining(composite->members[i], member_offset), limit);
+		result = tvb_find_guint8(composite->members[i], member_offset, member_length, needle);
+		if (result != -1)
+			return composite->start_offsets[i] + result;
+
+		limit		-= member_length;
+		member_offset	 = 0;
+		i++;
 	}
+	return -1;
+}
 
-	/* special case */
-	if (!member_tvb) {
-		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
-		return target;
+static gint
+composite_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern* pattern, guchar *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
+	guint	    member_offset, member_length;
+	gint	    result;
+
+	/* Search each member in turn instead of flattening the composite. */
+	i = composite_find_member(composite, abs_offset);
+	member_offset = (i < composite->num_members) ? abs_offset - composite->start_offsets[i] : 0;
+	while (limit > 0 && i < composite->num_members) {
+		member_length = MIN((guint)tvb_captured_length_remaining(composite->members[i], member_offset), limit);
+		result = tvb_ws_mempbrk_pattern_guint8(composite->members[i], member_offset, member_length, pattern, found_needle);
+		if (result != -1)
+			return composite->start_offsets[i] + result;
+
+		limit		-= member_length;
+		member_offset	 = 0;
+		i++;
 	}
+	return -1;
+}
 
-	member_offset = abs_offset - composite->start_offsets[i];
-
-	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
-		DISSECTOR_ASSERT(!tvb->real_data);
-		return tvb_memcpy(member_tvb, target, member_offset, abs_length);
-	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
-		member_length = tvb_captured_length_remaining(member_tvb, member_offset);
+static gboolean
+composite_foreach_segment(tvbuff_t *tvb, guint abs_offset, guint abs_length, tvb_segment_func func, void *user_data)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	guint	    i;
+	guint	    member_offset, member_length;
 
-		/* composite_memcpy() can't handle a member_length of zero. */
-		DISSECTOR_ASSERT(member_length > 0);
+	i = composite_find_member(composite, abs_offset);
+	member_offset = (i < composite->num_members) ? abs_offset - composite->start_offsets[i] : 0;
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_length = MIN((guint)tvb_captured_length_remaining(composite->members[i], member_offset), abs_length);
+		if (!tvb_foreach_segment(composite->members[i], member_offset, member_length, func, user_data))
+			return FALSE;
 
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
 		abs_length	-= member_length;
-
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
-		}
-
-		return target;
+		member_offset	 = 0;
+		i++;
 	}
-
-	DISSECTOR_ASSERT_NOT_REACHED();
+	return TRUE;
 }
 
 static const struct tvb_ops tvb_composite_ops = {
@@ -174,9 +273,10 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_guint8 XXX */
-	NULL,                 /* pbrk_guint8 XXX */
+	composite_find_guint8, /* find_guint8 */
+	composite_pbrk_guint8, /* pbrk_guint8 */
 	NULL,                 /* clone */
+	composite_foreach_segment, /* foreach_segment */
 };
 
 /*
@@ -198,7 +298,12 @@ tvb_new_composite(void)
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
 
-	composite->tvbs		 = NULL;
+	composite->tvbs		 = g_ptr_array_new();
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
+	composite->owns_members	 = FALSE;
+	composite->flat_scope	 = NULL;
+	composite->flat_cb_id	 = 0;
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
 
@@ -219,11 +324,12 @@ tvb_composite_append(tvbuff_t *tvb, tvbuff_t *member)
 	 */
 	if (member && member->length) {
 		composite       = &composite_tvb->composite;
-		composite->tvbs = g_slist_append(composite->tvbs, member);
+		DISSECTOR_ASSERT(!composite->owns_members);
+		g_ptr_array_add(composite->tvbs, member);
 
 		/* Attach the composite TVB to the first TVB only. */
-		if (!composite->tvbs->next) {
-			tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb);
+		if (composite->tvbs->len == 1) {
+			tvb_add_to_chain(member, tvb);
 		}
 	}
 }
@@ -242,24 +348,52 @@ tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member)
 	 */
 	if (member && member->length) {
 		composite       = &composite_tvb->composite;
-		composite->tvbs = g_slist_prepend(composite->tvbs, member);
+		DISSECTOR_ASSERT(!composite->owns_members);
+		g_ptr_array_insert(composite->tvbs, 0, member);
 
 		/* Attach the composite TVB to the first TVB only. */
-		if (!composite->tvbs->next) {
-			tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb);
+		if (composite->tvbs->len == 1) {
+			tvb_add_to_chain(member, tvb);
 		}
 	}
 }
 
+/*
+ * Unlike with tvb_composite_append(), the member's chain becomes part of
+ * the composite's, so the composite can outlive the chain the member was
+ * created in; it's freed when the composite is. A composite's members
+ * must either all be added this way or none of them.
+ */
+void
+tvb_composite_append_chain(tvbuff_t *tvb, tvbuff_t *member)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite;
+
+	DISSECTOR_ASSERT(tvb && !tvb->initialized);
+	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
+	DISSECTOR_ASSERT(member);
+
+	composite = &composite_tvb->composite;
+	DISSECTOR_ASSERT(composite->owns_members || composite->tvbs->len == 0);
+	composite->owns_members = TRUE;
+
+	tvb_add_to_chain(tvb, member);
+
+	/* Zero-length members are only freed along with the composite. */
+	if (member->length) {
+		g_ptr_array_add(composite->tvbs, member);
+	}
+}
+
 void
 tvb_composite_finalize(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	GSList	   *slist;
 	guint	    num_members;
 	tvbuff_t   *member_tvb;
 	tvb_comp_t *composite;
-	int	    i = 0;
+	guint	    i;
 
 	DISSECTOR_ASSERT(tvb && !tvb->initialized);
 	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
@@ -268,7 +402,7 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	DISSECTOR_ASSERT(tvb->contained_length == 0);
 
 	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
+	num_members = composite->tvbs->len;
 
 	/* Dissectors should not create composite TVBs if they're not going to
 	 * put at least one TVB in them.
@@ -276,18 +410,19 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	 */
 	DISSECTOR_ASSERT(num_members);
 
+	composite->num_members = num_members;
+	composite->members = (tvbuff_t **)g_ptr_array_free(composite->tvbs, FALSE);
+	composite->tvbs = NULL;
 	composite->start_offsets = g_new(guint, num_members);
 	composite->end_offsets = g_new(guint, num_members);
 
-	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
-		DISSECTOR_ASSERT((guint) i < num_members);
-		member_tvb = (tvbuff_t *)slist->data;
+	for (i = 0; i < num_members; i++) {
+		member_tvb = composite->members[i];
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
 		tvb->contained_length += member_tvb->contained_length;
 		composite->end_offsets[i] = tvb->length - 1;
-		i++;
 	}
 
 	tvb->initialized = TRUE;
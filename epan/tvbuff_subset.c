@@ -102,6 +102,14 @@ subset_clone(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 	return tvb_clone_offset_len(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, abs_length);
 }
 
+static gboolean
+subset_foreach_segment(tvbuff_t *tvb, guint abs_offset, guint abs_length, tvb_segment_func func, void *user_data)
+{
+	struct tvb_subset *subset_tvb = (struct tvb_subset *) tvb;
+
+	return tvb_foreach_segment(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, abs_length, func, user_data);
+}
+
 static const struct tvb_ops tvb_subset_ops = {
 	sizeof(struct tvb_subset), /* size */
 
@@ -112,6 +120,7 @@ static const struct tvb_ops tvb_subset_ops = {
 	subset_find_guint8,   /* find_guint8 */
 	subset_pbrk_guint8,   /* pbrk_guint8 */
 	subset_clone,         /* clone */
+	subset_foreach_segment, /* foreach_segment */
 };
 
 static tvbuff_t *
@@ -138,7 +147,7 @@ tvb_new_with_subset(tvbuff_t *backing, const guint reported_length,
 
 	/* Optimization. If the backing buffer has a pointer to contiguous, real data,
 	 * then we can point directly to our starting offset in that buffer */
-	if (backing->real_data != NULL) {
+	if (backing->real_data != NULL && !(backing->flags & TVBUFF_TRANSIENT_DATA)) {
 		tvb->real_data = backing->real_data + subset_tvb_offset;
 	}
 
@@ -35,38 +35,92 @@
  * perfect, but it should stop most of the bad behaviour that emem permitted.
  */
 
-/* TODO: Make these thread-local */
+/* The file scope is shared by all threads. It is only switched to a
+ * threaded allocator, so that they can allocate from it at the same time,
+ * by programs that dissect on several threads. Threads other than the
+ * main one that dissect packets get their own packet scope from
+ * wmem_init_thread_scope(); the epan scope is only for the main thread. */
 static wmem_allocator_t *packet_scope;
 static wmem_allocator_t *file_scope;
 static wmem_allocator_t *epan_scope;
 
+static bool file_scope_threaded;
+
+static GPrivate thread_packet_scope;
+
 /* Packet Scope */
 
 wmem_allocator_t *
 wmem_packet_scope(void)
 {
+    wmem_allocator_t *scope;
+
+    scope = (wmem_allocator_t *)g_private_get(&thread_packet_scope);
+    if (scope)
+        return scope;
+
     ws_assert(packet_scope);
 
     return packet_scope;
 }
 
+bool
+wmem_in_packet_scope(void)
+{
+    wmem_allocator_t *scope;
+
+    scope = (wmem_allocator_t *)g_private_get(&thread_packet_scope);
+    if (!scope)
+        scope = packet_scope;
+
+    return scope && wmem_in_scope(scope);
+}
+
 void
 wmem_enter_packet_scope(void)
 {
-    ws_assert(packet_scope);
+    wmem_allocator_t *scope = wmem_packet_scope();
+
     ws_assert(wmem_in_scope(file_scope));
-    ws_assert(!wmem_in_scope(packet_scope));
+    ws_assert(!wmem_in_scope(scope));
 
-    wmem_enter_scope(packet_scope);
+    wmem_enter_scope(scope);
 }
 
 void
 wmem_leave_packet_scope(void)
 {
-    ws_assert(packet_scope);
-    ws_assert(wmem_in_scope(packet_scope));
+    wmem_allocator_t *scope = wmem_packet_scope();
 
-    wmem_leave_scope(packet_scope);
+    ws_assert(wmem_in_scope(scope));
+
+    wmem_leave_scope(scope);
+}
+
+void
+wmem_init_thread_scope(void)
+{
+    wmem_allocator_t *scope;
+
+    ws_assert(file_scope_threaded);
+    ws_assert(g_private_get(&thread_packet_scope) == NULL);
+
+    scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+    wmem_leave_scope(scope);
+    g_private_set(&thread_packet_scope, scope);
+}
+
+void
+wmem_cleanup_thread_scope(void)
+{
+    wmem_allocator_t *scope;
+
+    scope = (wmem_allocator_t *)g_private_get(&thread_packet_scope);
+    ws_assert(scope);
+    ws_assert(!wmem_in_scope(scope));
+
+    g_private_set(&thread_packet_scope, NULL);
+    wmem_destroy_allocator(scope);
 }
 
 /* File Scope */
@@ -79,6 +133,16 @@ wmem_file_scope(void)
     return file_scope;
 }
 
+void
+wmem_use_threaded_file_scope(void)
+{
+    ws_assert(file_scope);
+    ws_assert(!wmem_in_scope(file_scope));
+
+    wmem_allocator_make_threaded(file_scope);
+    file_scope_threaded = true;
+}
+
 void
 wmem_enter_file_scope(void)
 {
@@ -151,6 +215,8 @@ wmem_cleanup_scopes(void)
     packet_scope = NULL;
     file_scope   = NULL;
     epan_scope   = NULL;
+
+    file_scope_threaded = false;
 }
 
 /*
@@ -38,6 +38,16 @@ WS_DLL_PUBLIC
 wmem_allocator_t *
 wmem_packet_scope(void);
 
+/**
+ * @brief Check whether a packet is being dissected.
+ *
+ * @return true if the packet scope of the calling thread exists and is in
+ * scope, i.e. memory allocated in it is freed at the end of the packet.
+ */
+WS_DLL_PUBLIC
+bool
+wmem_in_packet_scope(void);
+
 WS_DLL_LOCAL
 void
 wmem_enter_packet_scope(void);
@@ -63,6 +73,37 @@ WS_DLL_LOCAL
 void
 wmem_leave_file_scope(void);
 
+/**
+ * @brief Let several threads allocate from the file scope at once.
+ *
+ * The file scope is a single-threaded allocator unless this is called,
+ * which a program must do before it opens a file that it will dissect on
+ * several threads. It must not be in scope.
+ */
+WS_DLL_PUBLIC
+void
+wmem_use_threaded_file_scope(void);
+
+/**
+ * @brief Give the calling thread its own packet scope.
+ *
+ * Threads other than the one that called wmem_init_scopes() must call this
+ * before dissecting packets, and wmem_cleanup_thread_scope() before they
+ * exit. wmem_packet_scope() then returns the packet scope of the thread.
+ * The file scope is shared by all threads, so wmem_use_threaded_file_scope()
+ * must have been called.
+ */
+WS_DLL_PUBLIC
+void
+wmem_init_thread_scope(void);
+
+/**
+ * @brief Destroy the packet scope of the calling thread.
+ */
+WS_DLL_PUBLIC
+void
+wmem_cleanup_thread_scope(void);
+
 /* Scope Management */
 
 WS_DLL_PUBLIC
@@ -299,7 +299,8 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
     cf->drops     = 0;
     cf->snap      = wtap_snapshot_length(cf->provider.wth);
 
-    /* Allocate a frame_data_sequence for the frames in this file */
+    /* Allocate a frame_data_sequence for the frames in this file. The
+       packet list keeps a pointer to each frame, so it can't be packed. */
     cf->provider.frames = new_frame_data_sequence();
 
     nstime_set_zero(&cf->elapsed_time);
@@ -1502,7 +1503,7 @@ cf_merge_files_to_tempfile(gpointer pd_window, const char *temp_dir, char **out_
     status = merge_files_to_tempfile(temp_dir, out_filenamep, "wireshark", file_type,
             in_filenames,
             in_file_count, do_append,
-            IDB_MERGE_MODE_ALL_SAME, 0 /* snaplen */,
+            IDB_MERGE_MODE_ALL_SAME, 0 /* snaplen */, 0 /* read_ahead */,
             "Wireshark", &cb, &err, &err_info,
             &err_fileno, &err_framenum);
 
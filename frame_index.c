@@ -0,0 +1,285 @@
+/* frame_index.c
+ * Sidecar index files holding the frame offsets, lengths and time stamps
+ * of a capture file, so that it can be reopened without reading it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/frame_data.h>
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+
+#include "frame_index.h"
+
+/*
+ * An index file is a header followed by one fixed-size record per frame,
+ * all in little-endian byte order.
+ *
+ * Header:
+ *
+ *   0  magic, FRAME_INDEX_MAGIC
+ *   8  version, FRAME_INDEX_VERSION
+ *  12  file type/subtype of the capture file
+ *  16  size of the capture file
+ *  24  modification time of the capture file, in seconds
+ *  32  SHA-256 of the first FRAME_INDEX_HASHED_BYTES of the capture file
+ *  64  number of sections of the capture file
+ *  68  number of interfaces of the capture file
+ *  72  number of frames
+ *  76  reserved, 0
+ *
+ * Frame record:
+ *
+ *   0  file offset
+ *   8  time stamp, seconds
+ *  16  time stamp, nanoseconds
+ *  20  packet length
+ *  24  captured length
+ *  28  flags (FRAME_INDEX_HAS_TS)
+ *  29  time stamp precision
+ *  30  reserved, 0
+ */
+#define FRAME_INDEX_MAGIC           "WSFRMIDX"
+#define FRAME_INDEX_VERSION         1
+#define FRAME_INDEX_HEADER_LEN      80
+#define FRAME_INDEX_RECORD_LEN      32
+#define FRAME_INDEX_HASH_LEN        32
+#define FRAME_INDEX_HASHED_BYTES    65536
+
+#define FRAME_INDEX_HAS_TS          0x01
+
+/* Number of frame records read or written at a time. */
+#define FRAME_INDEX_RECORDS_PER_IO  4096
+
+char *
+frame_index_filename(const char *capture_filename)
+{
+    return ws_strdup_printf("%s.wsidx", capture_filename);
+}
+
+/*
+ * Build the header describing the capture file as it is now, apart from
+ * the number of frames.
+ */
+static gboolean
+frame_index_make_header(capture_file *cf, guint8 *hdr)
+{
+    ws_statb64 st;
+    FILE *fp;
+    guint8 *buf;
+    size_t len;
+    GChecksum *cksum;
+    gsize digest_len = FRAME_INDEX_HASH_LEN;
+    wtapng_iface_descriptions_t *idb_info;
+
+    if (ws_stat64(cf->filename, &st) != 0)
+        return FALSE;
+
+    fp = ws_fopen(cf->filename, "rb");
+    if (fp == NULL)
+        return FALSE;
+    buf = (guint8 *)g_malloc(FRAME_INDEX_HASHED_BYTES);
+    len = fread(buf, 1, FRAME_INDEX_HASHED_BYTES, fp);
+    fclose(fp);
+    cksum = g_checksum_new(G_CHECKSUM_SHA256);
+    g_checksum_update(cksum, buf, len);
+    g_free(buf);
+
+    memset(hdr, 0, FRAME_INDEX_HEADER_LEN);
+    memcpy(hdr, FRAME_INDEX_MAGIC, 8);
+    phtole32(hdr + 8, FRAME_INDEX_VERSION);
+    phtole32(hdr + 12, (guint32)cf->cd_t);
+    phtole64(hdr + 16, (guint64)st.st_size);
+    phtole64(hdr + 24, (guint64)st.st_mtime);
+    g_checksum_get_digest(cksum, hdr + 32, &digest_len);
+    g_checksum_free(cksum);
+    phtole32(hdr + 64, wtap_file_get_num_shbs(cf->provider.wth));
+    idb_info = wtap_file_get_idb_info(cf->provider.wth);
+    phtole32(hdr + 68, idb_info->interface_data->len);
+    g_free(idb_info);
+    return TRUE;
+}
+
+gboolean
+frame_index_load(capture_file *cf)
+{
+    char *index_name;
+    FILE *fp;
+    ws_statb64 st;
+    guint8 expected[FRAME_INDEX_HEADER_LEN];
+    guint8 hdr[FRAME_INDEX_HEADER_LEN];
+    guint8 *records = NULL;
+    guint32 count, done = 0, chunk;
+    guint32 cum_bytes = 0;
+    wtap_rec rec;
+    frame_data fdlocal;
+    frame_data *fdata;
+    const guint8 *p;
+    gboolean ok = FALSE;
+
+    ws_assert(cf->count == 0);
+
+    if (!frame_index_make_header(cf, expected))
+        return FALSE;
+
+    index_name = frame_index_filename(cf->filename);
+    fp = ws_fopen(index_name, "rb");
+    g_free(index_name);
+    if (fp == NULL)
+        return FALSE;
+
+    if (fread(hdr, 1, sizeof hdr, fp) != sizeof hdr)
+        goto done;
+    /* Everything but the frame count must match. */
+    if (memcmp(hdr, expected, 72) != 0 || pletoh32(hdr + 76) != 0)
+        goto done;
+    count = pletoh32(hdr + 72);
+    if (ws_fstat64(ws_fileno(fp), &st) != 0 ||
+            (guint64)st.st_size != FRAME_INDEX_HEADER_LEN + (guint64)count * FRAME_INDEX_RECORD_LEN)
+        goto done;
+
+    records = (guint8 *)g_malloc(FRAME_INDEX_RECORDS_PER_IO * FRAME_INDEX_RECORD_LEN);
+    wtap_rec_init(&rec);
+    rec.rec_type = REC_TYPE_PACKET;
+    while (done < count) {
+        chunk = MIN(count - done, FRAME_INDEX_RECORDS_PER_IO);
+        if (fread(records, FRAME_INDEX_RECORD_LEN, chunk, fp) != chunk)
+            break;
+        for (p = records; p < records + chunk * FRAME_INDEX_RECORD_LEN; p += FRAME_INDEX_RECORD_LEN) {
+            rec.presence_flags = (p[28] & FRAME_INDEX_HAS_TS) ? WTAP_HAS_TS : 0;
+            rec.ts.secs = (time_t)pletoh64(p + 8);
+            rec.ts.nsecs = (int)pletoh32(p + 16);
+            rec.tsprec = p[29] & 0x0F;
+            rec.rec_header.packet_header.len = pletoh32(p + 20);
+            rec.rec_header.packet_header.caplen = pletoh32(p + 24);
+
+            /* Do what a first pass without dissection would do. */
+            frame_data_init(&fdlocal, done + 1, &rec, (gint64)pletoh64(p), cum_bytes);
+            fdata = frame_data_sequence_add(cf->provider.frames, &fdlocal);
+            frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                    &cf->provider.ref, cf->provider.prev_dis);
+            frame_data_set_after_dissect(fdata, &cum_bytes);
+            cf->provider.prev_cap = cf->provider.prev_dis = fdata;
+            done++;
+        }
+    }
+    wtap_rec_cleanup(&rec);
+
+    if (done == count) {
+        cf->count = count;
+        ok = TRUE;
+    } else {
+        /* The index was cut short while we were reading it; start over. */
+        free_frame_data_sequence(cf->provider.frames);
+        cf->provider.frames = new_frame_data_sequence();
+        cf->provider.ref = NULL;
+        cf->provider.prev_dis = NULL;
+        cf->provider.prev_cap = NULL;
+        nstime_set_zero(&cf->elapsed_time);
+    }
+
+done:
+    g_free(records);
+    fclose(fp);
+    return ok;
+}
+
+gboolean
+frame_index_save(capture_file *cf, int *err)
+{
+    char *index_name, *tmp_name;
+    FILE *fp;
+    guint8 hdr[FRAME_INDEX_HEADER_LEN];
+    guint8 *records, *p;
+    const frame_data *fdata;
+    guint32 chunk;
+
+    if (!frame_index_make_header(cf, hdr)) {
+        *err = errno;
+        return FALSE;
+    }
+    phtole32(hdr + 72, cf->count);
+
+    index_name = frame_index_filename(cf->filename);
+    tmp_name = ws_strdup_printf("%s.tmp", index_name);
+    fp = ws_fopen(tmp_name, "wb");
+    if (fp == NULL) {
+        *err = errno;
+        g_free(tmp_name);
+        g_free(index_name);
+        return FALSE;
+    }
+
+    if (fwrite(hdr, 1, sizeof hdr, fp) != sizeof hdr)
+        goto fail;
+
+    records = (guint8 *)g_malloc(FRAME_INDEX_RECORDS_PER_IO * FRAME_INDEX_RECORD_LEN);
+    for (guint32 framenum = 1; framenum <= cf->count; framenum += chunk) {
+        chunk = MIN(cf->count - framenum + 1, FRAME_INDEX_RECORDS_PER_IO);
+        memset(records, 0, chunk * FRAME_INDEX_RECORD_LEN);
+        p = records;
+        for (guint32 i = 0; i < chunk; i++, p += FRAME_INDEX_RECORD_LEN) {
+            fdata = frame_data_sequence_find(cf->provider.frames, framenum + i);
+            phtole64(p, (guint64)fdata->file_off);
+            phtole64(p + 8, (guint64)fdata->abs_ts.secs);
+            phtole32(p + 16, (guint32)fdata->abs_ts.nsecs);
+            phtole32(p + 20, fdata->pkt_len);
+            phtole32(p + 24, fdata->cap_len);
+            p[28] = fdata->has_ts ? FRAME_INDEX_HAS_TS : 0;
+            p[29] = (guint8)fdata->tsprec;
+        }
+        if (fwrite(records, FRAME_INDEX_RECORD_LEN, chunk, fp) != chunk) {
+            g_free(records);
+            goto fail;
+        }
+    }
+    g_free(records);
+
+    if (fclose(fp) != 0) {
+        fp = NULL;
+        goto fail;
+    }
+    /* Windows' rename() doesn't replace an existing file. */
+    ws_unlink(index_name);
+    if (ws_rename(tmp_name, index_name) != 0) {
+        fp = NULL;
+        goto fail;
+    }
+    g_free(tmp_name);
+    g_free(index_name);
+    return TRUE;
+
+fail:
+    *err = errno;
+    if (fp != NULL)
+        fclose(fp);
+    ws_unlink(tmp_name);
+    g_free(tmp_name);
+    g_free(index_name);
+    return FALSE;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,51 @@
+/** @file
+ *
+ * Sidecar index files holding the frame offsets, lengths and time stamps
+ * of a capture file, so that it can be reopened without reading it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __FRAME_INDEX_H__
+#define __FRAME_INDEX_H__
+
+#include "cfile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Return the name of the index file of a capture file; the result must
+ * be freed with g_free().
+ */
+extern char *frame_index_filename(const char *capture_filename);
+
+/*
+ * If the capture file opened in cf has an index file that matches it
+ * (same size, modification time and leading bytes, and no interfaces or
+ * sections that haven't been seen when opening it), fill in the empty
+ * cf->provider.frames and cf->count from the index, as a sequential read
+ * of the file without a read filter would, and return TRUE.
+ *
+ * The frames are not dissected; they'll be dissected when they're first
+ * looked at. Return FALSE, leaving cf unchanged, if there is no usable
+ * index.
+ */
+extern gboolean frame_index_load(capture_file *cf);
+
+/*
+ * Write the index file for the frames of cf that have been read.
+ * Return FALSE and set *err on failure.
+ */
+extern gboolean frame_index_save(capture_file *cf, int *err);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FRAME_INDEX_H__ */
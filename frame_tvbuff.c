@@ -157,6 +157,7 @@ static const struct tvb_ops tvb_frame_ops = {
     frame_find_guint8,    /* find_guint8 */
     frame_pbrk_guint8,    /* pbrk_guint8 */
     frame_clone,          /* clone */
+    NULL,                 /* foreach_segment */
 };
 
 /* based on tvb_new_real_data() */
@@ -65,6 +65,11 @@ print_usage(FILE *output)
     fprintf(output, "  -I <IDB merge mode> set the merge mode for Interface Description Blocks; default is 'all'.\n");
     fprintf(output, "                    an empty \"-I\" option will list the merge modes.\n");
     fprintf(output, "\n");
+    fprintf(output, "Processing:\n");
+    fprintf(output, "  --read-ahead <records>\n");
+    fprintf(output, "                    read up to <records> records ahead from each input file\n");
+    fprintf(output, "                    in worker threads; default is to read on one thread.\n");
+    fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h, --help        display this help and exit.\n");
     fprintf(output, "  -V                verbose output.\n");
@@ -198,15 +203,18 @@ main(int argc, char *argv[])
         cfile_close_failure_message
     };
     int                 opt;
+#define LONGOPT_READ_AHEAD           LONGOPT_BASE_APPLICATION+1
     static const struct ws_option long_options[] = {
         {"help", ws_no_argument, NULL, 'h'},
         {"version", ws_no_argument, NULL, 'v'},
+        {"read-ahead", ws_required_argument, NULL, LONGOPT_READ_AHEAD},
         {0, 0, 0, 0 }
     };
     gboolean            do_append          = FALSE;
     gboolean            verbose            = FALSE;
     int                 in_file_count      = 0;
     guint32             snaplen            = 0;
+    guint32             read_ahead         = 0;
     int                 file_type          = WTAP_FILE_TYPE_SUBTYPE_UNKNOWN;
     int                 err                = 0;
     gchar              *err_info           = NULL;
@@ -308,6 +316,10 @@ main(int argc, char *argv[])
                 out_filename = ws_optarg;
                 break;
 
+            case LONGOPT_READ_AHEAD:
+                read_ahead = get_nonzero_guint32(ws_optarg, "read-ahead depth");
+                break;
+
             case '?':              /* Bad options if GNU getopt */
                 switch(ws_optopt) {
                     case'F':
@@ -368,7 +380,7 @@ main(int argc, char *argv[])
         /* merge the files to the standard output */
         status = merge_files_to_stdout(file_type,
                 (const char *const *) &argv[ws_optind],
-                in_file_count, do_append, mode, snaplen,
+                in_file_count, do_append, mode, snaplen, read_ahead,
                 get_appname_and_version(),
                 verbose ? &cb : NULL,
                 &err, &err_info, &err_fileno, &err_framenum);
@@ -376,7 +388,7 @@ main(int argc, char *argv[])
         /* merge the files to the outfile */
         status = merge_files(out_filename, file_type,
                 (const char *const *) &argv[ws_optind], in_file_count,
-                do_append, mode, snaplen, get_appname_and_version(),
+                do_append, mode, snaplen, read_ahead, get_appname_and_version(),
                 verbose ? &cb : NULL,
                 &err, &err_info, &err_fileno, &err_framenum);
     }
@@ -107,19 +107,21 @@ static void ipv6_hosts_stats_tree_init(stats_tree *st) {
 	st_node_ipv6 = stats_tree_create_node(st, st_str_ipv6, 0, STAT_DT_INT, true);
 }
 
-static tap_packet_status ip_hosts_stats_tree_packet(stats_tree *st, packet_info *pinfo, int st_node, const char *st_str) {
-	tick_stat_node(st, st_str, 0, false);
-	tick_stat_node(st, address_to_str(pinfo->pool, &pinfo->net_src), st_node, false);
-	tick_stat_node(st, address_to_str(pinfo->pool, &pinfo->net_dst), st_node, false);
+static tap_packet_status ip_hosts_stats_tree_packet(stats_tree *st, packet_info *pinfo, int st_node) {
+	stat_node *node = stats_tree_get_node(st, st_node);
+
+	stats_tree_tick_node(node);
+	stats_tree_tick_node(stats_tree_get_addr_node(node, &pinfo->net_src, false));
+	stats_tree_tick_node(stats_tree_get_addr_node(node, &pinfo->net_dst, false));
 	return TAP_PACKET_REDRAW;
 }
 
 static tap_packet_status ipv4_hosts_stats_tree_packet(stats_tree *st, packet_info *pinfo, epan_dissect_t *edt _U_, const void *p _U_, tap_flags_t flags _U_) {
-	return ip_hosts_stats_tree_packet(st, pinfo, st_node_ipv4, st_str_ipv4);
+	return ip_hosts_stats_tree_packet(st, pinfo, st_node_ipv4);
 }
 
 static tap_packet_status ipv6_hosts_stats_tree_packet(stats_tree *st, packet_info *pinfo, epan_dissect_t *edt _U_, const void *p _U_, tap_flags_t flags _U_) {
-	return ip_hosts_stats_tree_packet(st, pinfo, st_node_ipv6, st_str_ipv6);
+	return ip_hosts_stats_tree_packet(st, pinfo, st_node_ipv6);
 }
 
 /* ip host stats_tree -- separate source and dest, test stats_tree flags */
@@ -158,24 +160,25 @@ static void ipv6_srcdst_stats_tree_init(stats_tree *st) {
 static tap_packet_status ip_srcdst_stats_tree_packet(stats_tree *st,
 						     packet_info *pinfo,
 						     int st_node_src,
-						     const char *st_str_src,
-						     int st_node_dst,
-						     const char *st_str_dst) {
+						     int st_node_dst) {
+	stat_node *src_node = stats_tree_get_node(st, st_node_src);
+	stat_node *dst_node = stats_tree_get_node(st, st_node_dst);
+
 	/* update source branch */
-	tick_stat_node(st, st_str_src, 0, false);
-	tick_stat_node(st, address_to_str(pinfo->pool, &pinfo->net_src), st_node_src, false);
+	stats_tree_tick_node(src_node);
+	stats_tree_tick_node(stats_tree_get_addr_node(src_node, &pinfo->net_src, false));
 	/* update destination branch */
-	tick_stat_node(st, st_str_dst, 0, false);
-	tick_stat_node(st, address_to_str(pinfo->pool, &pinfo->net_dst), st_node_dst, false);
+	stats_tree_tick_node(dst_node);
+	stats_tree_tick_node(stats_tree_get_addr_node(dst_node, &pinfo->net_dst, false));
 	return TAP_PACKET_REDRAW;
 }
 
 static tap_packet_status ipv4_srcdst_stats_tree_packet(stats_tree *st, packet_info *pinfo, epan_dissect_t *edt _U_, const void *p _U_, tap_flags_t flags _U_) {
-	return ip_srcdst_stats_tree_packet(st, pinfo, st_node_ipv4_src, st_str_ipv4_src, st_node_ipv4_dst, st_str_ipv4_dst);
+	return ip_srcdst_stats_tree_packet(st, pinfo, st_node_ipv4_src, st_node_ipv4_dst);
 }
 
 static tap_packet_status ipv6_srcdst_stats_tree_packet(stats_tree *st, packet_info *pinfo, epan_dissect_t *edt _U_, const void *p _U_, tap_flags_t flags _U_) {
-	return ip_srcdst_stats_tree_packet(st, pinfo, st_node_ipv6_src, st_str_ipv6_src, st_node_ipv6_dst, st_str_ipv6_dst);
+	return ip_srcdst_stats_tree_packet(st, pinfo, st_node_ipv6_src, st_node_ipv6_dst);
 }
 
 /* packet type stats_tree -- test pivot node */
@@ -221,25 +224,27 @@ static void ipv6_dsts_stats_tree_init(stats_tree *st) {
 	st_node_ipv6_dsts = stats_tree_create_node(st, st_str_ipv6_dsts, 0, STAT_DT_INT, true);
 }
 
-static tap_packet_status dsts_stats_tree_packet(stats_tree *st, packet_info *pinfo, int st_node, const char *st_str) {
-	static char str[128];
-	int ip_dst_node;
-	int protocol_node;
+static tap_packet_status dsts_stats_tree_packet(stats_tree *st, packet_info *pinfo, int st_node) {
+	stat_node *node = stats_tree_get_node(st, st_node);
+	stat_node *ip_dst_node;
+	stat_node *protocol_node;
 
-	tick_stat_node(st, st_str, 0, false);
-	ip_dst_node = tick_stat_node(st, address_to_str(pinfo->pool, &pinfo->net_dst), st_node, true);
-	protocol_node = tick_stat_node(st, port_type_to_str(pinfo->ptype), ip_dst_node, true);
-	snprintf(str, sizeof(str) - 1, "%u", pinfo->destport);
-	tick_stat_node(st, str, protocol_node, true);
+	stats_tree_tick_node(node);
+	ip_dst_node = stats_tree_get_addr_node(node, &pinfo->net_dst, true);
+	stats_tree_tick_node(ip_dst_node);
+	/* port_type_to_str() returns string literals */
+	protocol_node = stats_tree_get_str_node(ip_dst_node, port_type_to_str(pinfo->ptype), true);
+	stats_tree_tick_node(protocol_node);
+	stats_tree_tick_node(stats_tree_get_int_node(protocol_node, pinfo->destport, NULL, true));
 	return TAP_PACKET_REDRAW;
 }
 
 static tap_packet_status ipv4_dsts_stats_tree_packet(stats_tree *st, packet_info *pinfo, epan_dissect_t *edt _U_, const void *p _U_, tap_flags_t flags _U_) {
-	return dsts_stats_tree_packet(st, pinfo, st_node_ipv4_dsts, st_str_ipv4_dsts);
+	return dsts_stats_tree_packet(st, pinfo, st_node_ipv4_dsts);
 }
 
 static tap_packet_status ipv6_dsts_stats_tree_packet(stats_tree *st, packet_info *pinfo, epan_dissect_t *edt _U_, const void *p _U_, tap_flags_t flags _U_) {
-	return dsts_stats_tree_packet(st, pinfo, st_node_ipv6_dsts, st_str_ipv6_dsts);
+	return dsts_stats_tree_packet(st, pinfo, st_node_ipv6_dsts);
 }
 
 static int st_node_ipv4_src_ttls = -1;
@@ -255,29 +260,30 @@ static void ipv6_src_ttl_stats_tree_init(stats_tree* st) {
 	st_node_ipv6_src_ttls = stats_tree_create_node(st, st_str_ipv6_src_ttls, 0, STAT_DT_INT, true);
 }
 
-static tap_packet_status src_ttl_stats_tree_packet(stats_tree* st, packet_info* pinfo, int st_node, const char* st_str, uint8_t ttl) {
-	static char str[128];
-	int ip_src_node;
-	int ttl_node;
+static tap_packet_status src_ttl_stats_tree_packet(stats_tree* st, packet_info* pinfo, int st_node, uint8_t ttl) {
+	stat_node *node = stats_tree_get_node(st, st_node);
+	stat_node *ip_src_node;
+	stat_node *ttl_node;
 
-	tick_stat_node(st, st_str, 0, false);
-	ip_src_node = tick_stat_node(st, address_to_str(pinfo->pool, &pinfo->net_src), st_node, true);
-	snprintf(str, sizeof(str) - 1, "%u", ttl);
-	ttl_node = tick_stat_node(st, str, ip_src_node, true);
-	tick_stat_node(st, address_to_str(pinfo->pool, &pinfo->net_dst), ttl_node, true);
+	stats_tree_tick_node(node);
+	ip_src_node = stats_tree_get_addr_node(node, &pinfo->net_src, true);
+	stats_tree_tick_node(ip_src_node);
+	ttl_node = stats_tree_get_int_node(ip_src_node, ttl, NULL, true);
+	stats_tree_tick_node(ttl_node);
+	stats_tree_tick_node(stats_tree_get_addr_node(ttl_node, &pinfo->net_dst, true));
 	return TAP_PACKET_REDRAW;
 }
 
 static tap_packet_status ipv4_src_ttl_stats_tree_packet(stats_tree* st, packet_info* pinfo, epan_dissect_t* edt _U_, const void* p, tap_flags_t flags _U_) {
 	ws_ip4* iph = (ws_ip4*)p;
 
-	return src_ttl_stats_tree_packet(st, pinfo, st_node_ipv4_src_ttls, st_str_ipv4_src_ttls, iph->ip_ttl);
+	return src_ttl_stats_tree_packet(st, pinfo, st_node_ipv4_src_ttls, iph->ip_ttl);
 }
 
 static tap_packet_status ipv6_src_ttl_stats_tree_packet(stats_tree* st, packet_info* pinfo, epan_dissect_t* edt _U_, const void* p, tap_flags_t flags _U_) {
 	ws_ip6* iph = (ws_ip6*)p;
 
-	return src_ttl_stats_tree_packet(st, pinfo, st_node_ipv6_src_ttls, st_str_ipv6_src_ttls, iph->ip6_hop);
+	return src_ttl_stats_tree_packet(st, pinfo, st_node_ipv6_src_ttls, iph->ip6_hop);
 }
 
 /* packet length stats_tree -- test range node */
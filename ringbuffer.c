@@ -67,6 +67,21 @@ typedef z_stream zlib_stream;
 #endif /* HAVE_ZLIB */
 #endif
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#ifndef ZSTD_CLEVEL_DEFAULT
+#define ZSTD_CLEVEL_DEFAULT 3
+#endif
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+#include <lz4frame.h>
+#endif /* HAVE_LZ4FRAME_H */
+
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_ZSTD) || defined (HAVE_LZ4FRAME_H)
+#define RINGBUF_CAN_COMPRESS
+#endif
+
 /* Ringbuffer file structure */
 typedef struct _rb_file {
     gchar         *name;
@@ -134,56 +149,181 @@ CleanupOldCap(gchar* name)
     g_mutex_unlock(&rb_data.mutex);
 }
 
+#ifdef RINGBUF_CAN_COMPRESS
+#define FS_READ_SIZE 65536
+
+/*
+ * Size of the pieces of the file compressed as separate zstd or lz4
+ * frames.  Every frame can be decompressed on its own, so readers can
+ * seek in the compressed file without decompressing all of it.
+ */
+#define FS_FRAME_SIZE (1024 * 1024)
+
 #if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
 /*
- * compress capture file
+ * gzip the contents of fd into outname
  */
-static int
-ringbuf_exec_compress(gchar* name)
+static gboolean
+ringbuf_compress_gzip(int fd, const gchar *outname)
 {
     guint8  *buffer = NULL;
-    gchar* outgz = NULL;
-    int  fd = -1;
     ssize_t nread;
-    gboolean delete_org_file = TRUE;
+    gboolean ok = TRUE;
     gzFile fi = NULL;
 
-    fd = ws_open(name, O_RDONLY | O_BINARY, 0000);
-    if (fd < 0) {
-        return -1;
-    }
-
-    outgz = ws_strdup_printf("%s.gz", name);
-    fi = ZLIB_PREFIX(gzopen)(outgz, "wb");
-    g_free(outgz);
+    fi = ZLIB_PREFIX(gzopen)(outname, "wb");
     if (fi == NULL) {
-        ws_close(fd);
-        return -1;
+        return FALSE;
     }
 
-#define FS_READ_SIZE 65536
     buffer = (guint8*)g_malloc(FS_READ_SIZE);
     if (buffer == NULL) {
-        ws_close(fd);
         ZLIB_PREFIX(gzclose)(fi);
-        return -1;
+        return FALSE;
     }
 
     while ((nread = ws_read(fd, buffer, FS_READ_SIZE)) > 0) {
         int n = ZLIB_PREFIX(gzwrite)(fi, buffer, (unsigned int)nread);
         if (n <= 0) {
             /* mark compression as failed */
-            delete_org_file = FALSE;
+            ok = FALSE;
             break;
         }
     }
     if (nread < 0) {
         /* mark compression as failed */
-        delete_org_file = FALSE;
+        ok = FALSE;
     }
-    ws_close(fd);
     ZLIB_PREFIX(gzclose)(fi);
     g_free(buffer);
+    return ok;
+}
+#endif
+
+#if defined (HAVE_ZSTD) || defined (HAVE_LZ4FRAME_H)
+/*
+ * Read up to FS_FRAME_SIZE bytes from fd into buffer; return the number
+ * of bytes read, or -1 on error.
+ */
+static ssize_t
+ringbuf_read_frame(int fd, guint8 *buffer)
+{
+    ssize_t nread, total = 0;
+
+    while (total < FS_FRAME_SIZE) {
+        nread = ws_read(fd, buffer + total, FS_FRAME_SIZE - (unsigned int)total);
+        if (nread < 0)
+            return -1;
+        if (nread == 0)
+            break;
+        total += nread;
+    }
+    return total;
+}
+
+/*
+ * Compress the contents of fd into outname, one frame of at most
+ * FS_FRAME_SIZE bytes at a time, with compress_frame()
+ */
+static gboolean
+ringbuf_compress_frames(int fd, const gchar *outname, size_t bound,
+        size_t (*compress_frame)(guint8 *, size_t, const guint8 *, size_t))
+{
+    guint8  *buffer = NULL;
+    guint8  *outbuf = NULL;
+    ssize_t nread;
+    size_t  ncomp;
+    gboolean ok = TRUE;
+    int  outfd;
+
+    outfd = ws_open(outname, O_WRONLY|O_BINARY|O_TRUNC|O_CREAT,
+            rb_data.group_read_access ? 0640 : 0600);
+    if (outfd < 0) {
+        return FALSE;
+    }
+
+    buffer = (guint8*)g_malloc(FS_FRAME_SIZE);
+    outbuf = (guint8*)g_malloc(bound);
+
+    while ((nread = ringbuf_read_frame(fd, buffer)) > 0) {
+        ncomp = compress_frame(outbuf, bound, buffer, nread);
+        if (ncomp == 0 || ws_write(outfd, outbuf, (unsigned int)ncomp) != (ssize_t)ncomp) {
+            /* mark compression as failed */
+            ok = FALSE;
+            break;
+        }
+    }
+    if (nread < 0) {
+        /* mark compression as failed */
+        ok = FALSE;
+    }
+    if (ws_close(outfd) < 0) {
+        ok = FALSE;
+    }
+    g_free(outbuf);
+    g_free(buffer);
+    return ok;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static size_t
+ringbuf_zstd_frame(guint8 *dst, size_t dst_size, const guint8 *src, size_t src_size)
+{
+    size_t ret = ZSTD_compress(dst, dst_size, src, src_size, ZSTD_CLEVEL_DEFAULT);
+
+    return ZSTD_isError(ret) ? 0 : ret;
+}
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+static size_t
+ringbuf_lz4_frame(guint8 *dst, size_t dst_size, const guint8 *src, size_t src_size)
+{
+    size_t ret = LZ4F_compressFrame(dst, dst_size, src, src_size, NULL);
+
+    return LZ4F_isError(ret) ? 0 : ret;
+}
+#endif
+
+/*
+ * compress capture file
+ */
+static int
+ringbuf_exec_compress(gchar* name)
+{
+    gchar* outname = NULL;
+    int  fd = -1;
+    gboolean delete_org_file = FALSE;
+
+    fd = ws_open(name, O_RDONLY | O_BINARY, 0000);
+    if (fd < 0) {
+        g_free(name);
+        return -1;
+    }
+
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
+    if (strcmp(rb_data.compress_type, "gzip") == 0) {
+        outname = ws_strdup_printf("%s.gz", name);
+        delete_org_file = ringbuf_compress_gzip(fd, outname);
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (strcmp(rb_data.compress_type, "zstd") == 0) {
+        outname = ws_strdup_printf("%s.zst", name);
+        delete_org_file = ringbuf_compress_frames(fd, outname,
+                ZSTD_compressBound(FS_FRAME_SIZE), ringbuf_zstd_frame);
+    }
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    if (strcmp(rb_data.compress_type, "lz4") == 0) {
+        outname = ws_strdup_printf("%s.lz4", name);
+        delete_org_file = ringbuf_compress_frames(fd, outname,
+                LZ4F_compressFrameBound(FS_FRAME_SIZE, NULL), ringbuf_lz4_frame);
+    }
+#endif
+    ws_close(fd);
+    g_free(outname);
 
     /* delete the original file only if compression succeeds */
     if (delete_org_file) {
@@ -232,8 +372,8 @@ ringbuf_open_file(rb_file *rfile, int *err)
             /* remove old file (if any, so ignore error) */
             ws_unlink(rfile->name);
         }
-#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
-        else if (rb_data.compress_type != NULL && strcmp(rb_data.compress_type, "gzip") == 0) {
+#ifdef RINGBUF_CAN_COMPRESS
+        else if (rb_data.compress_type != NULL && strcmp(rb_data.compress_type, "none") != 0) {
             ringbuf_start_compress_file(rfile);
         }
 #endif
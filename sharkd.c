@@ -37,6 +37,7 @@
 #include <epan/timestamp.h>
 #include <epan/packet.h>
 #include "frame_tvbuff.h"
+#include "frame_index.h"
 #include <epan/disabled_protos.h>
 #include <epan/prefs.h>
 #include <epan/column.h>
@@ -228,7 +229,7 @@ sharkd_epan_new(capture_file *cf)
 
 static gboolean
 process_packet(capture_file *cf, epan_dissect_t *edt,
-        gint64 offset, wtap_rec *rec, Buffer *buf)
+        gint64 offset, wtap_rec *rec, const guint8 *data)
 {
     frame_data     fdlocal;
     gboolean       passed;
@@ -271,7 +272,7 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
         }
 
         epan_dissect_run(edt, cf->cd_t, rec,
-                frame_tvbuff_new_buffer(&cf->provider, &fdlocal, buf),
+                frame_tvbuff_new(&cf->provider, &fdlocal, data),
                 &fdlocal, NULL);
 
         /* Run the read filter if we have one. */
@@ -309,20 +310,60 @@ process_packet(capture_file *cf, epan_dissect_t *edt,
 }
 
 
+/*
+ * Set if the file has name resolution or decryption secrets blocks; those
+ * are only handed to us when reading the file sequentially, so we must
+ * not skip that by loading the frames from an index file.
+ */
+static gboolean file_has_side_data;
+
+static void
+sharkd_new_ipv4(const guint addr, const gchar *name, const bool static_entry)
+{
+    file_has_side_data = TRUE;
+    add_ipv4_name(addr, name, static_entry);
+}
+
+static void
+sharkd_new_ipv6(const void *addrp, const gchar *name, const bool static_entry)
+{
+    file_has_side_data = TRUE;
+    add_ipv6_name((const ws_in6_addr *)addrp, name, static_entry);
+}
+
+static void
+sharkd_new_secrets(guint32 secrets_type, const void *secrets, guint size)
+{
+    file_has_side_data = TRUE;
+    secrets_wtap_callback(secrets_type, secrets, size);
+}
+
 static int
-load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
+load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count,
+        gboolean use_index)
 {
-    int          err;
+    int          err = 0;
     gchar       *err_info = NULL;
-    gint64       data_offset;
-    wtap_rec     rec;
-    Buffer       buf;
+    wtap_rec_batch batch;
     epan_dissect_t *edt = NULL;
 
-    {
-        /* Allocate a frame_data_sequence for all the frames. */
-        cf->provider.frames = new_frame_data_sequence();
+    /* Allocate a frame_data_sequence for all the frames. Requests look
+       frames up in any order and keep pointers to them, so it can't be
+       packed. */
+    cf->provider.frames = new_frame_data_sequence();
 
+    if (use_index && !file_has_side_data && max_packet_count == 0 &&
+            max_byte_count == 0 && cf->rfcode == NULL &&
+            frame_index_load(cf)) {
+        /* We have the frames without reading the file; they'll be
+           dissected when they're asked for. */
+        wtap_sequential_close(cf->provider.wth);
+        cf->provider.prev_dis = NULL;
+        cf->provider.prev_cap = NULL;
+        return 0;
+    }
+
+    {
         {
             gboolean create_proto_tree;
 
@@ -345,22 +386,29 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
             edt = epan_dissect_new(cf->epan, create_proto_tree, FALSE);
         }
 
-        wtap_rec_init(&rec);
-        ws_buffer_init(&buf, 1514);
-
-        while (wtap_read(cf->provider.wth, &rec, &buf, &err, &err_info, &data_offset)) {
-            if (process_packet(cf, edt, data_offset, &rec, &buf)) {
-                wtap_rec_reset(&rec);
-                /* Stop reading if we have the maximum number of packets;
-                 * When the -c option has not been used, max_packet_count
-                 * starts at 0, which practically means, never stop reading.
-                 * (unless we roll over max_packet_count ?)
-                 */
-                if ( (--max_packet_count == 0) || (max_byte_count != 0 && data_offset >= max_byte_count)) {
-                    err = 0; /* This is not an error */
-                    break;
+        /* Read the records in batches; their data stays valid until the
+           next batch is read, which is long enough to dissect them. */
+        wtap_rec_batch_init(&batch, 256, 256 * 1024);
+
+        while (wtap_read_batch(cf->provider.wth, &batch, &err, &err_info)) {
+            unsigned i;
+
+            for (i = 0; i < batch.num_recs; i++) {
+                if (process_packet(cf, edt, batch.offsets[i], &batch.recs[i], batch.data[i])) {
+                    /* Stop reading if we have the maximum number of packets;
+                     * When the -c option has not been used, max_packet_count
+                     * starts at 0, which practically means, never stop reading.
+                     * (unless we roll over max_packet_count ?)
+                     */
+                    if ( (--max_packet_count == 0) || (max_byte_count != 0 && batch.offsets[i] >= max_byte_count)) {
+                        break;
+                    }
                 }
             }
+            if (i < batch.num_recs) {
+                err = 0; /* This is not an error */
+                break;
+            }
         }
 
         if (edt) {
@@ -368,8 +416,7 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
             edt = NULL;
         }
 
-        wtap_rec_cleanup(&rec);
-        ws_buffer_free(&buf);
+        wtap_rec_batch_cleanup(&batch);
 
         /* Close the sequential I/O side, to free up memory it requires. */
         wtap_sequential_close(cf->provider.wth);
@@ -384,6 +431,14 @@ load_cap_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
 
     if (err != 0) {
         cfile_read_failure_message(cf->filename, err, err_info);
+    } else if (use_index && !file_has_side_data && max_packet_count == 0 &&
+            max_byte_count == 0 && cf->rfcode == NULL) {
+        int index_err;
+
+        /* Failing to write the index only makes the next load slower. */
+        if (!frame_index_save(cf, &index_err))
+            ws_info("Couldn't write the index of %s: %s", cf->filename,
+                    g_strerror(index_err));
     }
 
     return err;
@@ -432,9 +487,10 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
 
     cf->state = FILE_READ_IN_PROGRESS;
 
-    wtap_set_cb_new_ipv4(cf->provider.wth, add_ipv4_name);
-    wtap_set_cb_new_ipv6(cf->provider.wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
-    wtap_set_cb_new_secrets(cf->provider.wth, secrets_wtap_callback);
+    file_has_side_data = FALSE;
+    wtap_set_cb_new_ipv4(cf->provider.wth, sharkd_new_ipv4);
+    wtap_set_cb_new_ipv6(cf->provider.wth, sharkd_new_ipv6);
+    wtap_set_cb_new_secrets(cf->provider.wth, sharkd_new_secrets);
 
     return CF_OK;
 
@@ -471,9 +527,9 @@ sharkd_cf_open(const char *fname, unsigned int type, gboolean is_tempfile, int *
 }
 
 int
-sharkd_load_cap_file(void)
+sharkd_load_cap_file(gboolean use_index)
 {
-    return load_cap_file(&cfile, 0, 0);
+    return load_cap_file(&cfile, 0, 0, use_index);
 }
 
 frame_data *
@@ -604,21 +660,27 @@ sharkd_retap(void)
     return 0;
 }
 
+/*
+ * Apply the display filter dftext to the frames from first_framenum on,
+ * setting bit (framenum % 8) of result[framenum / 8] for each frame that
+ * passes it; result must have room for cfile.count frames. *prev_dis_num
+ * is the last frame before first_framenum that passed the filter, and is
+ * updated as frames pass it.
+ *
+ * Returns -1 if the filter is invalid, 0 if it matches all frames (result
+ * is left alone), and 1 otherwise.
+ */
 int
-sharkd_filter(const char *dftext, guint8 **result)
+sharkd_filter(const char *dftext, guint32 first_framenum, guint32 *prev_dis_num, guint8 *result)
 {
     dfilter_t  *dfcode = NULL;
 
-    guint32 framenum, prev_dis_num = 0;
-    guint32 frames_count;
+    guint32 framenum;
     Buffer buf;
     wtap_rec rec;
     int err;
     char *err_info = NULL;
 
-    guint8 *result_bits;
-    guint8  passed_bits;
-
     epan_dissect_t edt;
 
     if (!dfilter_compile(dftext, &dfcode, NULL)) {
@@ -627,27 +689,16 @@ sharkd_filter(const char *dftext, guint8 **result)
 
     /* if dfilter_compile() success, but (dfcode == NULL) all frames are matching */
     if (dfcode == NULL) {
-        *result = NULL;
         return 0;
     }
 
-    frames_count = cfile.count;
-
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
     epan_dissect_init(&edt, cfile.epan, TRUE, FALSE);
 
-    passed_bits = 0;
-    result_bits = (guint8 *) g_malloc(2 + (frames_count / 8));
-
-    for (framenum = 1; framenum <= frames_count; framenum++) {
+    for (framenum = first_framenum; framenum <= cfile.count; framenum++) {
         frame_data *fdata = sharkd_get_frame(framenum);
 
-        if ((framenum & 7) == 0) {
-            result_bits[(framenum / 8) - 1] = passed_bits;
-            passed_bits = 0;
-        }
-
         if (!wtap_seek_read(cfile.provider.wth, fdata->file_off, &rec, &buf, &err, &err_info))
             break;
 
@@ -656,14 +707,14 @@ sharkd_filter(const char *dftext, guint8 **result)
 
         fdata->ref_time = FALSE;
         fdata->frame_ref_num = (framenum != 1) ? 1 : 0;
-        fdata->prev_dis_num = prev_dis_num;
+        fdata->prev_dis_num = *prev_dis_num;
         epan_dissect_run(&edt, cfile.cd_t, &rec,
                 frame_tvbuff_new_buffer(&cfile.provider, fdata, &buf),
                 fdata, NULL);
 
         if (dfilter_apply_edt(dfcode, &edt)) {
-            passed_bits |= (1 << (framenum % 8));
-            prev_dis_num = framenum;
+            result[framenum / 8] |= 1 << (framenum % 8);
+            *prev_dis_num = framenum;
         }
 
         /* if passed or ref -> frame_data_set_after_dissect */
@@ -672,19 +723,13 @@ sharkd_filter(const char *dftext, guint8 **result)
         epan_dissect_reset(&edt);
     }
 
-    if ((framenum & 7) == 0)
-        framenum--;
-    result_bits[framenum / 8] = passed_bits;
-
     wtap_rec_cleanup(&rec);
     ws_buffer_free(&buf);
     epan_dissect_cleanup(&edt);
 
     dfilter_free(dfcode);
 
-    *result = result_bits;
-
-    return framenum;
+    return 1;
 }
 
 /*
@@ -30,9 +30,9 @@ typedef void (*sharkd_dissect_func_t)(epan_dissect_t *edt, proto_tree *tree, str
 
 /* sharkd.c */
 cf_status_t sharkd_cf_open(const char *fname, unsigned int type, gboolean is_tempfile, int *err);
-int sharkd_load_cap_file(void);
+int sharkd_load_cap_file(gboolean use_index);
 int sharkd_retap(void);
-int sharkd_filter(const char *dftext, guint8 **result);
+int sharkd_filter(const char *dftext, guint32 first_framenum, guint32 *prev_dis_num, guint8 *result);
 frame_data *sharkd_get_frame(guint32 framenum);
 enum dissect_request_status {
   DISSECT_REQUEST_SUCCESS,
@@ -53,6 +53,10 @@ const char *sharkd_version(void);
 /* sharkd_daemon.c */
 int sharkd_init(int argc, char **argv);
 int sharkd_loop(int argc _U_, char* argv[] _U_);
+#ifndef _WIN32
+gboolean sharkd_shared_attach(const char *fname, guint32 rpcid, const guint8 *pending, size_t pending_len);
+gboolean sharkd_shared_publish(const char *fname, guint32 *rpcid, GByteArray *pending);
+#endif
 
 /* sharkd_session.c */
 int sharkd_session_main(int mode_setting);
@@ -25,6 +25,7 @@
 #include <wsutil/win32-utils.h>
 #endif
 
+#include <wsutil/file_util.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/socket.h>
 #include <wsutil/inet_addr.h>
@@ -34,7 +35,10 @@
 
 #ifndef _WIN32
 #include <sys/un.h>
+#include <sys/stat.h>
 #include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
 #endif
 
 #include <wsutil/strtoi.h>
@@ -473,3 +477,385 @@ sharkd_loop(int argc _U_, char* argv[])
     }
     return 0;
 }
+
+#ifndef _WIN32
+/*
+ * Sessions that load the same file with "shared" set are served by forks
+ * of a template process, which keeps the file loaded and listens on a
+ * local socket named after the daemon and the file. A new session hands
+ * its client connection over to the template instead of reading the file
+ * again; the template forks, and the child carries on with the session,
+ * sharing the template's frames and dissection state copy-on-write.
+ */
+
+/* Seconds without a new session after which a template goes away. */
+#define SHARKD_SHARED_IDLE_TIMEOUT 600
+
+/* Most unread input a session can hand over with its connection. */
+#define SHARKD_SHARED_MAX_PENDING (1024 * 1024)
+
+/* Sent along with the client connection. */
+typedef struct {
+    guint32 rpcid;
+    guint32 pending_len;
+} sharkd_shared_hdr_t;
+
+static char *
+sharkd_shared_socket_path(const char *fname)
+{
+    char *abs_name, *key, *digest, *path;
+
+    abs_name = realpath(fname, NULL);
+    if (abs_name == NULL)
+        return NULL;
+
+    /* Only sessions of the same daemon have the same configuration. */
+    key = ws_strdup_printf("%d:%s", (int) getppid(), abs_name);
+    free(abs_name);
+    digest = g_compute_checksum_for_string(G_CHECKSUM_SHA256, key, -1);
+    g_free(key);
+    path = ws_strdup_printf("%s/sharkd-%.32s.sock", g_get_user_runtime_dir(), digest);
+    g_free(digest);
+
+    if (strlen(path) >= sizeof(((struct sockaddr_un *) NULL)->sun_path))
+    {
+        g_free(path);
+        return NULL;
+    }
+    return path;
+}
+
+static int
+sharkd_shared_socket(const char *path, struct sockaddr_un *s_un)
+{
+    memset(s_un, 0, sizeof(*s_un));
+    s_un->sun_family = AF_UNIX;
+    (void) g_strlcpy(s_un->sun_path, path, sizeof(s_un->sun_path));
+
+    return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+static gboolean
+sharkd_shared_write(int fd, const void *data, size_t len)
+{
+    const guint8 *p = (const guint8 *) data;
+    ssize_t n;
+
+    while (len > 0)
+    {
+        n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+        p += n;
+        len -= (size_t) n;
+    }
+    return TRUE;
+}
+
+static gboolean
+sharkd_shared_read(int fd, void *data, size_t len)
+{
+    guint8 *p = (guint8 *) data;
+    ssize_t n;
+
+    while (len > 0)
+    {
+        n = read(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+        p += n;
+        len -= (size_t) n;
+    }
+    return TRUE;
+}
+
+gboolean
+sharkd_shared_attach(const char *fname, guint32 rpcid, const guint8 *pending, size_t pending_len)
+{
+    struct sockaddr_un s_un;
+    sharkd_shared_hdr_t hdr;
+    struct msghdr msg;
+    struct iovec iov;
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    struct cmsghdr *cmsg;
+    char *path;
+    int fd;
+    guint8 ack = 0;
+
+    if (pending_len > SHARKD_SHARED_MAX_PENDING)
+        return FALSE;
+
+    path = sharkd_shared_socket_path(fname);
+    if (path == NULL)
+        return FALSE;
+
+    fd = sharkd_shared_socket(path, &s_un);
+    g_free(path);
+    if (fd < 0)
+        return FALSE;
+
+    if (connect(fd, (struct sockaddr *) &s_un, sizeof(s_un)) != 0)
+    {
+        close(fd);
+        return FALSE;
+    }
+
+    hdr.rpcid = rpcid;
+    hdr.pending_len = (guint32) pending_len;
+    iov.iov_base = &hdr;
+    iov.iov_len = sizeof(hdr);
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&ctl, 0, sizeof(ctl));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    /* stdin and stdout are both the client connection. */
+    *(int *) CMSG_DATA(cmsg) = 0;
+
+    if (sendmsg(fd, &msg, 0) != (ssize_t) sizeof(hdr) ||
+            !sharkd_shared_write(fd, pending, pending_len) ||
+            !sharkd_shared_read(fd, &ack, 1))
+    {
+        ack = 0;
+    }
+
+    close(fd);
+    return ack == 1;
+}
+
+/*
+ * Receive a client connection handed over by sharkd_shared_attach().
+ * Returns the connection, or -1.
+ */
+static int
+sharkd_shared_receive(int conn, guint32 *rpcid, GByteArray *pending)
+{
+    sharkd_shared_hdr_t hdr;
+    struct msghdr msg;
+    struct iovec iov;
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+    struct cmsghdr *cmsg;
+    int client_fd = -1;
+    ssize_t n;
+
+    iov.iov_base = &hdr;
+    iov.iov_len = sizeof(hdr);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+
+    do
+        n = recvmsg(conn, &msg, 0);
+    while (n < 0 && errno == EINTR);
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); n > 0 && cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+            memcpy(&client_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (client_fd < 0)
+        return -1;
+
+    if (n != (ssize_t) sizeof(hdr) || hdr.pending_len > SHARKD_SHARED_MAX_PENDING)
+    {
+        close(client_fd);
+        return -1;
+    }
+
+    g_byte_array_set_size(pending, hdr.pending_len);
+    if (!sharkd_shared_read(conn, pending->data, hdr.pending_len))
+    {
+        close(client_fd);
+        return -1;
+    }
+
+    *rpcid = hdr.rpcid;
+    return client_fd;
+}
+
+static gboolean
+sharkd_shared_file_changed(const char *fname, const ws_statb64 *orig)
+{
+    ws_statb64 st;
+
+    if (ws_stat64(fname, &st) != 0)
+        return TRUE;
+
+    return st.st_size != orig->st_size || st.st_mtime != orig->st_mtime ||
+        st.st_ino != orig->st_ino || st.st_dev != orig->st_dev;
+}
+
+/*
+ * Create the socket of a template, accessible only by our user from the
+ * start. Returns the socket, or -1 if another template serves the file.
+ */
+static int
+sharkd_shared_bind(const char *path, struct sockaddr_un *s_un)
+{
+    mode_t old_mask;
+    int fd, probe_fd, ret;
+
+    fd = sharkd_shared_socket(path, s_un);
+    if (fd < 0)
+        return -1;
+
+    old_mask = umask(S_IRWXG | S_IRWXO);
+    ret = bind(fd, (struct sockaddr *) s_un, sizeof(*s_un));
+    if (ret != 0 && errno == EADDRINUSE)
+    {
+        /*
+         * If another session got there first, it serves the file, but
+         * the socket may be left over from a template that was killed;
+         * nothing accepts connections on that.
+         */
+        probe_fd = sharkd_shared_socket(path, s_un);
+        if (probe_fd >= 0 &&
+                connect(probe_fd, (struct sockaddr *) s_un, sizeof(*s_un)) != 0 &&
+                errno == ECONNREFUSED)
+        {
+            unlink(path);
+            ret = bind(fd, (struct sockaddr *) s_un, sizeof(*s_un));
+        }
+        if (probe_fd >= 0)
+            close(probe_fd);
+    }
+    umask(old_mask);
+
+    if (ret != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+gboolean
+sharkd_shared_publish(const char *fname, guint32 *rpcid, GByteArray *pending)
+{
+    struct sockaddr_un s_un;
+    struct pollfd pfd;
+    ws_statb64 st;
+    char *path;
+    int listen_fd, conn, client_fd, null_fd;
+    pid_t pid;
+    guint8 ack;
+
+    if (ws_stat64(fname, &st) != 0)
+        return FALSE;
+
+    path = sharkd_shared_socket_path(fname);
+    if (path == NULL)
+        return FALSE;
+
+    /* Anything buffered would be written twice. */
+    fflush(stdout);
+
+    pid = fork();
+    if (pid != 0)
+    {
+        if (pid == -1)
+            fprintf(stderr, "cannot fork() shared session: %s\n", g_strerror(errno));
+        g_free(path);
+        return FALSE;
+    }
+
+    /* Template: let go of the client connection of the session it was forked from. */
+    null_fd = ws_open("/dev/null", O_RDWR, 0);
+    if (null_fd >= 0)
+    {
+        dup2(null_fd, 0);
+        dup2(null_fd, 1);
+        close(null_fd);
+    }
+
+    listen_fd = sharkd_shared_bind(path, &s_un);
+    if (listen_fd < 0)
+        _exit(0);
+    if (listen(listen_fd, SOMAXCONN) != 0)
+    {
+        unlink(path);
+        _exit(0);
+    }
+
+    pfd.fd = listen_fd;
+    pfd.events = POLLIN;
+
+    for (;;)
+    {
+        int ret = poll(&pfd, 1, SHARKD_SHARED_IDLE_TIMEOUT * 1000);
+
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            break;
+
+        conn = accept(listen_fd, NULL, NULL);
+        if (conn < 0)
+            continue;
+
+        client_fd = sharkd_shared_receive(conn, rpcid, pending);
+        if (client_fd < 0)
+        {
+            close(conn);
+            continue;
+        }
+
+        /* Refuse to serve a file that has changed since it was loaded; the session will load it itself. */
+        if (sharkd_shared_file_changed(fname, &st))
+        {
+            ack = 0;
+            (void) sharkd_shared_write(conn, &ack, 1);
+            close(client_fd);
+            close(conn);
+            break;
+        }
+
+        pid = fork();
+        if (pid == 0)
+        {
+            close(listen_fd);
+            g_free(path);
+
+            ack = 1;
+            (void) sharkd_shared_write(conn, &ack, 1);
+            close(conn);
+
+            /* redirect stdin, stdout to socket */
+            dup2(client_fd, 0);
+            dup2(client_fd, 1);
+            close(client_fd);
+            return TRUE;
+        }
+
+        if (pid == -1)
+        {
+            fprintf(stderr, "cannot fork() shared session: %s\n", g_strerror(errno));
+            ack = 0;
+            (void) sharkd_shared_write(conn, &ack, 1);
+        }
+        close(client_fd);
+        close(conn);
+    }
+
+    unlink(path);
+    _exit(0);
+}
+#endif
@@ -25,6 +25,7 @@
 #include <wsutil/json_dumper.h>
 #include <wsutil/ws_assert.h>
 #include <wsutil/wsgcrypt.h>
+#include <wsutil/file_util.h>
 
 #include <file.h>
 #include <epan/epan_dissect.h>
@@ -71,6 +72,7 @@
 
 #include <epan/maxmind_db.h>
 
+#include <wsutil/bits_count_ones.h>
 #include <wsutil/pint.h>
 #include <wsutil/strnatcmp.h>
 #include <wsutil/strtoi.h>
@@ -79,15 +81,30 @@
 
 #include "sharkd.h"
 
+/* Number of frames of a filtered view between two entries of its ranks. */
+#define SHARKD_FILTER_RANK_FRAMES 4096
+
+/*
+ * A filtered view of the frames, computed once per filter and extended
+ * when there are more frames than it covers.
+ */
 struct sharkd_filter_item
 {
-    guint8 *filtered; /* can be NULL if all frames are matching for given filter. */
+    guint8 *filtered;     /* can be NULL if all frames are matching for given filter. */
+    guint32 frames;       /* count of frames the filter has been applied to */
+    guint32 passed;       /* count of those that passed it */
+    guint32 prev_dis_num; /* last of those that passed it */
+    guint32 *ranks;       /* ranks[i] - count of passed frames before frame i * SHARKD_FILTER_RANK_FRAMES */
 };
 
 static GHashTable *filter_table;
 
 static int mode;
 static guint32 rpcid;
+static guint32 request_count;
+
+/* Input read from the client but not yet processed. */
+static GByteArray *session_input;
 
 static json_dumper dumper;
 
@@ -439,6 +456,8 @@ json_prep(char* buf, const jsmntok_t* tokens, int count)
         {"iograph",    "filter8",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"iograph",    "filter9",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"load",       "file",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
+        {"load",       "index",          2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  SHARKD_OPTIONAL},
+        {"load",       "shared",         2, JSMN_PRIMITIVE,    SHARKD_JSON_BOOLEAN,  SHARKD_OPTIONAL},
         {"setcomment", "frame",          2, JSMN_PRIMITIVE,    SHARKD_JSON_UINTEGER, SHARKD_MANDATORY},
         {"setcomment", "comment",        2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_OPTIONAL},
         {"setconf",    "name",           2, JSMN_STRING,       SHARKD_JSON_STRING,   SHARKD_MANDATORY},
@@ -727,9 +746,80 @@ sharkd_session_filter_free(gpointer data)
     struct sharkd_filter_item *l = (struct sharkd_filter_item *) data;
 
     g_free(l->filtered);
+    g_free(l->ranks);
     g_free(l);
 }
 
+static guint32
+sharkd_session_filter_count(const guint8 *bits, size_t len)
+{
+    guint32 count = 0;
+
+    for (; len >= 8; bits += 8, len -= 8)
+        count += ws_count_ones(pletoh64(bits));
+    for (; len > 0; bits++, len--)
+        count += ws_count_ones(*bits);
+    return count;
+}
+
+/*
+ * Apply the filter of a view to the frames that have been read since it
+ * was last applied.
+ */
+static gboolean
+sharkd_session_filter_extend(struct sharkd_filter_item *l, const char *filter)
+{
+    size_t old_len, new_len, block_start, block_end;
+    guint32 old_blocks, new_blocks, block;
+    int ret;
+
+    if (l->frames != 0 && l->filtered == NULL)
+    {
+        l->frames = l->passed = cfile.count;
+        return TRUE;
+    }
+
+    if (l->frames != 0 && l->frames == cfile.count)
+        return TRUE;
+
+    old_len = l->filtered ? l->frames / 8 + 1 : 0;
+    new_len = cfile.count / 8 + 1;
+    l->filtered = (guint8 *) g_realloc(l->filtered, new_len);
+    memset(l->filtered + old_len, 0, new_len - old_len);
+
+    ret = sharkd_filter(filter, l->frames + 1, &l->prev_dis_num, l->filtered);
+    if (ret == -1)
+        return FALSE;
+
+    if (ret == 0)
+    {
+        g_free(l->filtered);
+        l->filtered = NULL;
+        l->frames = l->passed = cfile.count;
+        return TRUE;
+    }
+
+    /* The ranks up to the block of the first new frame are unchanged. */
+    old_blocks = l->ranks ? l->frames / SHARKD_FILTER_RANK_FRAMES + 1 : 0;
+    new_blocks = cfile.count / SHARKD_FILTER_RANK_FRAMES + 1;
+    l->ranks = g_renew(guint32, l->ranks, new_blocks);
+    if (old_blocks == 0)
+        l->ranks[old_blocks++] = 0;
+    for (block = old_blocks; block < new_blocks; block++)
+    {
+        block_start = (size_t) (block - 1) * (SHARKD_FILTER_RANK_FRAMES / 8);
+        l->ranks[block] = l->ranks[block - 1] +
+            sharkd_session_filter_count(l->filtered + block_start, SHARKD_FILTER_RANK_FRAMES / 8);
+    }
+
+    block_start = (size_t) (new_blocks - 1) * (SHARKD_FILTER_RANK_FRAMES / 8);
+    block_end = new_len;
+    l->passed = l->ranks[new_blocks - 1] +
+        sharkd_session_filter_count(l->filtered + block_start, block_end - block_start);
+    l->frames = cfile.count;
+    return TRUE;
+}
+
 static const struct sharkd_filter_item *
 sharkd_session_filter_data(const char *filter)
 {
@@ -738,22 +828,106 @@ sharkd_session_filter_data(const char *filter)
     l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, filter);
     if (!l)
     {
-        guint8 *filtered = NULL;
-
-        int ret = sharkd_filter(filter, &filtered);
+        l = g_new0(struct sharkd_filter_item, 1);
 
-        if (ret == -1)
+        if (!sharkd_session_filter_extend(l, filter))
+        {
+            sharkd_session_filter_free(l);
             return NULL;
-
-        l = g_new(struct sharkd_filter_item, 1);
-        l->filtered = filtered;
+        }
 
         g_hash_table_insert(filter_table, g_strdup(filter), l);
     }
+    else if (!sharkd_session_filter_extend(l, filter))
+        return NULL;
 
     return l;
 }
 
+/*
+ * Return the number of the frame at position n (from 0) of a filtered
+ * view, or 0 if fewer frames passed the filter.
+ */
+static guint32
+sharkd_session_filter_nth(const struct sharkd_filter_item *l, guint32 n)
+{
+    guint32 lo, hi, mid, count;
+    size_t pos, len;
+
+    if (n >= l->passed)
+        return 0;
+
+    if (l->filtered == NULL)
+        return n + 1;
+
+    /* Find the last block with no more than n frames before it. */
+    lo = 0;
+    hi = l->frames / SHARKD_FILTER_RANK_FRAMES;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo + 1) / 2;
+        if (l->ranks[mid] <= n)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    n -= l->ranks[lo];
+
+    len = l->frames / 8 + 1;
+    for (pos = (size_t) lo * (SHARKD_FILTER_RANK_FRAMES / 8); pos < len; pos++)
+    {
+        count = ws_count_ones(l->filtered[pos]);
+        if (n < count)
+        {
+            for (guint bit = 0; bit < 8; bit++)
+            {
+                if ((l->filtered[pos] & (1 << bit)) && n-- == 0)
+                    return (guint32) (pos * 8 + bit);
+            }
+        }
+        n -= count;
+    }
+    return 0;
+}
+
+/*
+ * Return the number of the first frame after framenum in a filtered view,
+ * or 0 if there's none.
+ */
+static guint32
+sharkd_session_filter_next(const struct sharkd_filter_item *l, guint32 framenum)
+{
+    size_t pos, len;
+    guint8 bits;
+
+    if (l == NULL || l->filtered == NULL)
+        return framenum < cfile.count ? framenum + 1 : 0;
+
+    framenum++;
+    len = l->frames / 8 + 1;
+    pos = framenum / 8;
+    if (pos >= len)
+        return 0;
+
+    /* The rest of the current byte, then whole bytes. */
+    bits = l->filtered[pos] >> (framenum % 8);
+    if (bits == 0)
+    {
+        while (++pos < len && l->filtered[pos] == 0)
+            ;
+        if (pos == len)
+            return 0;
+        framenum = (guint32) (pos * 8);
+        bits = l->filtered[pos];
+    }
+    while (!(bits & 1))
+    {
+        bits >>= 1;
+        framenum++;
+    }
+    return framenum;
+}
+
 static gboolean
 sharkd_rtp_match_init(rtpstream_id_t *id, const char *init_str)
 {
@@ -1162,7 +1336,16 @@ sharkd_session_process_info(void)
  * Process load request
  *
  * Input:
- *   (m) file - file to be loaded
+ *   (m) file  - file to be loaded
+ *   (o) index - if true, load the frames from the file's index file
+ *               if it's up to date, and write one after reading the
+ *               file otherwise; the frames are then dissected when
+ *               they're first requested instead of when loading
+ *   (o) shared - if true, and this is the first request of a session of
+ *                a daemon, share the loaded file with the other sessions
+ *                loading it the same way: the first one loads it, and the
+ *                others are served by copies of it instead of reading and
+ *                dissecting the file again
  *
  * Output object with attributes:
  *   (m) err - error code
@@ -1171,6 +1354,9 @@ static void
 sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 {
     const char *tok_file = json_find_attr(buf, tokens, count, "file");
+    const char *tok_index = json_find_attr(buf, tokens, count, "index");
+    const char *tok_shared = json_find_attr(buf, tokens, count, "shared");
+    gboolean shared = FALSE;
     int err = 0;
 
     if (!tok_file)
@@ -1178,6 +1364,20 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
 
     fprintf(stderr, "load: filename=%s\n", tok_file);
 
+#ifndef _WIN32
+    shared = tok_shared != NULL && !strcmp(tok_shared, "true") && request_count == 1 &&
+        (mode == SHARKD_MODE_CLASSIC_DAEMON || mode == SHARKD_MODE_GOLD_DAEMON);
+
+    if (shared && sharkd_shared_attach(tok_file, rpcid, session_input->data, session_input->len))
+    {
+        /* The session now runs in a copy of the session that loaded the file. */
+        fprintf(stderr, "load: handed over to shared session\n");
+        exit(0);
+    }
+#else
+    (void) tok_shared;
+#endif
+
     if (sharkd_cf_open(tok_file, WTAP_TYPE_AUTO, FALSE, &err) != CF_OK)
     {
         sharkd_json_error(
@@ -1187,9 +1387,12 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
         return;
     }
 
+    /* The filtered views were for the frames of the previous file. */
+    g_hash_table_remove_all(filter_table);
+
     TRY
     {
-        err = sharkd_load_cap_file();
+        err = sharkd_load_cap_file(tok_index != NULL && !strcmp(tok_index, "true"));
     }
     CATCH(OutOfMemoryError)
     {
@@ -1202,6 +1405,23 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
     }
     ENDTRY;
 
+#ifndef _WIN32
+    if (err == 0 && shared && sharkd_shared_publish(tok_file, &rpcid, session_input))
+    {
+        /*
+         * We're a copy serving another client; don't share the file
+         * position or the resolver with the session we were copied from.
+         */
+        fprintf(stderr, "load: shared session for filename=%s\n", tok_file);
+        wtap_fdreopen(cfile.provider.wth, cfile.filename, &err);
+#ifdef HAVE_MAXMINDDB
+        uat_get_table_by_name("MaxMind Database Paths")->post_update_cb();
+#endif
+    }
+#else
+    (void) shared;
+#endif
+
     if (err == 0)
     {
         sharkd_json_simple_ok(rpcid);
@@ -1541,7 +1761,9 @@ sharkd_session_process_frames_cb(epan_dissect_t *edt, proto_tree *tree _U_,
  * Input:
  *   (o) column0...columnXX - requested columns either number in range [0..NUM_COL_FMTS), or custom (syntax <dfilter>:<occurrence>).
  *                            If column0 is not specified default column set will be used.
- *   (o) filter - filter to be used
+ *   (o) filter - filter to be used; the frames that pass it are worked out
+ *                once, and the result is reused by later requests, so that
+ *                paging through them with skip and limit is cheap
  *   (o) skip=N   - skip N frames
  *   (o) limit=N  - show only N frames
  *   (o) refs  - list (comma separated) with sorted time reference frame numbers.
@@ -1565,12 +1787,13 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
     const char *tok_limit  = json_find_attr(buf, tokens, count, "limit");
     const char *tok_refs   = json_find_attr(buf, tokens, count, "refs");
 
-    const guint8 *filter_data = NULL;
+    const struct sharkd_filter_item *filter_item = NULL;
 
     guint32 prev_dis_num = 0;
     guint32 current_ref_frame = 0, next_ref_frame = G_MAXUINT32;
     guint32 skip;
     guint32 limit;
+    guint32 first_framenum;
 
     wtap_rec rec; /* Record metadata */
     Buffer rec_buf;   /* Record data */
@@ -1593,8 +1816,6 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 
     if (tok_filter)
     {
-        const struct sharkd_filter_item *filter_item;
-
         filter_item = sharkd_session_filter_data(tok_filter);
         if (!filter_item)
         {
@@ -1604,8 +1825,6 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
                     );
             return;
         }
-
-        filter_data = filter_item->filtered;
     }
 
     skip = 0;
@@ -1628,12 +1847,25 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
             return;
     }
 
+    /* Go straight to the first frame of the page. */
+    if (filter_item)
+    {
+        first_framenum = sharkd_session_filter_nth(filter_item, skip);
+        if (skip)
+            prev_dis_num = sharkd_session_filter_nth(filter_item, skip - 1);
+    }
+    else
+    {
+        first_framenum = (skip < cfile.count) ? skip + 1 : 0;
+        prev_dis_num = MIN(skip, cfile.count);
+    }
+
     sharkd_json_result_array_prologue(rpcid);
 
     wtap_rec_init(&rec);
     ws_buffer_init(&rec_buf, 1514);
 
-    for (guint32 framenum = 1; framenum <= cfile.count; framenum++)
+    for (guint32 framenum = first_framenum; framenum != 0; framenum = sharkd_session_filter_next(filter_item, framenum))
     {
         frame_data *fdata;
         guint32 ref_frame = (framenum != 1) ? 1 : 0;
@@ -1641,16 +1873,6 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
         int err;
         gchar *err_info;
 
-        if (filter_data && !(filter_data[framenum / 8] & (1 << (framenum % 8))))
-            continue;
-
-        if (skip)
-        {
-            skip--;
-            prev_dis_num = framenum;
-            continue;
-        }
-
         if (tok_refs)
         {
             if (framenum >= next_ref_frame)
@@ -5962,6 +6184,45 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
     }
 }
 
+/*
+ * Read a line of input, like fgets() on stdin, but keeping what's been
+ * read past it in session_input, so that it can be handed over to another
+ * process along with the connection.
+ */
+static gboolean
+sharkd_session_read_line(char *buf, size_t size)
+{
+    guint8 chunk[8 * 1024];
+    gboolean eof = FALSE;
+    guint8 *eol;
+    size_t len;
+    ws_file_ssize_t n;
+
+    for (;;)
+    {
+        eol = (guint8 *) memchr(session_input->data, '\n', session_input->len);
+        if (eol != NULL || session_input->len >= size - 1 || (eof && session_input->len > 0))
+        {
+            len = eol != NULL ? (size_t)(eol - session_input->data) + 1 : session_input->len;
+            len = MIN(len, size - 1);
+            memcpy(buf, session_input->data, len);
+            buf[len] = '\0';
+            g_byte_array_remove_range(session_input, 0, (guint) len);
+            return TRUE;
+        }
+        if (eof)
+            return FALSE;
+
+        n = ws_read(0, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            eof = TRUE;
+        else
+            g_byte_array_append(session_input, chunk, (guint) n);
+    }
+}
+
 int
 sharkd_session_main(int mode_setting)
 {
@@ -5984,11 +6245,15 @@ sharkd_session_main(int mode_setting)
 
     set_resolution_synchrony(TRUE);
 
-    while (fgets(buf, sizeof(buf), stdin))
+    session_input = g_byte_array_new();
+
+    while (sharkd_session_read_line(buf, sizeof(buf)))
     {
         /* every command is line separated JSON */
         int ret;
 
+        request_count++;
+
         ret = json_parse(buf, NULL, 0);
         if (ret <= 0)
         {
@@ -6026,6 +6291,7 @@ sharkd_session_main(int mode_setting)
     }
 
     g_hash_table_destroy(filter_table);
+    g_byte_array_free(session_input, TRUE);
     g_free(tokens);
 
     return 0;
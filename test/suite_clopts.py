@@ -9,6 +9,7 @@
 '''Command line option tests'''
 
 import json
+import re
 import sys
 import os.path
 import subprocess
@@ -128,6 +129,32 @@ class TestTsharkOptions:
         assert obj.get('ip.proto', 'NOT FOUND') == ['6']
         assert obj.get('http.host', 'NOT FOUND') == 'NOT FOUND'
 
+    def test_tshark_workers(self, cmd_tshark, capture_file, test_env):
+        '''--workers output matches a single process'''
+        if sys.platform == 'win32':
+            pytest.skip('--workers is not available on Windows')
+        args = (cmd_tshark, "-r", capture_file("dns+icmp.pcapng.gz"),
+                "-Tfields", "-eframe.number", "-eip.src", "-eip.dst")
+        single = subprocesstest.run(args, capture_output=True, env=test_env)
+        assert single.returncode == ExitCodes.OK
+        parallel = subprocesstest.run(args + ("--workers", "3"), capture_output=True, env=test_env)
+        assert parallel.returncode == ExitCodes.OK
+        assert parallel.stdout == single.stdout
+
+    def test_tshark_workers_autostop_packets(self, cmd_tshark, capture_file, test_env):
+        '''--workers stops after as many printed packets as a single process'''
+        if sys.platform == 'win32':
+            pytest.skip('--workers is not available on Windows')
+        args = (cmd_tshark, "-r", capture_file("dns+icmp.pcapng.gz"),
+                "-Y", "dns", "-a", "packets:5",
+                "-Tfields", "-eframe.number", "-eip.src", "-eip.dst")
+        single = subprocesstest.run(args, capture_output=True, env=test_env)
+        assert single.returncode == ExitCodes.OK
+        assert len(single.stdout.splitlines()) == 5
+        parallel = subprocesstest.run(args + ("--workers", "3"), capture_output=True, env=test_env)
+        assert parallel.returncode == ExitCodes.OK
+        assert parallel.stdout == single.stdout
+
 
 class TestTsharkCaptureClopts:
     def test_tshark_invalid_capfilter(self, cmd_tshark, capture_interface, result_file, test_env):
@@ -314,6 +341,141 @@ class TestTsharkZExpert:
         assert not grep_output(proc.stdout, 'Chats')
 
 
+def stats_tree_rows(text):
+    '''Return the (path, count) rows of a -z <tree>,tree plain text table.'''
+    rows = []
+    path = []
+    in_table = False
+    for line in text.splitlines():
+        if line.startswith('---'):
+            in_table = True
+            continue
+        if line.startswith('==='):
+            in_table = False
+            continue
+        m = re.match(r'^( *)(.*?)\s+(\d+)(\s|$)', line)
+        if not in_table or not m:
+            continue
+        depth = len(m.group(1))
+        path = path[:depth] + [m.group(2)]
+        rows.append(('/'.join(path), int(m.group(3))))
+    return sorted(rows)
+
+
+def expected_stats_tree_rows(tree):
+    '''Flatten a {name: (count, {children})} tree the same way.'''
+    rows = []
+    def add(prefix, children):
+        for name, (count, grandchildren) in children.items():
+            rows.append((prefix + name, count))
+            add(prefix + name + '/', grandchildren)
+    add('', tree)
+    return sorted(rows)
+
+
+def tick_stats_tree(children, names):
+    '''Tick the node at the path names, creating it if needed.'''
+    for name in names:
+        count, grandchildren = children.get(name, (0, {}))
+        children[name] = (count + 1, grandchildren)
+        children = grandchildren
+
+
+class TestTsharkZStatsTree:
+    # Trees that look their nodes up by address, port or status code must
+    # print exactly the nodes and counts the per-packet fields give, as
+    # they did when they named their nodes with formatted strings.
+
+    @pytest.mark.parametrize('pcap_file', ['http.pcap', 'dhcp.pcap'])
+    def test_tshark_z_dests_tree(self, cmd_tshark, capture_file, test_env, pcap_file):
+        root = 'IPv4 Statistics//Destinations and Ports'
+        fields = subprocesstest.run((cmd_tshark, '-Y', 'ip',
+            '-T', 'fields', '-e', 'ip.dst', '-e', 'tcp.dstport', '-e', 'udp.dstport',
+            '-E', 'occurrence=l',
+            '-r', capture_file(pcap_file)), capture_output=True, env=test_env)
+        tree = {root: (0, {})}
+        for line in fields.stdout.splitlines():
+            ip_dst, tcp_port, udp_port = line.split('\t')
+            if tcp_port:
+                tick_stats_tree(tree, (root, ip_dst, 'TCP', tcp_port))
+            else:
+                tick_stats_tree(tree, (root, ip_dst, 'UDP', udp_port))
+
+        proc = subprocesstest.run((cmd_tshark, '-q', '-z', 'dests,tree',
+            '-r', capture_file(pcap_file)), capture_output=True, env=test_env)
+        assert proc.returncode == 0
+        assert stats_tree_rows(proc.stdout) == expected_stats_tree_rows(tree)
+
+    def test_tshark_z_http_tree(self, cmd_tshark, capture_file, test_env):
+        root = 'Total HTTP Packets'
+        groups = {1: '1xx: Informational', 2: '2xx: Success', 3: '3xx: Redirection',
+                  4: '4xx: Client Error', 5: '5xx: Server Error'}
+        fields = subprocesstest.run((cmd_tshark, '-Y', 'http',
+            '-T', 'fields', '-e', 'http.request.method', '-e', 'http.response.code',
+            '-r', capture_file('http.pcap')), capture_output=True, env=test_env)
+        responses = {name: (0, {}) for name in ['???: broken'] + list(groups.values())}
+        tree = {root: (0, {
+            'HTTP Request Packets': (0, {}),
+            'HTTP Response Packets': (0, responses),
+            'Other HTTP Packets': (0, {}),
+        })}
+        for line in fields.stdout.splitlines():
+            methods, codes = line.split('\t')
+            for method in filter(None, methods.split(',')):
+                tick_stats_tree(tree, (root, 'HTTP Request Packets', method))
+            for code in filter(None, codes.split(',')):
+                group = groups.get(int(code) // 100, '???: broken')
+                tick_stats_tree(tree, (root, 'HTTP Response Packets', group, code))
+            if not methods and not codes:
+                tick_stats_tree(tree, (root, 'Other HTTP Packets'))
+
+        proc = subprocesstest.run((cmd_tshark, '-q', '-z', 'http,tree',
+            '-r', capture_file('http.pcap')), capture_output=True, env=test_env)
+        assert proc.returncode == 0
+        # Status codes are followed by their description, e.g. "200 OK".
+        rows = [(re.sub(r'/(\d{3}) [^/]*$', r'/\1', path), count)
+                for path, count in stats_tree_rows(proc.stdout)]
+        assert sorted(rows) == expected_stats_tree_rows(tree)
+
+
+
+class TestTsharkTapThreads:
+    # Statistics consumed on threads of their own must come out the same as
+    # those counted while dissecting.
+
+    @pytest.mark.parametrize('stat', [
+        'http,stat', 'http,tree', 'plen,tree', 'dests,tree',
+        'conv,tcp', 'conv,ip', 'endpoints,tcp', 'endpoints,eth',
+    ])
+    def test_tshark_z_tap_threads(self, cmd_tshark, capture_file, test_env, stat):
+        outputs = []
+        for tap_threads in ((), ('--tap-threads',)):
+            proc = subprocesstest.run((cmd_tshark, '-q', '-z', stat) + tap_threads +
+                ('-r', capture_file('http.pcap'),), capture_output=True, env=test_env)
+            assert proc.returncode == 0
+            outputs.append(proc.stdout)
+        assert '===' in outputs[0]
+        assert outputs[0] == outputs[1]
+
+    def test_tshark_z_shared_filter(self, cmd_tshark, capture_file, test_env):
+        # Listeners with the same filter string share one compiled filter;
+        # each must still see every packet that passes it.
+        fstring = 'tcp.port==80 && frame.len > 100'
+        stats = ('http,tree,' + fstring, 'dests,tree,' + fstring)
+        alone = []
+        for stat in stats:
+            proc = subprocesstest.run((cmd_tshark, '-q', '-z', stat,
+                '-r', capture_file('http.pcap'),), capture_output=True, env=test_env)
+            assert proc.returncode == 0
+            assert '===' in proc.stdout
+            alone.append(proc.stdout)
+        proc = subprocesstest.run((cmd_tshark, '-q', '-z', stats[0], '-z', stats[1],
+            '-r', capture_file('http.pcap'),), capture_output=True, env=test_env)
+        assert proc.returncode == 0
+        for output in alone:
+            assert output in proc.stdout
+
+
 class TestTsharkExtcap:
     # dumpcap dependency has been added to run this test only with capture support
     def test_tshark_extcap_interfaces(self, cmd_tshark, cmd_dumpcap, test_env, home_path):
@@ -115,3 +115,25 @@ class TestDfilterMembership:
         dfilter = 'eth.src in {11:12:13:14:15:16, 22-33-}'
         error = 'Error: "22-33-" is not a valid protocol or protocol field.'
         checkDFilterFail(dfilter, error)
+
+    def test_membership_large_set(self, checkDFilterCount):
+        ports = ', '.join(str(p) for p in range(1000, 3000)) + ', 80'
+        dfilter = 'tcp.port in {{{}}}'.format(ports)
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_overlapping_ranges(self, checkDFilterCount):
+        dfilter = 'tcp.srcport in {1 .. 50, 40 .. 79, 3000 .. 3200, 3150 .. 3266}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_overlapping_ranges_match(self, checkDFilterCount):
+        dfilter = 'tcp.srcport in {1 .. 50, 40 .. 90, 3000 .. 3266, 3260 .. 3268}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_ip_cidr_and_addresses(self, checkDFilterCount):
+        dfilter = 'ip.src in {192.168.0.1, 10.0.0.0/24, 172.16.1.1}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_not_in_large_set(self, checkDFilterCount):
+        ports = ', '.join(str(p) for p in range(1000, 3000))
+        dfilter = 'tcp.dstport not in {{{}}}'.format(ports)
+        checkDFilterCount(dfilter, 1)
@@ -130,6 +130,65 @@ def check_pcapng_dsb_fields(request, cmd_tshark):
     return check_dsb_fields_real
 
 
+class TestFileFormatsCompressed:
+    # Compressed one 256-byte chunk of dhcp.pcap per frame, so that the
+    # frames don't line up with the records.
+    def test_zstd_seekable_two_pass(self, cmd_tshark, capture_file, fileformats_baseline_str, features, test_env):
+        '''Zstandard seekable format, with a seek table, read with random access'''
+        if not features.have_zstd:
+            pytest.skip('Requires zstd.')
+        capture_stdout = subprocess.check_output((cmd_tshark,
+                '-r', capture_file('dhcp-seekable.pcap.zst'),
+                '-2',
+                '-Tfields',
+                '-e', 'frame.number', '-e', 'frame.time_epoch', '-e', 'frame.time_delta',
+                ),
+            encoding='utf-8', env=test_env)
+        assert capture_stdout == fileformats_baseline_str
+
+    def test_lz4_frames_two_pass(self, cmd_tshark, capture_file, fileformats_baseline_str, features, test_env):
+        '''lz4 frames with a skippable frame, read with random access'''
+        if not features.have_lz4:
+            pytest.skip('Requires lz4.')
+        capture_stdout = subprocess.check_output((cmd_tshark,
+                '-r', capture_file('dhcp-frames.pcap.lz4'),
+                '-2',
+                '-Tfields',
+                '-e', 'frame.number', '-e', 'frame.time_epoch', '-e', 'frame.time_delta',
+                ),
+            encoding='utf-8', env=test_env)
+        assert capture_stdout == fileformats_baseline_str
+
+    def check_editcap_compress(self, compress_type, extension, cmd_editcap, cmd_tshark, capture_file, result_file, fileformats_baseline_str, test_env):
+        outfile = result_file('dhcp-compressed.pcap.' + extension)
+        subprocess.check_call((cmd_editcap,
+                '-F', 'pcap',
+                '--compress', compress_type,
+                capture_file('dhcp.pcap'),
+                outfile,
+                ), env=test_env)
+        capture_stdout = subprocess.check_output((cmd_tshark,
+                '-r', outfile,
+                '-2',
+                '-Tfields',
+                '-e', 'frame.number', '-e', 'frame.time_epoch', '-e', 'frame.time_delta',
+                ),
+            encoding='utf-8', env=test_env)
+        assert capture_stdout == fileformats_baseline_str
+
+    def test_editcap_compress_zstd(self, cmd_editcap, cmd_tshark, capture_file, result_file, fileformats_baseline_str, features, test_env):
+        '''Write a zstd compressed file with editcap and read it back'''
+        if not features.have_zstd:
+            pytest.skip('Requires zstd.')
+        self.check_editcap_compress('zstd', 'zst', cmd_editcap, cmd_tshark, capture_file, result_file, fileformats_baseline_str, test_env)
+
+    def test_editcap_compress_lz4(self, cmd_editcap, cmd_tshark, capture_file, result_file, fileformats_baseline_str, features, test_env):
+        '''Write an lz4 compressed file with editcap and read it back'''
+        if not features.have_lz4:
+            pytest.skip('Requires lz4.')
+        self.check_editcap_compress('lz4', 'lz4', cmd_editcap, cmd_tshark, capture_file, result_file, fileformats_baseline_str, test_env)
+
+
 class TestFileFormatsPcapngDsb:
     def test_pcapng_dsb_1(self, cmd_tshark, dirs, capture_file, result_file, check_pcapng_dsb_fields, base_env):
         '''Check that DSBs are preserved while rewriting files.'''
@@ -90,3 +90,21 @@ class TestOutputFormats:
         ''' Check that the option -j works with -Tek.'''
         check_outputformat("ek", extra_args=['-j', 'dhcp'], expected="dhcp-filter.ek",
             multiline=True, env=base_env)
+
+    def test_outputformat_arrow(self, cmd_tshark, capture_file, base_env):
+        '''Checks that -Tarrow writes the fields as typed columns.'''
+        stdout = subprocess.run([cmd_tshark, '-r', capture_file('dhcp.pcap'), '-T', 'arrow',
+                                 '-E', 'occurrence=f', '-e', 'frame.number', '-e', 'ip.src',
+                                 '-e', 'dhcp.type'],
+                                check=True, capture_output=True, env=base_env).stdout
+        # Messages start with a continuation marker, and the stream ends
+        # with an empty one.
+        assert stdout.startswith(b'\xff\xff\xff\xff')
+        assert stdout.endswith(b'\xff\xff\xff\xff\x00\x00\x00\x00')
+
+        pa_ipc = pytest.importorskip('pyarrow.ipc')
+        table = pa_ipc.open_stream(stdout).read_all()
+        assert table.column_names == ['frame.number', 'ip.src', 'dhcp.type']
+        assert str(table.schema.field('frame.number').type) == 'uint32'
+        assert table.column('frame.number').to_pylist() == [1, 2, 3, 4]
+        assert table.column('ip.src').to_pylist()[:2] == [bytes([0, 0, 0, 0]), bytes([192, 168, 0, 1])]
@@ -9,7 +9,14 @@
 '''sharkd tests'''
 
 import json
+import os.path
+import shutil
+import signal
+import socket
 import subprocess
+import sys
+import tempfile
+import time
 import pytest
 from matchers import *
 
@@ -221,6 +228,88 @@ class TestSharkd:
             },
         ))
 
+    def test_sharkd_req_load_index(self, run_sharkd_session, capture_file, result_file):
+        pcap_file = result_file('dhcp.pcap')
+        shutil.copyfile(capture_file('dhcp.pcap'), pcap_file)
+        commands = [json.dumps(x) for x in (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": pcap_file, "index": True}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"frames",
+            "params":{"column0":"frame.time_relative","column1":"frame.len"}
+            },
+        )]
+        # The first load writes the index, the second one uses it.
+        without_index = run_sharkd_session(commands)
+        assert os.path.isfile(pcap_file + '.wsidx')
+        with_index = run_sharkd_session(commands)
+        assert without_index[0] == {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}}
+        assert len(without_index[1]["result"]) == 4
+        assert with_index == without_index
+
+    def test_sharkd_req_load_shared_console(self, check_sharkd_session, capture_file):
+        # Sharing needs a daemon; a console session loads the file itself.
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap'), "shared": True}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"status"},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"frames": 4, "duration": 0.070345000,
+                "filename": "dhcp.pcap", "filesize": 1400,
+                "columns": MatchAny(list), "column_info": MatchAny(list)}},
+        ))
+
+    @pytest.mark.skipif(sys.platform.startswith('win32'), reason='Sharing needs Unix domain sockets')
+    def test_sharkd_req_load_shared_daemon(self, cmd_sharkd, base_env, capture_file):
+        # Socket paths are short, so don't put them in the pytest directory.
+        sock_dir = tempfile.mkdtemp(prefix='sharkd')
+        daemon_sock = os.path.join(sock_dir, 'sharkd.sock')
+        stderr_path = os.path.join(sock_dir, 'stderr.txt')
+        env = dict(base_env, XDG_RUNTIME_DIR=sock_dir)
+        load = {"jsonrpc":"2.0", "id":1, "method":"load",
+                "params":{"file": capture_file('dhcp.pcap'), "shared": True}}
+        status = {"jsonrpc":"2.0", "id":2, "method":"status"}
+
+        def run_session():
+            with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as conn:
+                conn.settimeout(60)
+                conn.connect(daemon_sock)
+                conn.sendall((json.dumps(load) + '\n' + json.dumps(status) + '\n').encode('utf-8'))
+                reader = conn.makefile('r', encoding='utf-8')
+                return (json.loads(reader.readline()), json.loads(reader.readline()))
+
+        # The daemon goes to the background; the sessions and the shared
+        # template it forks stay in the session started here.
+        with open(stderr_path, 'w') as stderr:
+            daemon_proc = subprocess.Popen((cmd_sharkd, 'unix:' + daemon_sock),
+                stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL, stderr=stderr,
+                env=env, start_new_session=True)
+        try:
+            for _ in range(100):
+                if os.path.exists(daemon_sock):
+                    break
+                time.sleep(0.1)
+            first = run_session()
+            second = run_session()
+        finally:
+            try:
+                os.killpg(daemon_proc.pid, signal.SIGTERM)
+            except ProcessLookupError:
+                pass
+            daemon_proc.wait()
+            with open(stderr_path) as stderr:
+                daemon_stderr = stderr.read()
+            shutil.rmtree(sock_dir, ignore_errors=True)
+
+        assert first[0] == {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}}
+        assert first[1]["result"]["frames"] == 4
+        assert second == first
+        # The second session was served by the first one's copy.
+        assert 'load: shared session for filename=' in daemon_stderr
+        assert 'load: handed over to shared session' in daemon_stderr
+
     def test_sharkd_req_frames_delta_times(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"load",
@@ -237,6 +326,26 @@ class TestSharkd:
             },
         ))
 
+    def test_sharkd_req_frames_pages(self, run_sharkd_session, capture_file):
+        frame_filter = "frame.number in {2 9 10 100 700 800}"
+        commands = [json.dumps(x) for x in (
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+             "params":{"file": capture_file('logistics_multicast.pcapng')}
+             },
+            {"jsonrpc":"2.0", "id":2, "method":"frames","params":{"filter":frame_filter,"limit":2}},
+            {"jsonrpc":"2.0", "id":3, "method":"frames","params":{"filter":frame_filter,"skip":2,"limit":2}},
+            {"jsonrpc":"2.0", "id":4, "method":"frames","params":{"filter":frame_filter,"skip":4}},
+            {"jsonrpc":"2.0", "id":5, "method":"frames","params":{"filter":frame_filter,"skip":6}},
+            {"jsonrpc":"2.0", "id":6, "method":"frames","params":{"skip":798,"limit":5}},
+        )]
+        outputs = run_sharkd_session(commands)
+        assert outputs[0] == {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}}
+        assert [f["num"] for f in outputs[1]["result"]] == [2, 9]
+        assert [f["num"] for f in outputs[2]["result"]] == [10, 100]
+        assert [f["num"] for f in outputs[3]["result"]] == [700, 800]
+        assert outputs[4]["result"] == []
+        assert [f["num"] for f in outputs[5]["result"]] == [799, 800, 801, 802, 803]
+
     def test_sharkd_req_frames_comments(self, check_sharkd_session, capture_file):
         check_sharkd_session((
             {"jsonrpc":"2.0", "id":1, "method":"load",
@@ -19,6 +19,14 @@ class TestUnitTests:
         '''exntest'''
         subprocess.check_call(program('exntest'), env=base_env)
 
+    def test_unit_io_graph_item_test(self, program, base_env):
+        '''io_graph_item_test'''
+        subprocess.check_call(program('io_graph_item_test'), env=base_env)
+
+    def test_unit_merge_test(self, program, base_env):
+        '''merge_test'''
+        subprocess.check_call(program('merge_test'), env=base_env)
+
     def test_unit_oids_test(self, program, base_env):
         '''oids_test'''
         subprocess.check_call(program('oids_test'), env=base_env)
@@ -1045,7 +1045,11 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
 
     if (passed) {
         frame_data_set_after_dissect(&fdlocal, &cum_bytes);
-        cf->provider.prev_cap = cf->provider.prev_dis = frame_data_sequence_add(cf->provider.frames, &fdlocal);
+        /* The frames are packed, so we can't hold on to the added one. */
+        prev_dis_frame = *frame_data_sequence_add(cf->provider.frames, &fdlocal);
+        cf->provider.prev_dis = &prev_dis_frame;
+        prev_cap_frame = prev_dis_frame;
+        cf->provider.prev_cap = &prev_cap_frame;
 
         /* If we're not doing dissection then there won't be any dependent frames.
          * More importantly, edt.pi.fd.dependent_frames won't be initialized because
@@ -1142,9 +1146,11 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
                 return FALSE;
             }
         }
-        cf->provider.prev_dis = fdata;
+        prev_dis_frame = *fdata;
+        cf->provider.prev_dis = &prev_dis_frame;
     }
-    cf->provider.prev_cap = fdata;
+    prev_cap_frame = *fdata;
+    cf->provider.prev_cap = &prev_cap_frame;
 
     if (edt) {
         epan_dissect_reset(edt);
@@ -1231,6 +1237,7 @@ process_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
     gboolean     filtering_tap_listeners;
     guint        tap_flags;
     Buffer       buf;
+    gboolean     passed;
     epan_dissect_t *edt = NULL;
     wtap_rec     file_rec;
     guint8* raw_data;
@@ -1257,8 +1264,9 @@ process_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
     if (perform_two_pass_analysis) {
         frame_data *fdata;
 
-        /* Allocate a frame_data_sequence for all the frames. */
-        cf->provider.frames = new_frame_data_sequence();
+        /* Allocate a frame_data_sequence for all the frames. We only go
+           through them in order, so keep them packed. */
+        cf->provider.frames = new_packed_frame_data_sequence();
 
         if (do_dissection) {
             gboolean create_proto_tree;
@@ -1347,7 +1355,12 @@ process_file(capture_file *cf, int max_packet_count, gint64 max_byte_count)
                 process_packet_second_pass(cf, edt, fdata, &cf->rec, &buf, tap_flags);
             }
 #else
-            if (!process_packet_second_pass(cf, edt, fdata, &cf->rec, &buf))
+            /* The frames are packed; dissecting this one may look up others,
+               which mustn't evict it. */
+            frame_data_sequence_pin(cf->provider.frames, fdata);
+            passed = process_packet_second_pass(cf, edt, fdata, &cf->rec, &buf);
+            frame_data_sequence_unpin(cf->provider.frames, fdata);
+            if (!passed)
                 return FALSE;
 #endif
         }
@@ -0,0 +1,69 @@
+#!/bin/bash
+
+# Time tshark stats trees over capture files, e.g. to compare the cost of
+# the per-packet callbacks of a tree before and after a change. Each tree
+# is run a number of times, and the best time is compared to that of a
+# pass over the file without any tree.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+TEST_TYPE="bench"
+# shellcheck source=tools/test-common.sh
+. "$( dirname "$0" )"/test-common.sh || exit 1
+
+TREES="http,tree http_srv,tree ip_hosts,tree ip_srcdst,tree dests,tree ip_ttl,tree"
+RUNS=3
+
+while getopts "b:n:z:" OPTCHAR ; do
+    case $OPTCHAR in
+        b) WIRESHARK_BIN_DIR=$OPTARG ;;
+        n) RUNS=$OPTARG ;;
+        z) TREES=$OPTARG ;;
+        *) printf "Unknown option: %s\\n" "$OPTARG"
+    esac
+done
+shift $(( OPTIND - 1 ))
+
+if [ $# -lt 1 ]
+then
+    printf "Usage: %s [-b bin_dir] [-n runs] [-z \"tree ...\"] /path/to/file[s].pcap\\n" "$( basename "$0" )"
+    exit 1
+fi
+
+ws_bind_exec_paths
+ws_check_exec "$TSHARK"
+
+# Print the best wall clock time of RUNS runs of tshark with the given
+# arguments, in milliseconds.
+function best_time() {
+    local best=""
+    local start end elapsed
+    for (( run = 0; run < RUNS; run++ )) ; do
+        start=$($DATE +%s%N)
+        if ! "$TSHARK" -nqr "$@" > /dev/null ; then
+            echo "failed"
+            return 1
+        fi
+        end=$($DATE +%s%N)
+        elapsed=$(( (end - start) / 1000000 ))
+        if [ -z "$best" ] || [ $elapsed -lt "$best" ] ; then
+            best=$elapsed
+        fi
+    done
+    echo "$best"
+}
+
+for file in "$@"
+do
+    echo "$file:"
+    base=$(best_time "$file") || exit 1
+    printf "  %-20s %8s ms\\n" "(no tree)" "$base"
+    for tree in $TREES ; do
+        elapsed=$(best_time "$file" -z "$tree") || exit 1
+        printf "  %-20s %8s ms  (+%s ms)\\n" "$tree" "$elapsed" $(( elapsed - base ))
+    done
+done
@@ -30,6 +30,7 @@
 
 #ifndef _WIN32
 #include <signal.h>
+#include <sys/wait.h>
 #endif
 
 #include <glib.h>
@@ -51,6 +52,8 @@
 #include <wsutil/wslog.h>
 #include <wsutil/ws_assert.h>
 #include <wsutil/strtoi.h>
+#include <wsutil/pint.h>
+#include <wsutil/tempfile.h>
 #include <cli_main.h>
 #include <wsutil/version_info.h>
 #include <wiretap/wtap_opttypes.h>
@@ -98,6 +101,8 @@
 #include <epan/ex-opt.h>
 #include <epan/exported_pdu.h>
 #include <epan/secrets.h>
+#include <epan/etypes.h>
+#include <epan/ipproto.h>
 
 #include "capture_opts.h"
 
@@ -143,6 +148,8 @@
 #define LONGOPT_HEXDUMP                 LONGOPT_BASE_APPLICATION+7
 #define LONGOPT_SELECTED_FRAME          LONGOPT_BASE_APPLICATION+8
 #define LONGOPT_PRINT_TIMERS            LONGOPT_BASE_APPLICATION+9
+#define LONGOPT_WORKERS                 LONGOPT_BASE_APPLICATION+10
+#define LONGOPT_TAP_THREADS             LONGOPT_BASE_APPLICATION+11
 
 capture_file cfile;
 
@@ -157,6 +164,16 @@ static gboolean epan_auto_reset;
 
 static guint32 selected_frame_number;
 
+#ifndef _WIN32
+/*
+ * Parallel single-pass dissection; see process_cap_file_parallel().
+ */
+static guint worker_count;              /* number of worker processes, 0 if not parallel */
+static int worker_shard = -1;           /* shard dissected by this worker, -1 in the parent */
+static int worker_index_fd = -1;        /* pipe on which this worker sends its index */
+static GArray *worker_index;            /* index records not sent yet */
+#endif
+
 /*
  * The way the packet decode is to be written.
  */
@@ -167,7 +184,8 @@ typedef enum {
     WRITE_FIELDS,   /* User defined list of fields */
     WRITE_JSON,     /* JSON */
     WRITE_JSON_RAW, /* JSON only raw hex */
-    WRITE_EK        /* JSON bulk insert to Elasticsearch */
+    WRITE_EK,       /* JSON bulk insert to Elasticsearch */
+    WRITE_ARROW     /* User defined list of fields, as an Apache Arrow stream */
         /* Add CSV and the like here */
 } output_action_e;
 
@@ -255,7 +273,7 @@ typedef enum {
 static process_file_status_t process_cap_file(capture_file *, char *, int, gboolean, int, gint64, int);
 
 static gboolean process_packet_single_pass(capture_file *cf,
-        epan_dissect_t *edt, gint64 offset, wtap_rec *rec, Buffer *buf,
+        epan_dissect_t *edt, gint64 offset, wtap_rec *rec, const guint8 *pd,
         guint tap_flags);
 static void show_print_file_io_error(void);
 static gboolean write_preamble(capture_file *cf);
@@ -478,6 +496,10 @@ print_usage(FILE *output)
     fprintf(output, "Processing:\n");
     fprintf(output, "  -2                       perform a two-pass analysis\n");
     fprintf(output, "  -M <packet count>        perform session auto reset\n");
+#ifndef _WIN32
+    fprintf(output, "  --workers <count>        dissect in <count> processes, each handling a share\n");
+    fprintf(output, "                           of the conversations (single pass only)\n");
+#endif
     fprintf(output, "  -R <read filter>, --read-filter <read filter>\n");
     fprintf(output, "                           packet Read filter in Wireshark display filter syntax\n");
     fprintf(output, "                           (requires -2)\n");
@@ -529,7 +551,7 @@ print_usage(FILE *output)
     fprintf(output, "     delimit               delimit ASCII dump text with '|' characters\n");
     fprintf(output, "     noascii               exclude ASCII dump text\n");
     fprintf(output, "     help                  display help for --hexdump and exit\n");
-    fprintf(output, "  -T pdml|ps|psml|json|jsonraw|ek|tabs|text|fields|?\n");
+    fprintf(output, "  -T pdml|ps|psml|json|jsonraw|ek|tabs|text|fields|arrow|?\n");
     fprintf(output, "                           format of text output (def: text)\n");
     fprintf(output, "  -j <protocolfilter>      protocols layers filter if -T ek|pdml|json selected\n");
     fprintf(output, "                           (e.g. \"ip ip.flags text\", filter does not expand child\n");
@@ -560,6 +582,7 @@ print_usage(FILE *output)
     fprintf(output, "  -X <key>:<value>         eXtension options, see the man page for details\n");
     fprintf(output, "  -U tap_name              PDUs export mode, see the man page for details\n");
     fprintf(output, "  -z <statistics>          various statistics, see the man page for details\n");
+    fprintf(output, "  --tap-threads            run the statistics that support it in threads\n");
     fprintf(output, "  --export-objects <protocol>,<destdir>\n");
     fprintf(output, "                           save exported objects for a protocol to a directory\n");
     fprintf(output, "                           named \"destdir\"\n");
@@ -959,6 +982,8 @@ main(int argc, char *argv[])
         {"hexdump", ws_required_argument, NULL, LONGOPT_HEXDUMP},
         {"selected-frame", ws_required_argument, NULL, LONGOPT_SELECTED_FRAME},
         {"print-timers", ws_no_argument, NULL, LONGOPT_PRINT_TIMERS},
+        {"workers", ws_required_argument, NULL, LONGOPT_WORKERS},
+        {"tap-threads", ws_no_argument, NULL, LONGOPT_TAP_THREADS},
         {0, 0, 0, 0}
     };
     gboolean             arg_error = FALSE;
@@ -1690,6 +1715,10 @@ main(int argc, char *argv[])
                     output_action = WRITE_FIELDS;
                     print_details = TRUE;   /* Need full tree info */
                     print_summary = FALSE;  /* Don't allow summary */
+                } else if (strcmp(ws_optarg, "arrow") == 0) {
+                    output_action = WRITE_ARROW;
+                    print_details = TRUE;   /* Need full tree info */
+                    print_summary = FALSE;  /* Don't allow summary */
                 } else if (strcmp(ws_optarg, "json") == 0) {
                     output_action = WRITE_JSON;
                     print_details = TRUE;   /* Need details */
@@ -1707,6 +1736,8 @@ main(int argc, char *argv[])
                     cmdarg_err("Invalid -T parameter \"%s\"; it must be one of:", ws_optarg);                   /* x */
                     cmdarg_err_cont("\t\"fields\"  The values of fields specified with the -e option, in a form\n"
                             "\t          specified by the -E option.\n"
+                            "\t\"arrow\"   The values of fields specified with the -e option, as typed\n"
+                            "\t          columns of an Apache Arrow IPC stream.\n"
                             "\t\"pdml\"    Packet Details Markup Language, an XML-based format for the\n"
                             "\t          details of a decoded packet. This information is equivalent to\n"
                             "\t          the packet details printed with the -V flag.\n"
@@ -1874,6 +1905,18 @@ main(int argc, char *argv[])
             case LONGOPT_PRINT_TIMERS:
                 opt_print_timers = TRUE;
                 break;
+            case LONGOPT_WORKERS:
+#ifndef _WIN32
+                worker_count = get_positive_int(ws_optarg, "worker count");
+#else
+                cmdarg_err("--workers isn't supported on this platform.");
+                exit_status = WS_EXIT_INVALID_OPTION;
+                goto clean_exit;
+#endif
+                break;
+            case LONGOPT_TAP_THREADS:
+                set_tap_listener_threads(TRUE);
+                break;
             default:
             case '?':        /* Bad flag - print usage message */
                 switch(ws_optopt) {
@@ -1918,14 +1961,14 @@ main(int argc, char *argv[])
      * This also doesn't distinguish PDML from PSML, but shouldn't allow the
      * latter.
      */
-    if ((WRITE_FIELDS != output_action && WRITE_XML != output_action && WRITE_JSON != output_action && WRITE_EK != output_action) && 0 != output_fields_num_fields(output_fields)) {
+    if ((WRITE_FIELDS != output_action && WRITE_ARROW != output_action && WRITE_XML != output_action && WRITE_JSON != output_action && WRITE_EK != output_action) && 0 != output_fields_num_fields(output_fields)) {
         cmdarg_err("Output fields were specified with \"-e\", "
-                "but \"-Tek, -Tfields, -Tjson or -Tpdml\" was not specified.");
+                "but \"-Tarrow, -Tek, -Tfields, -Tjson or -Tpdml\" was not specified.");
         exit_status = WS_EXIT_INVALID_OPTION;
         goto clean_exit;
-    } else if (WRITE_FIELDS == output_action && 0 == output_fields_num_fields(output_fields)) {
-        cmdarg_err("\"-Tfields\" was specified, but no fields were "
-                "specified with \"-e\".");
+    } else if ((WRITE_FIELDS == output_action || WRITE_ARROW == output_action) && 0 == output_fields_num_fields(output_fields)) {
+        cmdarg_err("\"-T%s\" was specified, but no fields were "
+                "specified with \"-e\".", WRITE_ARROW == output_action ? "arrow" : "fields");
 
         exit_status = WS_EXIT_INVALID_OPTION;
         goto clean_exit;
@@ -2044,6 +2087,35 @@ main(int argc, char *argv[])
         goto clean_exit;
     }
 
+#ifndef _WIN32
+    if (worker_count > 1) {
+        /* The workers each print the packets they dissect, and we put
+           their output back in frame order, so this only works when
+           reading a file and printing text or fields for every packet. */
+        if (cf_name == NULL || strcmp(cf_name, "-") == 0) {
+            cmdarg_err("--workers requires reading a capture file with -r.");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+        if (perform_two_pass_analysis || epan_auto_reset) {
+            cmdarg_err("--workers can't be used with -2 or -M.");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+        if (output_file_name != NULL || pdu_export_arg != NULL) {
+            cmdarg_err("--workers can't be used when writing packets to a file.");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+        if (!print_packet_info ||
+                (output_action != WRITE_TEXT && output_action != WRITE_FIELDS)) {
+            cmdarg_err("--workers requires printing packets with \"-T text\" or \"-T fields\".");
+            exit_status = WS_EXIT_INVALID_OPTION;
+            goto clean_exit;
+        }
+    }
+#endif
+
 #ifdef HAVE_LIBPCAP
     if (caps_queries) {
         /* We're supposed to list the link-layer/timestamp types for an interface;
@@ -3102,8 +3174,8 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
                 wtap_close(cf->provider.wth);
                 cf->provider.wth = NULL;
             } else {
-                ret = process_packet_single_pass(cf, edt, data_offset, &rec, &buf,
-                        tap_flags);
+                ret = process_packet_single_pass(cf, edt, data_offset, &rec,
+                        ws_buffer_start_ptr(&buf), tap_flags);
             }
             if (ret != FALSE) {
                 /* packet successfully read and gone through the "Read Filter" */
@@ -3350,7 +3422,11 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
 
     if (passed) {
         frame_data_set_after_dissect(&fdlocal, &cum_bytes);
-        cf->provider.prev_cap = cf->provider.prev_dis = frame_data_sequence_add(cf->provider.frames, &fdlocal);
+        /* The frames are packed, so we can't hold on to the added one. */
+        prev_dis_frame = *frame_data_sequence_add(cf->provider.frames, &fdlocal);
+        cf->provider.prev_dis = &prev_dis_frame;
+        prev_cap_frame = prev_dis_frame;
+        cf->provider.prev_cap = &prev_cap_frame;
 
         /* If we're not doing dissection then there won't be any dependent frames.
          * More importantly, edt.pi.fd.dependent_frames won't be initialized because
@@ -3452,8 +3528,9 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
     wtap_rec_init(&rec);
     ws_buffer_init(&buf, 1514);
 
-    /* Allocate a frame_data_sequence for all the frames. */
-    cf->provider.frames = new_frame_data_sequence();
+    /* Allocate a frame_data_sequence for all the frames. We only go
+       through them in order, so keep them packed. */
+    cf->provider.frames = new_packed_frame_data_sequence();
 
     if (do_dissection) {
         gboolean create_proto_tree;
@@ -3624,9 +3701,11 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
                 exit(2);
             }
         }
-        cf->provider.prev_dis = fdata;
+        prev_dis_frame = *fdata;
+        cf->provider.prev_dis = &prev_dis_frame;
     }
-    cf->provider.prev_cap = fdata;
+    prev_cap_frame = *fdata;
+    cf->provider.prev_cap = &prev_cap_frame;
 
     if (edt) {
         epan_dissect_reset(edt);
@@ -3669,6 +3748,7 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
     int             framenum = 0;
     int             write_framenum = 0;
     frame_data     *fdata;
+    gboolean        passed;
     gboolean        filtering_tap_listeners;
     guint           tap_flags;
     epan_dissect_t *edt = NULL;
@@ -3743,7 +3823,12 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
             break;
         }
         ws_debug("tshark: invoking process_packet_second_pass() for frame #%d", framenum);
-        if (process_packet_second_pass(cf, edt, fdata, &rec, &buf, tap_flags)) {
+        /* The frames are packed; dissecting this one may look up others,
+           which mustn't evict it. */
+        frame_data_sequence_pin(cf->provider.frames, fdata);
+        passed = process_packet_second_pass(cf, edt, fdata, &rec, &buf, tap_flags);
+        frame_data_sequence_unpin(cf->provider.frames, fdata);
+        if (passed) {
             /* Either there's no read filtering or this packet passed the
                filter, so, if we're writing to a capture file, write
                this packet out. */
@@ -3777,6 +3862,233 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
     return status;
 }
 
+#ifndef _WIN32
+/*
+ * Support for "--workers": the file is read by worker processes, each of
+ * which dissects and prints the packets of a share of the conversations,
+ * and skips the others. Each worker writes its output to a temporary
+ * file and sends the parent, over a pipe, the frame number and end
+ * offset of each packet it printed; the parent copies the output back to
+ * the standard output in frame order.
+ */
+typedef struct {
+    guint32 framenum;   /* 0 for the final record of a worker */
+    guint32 count;      /* final record: number of packets read */
+    gint32  err;        /* final record: error code of the pass */
+    gint32  status;     /* final record: pass_status_t of the pass */
+    gint64  end;        /* end of the packet's output in the worker's file */
+} worker_index_rec_t;
+
+/* Number of index records a worker batches before writing them out. */
+#define WORKER_INDEX_BATCH  512
+
+/*
+ * Hash the conversation of a packet, so that both directions of a
+ * conversation go to the same worker. We only look at Ethernet, Linux
+ * cooked and raw IP packets; everything else, and non-IP traffic,
+ * hashes to 0 and is dissected by the first worker.
+ *
+ * We hash the addresses and the protocol above IP, but not the ports:
+ * only the first fragment of a fragmented datagram has them, and all
+ * the fragments, as well as the unfragmented packets of the same flow,
+ * must go to the worker that reassembles the datagram and tracks the
+ * flow.
+ */
+static guint32
+packet_conversation_hash(const wtap_rec *rec, const guint8 *pd)
+{
+    guint32 len = rec->rec_header.packet_header.caplen;
+    guint32 off = 0;
+    guint16 etype = 0;
+    const guint8 *src, *dst;
+    guint addr_len;
+    guint8 proto;
+    guint32 hdr_len;
+    guint32 hash = 2166136261U;
+
+    switch (rec->rec_header.packet_header.pkt_encap) {
+
+    case WTAP_ENCAP_ETHERNET:
+        if (len < 14)
+            return 0;
+        etype = pntoh16(pd + 12);
+        off = 14;
+        while ((etype == ETHERTYPE_VLAN || etype == ETHERTYPE_IEEE_802_1AD ||
+                    etype == ETHERTYPE_QINQ_OLD) && len >= off + 4) {
+            etype = pntoh16(pd + off + 2);
+            off += 4;
+        }
+        break;
+
+    case WTAP_ENCAP_SLL:
+        if (len < 16)
+            return 0;
+        etype = pntoh16(pd + 14);
+        off = 16;
+        break;
+
+    case WTAP_ENCAP_RAW_IP:
+        if (len < 1)
+            return 0;
+        etype = (pd[0] >> 4) == 6 ? ETHERTYPE_IPv6 : ETHERTYPE_IP;
+        break;
+
+    case WTAP_ENCAP_RAW_IP4:
+        etype = ETHERTYPE_IP;
+        break;
+
+    case WTAP_ENCAP_RAW_IP6:
+        etype = ETHERTYPE_IPv6;
+        break;
+
+    default:
+        return 0;
+    }
+
+    pd += off;
+    len -= off;
+    if (etype == ETHERTYPE_IP) {
+        if (len < 20 || (pd[0] >> 4) != 4)
+            return 0;
+        proto = pd[9];
+        src = pd + 12;
+        dst = pd + 16;
+        addr_len = 4;
+    } else if (etype == ETHERTYPE_IPv6) {
+        if (len < 40 || (pd[0] >> 4) != 6)
+            return 0;
+        proto = pd[6];
+        src = pd + 8;
+        dst = pd + 24;
+        addr_len = 16;
+        /*
+         * Skip the extension headers that can come before the fragment
+         * header, and the fragment header itself, so that fragments
+         * hash like the unfragmented packets of their flow.
+         */
+        hdr_len = 40;
+        while ((proto == IP_PROTO_HOPOPTS || proto == IP_PROTO_ROUTING ||
+                    proto == IP_PROTO_DSTOPTS || proto == IP_PROTO_FRAGMENT) &&
+                len >= hdr_len + 2) {
+            guint8 next = pd[hdr_len];
+
+            if (proto == IP_PROTO_FRAGMENT)
+                hdr_len += 8;
+            else
+                hdr_len += (pd[hdr_len + 1] + 1) * 8;
+            proto = next;
+        }
+    } else {
+        return 0;
+    }
+
+    /* Put the endpoints in a canonical order. */
+    if (memcmp(src, dst, addr_len) > 0) {
+        const guint8 *tmp_addr = src;
+
+        src = dst;
+        dst = tmp_addr;
+    }
+
+    /* FNV-1a */
+    for (guint i = 0; i < addr_len; i++)
+        hash = (hash ^ src[i]) * 16777619U;
+    for (guint i = 0; i < addr_len; i++)
+        hash = (hash ^ dst[i]) * 16777619U;
+    hash = (hash ^ proto) * 16777619U;
+
+    return hash;
+}
+
+static gboolean
+worker_wants_packet(const wtap_rec *rec, const guint8 *pd)
+{
+    if (worker_shard < 0)
+        return TRUE;
+    if (rec->rec_type != REC_TYPE_PACKET)
+        return worker_shard == 0;
+    return packet_conversation_hash(rec, pd) % worker_count == (guint)worker_shard;
+}
+
+/*
+ * Account for a packet that another worker dissects, so that the frame
+ * numbers, reference frame and time deltas stay the same as when the
+ * packets are all dissected by one process.
+ */
+static void
+skip_packet_single_pass(capture_file *cf, gint64 offset, wtap_rec *rec)
+{
+    frame_data fdata;
+
+    cf->count++;
+    frame_data_init(&fdata, cf->count, rec, offset, cum_bytes);
+
+    frame_data_set_before_dissect(&fdata, &cf->elapsed_time,
+            &cf->provider.ref, cf->provider.prev_dis);
+    if (cf->provider.ref == &fdata) {
+        ref_frame = fdata;
+        cf->provider.ref = &ref_frame;
+    }
+
+    /* Without a display filter every packet is displayed; with one, we
+       don't know whether the other worker displays it, so we treat it
+       as not displayed. */
+    if (cf->dfcode == NULL) {
+        frame_data_set_after_dissect(&fdata, &cum_bytes);
+        prev_dis_frame = fdata;
+        cf->provider.prev_dis = &prev_dis_frame;
+    }
+
+    prev_cap_frame = fdata;
+    cf->provider.prev_cap = &prev_cap_frame;
+    frame_data_destroy(&fdata);
+}
+
+static gboolean
+worker_flush_index(void)
+{
+    const guint8 *p;
+    size_t left;
+    ssize_t n;
+
+    if (worker_index->len == 0)
+        return TRUE;
+
+    /* The offsets are only valid once the output is in the file. */
+    fflush(stdout);
+
+    p = (const guint8 *)worker_index->data;
+    left = worker_index->len * sizeof(worker_index_rec_t);
+    while (left != 0) {
+        n = ws_write(worker_index_fd, p, (unsigned int)left);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return FALSE;
+        }
+        p += n;
+        left -= n;
+    }
+    g_array_set_size(worker_index, 0);
+    return TRUE;
+}
+
+static void
+worker_add_index(guint32 framenum)
+{
+    worker_index_rec_t idx;
+
+    memset(&idx, 0, sizeof idx);
+    idx.framenum = framenum;
+    idx.end = ftell(stdout);
+    g_array_append_val(worker_index, idx);
+    if (worker_index->len >= WORKER_INDEX_BATCH && !worker_flush_index()) {
+        cmdarg_err("Worker couldn't write to its index pipe: %s.", g_strerror(errno));
+        _exit(WS_EXIT_INVALID_FILE);
+    }
+}
+#endif /* _WIN32 */
+
 static pass_status_t
 process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
         int max_packet_count, gint64 max_byte_count,
@@ -3784,8 +4096,8 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
         int *err, gchar **err_info,
         volatile guint32 *err_framenum)
 {
-    wtap_rec        rec;
-    Buffer          buf;
+    wtap_rec_batch  batch;
+    wtap_rec       *rec;
     gboolean create_proto_tree = FALSE;
     gboolean        filtering_tap_listeners;
     guint           tap_flags;
@@ -3793,11 +4105,9 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     int             write_framenum = 0;
     epan_dissect_t *edt = NULL;
     gint64          data_offset;
+    gboolean        done = FALSE;
     pass_status_t   status = PASS_SUCCEEDED;
 
-    wtap_rec_init(&rec);
-    ws_buffer_init(&buf, 1514);
-
     /* Do we have any tap listeners with filters? */
     filtering_tap_listeners = have_filtering_tap_listeners();
 
@@ -3848,62 +4158,81 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
      */
     set_resolution_synchrony(TRUE);
 
+    /* Read the records in batches; their data stays valid until the
+       next batch is read, which is long enough to dissect and write them. */
+    wtap_rec_batch_init(&batch, 256, 256 * 1024);
+
     *err = 0;
-    while (wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
-        if (read_interrupted) {
-            status = PASS_INTERRUPTED;
-            break;
-        }
-        framenum++;
+    while (!done && wtap_read_batch(cf->provider.wth, &batch, err, err_info)) {
+        for (unsigned i = 0; i < batch.num_recs; i++) {
+            rec = &batch.recs[i];
+            data_offset = batch.offsets[i];
+
+            if (read_interrupted) {
+                status = PASS_INTERRUPTED;
+                done = TRUE;
+                break;
+            }
+            framenum++;
 
-        /*
-         * Process whatever IDBs we haven't seen yet.
-         */
-        if (!process_new_idbs(cf->provider.wth, pdh, err, err_info)) {
-            *err_framenum = framenum;
-            status = PASS_WRITE_ERROR;
-            break;
-        }
+            /*
+             * Process whatever IDBs we haven't seen yet.
+             */
+            if (!process_new_idbs(cf->provider.wth, pdh, err, err_info)) {
+                *err_framenum = framenum;
+                status = PASS_WRITE_ERROR;
+                done = TRUE;
+                break;
+            }
 
-        ws_debug("tshark: processing packet #%d", framenum);
+            ws_debug("tshark: processing packet #%d", framenum);
 
-        reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
+            reset_epan_mem(cf, edt, create_proto_tree, print_packet_info && print_details);
 
-        if (process_packet_single_pass(cf, edt, data_offset, &rec, &buf, tap_flags)) {
-            /* Either there's no read filtering or this packet passed the
-               filter, so, if we're writing to a capture file, write
-               this packet out. */
-            write_framenum++;
-            if (pdh != NULL) {
-                ws_debug("tshark: writing packet #%d to outfile as #%d",
-                        framenum, write_framenum);
-                if (!wtap_dump(pdh, &rec, ws_buffer_start_ptr(&buf), err, err_info)) {
-                    /* Error writing to the output file. */
-                    ws_debug("tshark: error writing to a capture file (%d)", *err);
-                    *err_framenum = framenum;
-                    status = PASS_WRITE_ERROR;
-                    break;
+#ifndef _WIN32
+            if (!worker_wants_packet(rec, batch.data[i])) {
+                skip_packet_single_pass(cf, data_offset, rec);
+            } else
+#endif
+            if (process_packet_single_pass(cf, edt, data_offset, rec, batch.data[i], tap_flags)) {
+                /* Either there's no read filtering or this packet passed the
+                   filter, so, if we're writing to a capture file, write
+                   this packet out. */
+                write_framenum++;
+                if (pdh != NULL) {
+                    ws_debug("tshark: writing packet #%d to outfile as #%d",
+                            framenum, write_framenum);
+                    if (!wtap_dump(pdh, rec, batch.data[i], err, err_info)) {
+                        /* Error writing to the output file. */
+                        ws_debug("tshark: error writing to a capture file (%d)", *err);
+                        *err_framenum = framenum;
+                        status = PASS_WRITE_ERROR;
+                        done = TRUE;
+                        break;
+                    }
                 }
             }
+            /* Stop reading if we hit a stop condition */
+            if (max_packet_count > 0 && framenum >= max_packet_count) {
+                ws_debug("tshark: max_packet_count (%d) reached", max_packet_count);
+                *err = 0; /* This is not an error */
+                done = TRUE;
+                break;
+            }
+            if (max_write_packet_count > 0 && write_framenum >= max_write_packet_count) {
+                ws_debug("tshark: max_write_packet_count (%d) reached", max_write_packet_count);
+                *err = 0; /* This is not an error */
+                done = TRUE;
+                break;
+            }
+            if (max_byte_count != 0 && data_offset >= max_byte_count) {
+                ws_debug("tshark: max_byte_count (%" PRId64 "/%" PRId64 ") reached",
+                        data_offset, max_byte_count);
+                *err = 0; /* This is not an error */
+                done = TRUE;
+                break;
+            }
         }
-        /* Stop reading if we hit a stop condition */
-        if (max_packet_count > 0 && framenum >= max_packet_count) {
-            ws_debug("tshark: max_packet_count (%d) reached", max_packet_count);
-            *err = 0; /* This is not an error */
-            break;
-        }
-        if (max_write_packet_count > 0 && write_framenum >= max_write_packet_count) {
-            ws_debug("tshark: max_write_packet_count (%d) reached", max_write_packet_count);
-            *err = 0; /* This is not an error */
-            break;
-        }
-        if (max_byte_count != 0 && data_offset >= max_byte_count) {
-            ws_debug("tshark: max_byte_count (%" PRId64 "/%" PRId64 ") reached",
-                    data_offset, max_byte_count);
-            *err = 0; /* This is not an error */
-            break;
-        }
-        wtap_rec_reset(&rec);
     }
     if (status == PASS_SUCCEEDED) {
         if (*err != 0) {
@@ -3923,11 +4252,264 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
     if (edt)
         epan_dissect_free(edt);
 
-    ws_buffer_free(&buf);
-    wtap_rec_cleanup(&rec);
+    wtap_rec_batch_cleanup(&batch);
+
+    return status;
+}
+
+#ifndef _WIN32
+/*
+ * Run one worker of a parallel pass; called in the child process. Never
+ * returns.
+ */
+static void
+run_worker(capture_file *cf, guint shard, const char *out_name, int index_fd,
+        int max_packet_count, gint64 max_byte_count, int max_write_packet_count)
+{
+    worker_index_rec_t idx;
+    int err;
+    gchar *err_info = NULL;
+    guint32 err_framenum = 0;
+    pass_status_t status;
+
+    /* The parent's handle on the file shares its offset with ours, so
+       open the file again. */
+    wtap_close(cf->provider.wth);
+    cf->provider.wth = wtap_open_offline(cf->filename, cf->open_type, &err,
+            &err_info, FALSE);
+    if (cf->provider.wth == NULL) {
+        cfile_open_failure_message(cf->filename, err, err_info);
+        _exit(WS_EXIT_INVALID_FILE);
+    }
+    wtap_set_cb_new_ipv4(cf->provider.wth, add_ipv4_name);
+    wtap_set_cb_new_ipv6(cf->provider.wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
+    wtap_set_cb_new_secrets(cf->provider.wth, secrets_wtap_callback);
+
+    if (freopen(out_name, "wb", stdout) == NULL) {
+        cmdarg_err("Worker couldn't open %s: %s.", out_name, g_strerror(errno));
+        _exit(WS_EXIT_INVALID_FILE);
+    }
+
+    worker_shard = shard;
+    worker_index_fd = index_fd;
+    worker_index = g_array_sized_new(FALSE, FALSE, sizeof(worker_index_rec_t),
+            WORKER_INDEX_BATCH);
+
+    status = process_cap_file_single_pass(cf, NULL, max_packet_count,
+            max_byte_count, max_write_packet_count, &err, &err_info,
+            &err_framenum);
+    g_free(err_info);
+
+    memset(&idx, 0, sizeof idx);
+    idx.count = cf->count;
+    idx.err = err;
+    idx.status = status;
+    g_array_append_val(worker_index, idx);
+    if (!worker_flush_index() || ferror(stdout))
+        _exit(WS_EXIT_INVALID_FILE);
+    _exit(EXIT_SUCCESS);
+}
+
+/* Read the next index record of a worker. */
+static gboolean
+read_worker_index(FILE *fp, worker_index_rec_t *idx)
+{
+    return fread(idx, sizeof *idx, 1, fp) == 1;
+}
+
+/* Copy the output of a worker from its current position up to "end". */
+static gboolean
+copy_worker_output(int fd, gint64 *pos, gint64 end)
+{
+    char buf[65536];
+    gint64 left = end - *pos;
+    ssize_t n;
+
+    while (left > 0) {
+        n = ws_read(fd, buf, (unsigned int)MIN(left, (gint64)sizeof buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+        if (fwrite(buf, 1, n, stdout) != (size_t)n)
+            return FALSE;
+        left -= n;
+        *pos += n;
+    }
+    return TRUE;
+}
+
+/*
+ * Single pass over the file with worker_count worker processes, each of
+ * which dissects a share of the conversations; the output is put back in
+ * frame order as the workers produce it.
+ *
+ * If max_write_packet_count is set, each worker stops after printing that
+ * many packets, which is enough for us to have the first that many of
+ * them all; once we have copied those, the workers are stopped.
+ */
+static pass_status_t
+process_cap_file_parallel(capture_file *cf, int max_packet_count,
+        gint64 max_byte_count, int max_write_packet_count, int *err,
+        gchar **err_info)
+{
+    pid_t              *pids = g_new0(pid_t, worker_count);
+    int                *out_fds = g_new(int, worker_count);
+    FILE              **index_fps = g_new0(FILE *, worker_count);
+    char              **out_names = g_new0(char *, worker_count);
+    worker_index_rec_t *heads = g_new0(worker_index_rec_t, worker_count);
+    gint64             *positions = g_new0(gint64, worker_count);
+    guint               running = 0;
+    int                 write_framenum = 0;
+    gboolean            stopped = FALSE;
+    pass_status_t       status = PASS_SUCCEEDED;
+    int                 pipe_fds[2];
+    GError             *gerr = NULL;
+    int                 wstatus;
+
+    *err = 0;
+    for (guint i = 0; i < worker_count; i++)
+        out_fds[i] = -1;
+
+    /* Don't let the workers inherit anything we haven't written yet. */
+    fflush(stdout);
+    fflush(stderr);
+
+    for (guint i = 0; i < worker_count; i++) {
+        out_fds[i] = create_tempfile(NULL, &out_names[i], "tshark_worker", NULL, &gerr);
+        if (out_fds[i] == -1) {
+            *err = WTAP_ERR_INTERNAL;
+            *err_info = ws_strdup_printf("couldn't create a file for worker output: %s",
+                    gerr->message);
+            g_clear_error(&gerr);
+            status = PASS_READ_ERROR;
+            break;
+        }
+        if (pipe(pipe_fds) == -1) {
+            *err = WTAP_ERR_INTERNAL;
+            *err_info = ws_strdup_printf("couldn't create a pipe for a worker: %s",
+                    g_strerror(errno));
+            status = PASS_READ_ERROR;
+            break;
+        }
+        pids[i] = fork();
+        if (pids[i] == -1) {
+            *err = WTAP_ERR_INTERNAL;
+            *err_info = ws_strdup_printf("couldn't start a worker process: %s",
+                    g_strerror(errno));
+            ws_close(pipe_fds[0]);
+            ws_close(pipe_fds[1]);
+            pids[i] = 0;
+            status = PASS_READ_ERROR;
+            break;
+        }
+        if (pids[i] == 0) {
+            /* Child; close our copies of the parent's end of everything. */
+            ws_close(pipe_fds[0]);
+            for (guint j = 0; j <= i; j++) {
+                ws_close(out_fds[j]);
+                if (index_fps[j] != NULL)
+                    fclose(index_fps[j]);
+            }
+            run_worker(cf, i, out_names[i], pipe_fds[1], max_packet_count,
+                    max_byte_count, max_write_packet_count);
+        }
+        ws_close(pipe_fds[1]);
+        index_fps[i] = fdopen(pipe_fds[0], "rb");
+        running++;
+    }
+
+    if (status != PASS_SUCCEEDED) {
+        for (guint i = 0; i < running; i++)
+            kill(pids[i], SIGTERM);
+    }
+
+    /* Get the first record of every worker. */
+    for (guint i = 0; i < running; i++) {
+        if (!read_worker_index(index_fps[i], &heads[i]))
+            heads[i].framenum = G_MAXUINT32;
+    }
+
+    /* Copy the output of the worker with the lowest frame number until
+       every worker has sent its final record. */
+    for (;;) {
+        guint next = running;
+
+        for (guint i = 0; i < running; i++) {
+            if (heads[i].framenum == 0 || heads[i].framenum == G_MAXUINT32)
+                continue;
+            if (next == running || heads[i].framenum < heads[next].framenum)
+                next = i;
+        }
+        if (next == running)
+            break;
+
+        if (!copy_worker_output(out_fds[next], &positions[next], heads[next].end) ||
+                ferror(stdout)) {
+            show_print_file_io_error();
+            for (guint i = 0; i < running; i++)
+                kill(pids[i], SIGTERM);
+            exit(2);
+        }
+        if (line_buffered)
+            fflush(stdout);
+
+        write_framenum++;
+        if (max_write_packet_count > 0 && write_framenum >= max_write_packet_count) {
+            ws_debug("tshark: max_write_packet_count (%d) reached", max_write_packet_count);
+            /* The rest of the workers' output isn't wanted. */
+            cf->count = heads[next].framenum;
+            for (guint i = 0; i < running; i++)
+                kill(pids[i], SIGKILL);
+            stopped = TRUE;
+            break;
+        }
+
+        if (!read_worker_index(index_fps[next], &heads[next]))
+            heads[next].framenum = G_MAXUINT32;
+    }
+
+    for (guint i = 0; i < running && !stopped; i++) {
+        if (heads[i].framenum == G_MAXUINT32) {
+            /* It exited without sending its final record. */
+            if (status == PASS_SUCCEEDED) {
+                *err = WTAP_ERR_INTERNAL;
+                *err_info = g_strdup("worker process exited unexpectedly");
+                status = PASS_READ_ERROR;
+            }
+        } else {
+            if (heads[i].count > cf->count)
+                cf->count = heads[i].count;
+            if (status == PASS_SUCCEEDED && heads[i].status != PASS_SUCCEEDED) {
+                *err = heads[i].err;
+                status = (pass_status_t)heads[i].status;
+            }
+        }
+    }
+
+    for (guint i = 0; i < worker_count; i++) {
+        if (pids[i] > 0) {
+            while (waitpid(pids[i], &wstatus, 0) == -1 && errno == EINTR)
+                ;
+        }
+        if (index_fps[i] != NULL)
+            fclose(index_fps[i]);
+        if (out_fds[i] != -1)
+            ws_close(out_fds[i]);
+        if (out_names[i] != NULL)
+            ws_unlink(out_names[i]);
+        g_free(out_names[i]);
+    }
+    g_free(pids);
+    g_free(out_fds);
+    g_free(index_fps);
+    g_free(out_names);
+    g_free(heads);
+    g_free(positions);
 
     return status;
 }
+#endif /* _WIN32 */
 
 static process_file_status_t
 process_cap_file(capture_file *cf, char *save_file, int out_file_type,
@@ -4060,6 +4642,20 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
         first_pass_status = PASS_SUCCEEDED; /* There is no first pass */
 
         elapsed_start = g_get_monotonic_time();
+#ifndef _WIN32
+        if (worker_count > 1 && tap_listeners_require_dissection()) {
+            /* Taps have to see every packet in one process. */
+            ws_message("Ignoring option --workers because taps are in use");
+            worker_count = 1;
+        }
+        if (worker_count > 1) {
+            second_pass_status = process_cap_file_parallel(cf,
+                    max_packet_count,
+                    max_byte_count,
+                    max_write_packet_count,
+                    &err, &err_info);
+        } else
+#endif
         second_pass_status = process_cap_file_single_pass(cf, pdh,
                 max_packet_count,
                 max_byte_count,
@@ -4216,7 +4812,7 @@ out:
 
 static gboolean
 process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
-        wtap_rec *rec, Buffer *buf, guint tap_flags _U_)
+        wtap_rec *rec, const guint8 *pd, guint tap_flags _U_)
 {
     frame_data      fdata;
     column_info    *cinfo;
@@ -4289,7 +4885,7 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
         block = wtap_block_ref(rec->block);
         elapsed_start = g_get_monotonic_time();
         epan_dissect_run_with_taps(edt, cf->cd_t, rec,
-                frame_tvbuff_new_buffer(&cf->provider, &fdata, buf),
+                frame_tvbuff_new(&cf->provider, &fdata, pd),
                 &fdata, cinfo);
         tshark_elapsed.first_pass.dissect += g_get_monotonic_time() - elapsed_start;
 
@@ -4321,6 +4917,10 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
                 show_print_file_io_error();
                 exit(2);
             }
+#ifndef _WIN32
+            if (worker_shard >= 0)
+                worker_add_index(fdata.num);
+#endif
         }
 
         /* this must be set after print_packet() [bug #8160] */
@@ -4358,6 +4958,14 @@ write_preamble(capture_file *cf)
             write_fields_preamble(output_fields, stdout);
             return !ferror(stdout);
 
+        case WRITE_ARROW:
+#ifdef _WIN32
+            /* The stream is binary; avoid Windows text-mode processing (eg: for CR/LF) */
+            _setmode(1, O_BINARY);
+#endif
+            write_arrow_preamble(output_fields, stdout);
+            return !ferror(stdout);
+
         case WRITE_JSON:
         case WRITE_JSON_RAW:
             jdumper = write_json_preamble(stdout);
@@ -4712,6 +5320,10 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
             }
             break;
 
+        case WRITE_ARROW:
+            write_arrow_proto_tree(output_fields, edt, &cf->cinfo, stdout);
+            return !ferror(stdout);
+
         case WRITE_JSON:
             if (print_summary)
                 ws_assert_not_reached();
@@ -4773,6 +5385,11 @@ write_finale(void)
             write_fields_finale(output_fields, stdout);
             return !ferror(stdout);
 
+        case WRITE_ARROW:
+            if (!write_arrow_finale(output_fields, stdout))
+                return FALSE;
+            return !ferror(stdout);
+
         case WRITE_JSON:
         case WRITE_JSON_RAW:
             write_json_finale(&jdumper);
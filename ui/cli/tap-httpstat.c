@@ -136,11 +136,33 @@ httpstat_finish(void *psp)
 	g_free(sp);
 }
 
-static tap_packet_status
-httpstat_packet(void *psp, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *pri, tap_flags_t flags _U_)
+/* what httpstat_packet() needs of a packet, copied out of the tapped
+ * http_info_value_t so that it can be counted on a thread of its own */
+typedef struct _http_stat_record_t {
+	unsigned	 response_code;
+	char		*request_method;
+} http_stat_record_t;
+
+static void *
+httpstat_snapshot(void *psp _U_, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *pri, tap_flags_t flags _U_)
 {
 	const http_info_value_t *value = (const http_info_value_t *)pri;
+	http_stat_record_t *record;
+
+	if (value->response_code == 0 && !value->request_method)
+		return NULL;
+	record = g_new(http_stat_record_t, 1);
+	record->response_code = value->response_code;
+	record->request_method = value->response_code ? NULL : g_strdup(value->request_method);
+	return record;
+}
+
+static tap_packet_status
+httpstat_packet(void *psp, void *precord)
+{
+	http_stat_record_t *value = (http_stat_record_t *)precord;
 	httpstat_t *sp = (httpstat_t *)psp;
+	tap_packet_status status = TAP_PACKET_REDRAW;
 
 	/* We are only interested in reply packets with a status code */
 	/* Request or reply packets ? */
@@ -157,7 +179,8 @@ httpstat_packet(void *psp, packet_info *pinfo _U_, epan_dissect_t *edt _U_, cons
 			 */
 			int i = value->response_code;
 			if ((i < 100) || (i >= 600)) {
-				return TAP_PACKET_DONT_REDRAW;
+				status = TAP_PACKET_DONT_REDRAW;
+				goto done;
 			}
 			else if (i < 200) {
 				key = 199;	/* Hopefully, this status code will never be used */
@@ -177,12 +200,14 @@ httpstat_packet(void *psp, packet_info *pinfo _U_, epan_dissect_t *edt _U_, cons
 			sc = (http_response_code_t *)g_hash_table_lookup(
 				sp->hash_responses,
 				GUINT_TO_POINTER(key));
-			if (sc == NULL)
-				return TAP_PACKET_DONT_REDRAW;
+			if (sc == NULL) {
+				status = TAP_PACKET_DONT_REDRAW;
+				goto done;
+			}
 		}
 		sc->packets++;
 	}
-	else if (value->request_method) {
+	else {
 		http_request_methode_t *sc;
 
 		sc = (http_request_methode_t *)g_hash_table_lookup(
@@ -190,17 +215,19 @@ httpstat_packet(void *psp, packet_info *pinfo _U_, epan_dissect_t *edt _U_, cons
 				value->request_method);
 		if (sc == NULL) {
 			sc = g_new(http_request_methode_t, 1);
-			sc->response = g_strdup(value->request_method);
+			sc->response = value->request_method;
+			value->request_method = NULL;
 			sc->packets = 1;
 			sc->sp = sp;
 			g_hash_table_insert(sp->hash_requests, sc->response, sc);
 		} else {
 			sc->packets++;
 		}
-	} else {
-		return TAP_PACKET_DONT_REDRAW;
 	}
-	return TAP_PACKET_REDRAW;
+done:
+	g_free(value->request_method);
+	g_free(value);
+	return status;
 }
 
 
@@ -246,12 +273,13 @@ httpstat_init(const char *opt_arg, void *userdata _U_)
 	/*g_hash_table_foreach(http_status, (GHFunc)http_reset_hash_responses, NULL);*/
 
 
-	error_string = register_tap_listener(
+	error_string = register_tap_listener_threaded(
 			"http",
 			sp,
 			filter,
 			0,
 			httpstat_reset,
+			httpstat_snapshot,
 			httpstat_packet,
 			httpstat_draw,
 			httpstat_finish);
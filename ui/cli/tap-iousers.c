@@ -23,9 +23,19 @@
 typedef struct _io_users_t {
 	const char *type;
 	const char *filter;
+	tap_packet_cb packet;
 	conv_hash_t hash;
 } io_users_t;
 
+static void *
+iousers_snapshot(void *arg, packet_info *pinfo, epan_dissect_t *edt, const void *data, tap_flags_t flags)
+{
+	conv_hash_t *hash = (conv_hash_t*)arg;
+	io_users_t *iu = (io_users_t *)hash->user_data;
+
+	return conversation_table_snapshot(hash, iu->packet, pinfo, edt, data, flags);
+}
+
 static void
 iousers_draw(void *arg)
 {
@@ -241,8 +251,9 @@ void init_iousers(struct register_ct *ct, const char *filter)
 	iu->type = proto_get_protocol_short_name(find_protocol_by_id(get_conversation_proto_id(ct)));
 	iu->filter = g_strdup(filter);
 	iu->hash.user_data = iu;
+	iu->packet = get_conversation_packet_func(ct);
 
-	error_string = register_tap_listener(proto_get_protocol_filter_name(get_conversation_proto_id(ct)), &iu->hash, filter, 0, NULL, get_conversation_packet_func(ct), iousers_draw, NULL);
+	error_string = register_tap_listener_threaded(proto_get_protocol_filter_name(get_conversation_proto_id(ct)), &iu->hash, filter, 0, NULL, iousers_snapshot, conversation_table_consume, iousers_draw, NULL);
 	if (error_string) {
 		g_free(iu);
 		cmdarg_err("Couldn't register conversations tap: %s",
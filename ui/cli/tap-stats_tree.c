@@ -84,12 +84,13 @@ init_stats_tree(const char *opt_arg, void *userdata _U_)
 		return;
 	}
 
-	error_string = register_tap_listener(st->cfg->tapname,
+	error_string = register_tap_listener_threaded(st->cfg->tapname,
 					     st,
 					     st->filter,
 					     st->cfg->flags,
 					     stats_tree_reset,
-					     stats_tree_packet,
+					     stats_tree_snapshot,
+					     stats_tree_consume,
 					     draw_stats_tree,
 					     NULL);
 
@@ -299,3 +299,104 @@ double get_io_graph_item(const io_graph_item_t *items_, io_graph_item_unit_t val
     }
     return value;
 }
+
+void merge_io_graph_item(io_graph_item_t *item, const io_graph_item_t *next, int hf_index)
+{
+    bool new_max, new_min;
+
+    item->frames += next->frames;
+    item->bytes += next->bytes;
+
+    if (item->first_frame_in_invl == 0) {
+        item->first_frame_in_invl = next->first_frame_in_invl;
+    }
+    if (next->last_frame_in_invl != 0) {
+        item->last_frame_in_invl = next->last_frame_in_invl;
+    }
+
+    if (next->fields == 0) {
+        return;
+    }
+
+    if (hf_index < 0) {
+        item->fields += next->fields;
+        return;
+    }
+
+    /* As in update_io_graph_item, a tie goes to the earlier frame, which
+     * is in item. */
+    switch (proto_registrar_get_ftype(hf_index)) {
+    case FT_UINT8:
+    case FT_UINT16:
+    case FT_UINT24:
+    case FT_UINT32:
+    case FT_UINT40:
+    case FT_UINT48:
+    case FT_UINT56:
+    case FT_UINT64:
+        new_max = (item->fields == 0) || (next->uint_max > item->uint_max);
+        new_min = (item->fields == 0) || (next->uint_min < item->uint_min);
+        if (new_max) {
+            item->uint_max = next->uint_max;
+        }
+        if (new_min) {
+            item->uint_min = next->uint_min;
+        }
+        item->double_tot += next->double_tot;
+        break;
+    case FT_INT8:
+    case FT_INT16:
+    case FT_INT24:
+    case FT_INT32:
+    case FT_INT40:
+    case FT_INT48:
+    case FT_INT56:
+    case FT_INT64:
+        new_max = (item->fields == 0) || (next->int_max > item->int_max);
+        new_min = (item->fields == 0) || (next->int_min < item->int_min);
+        if (new_max) {
+            item->int_max = next->int_max;
+        }
+        if (new_min) {
+            item->int_min = next->int_min;
+        }
+        item->double_tot += next->double_tot;
+        break;
+    case FT_FLOAT:
+    case FT_DOUBLE:
+        new_max = (item->fields == 0) || (next->double_max > item->double_max);
+        new_min = (item->fields == 0) || (next->double_min < item->double_min);
+        if (new_max) {
+            item->double_max = next->double_max;
+        }
+        if (new_min) {
+            item->double_min = next->double_min;
+        }
+        item->double_tot += next->double_tot;
+        break;
+    case FT_RELATIVE_TIME:
+        /* LOAD only uses time_tot, which is added up in the same way. */
+        new_max = (item->fields == 0) || (nstime_cmp(&next->time_max, &item->time_max) > 0);
+        new_min = (item->fields == 0) || (nstime_cmp(&next->time_min, &item->time_min) < 0);
+        if (new_max) {
+            item->time_max = next->time_max;
+        }
+        if (new_min) {
+            item->time_min = next->time_min;
+        }
+        nstime_add(&item->time_tot, &next->time_tot);
+        break;
+    default:
+        /* Only counted. */
+        new_max = new_min = false;
+        break;
+    }
+
+    if (new_max) {
+        item->max_frame_in_invl = next->max_frame_in_invl;
+    }
+    if (new_min) {
+        item->min_frame_in_invl = next->min_frame_in_invl;
+    }
+    item->fields += next->fields;
+}
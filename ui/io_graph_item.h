@@ -191,6 +191,18 @@ GString *check_field_unit(const char *field_name, int *hf_index, io_graph_item_u
  */
 double get_io_graph_item(const io_graph_item_t *items, io_graph_item_unit_t val_units, int idx, int hf_index, const capture_file *cap_file, int interval, int cur_idx);
 
+/** Add the values of an interval to those of the interval before it.
+ *
+ * The result is what update_io_graph_item would have calculated had both
+ * intervals been a single one, so that items can be rolled up into
+ * coarser intervals without retapping.
+ *
+ * @param item [in,out] Item to merge into.
+ * @param next [in] Item of the interval following the one of item.
+ * @param hf_index [in] Header field index for advanced statistics.
+ */
+void merge_io_graph_item(io_graph_item_t *item, const io_graph_item_t *next, int hf_index);
+
 /** Update the values of an io_graph_item_t.
  *
  * Frame and byte counts are always calculated. If edt is non-NULL advanced
@@ -0,0 +1,238 @@
+/* io_graph_item_test.c
+ * Standalone program to test merge_io_graph_item()
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/proto.h>
+#include <wsutil/wslog.h>
+
+#include "ui/io_graph_item.h"
+
+static int proto_test = -1;
+static int hf_uint = -1;
+static int hf_int = -1;
+static int hf_double = -1;
+static int hf_reltime = -1;
+
+typedef struct {
+    uint32_t num;
+    uint32_t len;
+    int      value;     /* whole units, or seconds and 1/100 s */
+    bool     has_field;
+} test_packet;
+
+/* Tap a packet into items[idx], adding the test field to its tree the
+ * way a dissector would. */
+static void
+tap_packet(io_graph_item_t *items, int idx, int hf_index, io_graph_item_unit_t unit,
+           const test_packet *packet)
+{
+    epan_dissect_t edt;
+    frame_data fd;
+    nstime_t ts;
+
+    memset(&fd, 0, sizeof(fd));
+    fd.num = packet->num;
+    fd.pkt_len = packet->len;
+
+    epan_dissect_init(&edt, NULL, true, false);
+    if (hf_index >= 0) {
+        epan_dissect_prime_with_hfid(&edt, hf_index);
+    }
+    edt.pi.fd = &fd;
+    edt.pi.num = packet->num;
+
+    if (packet->has_field) {
+        if (hf_index == hf_uint) {
+            proto_tree_add_uint(edt.tree, hf_uint, NULL, 0, 0, (uint32_t)packet->value);
+        } else if (hf_index == hf_int) {
+            proto_tree_add_int(edt.tree, hf_int, NULL, 0, 0, packet->value);
+        } else if (hf_index == hf_double) {
+            proto_tree_add_double(edt.tree, hf_double, NULL, 0, 0, packet->value / 4.0);
+        } else if (hf_index == hf_reltime) {
+            ts.secs = packet->value / 100;
+            ts.nsecs = (packet->value % 100) * 10000000;
+            proto_tree_add_time(edt.tree, hf_reltime, NULL, 0, 0, &ts);
+        }
+    }
+
+    update_io_graph_item(items, idx, &edt.pi, hf_index >= 0 ? &edt : NULL, hf_index, unit, 1000000);
+    epan_dissect_cleanup(&edt);
+}
+
+static void
+assert_items_equal(const io_graph_item_t *merged, const io_graph_item_t *tapped, int hf_index)
+{
+    g_assert_cmpuint(merged->frames, ==, tapped->frames);
+    g_assert_cmpuint(merged->bytes, ==, tapped->bytes);
+    g_assert_cmpuint(merged->fields, ==, tapped->fields);
+    g_assert_cmpuint(merged->first_frame_in_invl, ==, tapped->first_frame_in_invl);
+    g_assert_cmpuint(merged->last_frame_in_invl, ==, tapped->last_frame_in_invl);
+    if (hf_index < 0) {
+        return;
+    }
+    g_assert_cmpuint(merged->min_frame_in_invl, ==, tapped->min_frame_in_invl);
+    g_assert_cmpuint(merged->max_frame_in_invl, ==, tapped->max_frame_in_invl);
+
+    /* What the graph shows, for every unit the field allows. */
+    for (int unit = IOG_ITEM_UNIT_FIRST; unit <= IOG_ITEM_UNIT_LAST; unit++) {
+        if (hf_index != hf_reltime && unit == IOG_ITEM_UNIT_CALC_LOAD) {
+            continue;
+        }
+        g_assert_cmpfloat(get_io_graph_item(merged, unit, 0, hf_index, NULL, 1000000, -1), ==,
+                          get_io_graph_item(tapped, unit, 0, hf_index, NULL, 1000000, -1));
+    }
+}
+
+/* Tapping first into one interval and second into the next, then merging
+ * the two, must give the same item as tapping both into one interval. */
+static void
+check_merge(int hf_index, const test_packet *first, const test_packet *second)
+{
+    io_graph_item_t split[2], tapped;
+
+    memset(split, 0, sizeof(split));
+    memset(&tapped, 0, sizeof(tapped));
+    reset_io_graph_items(split, 2, hf_index);
+    reset_io_graph_items(&tapped, 1, hf_index);
+
+    if (first) {
+        tap_packet(split, 0, hf_index, IOG_ITEM_UNIT_CALC_SUM, first);
+        tap_packet(&tapped, 0, hf_index, IOG_ITEM_UNIT_CALC_SUM, first);
+    }
+    if (second) {
+        tap_packet(split, 1, hf_index, IOG_ITEM_UNIT_CALC_SUM, second);
+        tap_packet(&tapped, 0, hf_index, IOG_ITEM_UNIT_CALC_SUM, second);
+    }
+    merge_io_graph_item(&split[0], &split[1], hf_index);
+    assert_items_equal(&split[0], &tapped, hf_index);
+}
+
+static void
+check_merge_field(int hf_index)
+{
+    static const test_packet low = { 1, 60, -3, true };
+    static const test_packet high = { 2, 1514, 250, true };
+    static const test_packet high_again = { 3, 64, 250, true };
+    static const test_packet zero = { 4, 100, 0, true };
+
+    check_merge(hf_index, &low, &high);
+    check_merge(hf_index, &high, &low);
+    /* Ties go to the earlier frame. */
+    check_merge(hf_index, &high, &high_again);
+    check_merge(hf_index, &zero, &high);
+    /* An empty interval on either side. */
+    check_merge(hf_index, NULL, &high);
+    check_merge(hf_index, &low, NULL);
+    check_merge(hf_index, NULL, NULL);
+}
+
+static void
+test_merge_frames(void)
+{
+    static const test_packet first = { 1, 60, 0, false };
+    static const test_packet second = { 2, 1514, 0, false };
+
+    check_merge(-1, &first, &second);
+    check_merge(-1, NULL, &second);
+}
+
+static void
+test_merge_uint(void)
+{
+    /* -3 wraps around to a large value, which is what makes it high. */
+    check_merge_field(hf_uint);
+}
+
+static void
+test_merge_int(void)
+{
+    check_merge_field(hf_int);
+}
+
+static void
+test_merge_double(void)
+{
+    check_merge_field(hf_double);
+}
+
+static void
+test_merge_reltime(void)
+{
+    check_merge_field(hf_reltime);
+}
+
+static void
+register_test_protocol(void)
+{
+    static hf_register_info hf[] = {
+        { &hf_uint,
+          { "Unsigned", "iogtest.uint", FT_UINT32, BASE_DEC, NULL, 0x0,
+            NULL, HFILL }},
+        { &hf_int,
+          { "Signed", "iogtest.int", FT_INT32, BASE_DEC, NULL, 0x0,
+            NULL, HFILL }},
+        { &hf_double,
+          { "Double", "iogtest.double", FT_DOUBLE, BASE_NONE, NULL, 0x0,
+            NULL, HFILL }},
+        { &hf_reltime,
+          { "Time", "iogtest.time", FT_RELATIVE_TIME, BASE_NONE, NULL, 0x0,
+            NULL, HFILL }},
+    };
+
+    proto_test = proto_register_protocol("I/O Graph Item Test", "IOGTEST", "iogtest");
+    proto_register_field_array(proto_test, hf, G_N_ELEMENTS(hf));
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    ws_log_init("io_graph_item_test", NULL);
+
+    g_test_init(&argc, &argv, NULL);
+
+    if (!epan_init(NULL, NULL, false)) {
+        return 2;
+    }
+    register_test_protocol();
+
+    g_test_add_func("/io_graph_item/merge/frames", test_merge_frames);
+    g_test_add_func("/io_graph_item/merge/uint", test_merge_uint);
+    g_test_add_func("/io_graph_item/merge/int", test_merge_int);
+    g_test_add_func("/io_graph_item/merge/double", test_merge_double);
+    g_test_add_func("/io_graph_item/merge/reltime", test_merge_reltime);
+
+    ret = g_test_run();
+
+    epan_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
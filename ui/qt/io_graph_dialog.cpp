@@ -98,6 +98,10 @@ const int min_zoom_pixels_ = 20;
 
 const int stat_update_interval_ = 200; // ms
 
+// The number of intervals a completely read file may span at the interval
+// packets are tapped at, if that is finer than the one shown.
+const int64_t max_tap_items_ = 1 << 18;
+
 // Saved graph settings
 typedef struct _io_graph_settings_t {
     bool enabled;
@@ -765,7 +769,9 @@ void IOGraphDialog::syncGraphSettings(int row)
 
     iog->y_axis_factor_ = uat_model_->data(uat_model_->index(row, colYAxisFactor)).toInt();
 
-    iog->setInterval(ui->intervalComboBox->itemData(ui->intervalComboBox->currentIndex()).toInt());
+    if (!iog->setInterval(ui->intervalComboBox->itemData(ui->intervalComboBox->currentIndex()).toInt(), cap_file_.capFile())) {
+        iog->setNeedRetap(true);
+    }
 
     if (!iog->configError().isEmpty()) {
         hint_err_ = iog->configError();
@@ -1510,6 +1516,7 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
 {
     int interval = ui->intervalComboBox->itemData(ui->intervalComboBox->currentIndex()).toInt();
     bool need_retap = false;
+    bool need_recalc = false;
 
     precision_ = ceil(log10(SCALE_F / interval));
     if (precision_ < 0) {
@@ -1531,8 +1538,9 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
         for (int row = 0; row < uat_model_->rowCount(); row++) {
             IOGraph *iog = ioGraphs_.value(row, NULL);
             if (iog) {
-                iog->setInterval(interval);
-                if (iog->visible()) {
+                if (iog->setInterval(interval, cap_file_.capFile())) {
+                    need_recalc = true;
+                } else if (iog->visible()) {
                     need_retap = true;
                 } else {
                     iog->setNeedRetap(true);
@@ -1543,6 +1551,8 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
 
     if (need_retap) {
         scheduleRetap(true);
+    } else if (need_recalc) {
+        scheduleRecalc(true);
     }
 }
 
@@ -2108,6 +2118,14 @@ IOGraph::IOGraph(QCustomPlot *parent) :
     hf_index_(-1),
     interval_(0),
     start_time_(NSTIME_INIT_ZERO),
+    base_interval_(0),
+    file_span_us_(0),
+    levels_(1),
+    base_cur_idx_(-1),
+    dirty_idx_(INT_MAX),
+    view_level_(0),
+    view_ratio_(0),
+    view_dirty_(false),
     cur_idx_(-1)
 {
     Q_ASSERT(parent_ != NULL);
@@ -2526,13 +2544,14 @@ int IOGraph::packetFromTime(double ts) const
 {
     int idx = ts * SCALE_F / interval_;
     if (idx >= 0 && idx <= cur_idx_) {
+        const io_graph_item_t *items = viewItems();
         switch (val_units_) {
         case IOG_ITEM_UNIT_CALC_MAX:
-            return items_[idx].max_frame_in_invl;
+            return items[idx].max_frame_in_invl;
         case IOG_ITEM_UNIT_CALC_MIN:
-            return items_[idx].min_frame_in_invl;
+            return items[idx].min_frame_in_invl;
         default:
-            return items_[idx].last_frame_in_invl;
+            return items[idx].last_frame_in_invl;
         }
     }
     return -1;
@@ -2540,10 +2559,16 @@ int IOGraph::packetFromTime(double ts) const
 
 void IOGraph::clearAllData()
 {
-    cur_idx_ = -1;
-    if (items_.size()) {
-        reset_io_graph_items(&items_[0], items_.size(), hf_index_);
+    base_cur_idx_ = -1;
+    if (levels_[0].size()) {
+        reset_io_graph_items(&levels_[0][0], levels_[0].size(), hf_index_);
     }
+    levels_.resize(1);
+    dirty_idx_ = INT_MAX;
+    // Everything is tapped again, so we can pick a new interval to tap at.
+    base_interval_ = tapInterval();
+    view_dirty_ = true;
+    updateView();
     if (graph_) {
         graph_->data()->clear();
     }
@@ -2555,6 +2580,8 @@ void IOGraph::clearAllData()
 
 void IOGraph::recalcGraphData(capture_file *cap_file)
 {
+    updateView();
+
     /* Moving average variables */
     unsigned int mavg_in_average_count = 0, mavg_left = 0;
     unsigned int mavg_to_remove = 0, mavg_to_add = 0;
@@ -2749,7 +2776,7 @@ bool IOGraph::hasItemToShow(int idx, double value) const
 
     bool result = false;
 
-    const io_graph_item_t *item = &items_[idx];
+    const io_graph_item_t *item = &viewItems()[idx];
 
     switch (val_units_) {
     case IOG_ITEM_UNIT_PACKETS:
@@ -2783,12 +2810,137 @@ bool IOGraph::hasItemToShow(int idx, double value) const
     return result;
 }
 
-void IOGraph::setInterval(int interval)
+// Returns false if the data for the new interval can't be derived from the
+// packets already tapped, in which case the graph needs a retap.
+bool IOGraph::setInterval(int interval, const capture_file *cap_file)
 {
+    if (cap_file) {
+        if (cap_file->state == FILE_READ_DONE) {
+            file_span_us_ = cap_file->elapsed_time.secs * INT64_C(1000000) + cap_file->elapsed_time.nsecs / 1000;
+        } else {
+            file_span_us_ = 0;
+        }
+    }
+    if (interval == interval_) {
+        return true;
+    }
     interval_ = interval;
     if (bars_) {
         bars_->setWidth(interval_ / SCALE_F);
     }
+    view_dirty_ = true;
+    updateView();
+    return view_ratio_ > 0;
+}
+
+// The interval to tap packets at. That's interval_ unless the file has been
+// read completely, in which case it is the finest of interval_ / 10, / 100
+// and / 1000 that doesn't need more than max_tap_items_ intervals, so that
+// finer intervals can be shown without a retap as well. LOAD spreads every
+// call over all of the intervals it spans, so it is tapped at interval_.
+int IOGraph::tapInterval() const
+{
+    int interval = interval_;
+
+    if (interval <= 0 || file_span_us_ <= 0 || val_units_ == IOG_ITEM_UNIT_CALC_LOAD) {
+        return interval;
+    }
+    for (int i = 0; i < 3 && interval % 10 == 0; i++) {
+        if (file_span_us_ / (interval / 10) >= max_tap_items_) {
+            break;
+        }
+        interval /= 10;
+    }
+    return interval;
+}
+
+// Fill in levels_[level] from from_idx on by merging pairs of
+// levels_[level - 1].
+void IOGraph::rollUpLevel(size_t level, int from_idx)
+{
+    const std::vector<io_graph_item_t> &finer = levels_[level - 1];
+    std::vector<io_graph_item_t> &coarser = levels_[level];
+    size_t count = (size_t)(base_cur_idx_ >> level) + 1;
+
+    coarser.resize(count);
+    for (size_t idx = from_idx; idx < count; idx++) {
+        coarser[idx] = finer[2 * idx];
+        if (2 * idx + 1 < finer.size()) {
+            merge_io_graph_item(&coarser[idx], &finer[2 * idx + 1], hf_index_);
+        }
+    }
+}
+
+// Bring the levels and the items shown at interval_ up to date with the
+// packets tapped since the last update, or with a new interval.
+void IOGraph::updateView()
+{
+    int from_idx = dirty_idx_;
+
+    if (view_dirty_) {
+        view_dirty_ = false;
+        view_level_ = 0;
+        view_ratio_ = 0;
+        items_.clear();
+        from_idx = 0;
+        if (base_interval_ <= 0 || interval_ % base_interval_ != 0) {
+            cur_idx_ = -1;
+            return;
+        }
+        view_ratio_ = interval_ / base_interval_;
+        while (view_ratio_ % 2 == 0) {
+            view_ratio_ /= 2;
+            view_level_++;
+        }
+    }
+
+    if (view_ratio_ == 0 || base_cur_idx_ < 0) {
+        cur_idx_ = -1;
+        return;
+    }
+
+    try {
+        for (size_t level = 1; level < levels_.size() || level <= view_level_; level++) {
+            if (level < levels_.size()) {
+                rollUpLevel(level, dirty_idx_ >> level);
+            } else {
+                levels_.emplace_back();
+                rollUpLevel(level, 0);
+            }
+        }
+        dirty_idx_ = INT_MAX;
+
+        const std::vector<io_graph_item_t> &level_items = levels_[view_level_];
+        int level_cur_idx = base_cur_idx_ >> view_level_;
+        cur_idx_ = level_cur_idx / view_ratio_;
+        if (view_ratio_ > 1) {
+            items_.resize((size_t)cur_idx_ + 1);
+            for (int idx = (from_idx >> view_level_) / view_ratio_; idx <= cur_idx_; idx++) {
+                int first = idx * view_ratio_;
+                items_[idx] = level_items[first];
+                for (int i = first + 1; i < first + view_ratio_ && i <= level_cur_idx; i++) {
+                    merge_io_graph_item(&items_[idx], &level_items[i], hf_index_);
+                }
+            }
+        }
+    } catch (std::bad_alloc&) {
+        ws_warning("Failed memory allocation!");
+        levels_.resize(1);
+        items_.clear();
+        view_dirty_ = true;
+        cur_idx_ = -1;
+    }
+}
+
+const io_graph_item_t *IOGraph::viewItems() const
+{
+    if (view_ratio_ > 1) {
+        return items_.data();
+    }
+    if (view_level_ >= levels_.size()) {
+        return NULL;
+    }
+    return levels_[view_level_].data();
 }
 
 // Get the value at the given interval (idx) for the current value unit.
@@ -2796,7 +2948,7 @@ double IOGraph::getItemValue(int idx, const capture_file *cap_file) const
 {
     ws_assert(idx < max_io_items_);
 
-    return get_io_graph_item(&items_[0], val_units_, idx, hf_index_, cap_file, interval_, cur_idx_);
+    return get_io_graph_item(viewItems(), val_units_, idx, hf_index_, cap_file, interval_, cur_idx_);
 }
 
 // "tap_reset" callback for register_tap_listener
@@ -2817,12 +2969,14 @@ tap_packet_status IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dis
         return TAP_PACKET_DONT_REDRAW;
     }
 
-    int64_t tmp_idx = get_io_graph_index(pinfo, iog->interval_);
+    int64_t tmp_idx = get_io_graph_index(pinfo, iog->base_interval_);
     bool recalc = false;
+    std::vector<io_graph_item_t> &items = iog->levels_[0];
 
     /* some sanity checks */
     if ((tmp_idx < 0) || (tmp_idx >= max_io_items_)) {
-        iog->cur_idx_ = (int)iog->items_.size() - 1;
+        iog->dirty_idx_ = MIN(iog->dirty_idx_, MAX(iog->base_cur_idx_, 0));
+        iog->base_cur_idx_ = (int)items.size() - 1;
         return TAP_PACKET_DONT_REDRAW;
     }
 
@@ -2836,14 +2990,14 @@ tap_packet_status IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dis
      * enabled/disabled taps.
      */
     if (!iog->visible()) {
-        if (idx > iog->cur_idx_) {
+        if (idx > iog->base_cur_idx_) {
             iog->need_retap_ = true;
         }
         return TAP_PACKET_DONT_REDRAW;
     }
 
-    if ((size_t)idx >= iog->items_.size()) {
-        const size_t old_size = iog->items_.size();
+    if ((size_t)idx >= items.size()) {
+        const size_t old_size = items.size();
         size_t new_size;
         if (old_size == 0) {
             new_size = 1024;
@@ -2852,19 +3006,19 @@ tap_packet_status IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dis
         }
         new_size = MAX(new_size, (size_t)idx + 1);
         try {
-            iog->items_.resize(new_size);
+            items.resize(new_size);
         } catch (std::bad_alloc&) {
             // std::vector.resize() has strong exception safety
             ws_warning("Failed memory allocation!");
             return TAP_PACKET_DONT_REDRAW;
         }
         // resize zero-initializes new items, which is what we want
-        //reset_io_graph_items(&iog->items_[old_size], new_size - old_size);
+        //reset_io_graph_items(&items[old_size], new_size - old_size);
     }
 
     /* update num_items */
-    if (idx > iog->cur_idx_) {
-        iog->cur_idx_ = idx;
+    if (idx > iog->base_cur_idx_) {
+        iog->base_cur_idx_ = idx;
         recalc = true;
     }
 
@@ -2879,7 +3033,10 @@ tap_packet_status IOGraph::tapPacket(void *iog_ptr, packet_info *pinfo, epan_dis
         adv_edt = edt;
     }
 
-    if (!update_io_graph_item(&iog->items_[0], idx, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->interval_)) {
+    /* LOAD adds to the intervals before this one as well. */
+    iog->dirty_idx_ = MIN(iog->dirty_idx_, iog->val_units_ == IOG_ITEM_UNIT_CALC_LOAD ? 0 : idx);
+
+    if (!update_io_graph_item(&items[0], idx, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->base_interval_)) {
         return TAP_PACKET_DONT_REDRAW;
     }
 
@@ -85,7 +85,7 @@ public:
     QString valueUnitField() const { return vu_field_; }
     void setValueUnitField(const QString &vu_field);
     unsigned int movingAveragePeriod() const { return moving_avg_period_; }
-    void setInterval(int interval);
+    bool setInterval(int interval, const capture_file *cap_file = NULL);
     bool addToLegend();
     bool removeFromLegend();
     QCPGraph *graph() const { return graph_; }
@@ -119,6 +119,10 @@ private:
     static void tapDraw(void *iog_ptr);
 
     void removeTapListener();
+    int tapInterval() const;
+    void rollUpLevel(size_t level, int from_idx);
+    void updateView();
+    const io_graph_item_t *viewItems() const;
 
     bool showsZero() const;
 
@@ -142,8 +146,21 @@ private:
     int interval_;
     nstime_t start_time_;
 
-    // Cached data. We should be able to change the Y axis without retapping as
-    // much as is feasible.
+    // Cached data. We should be able to change the Y axis and the interval
+    // without retapping as much as is feasible.
+    // Packets are counted in intervals of base_interval_ in levels_[0], and
+    // levels_[n] rolls pairs of levels_[n-1] up into intervals of
+    // base_interval_ << n. Any interval that is a multiple of base_interval_
+    // is served from the coarsest level that divides it, directly or by
+    // merging its items into items_.
+    int base_interval_;
+    int64_t file_span_us_; // Length of a completely read file, else 0
+    std::vector<std::vector<io_graph_item_t>> levels_;
+    int base_cur_idx_;
+    int dirty_idx_;        // levels_[0] items from here on aren't rolled up
+    size_t view_level_;
+    int view_ratio_;       // interval_ / (base_interval_ << view_level_)
+    bool view_dirty_;
     std::vector<io_graph_item_t> items_;
     int cur_idx_;
 };
@@ -28,6 +28,7 @@
 #include <ui/qt/utils/color_utils.h>
 #include <ui/qt/capture_file.h>
 #include <ui/qt/widgets/clickable_label.h>
+#include <ui/qt/models/packet_list_record.h>
 
 #include <QAction>
 #include <QActionGroup>
@@ -474,7 +475,7 @@ void MainStatusBar::showCaptureStatistics()
     }
 
     popGenericStatus(STATUS_CTX_MAIN);
-    pushGenericStatus(STATUS_CTX_MAIN, packets_str);
+    pushGenericStatus(STATUS_CTX_MAIN, packets_str, PacketListRecord::cacheStatistics());
 }
 
 void MainStatusBar::updateCaptureStatistics(capture_session *cap_session)
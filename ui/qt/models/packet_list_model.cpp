@@ -8,7 +8,9 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <numeric>
 #include <stdexcept>
 
 #include "packet_list_model.h"
@@ -36,8 +38,10 @@
 #include <QColor>
 #include <QElapsedTimer>
 #include <QFontMetrics>
+#include <QHash>
 #include <QModelIndex>
-#include <QElapsedTimer>
+#include <QThread>
+#include <QtConcurrent>
 
 // Print timing information
 //#define DEBUG_PACKET_LIST_MODEL 1
@@ -51,6 +55,98 @@ class SortAbort : public std::runtime_error
     using std::runtime_error::runtime_error;
 };
 
+// Rows are sorted by keys extracted from them before sorting, so that
+// each row is dissected once rather than every time it is compared, and
+// the sort itself can run on other threads. The text of a column is
+// interned, and the distinct strings ranked, so that comparing the text
+// of two rows is comparing two integers.
+struct PacketListSortKey
+{
+    PacketListRecord *record;
+    unsigned text_rank;
+};
+
+// The numeric value of a distinct column string, by rank.
+struct PacketListSortText
+{
+    double num;
+    bool num_ok;
+};
+
+class PacketListSortLess
+{
+public:
+    PacketListSortLess(capture_file *cf, int column, bool text_column, bool numeric,
+                       Qt::SortOrder order, const QVector<PacketListSortText> &texts,
+                       const std::atomic<bool> &abort) :
+        cf_(cf),
+        col_fmt_(cf->cinfo.columns[column].col_fmt),
+        text_column_(text_column),
+        numeric_(numeric),
+        order_(order),
+        texts_(texts),
+        abort_(abort)
+    {}
+
+    // Called on worker threads; this only reads the keys and frame data.
+    bool operator()(const PacketListSortKey &k1, const PacketListSortKey &k2) const
+    {
+        int cmp_val = 0;
+
+        if (abort_.load(std::memory_order_relaxed)) {
+            throw SortAbort("Sorting aborted");
+        }
+
+        if (!text_column_) {
+            // Column comes directly from frame data
+            cmp_val = frame_data_compare(cf_->epan, k1.record->frameData(), k2.record->frameData(), col_fmt_);
+        } else {
+            // XXX: The ranks follow the naive string comparison, which
+            // compares Unicode code points. Proper collation is more expensive
+            cmp_val = (k1.text_rank > k2.text_rank) - (k1.text_rank < k2.text_rank);
+            if (cmp_val != 0 && numeric_) {
+                // Custom column with numeric data (or something like a port
+                // number), parsed once per distinct string.
+                const PacketListSortText &t1 = texts_.at(k1.text_rank);
+                const PacketListSortText &t2 = texts_.at(k2.text_rank);
+
+                if (!t1.num_ok && !t2.num_ok) {
+                    cmp_val = 0;
+                } else if (!t1.num_ok || (t2.num_ok && t1.num < t2.num)) {
+                    // either r1 is invalid (and sort it before others) or both
+                    // r1 and r2 are valid (sort normally)
+                    cmp_val = -1;
+                } else if (!t2.num_ok || (t1.num > t2.num)) {
+                    cmp_val = 1;
+                }
+            }
+
+            if (cmp_val == 0) {
+                // All else being equal, compare column numbers.
+                cmp_val = frame_data_compare(cf_->epan, k1.record->frameData(), k2.record->frameData(), COL_NUMBER);
+            }
+        }
+
+        if (order_ == Qt::AscendingOrder) {
+            return cmp_val < 0;
+        } else {
+            return cmp_val > 0;
+        }
+    }
+
+private:
+    capture_file *cf_;
+    int col_fmt_;
+    bool text_column_;
+    bool numeric_;
+    Qt::SortOrder order_;
+    const QVector<PacketListSortText> &texts_;
+    const std::atomic<bool> &abort_;
+};
+
+// Don't bother splitting the sort into runs shorter than this.
+static const qsizetype min_sort_run_ = 16384;
+
 static PacketListModel * glbl_plist_model = Q_NULLPTR;
 static const int reserved_packets_ = 100000;
 
@@ -558,8 +654,6 @@ Qt::SortOrder PacketListModel::sort_order_;
 capture_file *PacketListModel::sort_cap_file_;
 bool PacketListModel::stop_flag_;
 ProgressFrame *PacketListModel::progress_frame_;
-double PacketListModel::comps_;
-double PacketListModel::exp_comps_;
 
 QElapsedTimer busy_timer_;
 const int busy_timeout_ = 65; // ms, approximately 15 fps
@@ -578,27 +672,6 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
 
     QString col_title = get_column_title(column);
 
-    if (text_sort_column_ >= 0 && (unsigned)visible_rows_.count() > prefs.gui_packet_list_cached_rows_max) {
-        /* Column not based on frame data but by column text that requires
-         * dissection, so to sort in a reasonable amount of time the column
-         * text needs to be cached.
-         */
-        /* If the sort is being triggered because the columns were already
-         * sorted and the filter is being cleared (or changed to something
-         * else with more rows than fit in the cache), then the temporary
-         * message will be immediately overwritten with the standard capture
-         * statistics by the packets_bar_update() call after thawing the rows.
-         * It will still blink yellow, and the user will get the message if
-         * they then click on the header file (wondering why it didn't sort.)
-         */
-        if (col_title.isEmpty()) {
-            col_title = tr("Column");
-        }
-        QString temp_msg = tr("%1 can only be sorted with %2 or fewer visible rows; increase cache size in Layout preferences").arg(col_title).arg(prefs.gui_packet_list_cached_rows_max);
-        mainApp->pushStatus(MainApplication::TemporaryStatus, temp_msg);
-        return;
-    }
-
     /* If we are currently in the middle of reading the capture file, don't
      * sort. PacketList::captureFileReadFinished invalidates all the cached
      * column strings and then tries to sort again.
@@ -622,14 +695,6 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
         busy_msg = tr("Sorting …");
     }
     stop_flag_ = false;
-    comps_ = 0;
-    /* XXX: The expected number of comparisons is O(N log N), but this could
-     * be a pretty significant overestimate of the amount of time it takes,
-     * if there are lots of identical entries. (Especially with string
-     * comparisons, some comparisons are faster than others.) Better to
-     * overestimate?
-     */
-    exp_comps_ = log2(visible_rows_.count()) * visible_rows_.count();
     progress_frame_ = nullptr;
     if (qobject_cast<MainWindow *>(mainApp->mainWindow())) {
         MainWindow *mw = qobject_cast<MainWindow *>(mainApp->mainWindow());
@@ -643,18 +708,30 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
 
     busy_timer_.start();
     sort_column_is_numeric_ = isNumericColumn(sort_column_);
-    QVector<PacketListRecord *> sorted_visible_rows_ = visible_rows_;
-    try {
-        std::sort(sorted_visible_rows_.begin(), sorted_visible_rows_.end(), recordLessThan);
 
+    /* The rows might change while we process events; sort the ones we
+     * started with, and only keep those that are still displayed below.
+     */
+    const QVector<PacketListRecord *> rows = visible_rows_;
+    QVector<PacketListSortKey> keys;
+    QVector<PacketListSortText> texts;
+    std::atomic<bool> abort(false);
+    bool sorted = makeSortKeys(rows, keys, texts);
+    if (sorted) {
+        PacketListSortLess less(sort_cap_file_, sort_column_, text_sort_column_ >= 0,
+                                sort_column_is_numeric_, sort_order_, texts, abort);
+        sorted = sortKeys(keys, less, abort);
+    }
+
+    if (sorted) {
         beginResetModel();
         visible_rows_.resize(0);
         number_to_row_.fill(0);
-        foreach (PacketListRecord *record, sorted_visible_rows_) {
-            frame_data *fdata = record->frameData();
+        foreach (const PacketListSortKey &key, keys) {
+            frame_data *fdata = key.record->frameData();
 
             if (fdata->passed_dfilter || fdata->ref_time) {
-                visible_rows_ << record;
+                visible_rows_ << key.record;
                 if (number_to_row_.size() <= (int)fdata->num) {
                     number_to_row_.resize(fdata->num + 10000);
                 }
@@ -662,8 +739,8 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
             }
         }
         endResetModel();
-    } catch (const SortAbort& e) {
-        mainApp->pushStatus(MainApplication::TemporaryStatus, e.what());
+    } else {
+        mainApp->pushStatus(MainApplication::TemporaryStatus, tr("Sorting aborted"));
     }
 
     if (progress_frame_ != nullptr) {
@@ -678,6 +755,163 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
     }
 }
 
+// Update the progress bar and let the GUI breathe. Returns false if the
+// user stopped the sort.
+bool PacketListModel::sortProgress(int percent)
+{
+    if (busy_timer_.elapsed() > busy_timeout_) {
+        if (progress_frame_) {
+            progress_frame_->setValue(percent);
+        }
+        // What's the least amount of processing that we can do which will draw
+        // the busy indicator?
+        mainApp->processEvents(QEventLoop::ExcludeSocketNotifiers, 1);
+        busy_timer_.restart();
+    }
+    return !stop_flag_;
+}
+
+// Extract the sort keys of the rows. This is where the rows are dissected,
+// if the column needs it, so it runs here on the GUI thread and takes the
+// first half of the progress bar.
+bool PacketListModel::makeSortKeys(const QVector<PacketListRecord *> &rows,
+                                   QVector<PacketListSortKey> &keys,
+                                   QVector<PacketListSortText> &texts)
+{
+    keys.reserve(rows.count());
+
+    if (text_sort_column_ < 0) {
+        foreach (PacketListRecord *record, rows) {
+            keys << PacketListSortKey{ record, 0 };
+        }
+        return true;
+    }
+
+    QHash<QString, unsigned> text_ids;
+    QVector<QString> strings;
+    qsizetype row = 0;
+    foreach (PacketListRecord *record, rows) {
+        QString text = record->columnString(sort_cap_file_, sort_column_);
+        QHash<QString, unsigned>::const_iterator it = text_ids.constFind(text);
+        unsigned id;
+
+        if (it == text_ids.constEnd()) {
+            id = static_cast<unsigned>(strings.count());
+            text_ids.insert(text, id);
+            strings << text;
+        } else {
+            id = it.value();
+        }
+        keys << PacketListSortKey{ record, id };
+
+        if (!sortProgress(static_cast<int>(++row * 50 / rows.count()))) {
+            return false;
+        }
+    }
+    text_ids.clear();
+
+    // Rank the distinct strings, and replace the ids with the ranks.
+    QVector<unsigned> by_text(strings.count());
+    std::iota(by_text.begin(), by_text.end(), 0);
+    std::sort(by_text.begin(), by_text.end(), [&strings](unsigned id1, unsigned id2) {
+        return strings.at(id1).compare(strings.at(id2)) < 0;
+    });
+
+    QVector<unsigned> rank(strings.count());
+    texts.resize(strings.count());
+    for (unsigned r = 0; r < static_cast<unsigned>(by_text.count()); r++) {
+        rank[by_text.at(r)] = r;
+        if (sort_column_is_numeric_) {
+            texts[r].num = parseNumericColumn(strings.at(by_text.at(r)), &texts[r].num_ok);
+        } else {
+            texts[r].num = 0;
+            texts[r].num_ok = false;
+        }
+    }
+    for (PacketListSortKey &key : keys) {
+        key.text_rank = rank.at(key.text_rank);
+    }
+
+    return true;
+}
+
+// Sort runs of the keys on worker threads, then merge them pairwise, also on
+// worker threads, while the GUI thread keeps the progress bar going and
+// watches for the user stopping the sort.
+bool PacketListModel::sortKeys(QVector<PacketListSortKey> &keys,
+                               const PacketListSortLess &less, std::atomic<bool> &abort)
+{
+    qsizetype runs = qBound<qsizetype>(1, keys.count() / min_sort_run_, QThread::idealThreadCount());
+    QVector<qsizetype> bounds;
+    for (qsizetype i = 0; i <= runs; i++) {
+        bounds << keys.count() * i / runs;
+    }
+    PacketListSortKey *base = keys.data();
+
+    // Each run is sorted, and then there is one merge less than there are runs.
+    int steps = static_cast<int>(runs * 2 - 1);
+    int steps_done = 0;
+
+    QList<QFuture<bool>> futures;
+    for (qsizetype i = 0; i < runs; i++) {
+        PacketListSortKey *first = base + bounds.at(i);
+        PacketListSortKey *last = base + bounds.at(i + 1);
+        futures << QtConcurrent::run([first, last, &less]() {
+            try {
+                std::sort(first, last, less);
+            } catch (const SortAbort &) {
+                return false;
+            }
+            return true;
+        });
+    }
+
+    for (;;) {
+        bool ok = true;
+        foreach (QFuture<bool> future, futures) {
+            while (!future.isFinished()) {
+                if (!sortProgress(50 + (steps_done * 50 / steps))) {
+                    abort = true;
+                }
+                QThread::msleep(1);
+            }
+            ok = future.result() && ok;
+            steps_done++;
+        }
+        if (!ok || abort) {
+            return false;
+        }
+        if (bounds.count() <= 2) {
+            break;
+        }
+
+        QVector<qsizetype> merged_bounds;
+        merged_bounds << 0;
+        futures.clear();
+        for (qsizetype i = 0; i + 2 < bounds.count(); i += 2) {
+            PacketListSortKey *first = base + bounds.at(i);
+            PacketListSortKey *middle = base + bounds.at(i + 1);
+            PacketListSortKey *last = base + bounds.at(i + 2);
+            futures << QtConcurrent::run([first, middle, last, &less]() {
+                try {
+                    std::inplace_merge(first, middle, last, less);
+                } catch (const SortAbort &) {
+                    return false;
+                }
+                return true;
+            });
+            merged_bounds << bounds.at(i + 2);
+        }
+        if (bounds.count() % 2 == 0) {
+            // An odd number of runs; the last one waits for the next round.
+            merged_bounds << bounds.last();
+        }
+        bounds = merged_bounds;
+    }
+
+    return true;
+}
+
 void PacketListModel::stopSorting()
 {
     stop_flag_ = true;
@@ -760,74 +994,6 @@ bool PacketListModel::isNumericColumn(int column)
     return true;
 }
 
-bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2)
-{
-    int cmp_val = 0;
-    comps_++;
-
-    // Wherein we try to cram the logic of packet_list_compare_records,
-    // _packet_list_compare_records, and packet_list_compare_custom from
-    // gtk/packet_list_store.c into one function
-
-    if (busy_timer_.elapsed() > busy_timeout_) {
-        if (progress_frame_) {
-            progress_frame_->setValue(static_cast<int>(comps_/exp_comps_ * 100));
-        }
-        // What's the least amount of processing that we can do which will draw
-        // the busy indicator?
-        mainApp->processEvents(QEventLoop::ExcludeSocketNotifiers, 1);
-        if (stop_flag_) {
-            throw SortAbort("Sorting aborted");
-        }
-        busy_timer_.restart();
-    }
-    if (sort_column_ < 0) {
-        // No column.
-        cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), COL_NUMBER);
-    } else if (text_sort_column_ < 0) {
-        // Column comes directly from frame data
-        cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), sort_cap_file_->cinfo.columns[sort_column_].col_fmt);
-    } else  {
-        QString r1String = r1->columnString(sort_cap_file_, sort_column_);
-        QString r2String = r2->columnString(sort_cap_file_, sort_column_);
-        // XXX: The naive string comparison compares Unicode code points.
-        // Proper collation is more expensive
-        cmp_val = r1String.compare(r2String);
-        if (cmp_val != 0 && sort_column_is_numeric_) {
-            // Custom column with numeric data (or something like a port number).
-            // Attempt to convert to numbers.
-            // XXX This is slow. Can we avoid doing this? Perhaps the actual
-            // values used for sorting should be cached too as QVariant[List].
-            // If so, we could consider using QCollatorSortKeys or similar
-            // for strings as well.
-            bool ok_r1, ok_r2;
-            double num_r1 = parseNumericColumn(r1String, &ok_r1);
-            double num_r2 = parseNumericColumn(r2String, &ok_r2);
-
-            if (!ok_r1 && !ok_r2) {
-                cmp_val = 0;
-            } else if (!ok_r1 || (ok_r2 && num_r1 < num_r2)) {
-                // either r1 is invalid (and sort it before others) or both
-                // r1 and r2 are valid (sort normally)
-                cmp_val = -1;
-            } else if (!ok_r2 || (num_r1 > num_r2)) {
-                cmp_val = 1;
-            }
-        }
-
-        if (cmp_val == 0) {
-            // All else being equal, compare column numbers.
-            cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), COL_NUMBER);
-        }
-    }
-
-    if (sort_order_ == Qt::AscendingOrder) {
-        return cmp_val < 0;
-    } else {
-        return cmp_val > 0;
-    }
-}
-
 // Parses a field as a double. Handle values with suffixes ("12ms"), negative
 // values ("-1.23") and fields with multiple occurrences ("1,2"). Marks values
 // that do not contain any numeric value ("Unknown") as invalid.
@@ -14,6 +14,8 @@
 
 #include <stdio.h>
 
+#include <atomic>
+
 #include <epan/packet.h>
 
 #include <QAbstractItemModel>
@@ -28,6 +30,10 @@
 
 class QElapsedTimer;
 
+struct PacketListSortKey;
+struct PacketListSortText;
+class PacketListSortLess;
+
 class PacketListModel : public QAbstractItemModel
 {
     Q_OBJECT
@@ -109,13 +115,17 @@ private:
     static int text_sort_column_;
     static Qt::SortOrder sort_order_;
     static capture_file *sort_cap_file_;
-    static bool recordLessThan(PacketListRecord *r1, PacketListRecord *r2);
     static double parseNumericColumn(const QString &val, bool *ok);
 
     static bool stop_flag_;
     static ProgressFrame *progress_frame_;
-    static double exp_comps_;
-    static double comps_;
+
+    bool sortProgress(int percent);
+    bool makeSortKeys(const QVector<PacketListRecord *> &rows,
+                      QVector<PacketListSortKey> &keys,
+                      QVector<PacketListSortText> &texts);
+    bool sortKeys(QVector<PacketListSortKey> &keys,
+                  const PacketListSortLess &less, std::atomic<bool> &abort);
 
     QElapsedTimer *idle_dissection_timer_;
     int idle_dissection_row_;
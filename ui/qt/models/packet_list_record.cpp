@@ -24,7 +24,31 @@
 
 #include <QStringList>
 
-QCache<uint32_t, QStringList> PacketListRecord::col_text_cache_(500);
+// Values longer than this, e.g. most Info column values, are seldom repeated.
+static const int max_interned_length_ = 64;
+// Rough allocation overhead of a QString's data, in bytes.
+static const int string_overhead_ = 32;
+// Stop sharing the values of a column if fewer than half of this many
+// lookups find a value to share.
+static const int column_sharing_sample_ = 1024;
+// After a sweep of the pool that doesn't make room, add this many values
+// to rows without sharing them before sweeping again.
+static const int string_pool_sweep_delay_max_ = 1024;
+
+// Bytes taken up by a pooled value: its key, its QString and the hash node.
+static inline qsizetype pooledSize(qsizetype len, qsizetype size)
+{
+    return len + size * static_cast<qsizetype>(sizeof(QChar)) + 2 * string_overhead_;
+}
+
+QCache<uint32_t, QStringList> PacketListRecord::col_text_cache_(28 * 1024 * 1024);
+QStringList PacketListRecord::uncached_col_text_;
+uint32_t PacketListRecord::uncached_num_ = 0;
+QHash<QByteArray, QString> PacketListRecord::string_pool_;
+qsizetype PacketListRecord::string_pool_bytes_ = 0;
+qsizetype PacketListRecord::max_string_pool_bytes_ = 4 * 1024 * 1024;
+int PacketListRecord::string_pool_sweep_delay_ = 0;
+QVector<PacketListRecord::ColumnSharing> PacketListRecord::column_sharing_;
 QMap<int, int> PacketListRecord::cinfo_column_;
 unsigned PacketListRecord::rows_color_ver_ = 1;
 
@@ -61,7 +85,7 @@ void PacketListRecord::ensureColorized(capture_file *cap_file)
 }
 
 // We might want to return a const char * instead. This would keep us from
-// creating excessive QByteArrays, e.g. in PacketListModel::recordLessThan.
+// creating excessive QByteArrays, e.g. in PacketListModel::makeSortKeys.
 const QString PacketListRecord::columnString(capture_file *cap_file, int column, bool colorized)
 {
     // packet_list_store.c:packet_list_get_value
@@ -79,14 +103,75 @@ const QString PacketListRecord::columnString(capture_file *cap_file, int column,
     bool dissect_color = ( colorized && !colorized_ ) || ( color_ver_ != rows_color_ver_ );
     QStringList *col_text = nullptr;
     if (!dissect_color) {
-        col_text = col_text_cache_.object(fdata_->num);
+        col_text = cachedColumnStrings();
     }
     if (col_text == nullptr || column >= col_text->count() || col_text->at(column).isNull()) {
         dissect(cap_file, true, dissect_color);
-        col_text = col_text_cache_.object(fdata_->num);
+        col_text = cachedColumnStrings();
     }
 
-    return col_text ? col_text->at(column) : QString();
+    return col_text && column < col_text->count() ? col_text->at(column) : QString();
+}
+
+// The column text of this row, if we have it.
+QStringList *PacketListRecord::cachedColumnStrings()
+{
+    QStringList *col_text = col_text_cache_.object(fdata_->num);
+
+    if (col_text == nullptr && uncached_num_ == fdata_->num) {
+        col_text = &uncached_col_text_;
+    }
+    return col_text;
+}
+
+void PacketListRecord::invalidateRecord()
+{
+    col_text_cache_.remove(fdata_->num);
+    if (uncached_num_ == fdata_->num) {
+        uncached_col_text_.clear();
+        uncached_num_ = 0;
+    }
+}
+
+void PacketListRecord::invalidateAllRecords()
+{
+    col_text_cache_.clear();
+    uncached_col_text_.clear();
+    uncached_num_ = 0;
+    string_pool_.clear();
+    string_pool_bytes_ = 0;
+    string_pool_sweep_delay_ = 0;
+    for (ColumnSharing &sharing : column_sharing_) {
+        sharing.lookups = sharing.hits = 0;
+    }
+}
+
+void PacketListRecord::setMaxCache(qsizetype bytes)
+{
+    // The shared values get an eighth, and the rows the rest.
+    max_string_pool_bytes_ = bytes / 8;
+    bytes -= max_string_pool_bytes_;
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    // QCache maxCost is an int in Qt 5.
+    bytes = qMin(bytes, static_cast<qsizetype>(INT_MAX));
+    col_text_cache_.setMaxCost(static_cast<int>(bytes));
+#else
+    col_text_cache_.setMaxCost(bytes);
+#endif
+}
+
+QString PacketListRecord::cacheStatistics()
+{
+    QString rows = QObject::tr("%Ln row(s)", "", static_cast<int>(col_text_cache_.size()));
+    QString values = QObject::tr("%Ln shared value(s)", "", static_cast<int>(string_pool_.size()));
+
+    return QObject::tr("Packet list cache: %1, %2 of %3; %4, %5 of %6")
+            .arg(rows)
+            .arg(file_size_to_qstring(col_text_cache_.totalCost()))
+            .arg(file_size_to_qstring(col_text_cache_.maxCost()))
+            .arg(values)
+            .arg(file_size_to_qstring(string_pool_bytes_))
+            .arg(file_size_to_qstring(max_string_pool_bytes_));
 }
 
 void PacketListRecord::resetColumns(column_info *cinfo)
@@ -98,10 +183,14 @@ void PacketListRecord::resetColumns(column_info *cinfo)
     }
 
     cinfo_column_.clear();
+    column_sharing_.fill(ColumnSharing(), cinfo->num_cols);
     int i, j;
     for (i = 0, j = 0; i < cinfo->num_cols; i++) {
+        // Frame numbers, times and lengths are seldom repeated, so only
+        // try to share the values of the other columns.
         if (!col_based_on_frame_data(cinfo, i)) {
             cinfo_column_[i] = j;
+            column_sharing_[i].shared = true;
             j++;
         }
     }
@@ -213,6 +302,86 @@ void PacketListRecord::dissect(capture_file *cap_file, bool dissect_columns, boo
     wtap_rec_cleanup(&rec);
 }
 
+// Drop the pooled values no cached row uses any more. Return true if that
+// leaves room for needed more bytes.
+bool PacketListRecord::sweepStringPool(qsizetype needed)
+{
+    if (string_pool_sweep_delay_ > 0) {
+        string_pool_sweep_delay_--;
+        return false;
+    }
+
+    QHash<QByteArray, QString>::iterator it = string_pool_.begin();
+    while (it != string_pool_.end()) {
+        if (it.value().isDetached()) {
+            string_pool_bytes_ -= pooledSize(it.key().size(), it.value().size());
+            it = string_pool_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (string_pool_bytes_ + needed > max_string_pool_bytes_) {
+        // Most values are in use; don't look again for a while.
+        string_pool_sweep_delay_ = string_pool_sweep_delay_max_;
+        return false;
+    }
+    return true;
+}
+
+// Return the QString for the value of a column, shared with other rows if
+// the column's values repeat. Set *cost to the number of bytes the row's
+// copy takes up, which is 0 for values in the pool, as those are accounted
+// for in string_pool_bytes_. Values are only removed from the pool once no
+// row uses them, so every value a row holds is charged either to the row
+// or to the pool.
+QString PacketListRecord::internColumnString(int column, const char *text, int *cost)
+{
+    if (!text) {
+        *cost = 0;
+        return QString();
+    }
+
+    int len = static_cast<int>(strlen(text));
+    ColumnSharing *sharing = column < column_sharing_.size() ? &column_sharing_[column] : nullptr;
+
+    if (sharing && sharing->shared && len <= max_interned_length_) {
+        // Look the value up without copying it.
+        QHash<QByteArray, QString>::const_iterator it = string_pool_.constFind(QByteArray::fromRawData(text, len));
+        bool found = it != string_pool_.constEnd();
+
+        sharing->lookups++;
+        if (found) {
+            sharing->hits++;
+        }
+        if (sharing->lookups >= column_sharing_sample_) {
+            // Values already pooled are dropped by the next sweep once the
+            // rows using them are gone.
+            sharing->shared = sharing->hits * 2 >= sharing->lookups;
+            sharing->lookups = sharing->hits = 0;
+        }
+        if (found) {
+            *cost = 0;
+            return it.value();
+        }
+
+        QString str = QString::fromUtf8(text, len);
+        qsizetype size = pooledSize(len, str.size());
+        if (string_pool_bytes_ + size <= max_string_pool_bytes_ || sweepStringPool(size)) {
+            string_pool_.insert(QByteArray(text, len), str);
+            string_pool_bytes_ += size;
+            *cost = 0;
+            return str;
+        }
+        *cost = static_cast<int>(str.size() * sizeof(QChar)) + string_overhead_;
+        return str;
+    }
+
+    QString str = QString::fromUtf8(text, len);
+    *cost = static_cast<int>(str.size() * sizeof(QChar)) + string_overhead_;
+    return str;
+}
+
 void PacketListRecord::cacheColumnStrings(column_info *cinfo)
 {
     // packet_list_store.c:packet_list_change_record(PacketList *packet_list, PacketListRecord *record, int col, column_info *cinfo)
@@ -221,12 +390,15 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
     }
 
     QStringList *col_text = new QStringList();
+    int cost = static_cast<int>(sizeof(QStringList) + cinfo->num_cols * sizeof(QString));
 
+    col_text->reserve(cinfo->num_cols);
     lines_ = 1;
     line_count_changed_ = false;
 
     for (int column = 0; column < cinfo->num_cols; ++column) {
         int col_lines = 1;
+        int col_cost;
 
         QString col_str;
         int text_col = cinfo_column_.value(column, -1);
@@ -234,7 +406,8 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
             col_fill_in_frame_data(fdata_, cinfo, column, false);
         }
 
-        col_str = QString(get_column_text(cinfo, column));
+        col_str = internColumnString(column, get_column_text(cinfo, column), &col_cost);
+        cost += col_cost;
         *col_text << col_str;
         col_lines = static_cast<int>(col_str.count('\n'));
         if (col_lines > lines_) {
@@ -243,5 +416,19 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
         }
     }
 
-    col_text_cache_.insert(fdata_->num, col_text);
+    // QCache::insert() drops a row that costs more than the whole cache
+    // may hold; keep the last such row, so that its text can still be
+    // shown.
+    if (cost > col_text_cache_.maxCost()) {
+        col_text_cache_.remove(fdata_->num);
+        uncached_col_text_ = *col_text;
+        uncached_num_ = fdata_->num;
+        delete col_text;
+        return;
+    }
+    if (uncached_num_ == fdata_->num) {
+        uncached_col_text_.clear();
+        uncached_num_ = 0;
+    }
+    col_text_cache_.insert(fdata_->num, col_text, cost);
 }
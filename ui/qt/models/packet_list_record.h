@@ -19,8 +19,10 @@
 
 #include <QByteArray>
 #include <QCache>
+#include <QHash>
 #include <QList>
 #include <QVariant>
+#include <QVector>
 
 struct conversation;
 struct _GStringChunk;
@@ -44,12 +46,12 @@ public:
     int columnTextSize(const char *str);
 
     void invalidateColorized() { colorized_ = false; }
-    void invalidateRecord() { col_text_cache_.remove(fdata_->num); }
-    static void invalidateAllRecords() { col_text_cache_.clear(); }
-    /* In Qt 6, QCache maxCost is a qsizetype, but the QAbstractItemModel
-     * number of rows is still an int, so we're limited to INT_MAX anyway.
-     */
-    static void setMaxCache(int cost) { col_text_cache_.setMaxCost(cost); }
+    void invalidateRecord();
+    static void invalidateAllRecords();
+    // Limit the column text cache, including the shared values, to roughly
+    // this many bytes.
+    static void setMaxCache(qsizetype bytes);
+    static QString cacheStatistics();
     static void resetColumns(column_info *cinfo);
     static void resetColorization() { rows_color_ver_++; }
 
@@ -57,9 +59,29 @@ public:
     inline int lineCountChanged() { return line_count_changed_; }
 
 private:
-    /** The column text for some columns */
+    /** The column text for some columns; the cost of a row is its size in bytes */
     static QCache<uint32_t, QStringList> col_text_cache_;
 
+    /** The column text of the last row too big for col_text_cache_, e.g.
+     *  if the cache is very small, and its frame number (0 if none) */
+    static QStringList uncached_col_text_;
+    static uint32_t uncached_num_;
+
+    /** Column values which are shared between rows, keyed by their UTF-8 text.
+     *  Rows aren't charged for these; the pool is, up to max_string_pool_bytes_. */
+    static QHash<QByteArray, QString> string_pool_;
+    static qsizetype string_pool_bytes_;
+    static qsizetype max_string_pool_bytes_;
+    static int string_pool_sweep_delay_;
+
+    /** How often the values of a text column were found in the pool */
+    struct ColumnSharing {
+        bool shared;
+        int lookups;
+        int hits;
+    };
+    static QVector<ColumnSharing> column_sharing_;
+
     frame_data *fdata_;
     int lines_;
     bool line_count_changed_;
@@ -77,6 +99,9 @@ private:
 
     void dissect(capture_file *cap_file, bool dissect_columns, bool dissect_color = false);
     void cacheColumnStrings(column_info *cinfo);
+    QStringList *cachedColumnStrings();
+    static QString internColumnString(int column, const char *text, int *cost);
+    static bool sweepStringPool(qsizetype needed);
 };
 
 #endif // PACKET_LIST_RECORD_H
@@ -23,6 +23,11 @@
 #include "wtap-int.h"
 
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif /* HAVE_SYS_MMAN_H */
 
 #if defined(HAVE_ZLIB) && !defined(HAVE_ZLIBNG)
 #define USE_ZLIB_OR_ZLIBNG
@@ -44,14 +49,14 @@ typedef zng_stream zlib_stream;
 #include <zstd.h>
 #endif /* HAVE_ZSTD */
 
-#ifdef HAVE_LZ4
+/*
+ * lz4 files are read and written with the frame API; HAVE_LZ4FRAME_H is
+ * only defined if lz4 is new enough (1.7.3 or later) for our use of it.
+ */
+#ifdef HAVE_LZ4FRAME_H
 #include <lz4.h>
-
-#if LZ4_VERSION_NUMBER >= 10703
-#define USE_LZ4
 #include <lz4frame.h>
-#endif /* LZ4_VERSION_NUMBER >= 10703 */
-#endif /* HAVE_LZ4 */
+#endif /* HAVE_LZ4FRAME_H */
 
 /*
  * List of compression types supported.
@@ -60,17 +65,18 @@ static struct compression_type {
     wtap_compression_type  type;
     const char            *extension;
     const char            *description;
+    const char            *name;
 } compression_types[] = {
 #ifdef USE_ZLIB_OR_ZLIBNG
-    { WTAP_GZIP_COMPRESSED, "gz", "gzip compressed" },
+    { WTAP_GZIP_COMPRESSED, "gz", "gzip compressed", "gzip" },
 #endif /* USE_ZLIB_OR_ZLIBNG */
 #ifdef HAVE_ZSTD
-    { WTAP_ZSTD_COMPRESSED, "zst", "zstd compressed" },
+    { WTAP_ZSTD_COMPRESSED, "zst", "zstd compressed", "zstd" },
 #endif /* HAVE_ZSTD */
-#ifdef USE_LZ4
-    { WTAP_LZ4_COMPRESSED, "lz4", "lz4 compressed" },
-#endif /* USE_LZ4 */
-    { WTAP_UNCOMPRESSED, NULL, NULL }
+#ifdef HAVE_LZ4FRAME_H
+    { WTAP_LZ4_COMPRESSED, "lz4", "lz4 compressed", "lz4" },
+#endif /* HAVE_LZ4FRAME_H */
+    { WTAP_UNCOMPRESSED, NULL, NULL, NULL }
 };
 
 static wtap_compression_type file_get_compression_type(FILE_T stream);
@@ -117,6 +123,59 @@ wtap_get_all_compression_type_extensions_list(void)
 	return extensions;
 }
 
+/*
+ * Return whether we can write files with the specified type of
+ * compression.
+ */
+bool
+wtap_can_write_compression_type(wtap_compression_type compression_type)
+{
+	switch (compression_type) {
+
+	case WTAP_UNCOMPRESSED:
+#ifdef USE_ZLIB_OR_ZLIBNG
+	case WTAP_GZIP_COMPRESSED:
+#endif /* USE_ZLIB_OR_ZLIBNG */
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+#endif /* HAVE_ZSTD */
+#ifdef HAVE_LZ4FRAME_H
+	case WTAP_LZ4_COMPRESSED:
+#endif /* HAVE_LZ4FRAME_H */
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+wtap_compression_type
+wtap_name_to_compression_type(const char *name)
+{
+	for (struct compression_type *p = compression_types;
+	    p->type != WTAP_UNCOMPRESSED; p++) {
+		if (strcmp(name, p->name) == 0)
+			return p->type;
+	}
+	return WTAP_UNCOMPRESSED;
+}
+
+GSList *
+wtap_get_all_output_compression_type_names_list(void)
+{
+	GSList *names;
+
+	names = NULL;	/* empty list, to start with */
+
+	for (struct compression_type *p = compression_types;
+	    p->type != WTAP_UNCOMPRESSED; p++) {
+		if (wtap_can_write_compression_type(p->type))
+			names = g_slist_prepend(names, (void *)p->name);
+	}
+
+	return names;
+}
+
 /* #define GZBUFSIZE 8192 */
 #define GZBUFSIZE 4096
 
@@ -197,13 +256,23 @@ struct wtap_reader {
 #ifdef HAVE_ZSTD
     ZSTD_DCtx *zstd_dctx;
 #endif /* HAVE_ZSTD */
-#ifdef USE_LZ4
+#ifdef HAVE_LZ4FRAME_H
     LZ4F_dctx *lz4_dctx;
-#endif /* USE_LZ4 */
+#endif /* HAVE_LZ4FRAME_H */
 
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+
+#ifdef HAVE_SYS_MMAN_H
+    /* memory mapping of an uncompressed file */
+    uint8_t *map;               /* the mapping, or NULL if the file isn't mapped */
+    int64_t map_len;            /* length of the mapping */
+    int64_t map_size;           /* bytes of the mapping the file still has */
+    bool mapped;                /* true if out is a window into the mapping */
+    uint8_t *out_buf;           /* our own output buffer, while mapped */
+    bool random_access;         /* true if reads are expected to be random */
+#endif /* HAVE_SYS_MMAN_H */
 };
 
 /* Current read offset within a buffer. */
@@ -292,6 +361,39 @@ fill_in_buffer(FILE_T state)
     return 0;
 }
 
+/*
+ * Make sure at least n bytes of input are available at in.next, unless
+ * the end of the file comes first, moving the unread input to the start
+ * of the buffer if there isn't enough room after it.
+ */
+static int
+fill_in_buffer_min(FILE_T state, unsigned n)
+{
+    while (state->in.avail < n && !state->eof) {
+        if (state->in.next != state->in.buf) {
+            memmove(state->in.buf, state->in.next, state->in.avail);
+            state->in.next = state->in.buf;
+        }
+        if (fill_in_buffer(state) == -1)
+            return -1;
+    }
+    return 0;
+}
+
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4FRAME_H)
+/*
+ * Skippable frames, which can appear between the frames of both
+ * Zstandard and lz4 compressed files. Their magic numbers are
+ * 0x184D2A50 through 0x184D2A5F.
+ */
+static bool
+is_skippable_frame(const uint8_t *magic)
+{
+    return (magic[0] & 0xf0) == 0x50 && magic[1] == 0x2a &&
+           magic[2] == 0x4d && magic[3] == 0x18;
+}
+#endif /* HAVE_ZSTD || HAVE_LZ4FRAME_H */
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -356,7 +458,12 @@ fast_seek_header(FILE_T file, int64_t in_pos, int64_t out_pos,
         item = (struct fast_seek_point *)file->fast_seek->pdata[file->fast_seek->len - 1];
 
     if (!item || item->out < out_pos) {
-        struct fast_seek_point *val = g_new(struct fast_seek_point,1);
+        /*
+         * Only zlib seek points in the middle of a deflate stream need
+         * the compression-specific data; there can be a lot of these
+         * seek points (one per zstd or lz4 frame), so leave it out.
+         */
+        struct fast_seek_point *val = (struct fast_seek_point *)g_malloc(offsetof(struct fast_seek_point, data));
         val->in = in_pos;
         val->out = out_pos;
         val->compression = compression;
@@ -382,9 +489,150 @@ fast_seek_reset(
 #endif /* HAVE_ZLIB */
 }
 
+#ifdef HAVE_SYS_MMAN_H
+/*
+ * Memory-mapped uncompressed files.
+ *
+ * Once a regular file that isn't too small has been found not to be
+ * compressed, it's mapped into memory, and the output buffer becomes a
+ * window into the mapping rather than a buffer we read into; data is
+ * then copied straight from the page cache to our caller, and seeking
+ * within the file doesn't need any system calls.
+ *
+ * The mapping covers the file as it was when it was mapped. Past its
+ * end, as when reading a file that's still being written, we go back
+ * to reading the file, with the file descriptor positioned after the
+ * last byte we delivered from the mapping. The mapping isn't removed
+ * until the file is closed, so pointers returned by file_get_mapped()
+ * remain valid until then.
+ *
+ * Touching a page of the mapping past the end of the file raises SIGBUS,
+ * so before the window is moved, we check the size of the file again;
+ * if the file has been truncated, the part of the mapping it no longer
+ * covers isn't used, and reading it gets the short read that reading
+ * the file would. A file truncated while a window, or a pointer from
+ * file_get_mapped(), is being read can still raise SIGBUS.
+ */
+#define MMAP_MIN_SIZE   (1024 * 1024)
+
+/* Map the file, if it's worth doing so. */
+static void
+map_file(FILE_T state)
+{
+    ws_statb64 st;
+    void *map;
+
+    if (state->map != NULL || state->is_compressed)
+        return;
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return;
+    if (st.st_size < MMAP_MIN_SIZE || (uint64_t)st.st_size > SIZE_MAX)
+        return;
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, state->fd, 0);
+    if (map == MAP_FAILED)
+        return;     /* just read the file */
+#ifdef MADV_SEQUENTIAL
+    if (!state->random_access)
+        madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif /* MADV_SEQUENTIAL */
+    state->map = (uint8_t *)map;
+    state->map_len = st.st_size;
+    state->map_size = st.st_size;
+}
+
+/*
+ * Stop using the part of the mapping past the end of the file, if the
+ * file has been truncated since it was mapped.
+ */
+static void
+map_check_size(FILE_T state)
+{
+    ws_statb64 st;
+
+    if (ws_fstat64(state->fd, &st) == -1)
+        st.st_size = 0;
+    if (st.st_size < state->map_size)
+        state->map_size = st.st_size;
+}
+
+/*
+ * Make the output buffer a window into the mapping, starting at the
+ * current position. Returns false, leaving the output buffer as it was,
+ * if the position isn't within the part of the mapping the file still
+ * covers.
+ */
+static bool
+map_window(FILE_T state)
+{
+    int64_t offset = state->start + state->pos;
+    int64_t remaining;
+
+    map_check_size(state);
+    remaining = state->map_size - offset;
+    if (remaining < 0)
+        return false;
+
+    if (!state->mapped) {
+        state->out_buf = state->out.buf;
+        state->mapped = true;
+    }
+    state->out.buf = state->map + offset;
+    state->out.next = state->out.buf;
+    state->out.avail = remaining > MAX_READ_BUF_SIZE ? MAX_READ_BUF_SIZE : (unsigned)remaining;
+    return true;
+}
+
+/* Go back to reading the file, at the current position. */
+static bool
+map_leave(FILE_T state)
+{
+    int64_t offset = state->start + state->pos;
+
+    state->out.buf = state->out_buf;
+    buf_reset(&state->out);
+    state->mapped = false;
+    if (ws_lseek64(state->fd, offset, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+        return false;
+    }
+    state->raw_pos = offset;
+    state->eof = false;
+    return true;
+}
+
+/* Remove the mapping, discarding anything left in the window. */
+static void
+map_release(FILE_T state)
+{
+    if (state->mapped) {
+        state->out.buf = state->out_buf;
+        buf_reset(&state->out);
+        state->mapped = false;
+    }
+    if (state->map != NULL) {
+        munmap(state->map, (size_t)state->map_len);
+        state->map = NULL;
+    }
+}
+#endif /* HAVE_SYS_MMAN_H */
+
 static bool
 uncompressed_fill_out_buffer(FILE_T state)
 {
+#ifdef HAVE_SYS_MMAN_H
+    if (state->mapped) {
+        /*
+         * We've used up the window; move it along or, if we're at
+         * the end of the mapping, go back to reading the file.
+         */
+        if (state->start + state->pos < state->map_size &&
+            map_window(state))
+            return true;
+        if (!map_leave(state))
+            return false;
+    }
+#endif /* HAVE_SYS_MMAN_H */
     if (buf_read(state, &state->out) < 0)
         return false;
     return true;
@@ -888,6 +1136,18 @@ check_for_zlib_compression(FILE_T state)
  * https://github.com/facebook/zstd/blob/dev/doc/zstd_compression_format.md
  */
 #ifdef HAVE_ZSTD
+static bool
+zstd_reset(FILE_T state)
+{
+    const size_t ret = ZSTD_initDStream(state->zstd_dctx);
+    if (ZSTD_isError(ret)) {
+        state->err = WTAP_ERR_DECOMPRESS;
+        state->err_info = ZSTD_getErrorName(ret);
+        return false;
+    }
+    return true;
+}
+
 static bool
 zstd_fill_out_buffer(FILE_T state)
 {
@@ -917,6 +1177,98 @@ zstd_fill_out_buffer(FILE_T state)
     }
     return true;
 }
+
+/*
+ * Zstandard seekable format.
+ *
+ * https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ *
+ * The file ends with a skippable frame holding the compressed and
+ * decompressed sizes of all the frames, so we can add a seek point
+ * for every frame up front rather than as we read them.
+ */
+#define ZSTD_SEEK_TABLE_MAGIC       0x184D2A5E
+#define ZSTD_SEEKABLE_MAGIC         0x8F92EAB1
+#define ZSTD_SKIPPABLE_HEADER_SIZE  8
+#define ZSTD_SEEK_TABLE_FOOTER_SIZE 9
+#define ZSTD_SEEK_ENTRIES_PER_READ  1024
+
+static bool
+read_at(int fd, int64_t offset, void *buf, unsigned len)
+{
+    if (ws_lseek64(fd, offset, SEEK_SET) == -1)
+        return false;
+    return ws_read(fd, buf, len) == (ssize_t)len;
+}
+
+static void
+zstd_read_seek_table(FILE_T state)
+{
+    uint8_t footer[ZSTD_SEEK_TABLE_FOOTER_SIZE];
+    uint8_t header[ZSTD_SKIPPABLE_HEADER_SIZE];
+    uint8_t *entries = NULL;
+    int64_t file_size, table_size, table_start;
+    int64_t in_pos, out_pos;
+    uint32_t num_frames, frame;
+    unsigned entry_size, first_point;
+
+    file_size = ws_lseek64(state->fd, 0, SEEK_END);
+    if (file_size == -1 ||
+        file_size - state->start < ZSTD_SKIPPABLE_HEADER_SIZE + ZSTD_SEEK_TABLE_FOOTER_SIZE)
+        goto done;
+
+    if (!read_at(state->fd, file_size - ZSTD_SEEK_TABLE_FOOTER_SIZE, footer, sizeof footer))
+        goto done;
+    if (pletoh32(&footer[5]) != ZSTD_SEEKABLE_MAGIC)
+        goto done;
+    if (footer[4] & 0x7c)   /* reserved bits */
+        goto done;
+    num_frames = pletoh32(&footer[0]);
+    entry_size = (footer[4] & 0x80) ? 12 : 8; /* with or without checksums */
+
+    table_size = ZSTD_SKIPPABLE_HEADER_SIZE + (int64_t)num_frames * entry_size + ZSTD_SEEK_TABLE_FOOTER_SIZE;
+    if (table_size > file_size - state->start)
+        goto done;
+    table_start = file_size - table_size;
+    if (!read_at(state->fd, table_start, header, sizeof header))
+        goto done;
+    if (pletoh32(&header[0]) != ZSTD_SEEK_TABLE_MAGIC ||
+        pletoh32(&header[4]) != table_size - ZSTD_SKIPPABLE_HEADER_SIZE)
+        goto done;
+
+    entries = (uint8_t *)g_malloc(ZSTD_SEEK_ENTRIES_PER_READ * entry_size);
+    first_point = state->fast_seek->len;
+    in_pos = state->start;
+    out_pos = 0;
+    for (frame = 0; frame < num_frames; ) {
+        unsigned count = MIN(num_frames - frame, ZSTD_SEEK_ENTRIES_PER_READ);
+
+        if (!read_at(state->fd, table_start + ZSTD_SKIPPABLE_HEADER_SIZE + (int64_t)frame * entry_size,
+                     entries, count * entry_size))
+            break;
+        for (unsigned i = 0; i < count; i++) {
+            fast_seek_header(state, in_pos, out_pos, ZSTD);
+            in_pos += pletoh32(&entries[i * entry_size]);
+            out_pos += pletoh32(&entries[i * entry_size + 4]);
+        }
+        frame += count;
+    }
+
+    /*
+     * If the frames don't add up to the data before the seek table,
+     * the table doesn't describe this file; don't use it.
+     */
+    if (frame != num_frames || in_pos != table_start) {
+        for (unsigned i = first_point; i < state->fast_seek->len; i++)
+            g_free(state->fast_seek->pdata[i]);
+        g_ptr_array_set_size(state->fast_seek, first_point);
+    }
+
+done:
+    g_free(entries);
+    /* Go back to where we were reading. */
+    ws_lseek64(state->fd, state->raw_pos, SEEK_SET);
+}
 #endif /* HAVE_ZSTD */
 
 /*
@@ -925,23 +1277,39 @@ zstd_fill_out_buffer(FILE_T state)
 static int
 check_for_zstd_compression(FILE_T state)
 {
+    if (fill_in_buffer_min(state, 4) == -1)
+        return -1;
+
+#ifdef HAVE_ZSTD
+    /*
+     * A skippable frame after a Zstandard frame, such as the seek table
+     * of the seekable format, is skipped by the Zstandard decompressor.
+     */
+    if (state->in.avail >= 4 && state->last_compression == ZSTD &&
+        is_skippable_frame(state->in.next)) {
+        if (!zstd_reset(state))
+            return -1;
+        state->compression = ZSTD;
+        return 1;
+    }
+#endif /* HAVE_ZSTD */
+
     /*
      * Look for the Zstandard header, and, if we find it, return
      * success if we support Zstandard and an error if we don't.
      */
     if (state->in.avail >= 4
-        && state->in.buf[0] == 0x28 && state->in.buf[1] == 0xb5
-        && state->in.buf[2] == 0x2f && state->in.buf[3] == 0xfd) {
+        && state->in.next[0] == 0x28 && state->in.next[1] == 0xb5
+        && state->in.next[2] == 0x2f && state->in.next[3] == 0xfd) {
 #ifdef HAVE_ZSTD
-        const size_t ret = ZSTD_initDStream(state->zstd_dctx);
-        if (ZSTD_isError(ret)) {
-            state->err = WTAP_ERR_DECOMPRESS;
-            state->err_info = ZSTD_getErrorName(ret);
+        if (!zstd_reset(state))
             return -1;
-        }
 
         state->compression = ZSTD;
         state->is_compressed = true;
+        /* Every frame can be decompressed independently. */
+        if (state->fast_seek)
+            fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, ZSTD);
         return 1;
 #else /* HAVE_ZSTD */
         state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
@@ -957,7 +1325,24 @@ check_for_zstd_compression(FILE_T state)
  *
  * https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
  */
-#ifdef USE_LZ4
+#ifdef HAVE_LZ4FRAME_H
+static bool
+lz4_reset(FILE_T state)
+{
+#if LZ4_VERSION_NUMBER >= 10800
+    LZ4F_resetDecompressionContext(state->lz4_dctx);
+#else /* LZ4_VERSION_NUMBER >= 10800 */
+    LZ4F_freeDecompressionContext(state->lz4_dctx);
+    const LZ4F_errorCode_t ret = LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION);
+    if (LZ4F_isError(ret)) {
+        state->err = WTAP_ERR_INTERNAL;
+        state->err_info = LZ4F_getErrorName(ret);
+        return false;
+    }
+#endif /* LZ4_VERSION_NUMBER >= 10800 */
+    return true;
+}
+
 static bool
 lz4_fill_out_buffer(FILE_T state)
 {
@@ -991,7 +1376,7 @@ lz4_fill_out_buffer(FILE_T state)
     }
     return true;
 }
-#endif /* USE_LZ4 */
+#endif /* HAVE_LZ4FRAME_H */
 
 /*
  * Check for an lz4 header.
@@ -999,33 +1384,41 @@ lz4_fill_out_buffer(FILE_T state)
 static int
 check_for_lz4_compression(FILE_T state)
 {
+    if (fill_in_buffer_min(state, 4) == -1)
+        return -1;
+
+#ifdef HAVE_LZ4FRAME_H
+    /* A skippable frame after an lz4 frame is skipped by the decompressor. */
+    if (state->in.avail >= 4 && state->last_compression == LZ4 &&
+        is_skippable_frame(state->in.next)) {
+        if (!lz4_reset(state))
+            return -1;
+        state->compression = LZ4;
+        return 1;
+    }
+#endif /* HAVE_LZ4FRAME_H */
+
     /*
      * Look for the lz4 header, and, if we find it, return success
      * if we support lz4 and an error if we don't.
      */
     if (state->in.avail >= 4
-        && state->in.buf[0] == 0x04 && state->in.buf[1] == 0x22
-        && state->in.buf[2] == 0x4d && state->in.buf[3] == 0x18) {
-#ifdef USE_LZ4
-#if LZ4_VERSION_NUMBER >= 10800
-        LZ4F_resetDecompressionContext(state->lz4_dctx);
-#else /* LZ4_VERSION_NUMBER >= 10800 */
-        LZ4F_freeDecompressionContext(state->lz4_dctx);
-        const LZ4F_errorCode_t ret = LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION);
-        if (LZ4F_isError(ret)) {
-            state->err = WTAP_ERR_INTERNAL;
-            state->err_info = LZ4F_getErrorName(ret);
+        && state->in.next[0] == 0x04 && state->in.next[1] == 0x22
+        && state->in.next[2] == 0x4d && state->in.next[3] == 0x18) {
+#ifdef HAVE_LZ4FRAME_H
+        if (!lz4_reset(state))
             return -1;
-        }
-#endif /* LZ4_VERSION_NUMBER >= 10800 */
         state->compression = LZ4;
         state->is_compressed = true;
+        /* Every frame can be decompressed independently. */
+        if (state->fast_seek)
+            fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, LZ4);
         return 1;
-#else /* USE_LZ4 */
+#else /* HAVE_LZ4FRAME_H */
         state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
         state->err_info = "reading lz4-compressed files isn't supported";
         return -1;
-#endif /* USE_LZ4 */
+#endif /* HAVE_LZ4FRAME_H */
     }
     return 0;
 }
@@ -1116,6 +1509,13 @@ check_for_compression(FILE_T state)
         buf_reset(&state->in);
     }
     state->compression = UNCOMPRESSED;
+#ifdef HAVE_SYS_MMAN_H
+    /* Deliver the data, including what we've already read, from the
+       mapping instead, if we can map the file. */
+    map_file(state);
+    if (state->map != NULL && !map_window(state))
+        map_release(state);
+#endif /* HAVE_SYS_MMAN_H */
     return 0;
 }
 
@@ -1164,13 +1564,13 @@ fill_out_buffer(FILE_T state)
         break;
 #endif /* HAVE_ZSTD */
 
-#ifdef USE_LZ4
+#ifdef HAVE_LZ4FRAME_H
     case LZ4:
         /* lz4 decompress */
         if (!lz4_fill_out_buffer(state))
             return -1;
         break;
-#endif /* USE_LZ4 */
+#endif /* HAVE_LZ4FRAME_H */
 
     default:
         /* Unknown compression type; keep reading */
@@ -1258,9 +1658,9 @@ file_fdopen(int fd)
 #endif /* HAVE_ZSTD */
     unsigned want = GZBUFSIZE;
     FILE_T state;
-#ifdef USE_LZ4
+#ifdef HAVE_LZ4FRAME_H
     size_t ret;
-#endif /* USE_LZ4 */
+#endif /* HAVE_LZ4FRAME_H */
 
     if (fd == -1)
         return NULL;
@@ -1378,12 +1778,12 @@ file_fdopen(int fd)
     }
 #endif /* HAVE_ZSTD */
 
-#ifdef USE_LZ4
+#ifdef HAVE_LZ4FRAME_H
     ret = LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION);
     if (LZ4F_isError(ret)) {
         goto err;
     }
-#endif /* USE_LZ4 */
+#endif /* HAVE_LZ4FRAME_H */
 
     /* return stream */
     return state;
@@ -1395,9 +1795,9 @@ err:
 #ifdef HAVE_ZSTD
     ZSTD_freeDCtx(state->zstd_dctx);
 #endif /* HAVE_ZSTD */
-#ifdef USE_LZ4
+#ifdef HAVE_LZ4FRAME_H
     LZ4F_freeDecompressionContext(state->lz4_dctx);
-#endif /* USE_LZ4 */
+#endif /* HAVE_LZ4FRAME_H */
     g_free(state->out.buf);
     g_free(state->in.buf);
     g_free(state);
@@ -1461,6 +1861,22 @@ void
 file_set_random_access(FILE_T stream, bool random_flag _U_, GPtrArray *seek)
 {
     stream->fast_seek = seek;
+#ifdef HAVE_SYS_MMAN_H
+    stream->random_access = random_flag;
+#ifdef MADV_NORMAL
+    if (random_flag && stream->map != NULL)
+        madvise(stream->map, (size_t)stream->map_len, MADV_NORMAL);
+#endif /* MADV_NORMAL */
+#endif /* HAVE_SYS_MMAN_H */
+#ifdef HAVE_ZSTD
+    /*
+     * The sequential stream is set up first, after the file has been
+     * identified, so it already knows whether it's Zstandard compressed.
+     */
+    if (seek != NULL && seek->len == 0 &&
+        (stream->compression == ZSTD || stream->last_compression == ZSTD))
+        zstd_read_seek_table(stream);
+#endif /* HAVE_ZSTD */
 }
 
 int64_t
@@ -1567,16 +1983,49 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
         }
     }
 
+#ifdef HAVE_SYS_MMAN_H
+    /*
+     * We're not seeking within the buffer.  Is this a mapped file,
+     * and are we seeking to somewhere in the mapping?
+     */
+    if (file->map != NULL && file->compression == UNCOMPRESSED &&
+        file->pos + offset >= 0 &&
+        file->start + file->pos + offset <= file->map_size) {
+        /*
+         * Yes.  Just move the window there, unless the file has been
+         * truncated since.
+         */
+        file->pos += offset;
+        if (map_window(file)) {
+            file->eof = false;
+            file->err = 0;
+            file->err_info = NULL;
+            return file->pos;
+        }
+        file->pos -= offset;
+    }
+
+    /*
+     * No.  If we're reading from the mapping, go back to reading
+     * the file, so that we can seek in it.
+     */
+    if (file->mapped && !map_leave(file)) {
+        *err = file->err;
+        return -1;
+    }
+#endif /* HAVE_SYS_MMAN_H */
+
     /*
      * We're not seeking within the buffer.  Do we have "fast seek" data
      * for the location to which we will be seeking, and is the offset
-     * outside the span for compressed files or is this an uncompressed
-     * file?
+     * outside the span, and the seek point past where we are, for
+     * compressed files or is this an uncompressed file?
      *
      * XXX, profile
      */
     if ((here = fast_seek_find(file, file->pos + offset)) &&
-        (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED)) {
+        (offset < 0 || (offset > SPAN && here->out > file->pos) ||
+         here->compression == UNCOMPRESSED)) {
         int64_t off, off2;
 
         /*
@@ -1598,7 +2047,11 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
             off2 = here->out;
         } else
 #endif /* USE_ZLIB_OR_ZLIBNG */
-        {
+        if (here->compression == ZSTD || here->compression == LZ4) {
+            /* Start of a frame. */
+            off = here->in;
+            off2 = here->out;
+        } else {
             off2 = (file->pos + offset);
             off = here->in + (off2 - here->out);
         }
@@ -1648,6 +2101,24 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
             file->compression = ZLIB;
         } else
 #endif /* USE_ZLIB_OR_ZLIBNG */
+#ifdef HAVE_ZSTD
+        if (here->compression == ZSTD) {
+            if (!zstd_reset(file)) {
+                *err = file->err;
+                return -1;
+            }
+            file->compression = ZSTD;
+        } else
+#endif /* HAVE_ZSTD */
+#ifdef HAVE_LZ4FRAME_H
+        if (here->compression == LZ4) {
+            if (!lz4_reset(file)) {
+                *err = file->err;
+                return -1;
+            }
+            file->compression = LZ4;
+        } else
+#endif /* HAVE_LZ4FRAME_H */
             file->compression = here->compression;
 
         offset = (file->pos + offset) - off2;
@@ -1757,6 +2228,11 @@ file_tell(FILE_T stream)
 int64_t
 file_tell_raw(FILE_T stream)
 {
+#ifdef HAVE_SYS_MMAN_H
+    /* We haven't read the file, but we've gotten this far into it. */
+    if (stream->mapped)
+        return stream->start + stream->pos;
+#endif /* HAVE_SYS_MMAN_H */
     return stream->raw_pos;
 }
 
@@ -1870,6 +2346,45 @@ file_read(void *buf, unsigned int len, FILE_T file)
     return (int)got;
 }
 
+/*
+ * If the next len bytes of the file are in its memory mapping, return
+ * a pointer to them, which remains valid until the file is closed, and
+ * move past them; otherwise, return NULL, and read them with file_read().
+ */
+const uint8_t *
+file_get_mapped(FILE_T file, unsigned len)
+{
+#ifdef HAVE_SYS_MMAN_H
+    const uint8_t *ptr;
+
+    /* process a skip request */
+    if (file->seek_pending) {
+        file->seek_pending = false;
+        if (gz_skip(file, file->skip) == -1)
+            return NULL;
+    }
+
+    if (!file->mapped || file->err != 0)
+        return NULL;
+    if (file->out.avail < len) {
+        /* Is it in the mapping, past the end of the window? */
+        if (file->start + file->pos + len > file->map_size)
+            return NULL;
+        if (!map_window(file) || file->out.avail < len)
+            return NULL;
+    }
+    ptr = file->out.next;
+    file->out.next += len;
+    file->out.avail -= len;
+    file->pos += len;
+    return ptr;
+#else /* HAVE_SYS_MMAN_H */
+    (void)file;
+    (void)len;
+    return NULL;
+#endif /* HAVE_SYS_MMAN_H */
+}
+
 /*
  * XXX - this *peeks* at next byte, not a character.
  */
@@ -2052,6 +2567,10 @@ file_clearerr(FILE_T stream)
 void
 file_fdclose(FILE_T file)
 {
+#ifdef HAVE_SYS_MMAN_H
+    /* The file may be replaced before it's reopened. */
+    map_release(file);
+#endif /* HAVE_SYS_MMAN_H */
     if (file->fd != -1)
         ws_close(file->fd);
     file->fd = -1;
@@ -2073,6 +2592,10 @@ file_close(FILE_T file)
 {
     int fd = file->fd;
 
+#ifdef HAVE_SYS_MMAN_H
+    map_release(file);
+#endif /* HAVE_SYS_MMAN_H */
+
     /* free memory and close file */
     if (file->size) {
 #ifdef USE_ZLIB_OR_ZLIBNG
@@ -2081,9 +2604,9 @@ file_close(FILE_T file)
 #ifdef HAVE_ZSTD
         ZSTD_freeDCtx(file->zstd_dctx);
 #endif /* HAVE_ZSTD */
-#ifdef USE_LZ4
+#ifdef HAVE_LZ4FRAME_H
         LZ4F_freeDecompressionContext(file->lz4_dctx);
-#endif /* USE_LZ4 */
+#endif /* HAVE_LZ4FRAME_H */
         g_free(file->out.buf);
         g_free(file->in.buf);
     }
@@ -2400,6 +2923,476 @@ gzwfile_geterr(GZWFILE_T state)
 }
 #endif /* USE_ZLIB_OR_ZLIBNG */
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4FRAME_H)
+/*
+ * The zstd and lz4 writers end the current frame once it holds this
+ * much uncompressed data, and start a new one with the next write.
+ * Every frame can be decompressed on its own, so the reader can seek
+ * to the start of any of them rather than decompressing the whole file.
+ */
+#define WFILE_FRAME_SIZE    (1024 * 1024)
+
+/* Write out len bytes from buf to fd.  Return -1, and set *err, on
+   failure; return 0 on success. */
+static int
+wfile_write_out(int fd, const void *buf, size_t len, int *err)
+{
+    ssize_t got;
+
+    got = ws_write(fd, buf, (unsigned int)len);
+    if (got < 0) {
+        *err = errno;
+        return -1;
+    }
+    if ((size_t)got != len) {
+        *err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
+    return 0;
+}
+#endif /* HAVE_ZSTD || HAVE_LZ4FRAME_H */
+
+#ifdef HAVE_ZSTD
+#ifndef ZSTD_CLEVEL_DEFAULT
+#define ZSTD_CLEVEL_DEFAULT 3
+#endif
+
+/* internal zstd file state data structure for writing */
+struct zstd_writer {
+    int fd;                 /* file descriptor */
+    int64_t pos;            /* current position in uncompressed data */
+    ZSTD_CStream *cstream;  /* compression stream */
+    unsigned char *out;     /* output buffer */
+    size_t size;            /* output buffer size */
+    uint32_t frame_in;      /* uncompressed bytes in the current frame */
+    uint32_t frame_out;     /* compressed bytes in the current frame */
+    uint32_t num_frames;    /* number of frames written */
+    GByteArray *seek_table; /* seek table entries for the frames written */
+    int err;                /* error code */
+    const char *err_info;   /* additional error information string for some errors */
+};
+
+ZSTDWFILE_T
+zstdwfile_open(const char *path)
+{
+    int fd;
+    ZSTDWFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = zstdwfile_fdopen(fd);
+    if (state == NULL) {
+        save_errno = errno;
+        ws_close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+ZSTDWFILE_T
+zstdwfile_fdopen(int fd)
+{
+    ZSTDWFILE_T state;
+
+    /* allocate zstd_writer structure to return */
+    state = (ZSTDWFILE_T)g_try_malloc0(sizeof *state);
+    if (state == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    state->fd = fd;
+    state->size = ZSTD_CStreamOutSize();
+    state->out = (unsigned char *)g_try_malloc(state->size);
+    state->cstream = ZSTD_createCStream();
+    if (state->out == NULL || state->cstream == NULL ||
+        ZSTD_isError(ZSTD_initCStream(state->cstream, ZSTD_CLEVEL_DEFAULT))) {
+        ZSTD_freeCStream(state->cstream);
+        g_free(state->out);
+        g_free(state);
+        errno = ENOMEM;
+        return NULL;
+    }
+    state->seek_table = g_byte_array_new();
+
+    /* return stream */
+    return state;
+}
+
+/* Write out the pos bytes that the compressor put into the output
+   buffer.  Return -1, and set state->err, on failure; return 0 on
+   success. */
+static int
+zstd_write_out(ZSTDWFILE_T state, size_t pos)
+{
+    if (pos == 0)
+        return 0;
+    if (wfile_write_out(state->fd, state->out, pos, &state->err) == -1)
+        return -1;
+    state->frame_out += (uint32_t)pos;
+    return 0;
+}
+
+/* Set state->err and state->err_info from a zstd error code. */
+static int
+zstd_set_error(ZSTDWFILE_T state, size_t ret)
+{
+    state->err = WTAP_ERR_INTERNAL;
+    state->err_info = ZSTD_getErrorName(ret);
+    return -1;
+}
+
+/* Compress len bytes from buf and write whatever the compressor produces
+   to the output file.  Return -1, and set state->err and possibly
+   state->err_info, on failure; return 0 on success. */
+static int
+zstd_comp(ZSTDWFILE_T state, const void *buf, size_t len)
+{
+    ZSTD_inBuffer input = { buf, len, 0 };
+    ZSTD_outBuffer output;
+    size_t ret;
+
+    while (input.pos < input.size) {
+        output.dst = state->out;
+        output.size = state->size;
+        output.pos = 0;
+        ret = ZSTD_compressStream(state->cstream, &output, &input);
+        if (ZSTD_isError(ret))
+            return zstd_set_error(state, ret);
+        if (zstd_write_out(state, output.pos) == -1)
+            return -1;
+    }
+    state->frame_in += (uint32_t)len;
+    return 0;
+}
+
+/* Write out everything the compressor has buffered and, if end is true,
+   end the current frame; the next write starts a new one.  Return -1,
+   and set state->err and possibly state->err_info, on failure; return
+   0 on success. */
+static int
+zstd_flush(ZSTDWFILE_T state, bool end)
+{
+    ZSTD_outBuffer output;
+    size_t ret;
+    uint32_t entry[2];
+
+    do {
+        output.dst = state->out;
+        output.size = state->size;
+        output.pos = 0;
+        if (end)
+            ret = ZSTD_endStream(state->cstream, &output);
+        else
+            ret = ZSTD_flushStream(state->cstream, &output);
+        if (ZSTD_isError(ret))
+            return zstd_set_error(state, ret);
+        if (zstd_write_out(state, output.pos) == -1)
+            return -1;
+    } while (ret != 0);
+
+    if (end) {
+        /* Remember the frame for the seek table. */
+        entry[0] = GUINT32_TO_LE(state->frame_out);
+        entry[1] = GUINT32_TO_LE(state->frame_in);
+        g_byte_array_append(state->seek_table, (const uint8_t *)entry, sizeof entry);
+        state->num_frames++;
+        state->frame_in = 0;
+        state->frame_out = 0;
+
+        ret = ZSTD_initCStream(state->cstream, ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(ret))
+            return zstd_set_error(state, ret);
+    }
+    return 0;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+unsigned
+zstdwfile_write(ZSTDWFILE_T state, const void *buf, unsigned len)
+{
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    /* if the current frame is big enough, end it so that this data
+       starts a new one */
+    if (state->frame_in >= WFILE_FRAME_SIZE && zstd_flush(state, true) == -1)
+        return 0;
+
+    if (zstd_comp(state, buf, len) == -1)
+        return 0;
+    state->pos += len;
+    return len;
+}
+
+/* Flush out what we've written so far.  Returns -1, and sets state->err,
+   on failure; returns 0 on success. */
+int
+zstdwfile_flush(ZSTDWFILE_T state)
+{
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    /* write out what's buffered, but don't end the frame */
+    if (zstd_flush(state, false) == -1)
+        return -1;
+    return 0;
+}
+
+/* Write the seek table of the Zstandard seekable format, so that the
+   reader can find all the frames without reading through the file. */
+static int
+zstd_write_seek_table(ZSTDWFILE_T state)
+{
+    uint8_t header[ZSTD_SKIPPABLE_HEADER_SIZE];
+    uint8_t footer[ZSTD_SEEK_TABLE_FOOTER_SIZE];
+
+    phtole32(&header[0], ZSTD_SEEK_TABLE_MAGIC);
+    phtole32(&header[4], state->seek_table->len + ZSTD_SEEK_TABLE_FOOTER_SIZE);
+    phtole32(&footer[0], state->num_frames);
+    footer[4] = 0;          /* no checksums */
+    phtole32(&footer[5], ZSTD_SEEKABLE_MAGIC);
+
+    if (wfile_write_out(state->fd, header, sizeof header, &state->err) == -1 ||
+        wfile_write_out(state->fd, state->seek_table->data, state->seek_table->len, &state->err) == -1 ||
+        wfile_write_out(state->fd, footer, sizeof footer, &state->err) == -1)
+        return -1;
+    return 0;
+}
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success. */
+int
+zstdwfile_close(ZSTDWFILE_T state)
+{
+    int ret = 0;
+
+    /* end the last frame, write the seek table, free memory, and close file */
+    if (state->err != 0)
+        ret = state->err;
+    else if (state->frame_in != 0 && zstd_flush(state, true) == -1)
+        ret = state->err;
+    else if (state->num_frames != 0 && zstd_write_seek_table(state) == -1)
+        ret = state->err;
+    ZSTD_freeCStream(state->cstream);
+    g_byte_array_free(state->seek_table, true);
+    g_free(state->out);
+    if (ws_close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+zstdwfile_geterr(ZSTDWFILE_T state)
+{
+    return state->err;
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+#ifndef LZ4F_HEADER_SIZE_MAX
+#define LZ4F_HEADER_SIZE_MAX    19
+#endif
+
+/* Largest chunk of data handed to LZ4F_compressUpdate() at once; the
+   output buffer is big enough for the compressed form of one chunk. */
+#define LZ4_WRITE_CHUNK_SIZE    (64 * 1024)
+
+/* internal lz4 file state data structure for writing */
+struct lz4_writer {
+    int fd;                 /* file descriptor */
+    int64_t pos;            /* current position in uncompressed data */
+    LZ4F_compressionContext_t cctx; /* compression context */
+    LZ4F_preferences_t prefs; /* frame parameters */
+    unsigned char *out;     /* output buffer */
+    size_t size;            /* output buffer size */
+    bool in_frame;          /* true if a frame has been started */
+    uint32_t frame_in;      /* uncompressed bytes in the current frame */
+    int err;                /* error code */
+    const char *err_info;   /* additional error information string for some errors */
+};
+
+LZ4WFILE_T
+lz4wfile_open(const char *path)
+{
+    int fd;
+    LZ4WFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = lz4wfile_fdopen(fd);
+    if (state == NULL) {
+        save_errno = errno;
+        ws_close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+LZ4WFILE_T
+lz4wfile_fdopen(int fd)
+{
+    LZ4WFILE_T state;
+    LZ4F_errorCode_t ret;
+
+    /* allocate lz4_writer structure to return */
+    state = (LZ4WFILE_T)g_try_malloc0(sizeof *state);
+    if (state == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    state->fd = fd;
+
+    /* default frame parameters, with independent blocks */
+    state->prefs.frameInfo.blockMode = LZ4F_blockIndependent;
+
+    state->size = LZ4F_compressBound(LZ4_WRITE_CHUNK_SIZE, &state->prefs);
+    if (state->size < LZ4F_HEADER_SIZE_MAX)
+        state->size = LZ4F_HEADER_SIZE_MAX;
+    state->out = (unsigned char *)g_try_malloc(state->size);
+    ret = LZ4F_createCompressionContext(&state->cctx, LZ4F_VERSION);
+    if (state->out == NULL || LZ4F_isError(ret)) {
+        LZ4F_freeCompressionContext(state->cctx);
+        g_free(state->out);
+        g_free(state);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* return stream */
+    return state;
+}
+
+/* Handle the result of an LZ4F_ compression call that put ret bytes
+   into the output buffer, writing them to the output file.  Return -1,
+   and set state->err and possibly state->err_info, on failure; return
+   0 on success. */
+static int
+lz4_write_out(LZ4WFILE_T state, size_t ret)
+{
+    if (LZ4F_isError(ret)) {
+        state->err = WTAP_ERR_INTERNAL;
+        state->err_info = LZ4F_getErrorName(ret);
+        return -1;
+    }
+    if (ret != 0 && wfile_write_out(state->fd, state->out, ret, &state->err) == -1)
+        return -1;
+    return 0;
+}
+
+/* End the current frame, if any.  Return -1, and set state->err and
+   possibly state->err_info, on failure; return 0 on success. */
+static int
+lz4_end_frame(LZ4WFILE_T state)
+{
+    if (!state->in_frame)
+        return 0;
+    state->in_frame = false;
+    state->frame_in = 0;
+    return lz4_write_out(state,
+                         LZ4F_compressEnd(state->cctx, state->out, state->size, NULL));
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+unsigned
+lz4wfile_write(LZ4WFILE_T state, const void *buf, unsigned len)
+{
+    const uint8_t *next = (const uint8_t *)buf;
+    unsigned left = len;
+    size_t n;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    /* if the current frame is big enough, end it so that this data
+       starts a new one */
+    if (state->frame_in >= WFILE_FRAME_SIZE && lz4_end_frame(state) == -1)
+        return 0;
+
+    if (!state->in_frame) {
+        if (lz4_write_out(state,
+                          LZ4F_compressBegin(state->cctx, state->out, state->size, &state->prefs)) == -1)
+            return 0;
+        state->in_frame = true;
+    }
+
+    /* compress the data a chunk at a time, so that the output always
+       fits in the output buffer */
+    while (left != 0) {
+        n = MIN(left, LZ4_WRITE_CHUNK_SIZE);
+        if (lz4_write_out(state,
+                          LZ4F_compressUpdate(state->cctx, state->out, state->size, next, n, NULL)) == -1)
+            return 0;
+        next += n;
+        left -= (unsigned)n;
+    }
+    state->frame_in += len;
+    state->pos += len;
+    return len;
+}
+
+/* Flush out what we've written so far.  Returns -1, and sets state->err,
+   on failure; returns 0 on success. */
+int
+lz4wfile_flush(LZ4WFILE_T state)
+{
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    /* write out what's buffered, but don't end the frame */
+    if (state->in_frame &&
+        lz4_write_out(state, LZ4F_flush(state->cctx, state->out, state->size, NULL)) == -1)
+        return -1;
+    return 0;
+}
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success. */
+int
+lz4wfile_close(LZ4WFILE_T state)
+{
+    int ret = 0;
+
+    /* end the last frame, free memory, and close file */
+    if (state->err != 0)
+        ret = state->err;
+    else if (lz4_end_frame(state) == -1)
+        ret = state->err;
+    LZ4F_freeCompressionContext(state->cctx);
+    g_free(state->out);
+    if (ws_close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+lz4wfile_geterr(LZ4WFILE_T state)
+{
+    return state->err;
+}
+#endif /* HAVE_LZ4FRAME_H */
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
@@ -22,6 +22,7 @@ extern int64_t file_tell_raw(FILE_T stream);
 extern int file_fstat(FILE_T stream, ws_statb64 *statb, int *err);
 WS_DLL_PUBLIC bool file_iscompressed(FILE_T stream);
 WS_DLL_PUBLIC int file_read(void *buf, unsigned int count, FILE_T file);
+extern const uint8_t *file_get_mapped(FILE_T file, unsigned len);
 WS_DLL_PUBLIC int file_peekc(FILE_T stream);
 WS_DLL_PUBLIC int file_getc(FILE_T stream);
 WS_DLL_PUBLIC char *file_gets(char *buf, int len, FILE_T stream);
@@ -44,4 +45,26 @@ extern int gzwfile_close(GZWFILE_T state);
 extern int gzwfile_geterr(GZWFILE_T state);
 #endif /* HAVE_ZLIB */
 
+#ifdef HAVE_ZSTD
+typedef struct zstd_writer *ZSTDWFILE_T;
+
+extern ZSTDWFILE_T zstdwfile_open(const char *path);
+extern ZSTDWFILE_T zstdwfile_fdopen(int fd);
+extern unsigned zstdwfile_write(ZSTDWFILE_T state, const void *buf, unsigned len);
+extern int zstdwfile_flush(ZSTDWFILE_T state);
+extern int zstdwfile_close(ZSTDWFILE_T state);
+extern int zstdwfile_geterr(ZSTDWFILE_T state);
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+typedef struct lz4_writer *LZ4WFILE_T;
+
+extern LZ4WFILE_T lz4wfile_open(const char *path);
+extern LZ4WFILE_T lz4wfile_fdopen(int fd);
+extern unsigned lz4wfile_write(LZ4WFILE_T state, const void *buf, unsigned len);
+extern int lz4wfile_flush(LZ4WFILE_T state);
+extern int lz4wfile_close(LZ4WFILE_T state);
+extern int lz4wfile_geterr(LZ4WFILE_T state);
+#endif /* HAVE_LZ4FRAME_H */
+
 #endif /* __FILE_H__ */
@@ -66,10 +66,13 @@ static int libpcap_try_record(wtap *wth, int *err, char **err_info);
 
 static bool libpcap_read(wtap *wth, wtap_rec *rec, Buffer *buf,
     int *err, char **err_info, int64_t *data_offset);
+static bool libpcap_read_batch(wtap *wth, wtap_rec_batch *batch,
+    int *err, char **err_info);
 static bool libpcap_seek_read(wtap *wth, int64_t seek_off,
     wtap_rec *rec, Buffer *buf, int *err, char **err_info);
 static bool libpcap_read_packet(wtap *wth, FILE_T fh,
-    wtap_rec *rec, Buffer *buf, int *err, char **err_info);
+    wtap_rec *rec, Buffer *buf, const uint8_t **data, int *err,
+    char **err_info);
 static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, char **err_info,
     struct pcaprec_ss990915_hdr *hdr);
 static void libpcap_close(wtap *wth);
@@ -294,6 +297,7 @@ wtap_open_return_val libpcap_open(wtap *wth, int *err, char **err_info)
 
 	/* This is a libpcap file */
 	wth->subtype_read = libpcap_read;
+	wth->subtype_read_batch = libpcap_read_batch;
 	wth->subtype_seek_read = libpcap_seek_read;
 	wth->subtype_close = libpcap_close;
 	wth->snapshot_length = hdr.snaplen;
@@ -899,7 +903,23 @@ static bool libpcap_read(wtap *wth, wtap_rec *rec, Buffer *buf,
 {
 	*data_offset = file_tell(wth->fh);
 
-	return libpcap_read_packet(wth, wth->fh, rec, buf, err, err_info);
+	return libpcap_read_packet(wth, wth->fh, rec, buf, NULL, err, err_info);
+}
+
+/* Read packets, appending their data to the batch's buffer */
+static bool libpcap_read_batch(wtap *wth, wtap_rec_batch *batch,
+    int *err, char **err_info)
+{
+	wtap_rec *rec;
+
+	while ((rec = wtap_rec_batch_next(wth, batch)) != NULL) {
+		batch->offsets[batch->num_recs] = file_tell(wth->fh);
+		if (!libpcap_read_packet(wth, wth->fh, rec, &batch->buf,
+		    &batch->data[batch->num_recs], err, err_info))
+			return false;
+		batch->num_recs++;
+	}
+	return true;
 }
 
 static bool
@@ -909,7 +929,7 @@ libpcap_seek_read(wtap *wth, int64_t seek_off, wtap_rec *rec,
 	if (file_seek(wth->random_fh, seek_off, SEEK_SET, err) == -1)
 		return false;
 
-	if (!libpcap_read_packet(wth, wth->random_fh, rec, buf, err,
+	if (!libpcap_read_packet(wth, wth->random_fh, rec, buf, NULL, err,
 	    err_info)) {
 		if (*err == 0)
 			*err = WTAP_ERR_SHORT_READ;
@@ -920,12 +940,13 @@ libpcap_seek_read(wtap *wth, int64_t seek_off, wtap_rec *rec,
 
 static bool
 libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
-    Buffer *buf, int *err, char **err_info)
+    Buffer *buf, const uint8_t **data, int *err, char **err_info)
 {
 	struct pcaprec_ss990915_hdr hdr;
 	unsigned packet_size;
 	unsigned orig_size;
 	int phdr_len;
+	uint8_t *pd;
 	libpcap_t *libpcap = (libpcap_t *)wth->priv;
 	bool is_nokia;
 
@@ -1008,13 +1029,25 @@ libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
 	rec->rec_header.packet_header.len = orig_size;
 
 	/*
-	 * Read the packet data.
+	 * If our caller can take a pointer to the packet data, and the
+	 * file is memory-mapped, point into the mapping rather than
+	 * copying the data; the mapping is read-only, but post-processing
+	 * only modifies the data of byte-swapped files.
+	 *
+	 * Otherwise, read the packet data, after any data already in the
+	 * buffer.
 	 */
-	if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
-		return false;	/* failed */
+	if (data != NULL && !libpcap->byte_swapped &&
+	    (*data = file_get_mapped(fh, packet_size)) != NULL) {
+		pd = (uint8_t *)*data;
+	} else {
+		if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
+			return false;	/* failed */
+		pd = ws_buffer_end_ptr(buf) - packet_size;
+	}
 
-	pcap_read_post_process(is_nokia, wth->file_encap, rec,
-	    ws_buffer_start_ptr(buf), libpcap->byte_swapped, libpcap->fcs_len);
+	pcap_read_post_process(is_nokia, wth->file_encap, rec, pd,
+	    libpcap->byte_swapped, libpcap->fcs_len);
 	return true;
 }
 
@@ -305,21 +305,515 @@ merge_select_frame_type(const int file_type, int in_file_count, merge_in_file_t
 }
 
 /*
- * returns true if first argument is earlier than second
+ * Min-heap of the input files that have a record available, ordered by
+ * the time stamp of that record, so that picking the next record to
+ * write is O(log N) in the number of input files rather than O(N).
+ */
+typedef struct {
+    unsigned *files;        /* indices into in_files[], heap-ordered */
+    unsigned  count;        /* number of entries in files[] */
+    unsigned  primed;       /* number of input files read at least once */
+    int       last;         /* file of the last returned record, or -1 */
+} merge_heap_t;
+
+static void
+merge_heap_init(merge_heap_t *heap, unsigned in_file_count)
+{
+    heap->files = g_new(unsigned, in_file_count);
+    heap->count = 0;
+    heap->primed = 0;
+    heap->last = -1;
+}
+
+static void
+merge_heap_cleanup(merge_heap_t *heap)
+{
+    g_free(heap->files);
+    heap->files = NULL;
+    heap->count = 0;
+}
+
+/*
+ * Returns true if the record of input file a must be written before the
+ * record of input file b.
+ *
+ * Records without a time stamp are treated as earlier than all other
+ * records (in file order among themselves); yes, this means you won't
+ * get a chronological merge of those records, but you obviously *can't*
+ * get that. Records with the same time stamp are taken from the later
+ * file first, as the linear scan this replaces did.
  */
 static bool
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_heap_before(const merge_in_file_t in_files[], unsigned a, unsigned b)
 {
-    if (l->secs > r->secs) {  /* left is later */
-        return false;
-    } else if (l->secs < r->secs) { /* left is earlier */
-        return true;
-    } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
+    const wtap_rec *rec_a = &in_files[a].rec;
+    const wtap_rec *rec_b = &in_files[b].rec;
+    bool has_ts_a = (rec_a->presence_flags & WTAP_HAS_TS) != 0;
+    bool has_ts_b = (rec_b->presence_flags & WTAP_HAS_TS) != 0;
+    int cmp;
+
+    if (!has_ts_a || !has_ts_b) {
+        if (!has_ts_a && !has_ts_b)
+            return a < b;
+        return !has_ts_a;
+    }
+    cmp = nstime_cmp(&rec_a->ts, &rec_b->ts);
+    if (cmp == 0)
+        return a > b;
+    return cmp < 0;
+}
+
+static void
+merge_heap_sift_up(merge_heap_t *heap, const merge_in_file_t in_files[], unsigned pos)
+{
+    unsigned file = heap->files[pos];
+
+    while (pos > 0) {
+        unsigned parent = (pos - 1) / 2;
+        if (!merge_heap_before(in_files, file, heap->files[parent]))
+            break;
+        heap->files[pos] = heap->files[parent];
+        pos = parent;
+    }
+    heap->files[pos] = file;
+}
+
+static void
+merge_heap_sift_down(merge_heap_t *heap, const merge_in_file_t in_files[], unsigned pos)
+{
+    unsigned file = heap->files[pos];
+
+    for (;;) {
+        unsigned child = 2 * pos + 1;
+        if (child >= heap->count)
+            break;
+        if (child + 1 < heap->count &&
+            merge_heap_before(in_files, heap->files[child + 1], heap->files[child]))
+            child++;
+        if (!merge_heap_before(in_files, heap->files[child], file))
+            break;
+        heap->files[pos] = heap->files[child];
+        pos = child;
+    }
+    heap->files[pos] = file;
+}
+
+static void
+merge_heap_push(merge_heap_t *heap, const merge_in_file_t in_files[], unsigned file)
+{
+    heap->files[heap->count] = file;
+    merge_heap_sift_up(heap, in_files, heap->count);
+    heap->count++;
+}
+
+static void
+merge_heap_pop(merge_heap_t *heap, const merge_in_file_t in_files[])
+{
+    ws_assert(heap->count > 0);
+    heap->count--;
+    if (heap->count > 0) {
+        heap->files[0] = heap->files[heap->count];
+        merge_heap_sift_down(heap, in_files, 0);
+    }
+}
+
+/*
+ * Read-ahead of the input files.
+ *
+ * Each input file is read into a ring of slots by a pool of at most
+ * MERGE_READ_AHEAD_MAX_THREADS worker threads, which serves any number of
+ * input files: a file with free slots is queued to the pool, and the worker
+ * that takes it fills its slots, so only one worker at a time uses the wtap
+ * of a file. The records are handed to the merge loop by swapping the
+ * wtap_rec and Buffer of a slot with those of the merge_in_file_t, so no
+ * packet data is copied.
+ *
+ * The workers are the only ones using the wtap until the pool is stopped,
+ * so they also collect what the merge loop would otherwise get from the
+ * wtap: the IDBs, NRBs and DSBs read along with each record, and the global
+ * interface ID of each packet.
+ */
+#define MERGE_READ_AHEAD_MAX_THREADS 8
+
+typedef struct {
+    GThread   **threads;
+    unsigned    thread_count;
+    GMutex      lock;           /* protects the fields below */
+    GCond       cond;           /* signalled when a file is queued */
+    GQueue      pending;        /* input files with slots to fill */
+    bool        stop;           /* set by the merge loop to stop the workers */
+} merge_read_ahead_pool_t;
+
+typedef struct {
+    GPtrArray  *idbs;           /* copies of the IDBs read before this record */
+    GPtrArray  *nrbs;           /* NRBs read before this record, owned by wth */
+    GPtrArray  *dsbs;           /* DSBs read before this record, owned by wth */
+    unsigned    interface_id;   /* global interface ID of the packet in wth */
+} merge_read_ahead_blocks_t;
+
+typedef struct {
+    wtap_rec    rec;
+    Buffer      buf;
+    merge_read_ahead_blocks_t blocks;
+} merge_read_ahead_slot_t;
+
+typedef struct merge_read_ahead_s {
+    merge_read_ahead_pool_t *pool;
+    GMutex      lock;           /* protects the fields below */
+    GCond       cond;           /* signalled when a slot is filled */
+    merge_read_ahead_slot_t *slots;
+    unsigned    depth;          /* number of slots */
+    unsigned    head;           /* first filled slot */
+    unsigned    count;          /* number of filled slots */
+    bool        queued;         /* queued to or being filled by a worker */
+    bool        stop;           /* set by the merge loop to stop the worker */
+    bool        done;           /* set by the worker at EOF or on an error */
+    int         err;            /* error that stopped the worker */
+    char       *err_info;
+    /* Only used by the worker. */
+    unsigned    nrbs_seen;
+    unsigned    dsbs_seen;
+    /* Blocks that came with the record in the merge_in_file_t. */
+    merge_read_ahead_blocks_t blocks;
+} merge_read_ahead_t;
+
+static void
+read_ahead_blocks_init(merge_read_ahead_blocks_t *blocks)
+{
+    blocks->idbs = g_ptr_array_new_with_free_func((GDestroyNotify)wtap_block_unref);
+    blocks->nrbs = g_ptr_array_new();
+    blocks->dsbs = g_ptr_array_new();
+    blocks->interface_id = 0;
+}
+
+static void
+read_ahead_blocks_clear(merge_read_ahead_blocks_t *blocks)
+{
+    g_ptr_array_set_size(blocks->idbs, 0);
+    g_ptr_array_set_size(blocks->nrbs, 0);
+    g_ptr_array_set_size(blocks->dsbs, 0);
+    blocks->interface_id = 0;
+}
+
+static void
+read_ahead_blocks_free(merge_read_ahead_blocks_t *blocks)
+{
+    g_ptr_array_free(blocks->idbs, true);
+    g_ptr_array_free(blocks->nrbs, true);
+    g_ptr_array_free(blocks->dsbs, true);
+}
+
+/*
+ * Collect the blocks that the worker read from wth along with the record
+ * in the slot.
+ */
+static void
+read_ahead_collect_blocks(merge_read_ahead_t *ra, wtap *wth,
+                          merge_read_ahead_slot_t *slot)
+{
+    wtap_block_t idb;
+    const wtap_rec *rec = &slot->rec;
+
+    /*
+     * The IDB in wth can still change (ISBs are added to it), so give
+     * the merge loop its own copy.
+     */
+    while ((idb = wtap_get_next_interface_description(wth)) != NULL) {
+        g_ptr_array_add(slot->blocks.idbs, wtap_block_make_copy(idb));
+    }
+    if (wth->nrbs) {
+        for (; ra->nrbs_seen < wth->nrbs->len; ra->nrbs_seen++) {
+            g_ptr_array_add(slot->blocks.nrbs,
+                            g_array_index(wth->nrbs, wtap_block_t, ra->nrbs_seen));
+        }
+    }
+    if (wth->dsbs) {
+        for (; ra->dsbs_seen < wth->dsbs->len; ra->dsbs_seen++) {
+            g_ptr_array_add(slot->blocks.dsbs,
+                            g_array_index(wth->dsbs, wtap_block_t, ra->dsbs_seen));
+        }
+    }
+    if (rec->rec_type == REC_TYPE_PACKET &&
+        (rec->presence_flags & WTAP_HAS_INTERFACE_ID)) {
+        unsigned section_num = (rec->presence_flags & WTAP_HAS_SECTION_NUMBER) ? rec->section_number : 0;
+        slot->blocks.interface_id = wtap_file_get_shb_global_interface_id(wth, section_num, rec->rec_header.packet_header.interface_id);
+    }
+}
+
+/*
+ * Fill the free slots of an input file, until they're all filled, the
+ * file ends or the merge loop stops reading ahead.
+ */
+static void
+read_ahead_fill(merge_in_file_t *in_file)
+{
+    merge_read_ahead_t *ra = in_file->read_ahead;
+    merge_read_ahead_slot_t *slot;
+    int64_t data_offset;
+    int err;
+    char *err_info;
+    bool ok;
+
+    for (;;) {
+        g_mutex_lock(&ra->lock);
+        if (ra->count == ra->depth || ra->stop) {
+            /* The merge loop queues the file again when it frees a slot. */
+            ra->queued = false;
+            g_mutex_unlock(&ra->lock);
+            return;
+        }
+        /* The merge loop doesn't touch this slot until count includes it. */
+        slot = &ra->slots[(ra->head + ra->count) % ra->depth];
+        g_mutex_unlock(&ra->lock);
+
+        ok = wtap_read(in_file->wth, &slot->rec, &slot->buf, &err, &err_info,
+                       &data_offset);
+        if (ok) {
+            read_ahead_collect_blocks(ra, in_file->wth, slot);
+        }
+
+        g_mutex_lock(&ra->lock);
+        if (ok) {
+            ra->count++;
+        } else {
+            ra->err = err;
+            ra->err_info = err_info;
+            ra->done = true;
+            ra->queued = false;
+        }
+        g_cond_signal(&ra->cond);
+        g_mutex_unlock(&ra->lock);
+
+        if (!ok)
+            return;
+    }
+}
+
+static void *
+read_ahead_worker(void *data)
+{
+    merge_read_ahead_pool_t *pool = (merge_read_ahead_pool_t *)data;
+    merge_in_file_t *in_file;
+
+    for (;;) {
+        g_mutex_lock(&pool->lock);
+        while (g_queue_is_empty(&pool->pending) && !pool->stop) {
+            g_cond_wait(&pool->cond, &pool->lock);
+        }
+        if (pool->stop) {
+            g_mutex_unlock(&pool->lock);
+            break;
+        }
+        in_file = (merge_in_file_t *)g_queue_pop_head(&pool->pending);
+        g_mutex_unlock(&pool->lock);
+
+        read_ahead_fill(in_file);
+    }
+    return NULL;
+}
+
+static void
+read_ahead_queue(merge_read_ahead_pool_t *pool, merge_in_file_t *in_file)
+{
+    g_mutex_lock(&pool->lock);
+    g_queue_push_tail(&pool->pending, in_file);
+    g_cond_signal(&pool->cond);
+    g_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Start reading ahead depth records from each of the input files, with
+ * a pool of worker threads. Returns the pool, to be stopped with
+ * read_ahead_stop().
+ */
+static merge_read_ahead_pool_t *
+read_ahead_start(merge_in_file_t *in_files, unsigned in_file_count, unsigned depth)
+{
+    merge_read_ahead_pool_t *pool;
+    merge_read_ahead_t *ra;
+
+    pool = g_new0(merge_read_ahead_pool_t, 1);
+    g_mutex_init(&pool->lock);
+    g_cond_init(&pool->cond);
+    g_queue_init(&pool->pending);
+
+    for (unsigned i = 0; i < in_file_count; i++) {
+        ra = g_new0(merge_read_ahead_t, 1);
+        ra->pool = pool;
+        g_mutex_init(&ra->lock);
+        g_cond_init(&ra->cond);
+        ra->depth = depth;
+        ra->slots = g_new(merge_read_ahead_slot_t, depth);
+        for (unsigned j = 0; j < depth; j++) {
+            wtap_rec_init(&ra->slots[j].rec);
+            ws_buffer_init(&ra->slots[j].buf, 1514);
+            read_ahead_blocks_init(&ra->slots[j].blocks);
+        }
+        read_ahead_blocks_init(&ra->blocks);
+        /* The blocks read before the first record are already processed. */
+        ra->nrbs_seen = in_files[i].nrbs_seen;
+        ra->dsbs_seen = in_files[i].dsbs_seen;
+        ra->queued = true;
+
+        in_files[i].read_ahead = ra;
+        g_queue_push_tail(&pool->pending, &in_files[i]);
+    }
+
+    pool->thread_count = MIN(in_file_count, MIN(g_get_num_processors(), MERGE_READ_AHEAD_MAX_THREADS));
+    pool->threads = g_new(GThread *, pool->thread_count);
+    for (unsigned i = 0; i < pool->thread_count; i++) {
+        pool->threads[i] = g_thread_new("merge_read_ahead", read_ahead_worker, pool);
+    }
+    return pool;
+}
+
+/*
+ * Stop the worker threads and discard the records they have read ahead.
+ * Afterwards the wtaps of the input files can be used by the merge loop
+ * again.
+ */
+static void
+read_ahead_stop(merge_read_ahead_pool_t *pool, merge_in_file_t *in_files, unsigned in_file_count)
+{
+    merge_read_ahead_t *ra;
+
+    if (pool == NULL)
+        return;
+
+    /* Make the workers give up the files they're filling... */
+    for (unsigned i = 0; i < in_file_count; i++) {
+        ra = in_files[i].read_ahead;
+        g_mutex_lock(&ra->lock);
+        ra->stop = true;
+        g_mutex_unlock(&ra->lock);
+    }
+    /* ...and not take any others. */
+    g_mutex_lock(&pool->lock);
+    pool->stop = true;
+    g_cond_broadcast(&pool->cond);
+    g_mutex_unlock(&pool->lock);
+    for (unsigned i = 0; i < pool->thread_count; i++) {
+        g_thread_join(pool->threads[i]);
+    }
+
+    for (unsigned i = 0; i < in_file_count; i++) {
+        ra = in_files[i].read_ahead;
+        for (unsigned j = 0; j < ra->depth; j++) {
+            wtap_rec_cleanup(&ra->slots[j].rec);
+            ws_buffer_free(&ra->slots[j].buf);
+            read_ahead_blocks_free(&ra->slots[j].blocks);
+        }
+        read_ahead_blocks_free(&ra->blocks);
+        g_free(ra->slots);
+        g_free(ra->err_info);
+        g_cond_clear(&ra->cond);
+        g_mutex_clear(&ra->lock);
+        g_free(ra);
+        in_files[i].read_ahead = NULL;
+    }
+
+    g_queue_clear(&pool->pending);
+    g_free(pool->threads);
+    g_cond_clear(&pool->cond);
+    g_mutex_clear(&pool->lock);
+    g_free(pool);
+}
+
+/*
+ * Take the next record of an input file from its read-ahead queue, waiting
+ * for the worker thread if the queue is empty. Same semantics as
+ * wtap_read().
+ */
+static bool
+read_ahead_next(merge_in_file_t *in_file, int *err, char **err_info)
+{
+    merge_read_ahead_t *ra = in_file->read_ahead;
+    merge_read_ahead_slot_t *slot;
+    merge_read_ahead_blocks_t blocks;
+    wtap_rec rec;
+    Buffer buf;
+    bool queue;
+
+    g_mutex_lock(&ra->lock);
+    while (ra->count == 0 && !ra->done) {
+        g_cond_wait(&ra->cond, &ra->lock);
+    }
+    if (ra->count == 0) {
+        /* The worker is at EOF or got an error; report it only once. */
+        *err = ra->err;
+        *err_info = ra->err_info;
+        ra->err = 0;
+        ra->err_info = NULL;
+        g_mutex_unlock(&ra->lock);
         return false;
     }
-    /* either one < two or one == two
-     * either way, return one
+    slot = &ra->slots[ra->head];
+    g_mutex_unlock(&ra->lock);
+
+    /*
+     * The merge loop is done with the previous record and has already
+     * released its block (possibly through a copy of the wtap_rec), so
+     * don't let the worker release it again.
      */
+    in_file->rec.block = NULL;
+    read_ahead_blocks_clear(&ra->blocks);
+
+    rec = in_file->rec;
+    in_file->rec = slot->rec;
+    slot->rec = rec;
+    buf = in_file->frame_buffer;
+    in_file->frame_buffer = slot->buf;
+    slot->buf = buf;
+    blocks = ra->blocks;
+    ra->blocks = slot->blocks;
+    slot->blocks = blocks;
+
+    g_mutex_lock(&ra->lock);
+    ra->head = (ra->head + 1) % ra->depth;
+    ra->count--;
+    queue = !ra->queued && !ra->done;
+    if (queue)
+        ra->queued = true;
+    g_mutex_unlock(&ra->lock);
+
+    if (queue)
+        read_ahead_queue(ra->pool, in_file);
+
+    *err = 0;
+    *err_info = NULL;
+    return true;
+}
+
+/*
+ * Read the next record of an input file into its merge_in_file_t, from
+ * the read-ahead queue if there's one. Same semantics as wtap_read().
+ */
+static bool
+merge_in_file_read(merge_in_file_t *in_file, int *err, char **err_info)
+{
+    int64_t data_offset;
+
+    if (in_file->read_ahead)
+        return read_ahead_next(in_file, err, err_info);
+    return wtap_read(in_file->wth, &in_file->rec, &in_file->frame_buffer,
+                     err, err_info, &data_offset);
+}
+
+/*
+ * Try to read the next record from an input file into its merge_in_file_t,
+ * updating its state. Returns false only on a read error.
+ */
+static bool
+merge_fill_in_file(merge_in_file_t *in_file, int *err, char **err_info)
+{
+    if (!merge_in_file_read(in_file, err, err_info)) {
+        if (*err != 0) {
+            in_file->state = GOT_ERROR;
+            return false;
+        }
+        in_file->state = AT_EOF;
+    } else
+        in_file->state = RECORD_PRESENT;
     return true;
 }
 
@@ -337,6 +831,7 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  *
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
+ * @param heap heap of the files with a record available
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -345,69 +840,49 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  */
 static merge_in_file_t *
 merge_read_packet(int in_file_count, merge_in_file_t in_files[],
-                  int *err, char **err_info)
+                  merge_heap_t *heap, int *err, char **err_info)
 {
-    int i;
-    int ei = -1;
-    nstime_t tv = NSTIME_INIT_MAX;
-    wtap_rec *rec;
+    unsigned ei;
 
     /*
      * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
+     * EOF. The first time through, that means reading a record from every
+     * file; after that, only the file whose record we returned last time
+     * needs another one, and it's still at the top of the heap.
      */
-    for (i = 0; i < in_file_count; i++) {
-        int64_t data_offset;
-
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, &in_files[i].rec,
-                           &in_files[i].frame_buffer, err, err_info,
-                           &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
-        }
+    while (heap->primed < (unsigned)in_file_count) {
+        ei = heap->primed++;
+        if (!merge_fill_in_file(&in_files[ei], err, err_info))
+            return &in_files[ei];
+        if (in_files[ei].state == RECORD_PRESENT)
+            merge_heap_push(heap, in_files, ei);
+    }
 
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = &in_files[i].rec;
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
-                break;
-            }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
-            }
+    if (heap->last != -1) {
+        ei = (unsigned)heap->last;
+        heap->last = -1;
+        ws_assert(heap->count > 0 && heap->files[0] == ei);
+        if (!merge_fill_in_file(&in_files[ei], err, err_info)) {
+            merge_heap_pop(heap, in_files);
+            return &in_files[ei];
         }
+        if (in_files[ei].state == RECORD_PRESENT)
+            merge_heap_sift_down(heap, in_files, 0);
+        else
+            merge_heap_pop(heap, in_files);
     }
 
-    if (ei == -1) {
+    if (heap->count == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
     }
 
+    ei = heap->files[0];
+
     /* We'll need to read another packet from this file. */
     in_files[ei].state = RECORD_NOT_PRESENT;
+    heap->last = (int)ei;
 
     /* Count this packet. */
     in_files[ei].packet_num++;
@@ -445,7 +920,6 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
                          int *err, char **err_info)
 {
     int i;
-    int64_t data_offset;
 
     /*
      * Find the first file not at EOF, and read the next packet from it.
@@ -453,9 +927,7 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
     for (i = 0; i < in_file_count; i++) {
         if (in_files[i].state == AT_EOF)
             continue; /* This file is already at EOF */
-        if (wtap_read(in_files[i].wth, &in_files[i].rec,
-                      &in_files[i].frame_buffer, err, err_info,
-                      &data_offset))
+        if (merge_in_file_read(&in_files[i], err, err_info))
             break; /* We have a packet */
         if (*err != 0) {
             /* Read error - quit immediately. */
@@ -837,19 +1309,74 @@ add_idb_to_merged_file(wtapng_iface_descriptions_t *merged_idb_list,
     return true;
 }
 
+/*
+ * Map an IDB found in the middle of an input file to an IDB of the merge
+ * file, creating a clone IDB for the merge file if needed.
+ */
+static bool
+process_new_idb(wtap_dumper *pdh, merge_in_file_t *in_file, const unsigned itf_count, const wtap_block_t input_file_idb, const idb_merge_mode mode, wtapng_iface_descriptions_t *merged_idb_list, int *err, char **err_info)
+{
+    unsigned                     merged_index;
+
+    /* If we were initially in ALL mode and all the interfaces
+     * did match, then we set the mode to ANY (merge duplicates).
+     * If the interfaces didn't match, then we are still in ALL
+     * mode, but treat that as NONE (write out all IDBs.)
+     * XXX: Should there be separate modes for "match ALL at the start
+     * and ANY later" vs "match ALL at the beginning and NONE later"?
+     * Should there be a two-pass mode for people who want ALL mode to
+     * work for IDBs in the middle of the file? (See #16542)
+     */
+
+    if (mode == IDB_MERGE_MODE_ANY_SAME &&
+        find_duplicate_idb(input_file_idb, merged_idb_list, &merged_index))
+    {
+        ws_debug("mode ANY set and found a duplicate");
+        /*
+         * It's the same as a previous IDB, so we're going to "merge"
+         * them into one by adding a map from its old IDB index to the
+         * new one. This will be used later to change the rec
+         * interface_id.
+         */
+        add_idb_index_map(in_file, itf_count, merged_index);
+    }
+    else {
+        ws_debug("mode NONE or ALL set or did not find a duplicate");
+        /*
+         * This IDB does not match a previous (or we want to save all
+         * IDBs), so add the IDB to the merge file, and add a map of
+         * the indices.
+         */
+        if (add_idb_to_merged_file(merged_idb_list, input_file_idb, pdh, err, err_info)) {
+            merged_index = merged_idb_list->interface_data->len - 1;
+            add_idb_index_map(in_file, itf_count, merged_index);
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 /*
  * Create clone IDBs for the merge file for IDBs found in the middle of
  * input files while processing.
+ *
+ * The IDBs of input files that are read ahead are processed along with
+ * their records by process_read_ahead_idbs() instead.
  */
 static bool
 process_new_idbs(wtap_dumper *pdh, merge_in_file_t *in_files, const unsigned in_file_count, const idb_merge_mode mode, wtapng_iface_descriptions_t *merged_idb_list, int *err, char **err_info)
 {
     wtap_block_t                 input_file_idb;
-    unsigned                     itf_count, merged_index;
+    unsigned                     itf_count;
     unsigned                     i;
 
     for (i = 0; i < in_file_count; i++) {
 
+        if (in_files[i].read_ahead)
+            continue;
+
         /*
          * The number below is the global interface number within wth,
          * not the number within the section. We will do both mappings
@@ -857,43 +1384,8 @@ process_new_idbs(wtap_dumper *pdh, merge_in_file_t *in_files, const unsigned in_
          */
         itf_count = in_files[i].wth->next_interface_data;
         while ((input_file_idb = wtap_get_next_interface_description(in_files[i].wth)) != NULL) {
-
-            /* If we were initially in ALL mode and all the interfaces
-             * did match, then we set the mode to ANY (merge duplicates).
-             * If the interfaces didn't match, then we are still in ALL
-             * mode, but treat that as NONE (write out all IDBs.)
-             * XXX: Should there be separate modes for "match ALL at the start
-             * and ANY later" vs "match ALL at the beginning and NONE later"?
-             * Should there be a two-pass mode for people who want ALL mode to
-             * work for IDBs in the middle of the file? (See #16542)
-             */
-
-            if (mode == IDB_MERGE_MODE_ANY_SAME &&
-                find_duplicate_idb(input_file_idb, merged_idb_list, &merged_index))
-            {
-                ws_debug("mode ANY set and found a duplicate");
-                /*
-                 * It's the same as a previous IDB, so we're going to "merge"
-                 * them into one by adding a map from its old IDB index to the
-                 * new one. This will be used later to change the rec
-                 * interface_id.
-                 */
-                add_idb_index_map(&in_files[i], itf_count, merged_index);
-            }
-            else {
-                ws_debug("mode NONE or ALL set or did not find a duplicate");
-                /*
-                 * This IDB does not match a previous (or we want to save all
-                 * IDBs), so add the IDB to the merge file, and add a map of
-                 * the indices.
-                 */
-                if (add_idb_to_merged_file(merged_idb_list, input_file_idb, pdh, err, err_info)) {
-                    merged_index = merged_idb_list->interface_data->len - 1;
-                    add_idb_index_map(&in_files[i], itf_count, merged_index);
-                } else {
-                    return false;
-                }
-            }
+            if (!process_new_idb(pdh, &in_files[i], itf_count, input_file_idb, mode, merged_idb_list, err, err_info))
+                return false;
             itf_count = in_files[i].wth->next_interface_data;
         }
     }
@@ -901,6 +1393,24 @@ process_new_idbs(wtap_dumper *pdh, merge_in_file_t *in_files, const unsigned in_
     return true;
 }
 
+/*
+ * Create clone IDBs for the merge file for the IDBs read ahead along with
+ * the current record of an input file.
+ */
+static bool
+process_read_ahead_idbs(wtap_dumper *pdh, merge_in_file_t *in_file, const idb_merge_mode mode, wtapng_iface_descriptions_t *merged_idb_list, int *err, char **err_info)
+{
+    GPtrArray *idbs = in_file->read_ahead->blocks.idbs;
+
+    for (unsigned i = 0; i < idbs->len; i++) {
+        /* The IDBs of the file are mapped in the order they were read. */
+        if (!process_new_idb(pdh, in_file, in_file->idb_index_map->len, idbs->pdata[i], mode, merged_idb_list, err, err_info))
+            return false;
+    }
+
+    return true;
+}
+
 /*
  * Create clone IDBs for the merge file, based on the input files and mode.
  */
@@ -989,8 +1499,13 @@ map_rec_interface_id(wtap_rec *rec, const merge_in_file_t *in_file)
     ws_assert(in_file->idb_index_map != NULL);
 
     if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
-        unsigned section_num = (rec->presence_flags & WTAP_HAS_SECTION_NUMBER) ? rec->section_number : 0;
-        current_interface_id = wtap_file_get_shb_global_interface_id(in_file->wth, section_num, rec->rec_header.packet_header.interface_id);
+        if (in_file->read_ahead) {
+            /* Looked up by the worker thread, which owns wth. */
+            current_interface_id = in_file->read_ahead->blocks.interface_id;
+        } else {
+            unsigned section_num = (rec->presence_flags & WTAP_HAS_SECTION_NUMBER) ? rec->section_number : 0;
+            current_interface_id = wtap_file_get_shb_global_interface_id(in_file->wth, section_num, rec->rec_header.packet_header.interface_id);
+        }
     }
 
     if (current_interface_id >= in_file->idb_index_map->len) {
@@ -1011,7 +1526,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                       merge_in_file_t *in_files, const unsigned in_file_count,
                       const bool do_append,
                       const idb_merge_mode mode, unsigned snaplen,
-                      merge_progress_callback_t* cb,
+                      unsigned read_ahead, merge_progress_callback_t* cb,
                       wtapng_iface_descriptions_t *idb_inf,
                       GArray *nrb_combined, GArray *dsb_combined,
                       int *err, char **err_info, unsigned *err_fileno,
@@ -1022,6 +1537,14 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     int                 count = 0;
     bool                stop_flag = false;
     wtap_rec *rec,      snap_rec;
+    merge_heap_t        heap;
+    merge_read_ahead_pool_t *read_ahead_pool = NULL;
+
+    merge_heap_init(&heap, in_file_count);
+
+    if (read_ahead > 0) {
+        read_ahead_pool = read_ahead_start(in_files, in_file_count, read_ahead);
+    }
 
     for (;;) {
         *err = 0;
@@ -1031,8 +1554,8 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                                                err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
-                                        err_info);
+            in_file = merge_read_packet(in_file_count, in_files, &heap,
+                                        err, err_info);
         }
 
         if (in_file == NULL) {
@@ -1080,6 +1603,11 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                 status = MERGE_ERR_CANT_WRITE_OUTFILE;
                 break;
             }
+            if (in_file->read_ahead &&
+                !process_read_ahead_idbs(pdh, in_file, mode, idb_inf, err, err_info)) {
+                status = MERGE_ERR_CANT_WRITE_OUTFILE;
+                break;
+            }
         }
 
         switch (rec->rec_type) {
@@ -1129,20 +1657,38 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
          * If any DSBs were read before this record, be sure to pass those now
          * such that wtap_dump can pick it up.
          */
-        if (nrb_combined && in_file->wth->nrbs) {
-            GArray *in_nrb = in_file->wth->nrbs;
-            for (unsigned i = in_file->nrbs_seen; i < in_nrb->len; i++) {
-                wtap_block_t wblock = g_array_index(in_nrb, wtap_block_t, i);
-                g_array_append_val(nrb_combined, wblock);
-                in_file->nrbs_seen++;
+        if (in_file->read_ahead) {
+            merge_read_ahead_blocks_t *blocks = &in_file->read_ahead->blocks;
+            if (nrb_combined) {
+                for (unsigned i = 0; i < blocks->nrbs->len; i++) {
+                    wtap_block_t wblock = (wtap_block_t)blocks->nrbs->pdata[i];
+                    g_array_append_val(nrb_combined, wblock);
+                    in_file->nrbs_seen++;
+                }
             }
-        }
-        if (dsb_combined && in_file->wth->dsbs) {
-            GArray *in_dsb = in_file->wth->dsbs;
-            for (unsigned i = in_file->dsbs_seen; i < in_dsb->len; i++) {
-                wtap_block_t wblock = g_array_index(in_dsb, wtap_block_t, i);
-                g_array_append_val(dsb_combined, wblock);
-                in_file->dsbs_seen++;
+            if (dsb_combined) {
+                for (unsigned i = 0; i < blocks->dsbs->len; i++) {
+                    wtap_block_t wblock = (wtap_block_t)blocks->dsbs->pdata[i];
+                    g_array_append_val(dsb_combined, wblock);
+                    in_file->dsbs_seen++;
+                }
+            }
+        } else {
+            if (nrb_combined && in_file->wth->nrbs) {
+                GArray *in_nrb = in_file->wth->nrbs;
+                for (unsigned i = in_file->nrbs_seen; i < in_nrb->len; i++) {
+                    wtap_block_t wblock = g_array_index(in_nrb, wtap_block_t, i);
+                    g_array_append_val(nrb_combined, wblock);
+                    in_file->nrbs_seen++;
+                }
+            }
+            if (dsb_combined && in_file->wth->dsbs) {
+                GArray *in_dsb = in_file->wth->dsbs;
+                for (unsigned i = in_file->dsbs_seen; i < in_dsb->len; i++) {
+                    wtap_block_t wblock = g_array_index(in_dsb, wtap_block_t, i);
+                    g_array_append_val(dsb_combined, wblock);
+                    in_file->dsbs_seen++;
+                }
             }
         }
 
@@ -1154,6 +1700,14 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         wtap_rec_reset(rec);
     }
 
+    merge_heap_cleanup(&heap);
+
+    /*
+     * Stop the worker threads, so that the IDBs, NRBs and DSBs read after
+     * the last records can be taken from the input files below.
+     */
+    read_ahead_stop(read_ahead_pool, in_files, in_file_count);
+
     if (cb)
         cb->callback_func(MERGE_EVENT_DONE, count, in_files, in_file_count, cb->data);
 
@@ -1240,7 +1794,7 @@ merge_files_common(const char* out_filename, /* filename in normal output mode,
                    char **out_filenamep, const char *pfx, /* tempfile mode  */
                    const int file_type, const char *const *in_filenames,
                    const unsigned in_file_count, const bool do_append,
-                   idb_merge_mode mode, unsigned snaplen,
+                   idb_merge_mode mode, unsigned snaplen, unsigned read_ahead,
                    const char *app_name, merge_progress_callback_t* cb,
                    int *err, char **err_info, unsigned *err_fileno,
                    uint32_t *err_framenum)
@@ -1397,7 +1951,7 @@ merge_files_common(const char* out_filename, /* filename in normal output mode,
             cb->callback_func(MERGE_EVENT_READY_TO_MERGE, 0, in_files, open_file_count, cb->data);
 
         status = merge_process_packets(pdh, file_type, in_files, open_file_count,
-                                       do_append, mode, snaplen, cb,
+                                       do_append, mode, snaplen, read_ahead, cb,
                                        idb_inf, nrb_combined, dsb_combined,
                                        err, err_info,
                                        err_fileno, err_framenum);
@@ -1421,7 +1975,7 @@ merge_files_common(const char* out_filename, /* filename in normal output mode,
             // We recurse here, but we're limited by MAX_MERGE_FILES
             status = merge_files_common(out_filename, out_filenamep, pfx,
                         file_type, (const char**)temp_files->pdata,
-                        temp_files->len, do_append, mode, snaplen, app_name,
+                        temp_files->len, do_append, mode, snaplen, read_ahead, app_name,
                         cb, err, err_info, err_fileno, err_framenum);
         }
         g_ptr_array_free(temp_files, true);
@@ -1439,7 +1993,8 @@ merge_result
 merge_files(const char* out_filename, const int file_type,
             const char *const *in_filenames, const unsigned in_file_count,
             const bool do_append, const idb_merge_mode mode,
-            unsigned snaplen, const char *app_name, merge_progress_callback_t* cb,
+            unsigned snaplen, unsigned read_ahead, const char *app_name,
+            merge_progress_callback_t* cb,
             int *err, char **err_info, unsigned *err_fileno,
             uint32_t *err_framenum)
 {
@@ -1463,7 +2018,7 @@ merge_files(const char* out_filename, const int file_type,
 
     return merge_files_common(out_filename, NULL, NULL,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, err,
+                              do_append, mode, snaplen, read_ahead, app_name, cb, err,
                               err_info, err_fileno, err_framenum);
 }
 
@@ -1477,7 +2032,8 @@ merge_files_to_tempfile(const char *tmpdir, char **out_filenamep, const char *pf
                         const int file_type, const char *const *in_filenames,
                         const unsigned in_file_count, const bool do_append,
                         const idb_merge_mode mode, unsigned snaplen,
-                        const char *app_name, merge_progress_callback_t* cb,
+                        unsigned read_ahead, const char *app_name,
+                        merge_progress_callback_t* cb,
                         int *err, char **err_info, unsigned *err_fileno,
                         uint32_t *err_framenum)
 {
@@ -1488,7 +2044,7 @@ merge_files_to_tempfile(const char *tmpdir, char **out_filenamep, const char *pf
 
     return merge_files_common(tmpdir, out_filenamep, pfx,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, err,
+                              do_append, mode, snaplen, read_ahead, app_name, cb, err,
                               err_info, err_fileno, err_framenum);
 }
 
@@ -1501,13 +2057,14 @@ merge_result
 merge_files_to_stdout(const int file_type, const char *const *in_filenames,
                       const unsigned in_file_count, const bool do_append,
                       const idb_merge_mode mode, unsigned snaplen,
-                      const char *app_name, merge_progress_callback_t* cb,
+                      unsigned read_ahead, const char *app_name,
+                      merge_progress_callback_t* cb,
                       int *err, char **err_info, unsigned *err_fileno,
                       uint32_t *err_framenum)
 {
     return merge_files_common(NULL, NULL, NULL,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, err,
+                              do_append, mode, snaplen, read_ahead, app_name, cb, err,
                               err_info, err_fileno, err_framenum);
 }
 
@@ -38,6 +38,7 @@ typedef struct merge_in_file_s {
     GArray         *idb_index_map;  /* used for mapping the old phdr interface_id values to new during merge */
     unsigned        nrbs_seen;      /* number of elements processed so far from wth->nrbs */
     unsigned        dsbs_seen;      /* number of elements processed so far from wth->dsbs */
+    struct merge_read_ahead_s *read_ahead; /* records read ahead from wth, or NULL */
 } merge_in_file_t;
 
 /** Return values from merge_files(). */
@@ -92,6 +93,17 @@ WS_DLL_PUBLIC const char*
 merge_idb_merge_mode_to_string(const int mode);
 
 
+/*
+ * If the read_ahead argument of the merge_files*() routines is not 0,
+ * a pool of worker threads reads each input file into a queue of up to
+ * read_ahead records, so that reading and decompressing the input files
+ * overlap and the merge itself only compares time stamps and writes
+ * records. 0 reads all the input files on the thread calling them.
+ *
+ * While the records are being merged, a progress callback must not use
+ * the wtap of the input files, as it is in use by the worker threads.
+ */
+
 /** @struct merge_progress_callback_t
  *
  * @brief Callback information for merging.
@@ -123,6 +135,8 @@ typedef struct {
  * @param do_append Whether to append by file order instead of chronological order
  * @param mode The IDB_MERGE_MODE_XXX merge mode for interface data
  * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
+ * @param read_ahead The number of records to read ahead from each input file,
+ *   or 0 not to read ahead
  * @param app_name The application name performing the merge, used in SHB info
  * @param cb The callback information to use during execution
  * @param[out] err Set to the internal WTAP_ERR_XXX error code if it failed
@@ -139,7 +153,8 @@ WS_DLL_PUBLIC merge_result
 merge_files(const char* out_filename, const int file_type,
             const char *const *in_filenames, const unsigned in_file_count,
             const bool do_append, const idb_merge_mode mode,
-            unsigned snaplen, const char *app_name, merge_progress_callback_t* cb,
+            unsigned snaplen, unsigned read_ahead, const char *app_name,
+            merge_progress_callback_t* cb,
             int *err, char **err_info, unsigned *err_fileno,
             uint32_t *err_framenum);
 
@@ -155,6 +170,8 @@ merge_files(const char* out_filename, const int file_type,
  * @param do_append Whether to append by file order instead of chronological order
  * @param mode The IDB_MERGE_MODE_XXX merge mode for interface data
  * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
+ * @param read_ahead The number of records to read ahead from each input file,
+ *   or 0 not to read ahead
  * @param app_name The application name performing the merge, used in SHB info
  * @param cb The callback information to use during execution
  * @param[out] err Set to the internal WTAP_ERR_XXX error code if it failed
@@ -172,7 +189,8 @@ merge_files_to_tempfile(const char *tmpdir, char **out_filenamep, const char *pf
                         const int file_type, const char *const *in_filenames,
                         const unsigned in_file_count, const bool do_append,
                         const idb_merge_mode mode, unsigned snaplen,
-                        const char *app_name, merge_progress_callback_t* cb,
+                        unsigned read_ahead, const char *app_name,
+                        merge_progress_callback_t* cb,
                         int *err, char **err_info, unsigned *err_fileno,
                         uint32_t *err_framenum);
 
@@ -184,6 +202,8 @@ merge_files_to_tempfile(const char *tmpdir, char **out_filenamep, const char *pf
  * @param do_append Whether to append by file order instead of chronological order
  * @param mode The IDB_MERGE_MODE_XXX merge mode for interface data
  * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
+ * @param read_ahead The number of records to read ahead from each input file,
+ *   or 0 not to read ahead
  * @param app_name The application name performing the merge, used in SHB info
  * @param cb The callback information to use during execution
  * @param[out] err Set to the internal WTAP_ERR_XXX error code if it failed
@@ -200,7 +220,8 @@ WS_DLL_PUBLIC merge_result
 merge_files_to_stdout(const int file_type, const char *const *in_filenames,
                       const unsigned in_file_count, const bool do_append,
                       const idb_merge_mode mode, unsigned snaplen,
-                      const char *app_name, merge_progress_callback_t* cb,
+                      unsigned read_ahead, const char *app_name,
+                      merge_progress_callback_t* cb,
                       int *err, char **err_info, unsigned *err_fileno,
                       uint32_t *err_framenum);
 
@@ -0,0 +1,279 @@
+/* merge_test.c
+ * Tests and benchmarks for merging capture files by time stamp
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <wiretap/wtap.h>
+#include <wiretap/merge.h>
+#include <wsutil/file_util.h>
+#include <wsutil/tempfile.h>
+#include <wsutil/wslog.h>
+
+/* Number of input files merged by the benchmark. */
+#define MERGE_PERF_FILES        500
+/* Number of records in each input file of the benchmark. */
+#define MERGE_PERF_RECORDS      200
+
+#define MERGE_TEST_LINKTYPE     1 /* Ethernet */
+#define MERGE_TEST_CAPLEN       60
+
+typedef struct {
+    char      *dir;
+    char     **in_filenames;
+    unsigned   in_file_count;
+    char      *out_filename;
+} merge_fixture_t;
+
+static void
+write_u16(FILE *fp, uint16_t val)
+{
+    g_assert_cmpuint(fwrite(&val, sizeof val, 1, fp), ==, 1);
+}
+
+static void
+write_u32(FILE *fp, uint32_t val)
+{
+    g_assert_cmpuint(fwrite(&val, sizeof val, 1, fp), ==, 1);
+}
+
+/*
+ * Write a pcap file whose record n has the time stamp
+ * (n * stride + first) microseconds, so that the records of the files
+ * are interleaved when merged.
+ */
+static void
+write_synthetic_pcap(const char *filename, unsigned records,
+                     uint64_t first, uint64_t stride)
+{
+    uint8_t data[MERGE_TEST_CAPLEN];
+    FILE *fp;
+
+    fp = ws_fopen(filename, "wb");
+    g_assert_nonnull(fp);
+
+    /* File header, host byte order. */
+    write_u32(fp, 0xa1b2c3d4);
+    write_u16(fp, 2);   /* version_major */
+    write_u16(fp, 4);   /* version_minor */
+    write_u32(fp, 0);   /* thiszone */
+    write_u32(fp, 0);   /* sigfigs */
+    write_u32(fp, 65535);
+    write_u32(fp, MERGE_TEST_LINKTYPE);
+
+    memset(data, 0x55, sizeof data);
+    for (unsigned n = 0; n < records; n++) {
+        uint64_t usecs = n * stride + first;
+
+        write_u32(fp, (uint32_t)(usecs / 1000000));
+        write_u32(fp, (uint32_t)(usecs % 1000000));
+        write_u32(fp, MERGE_TEST_CAPLEN);
+        write_u32(fp, MERGE_TEST_CAPLEN);
+        memcpy(data, &n, sizeof n);
+        g_assert_cmpuint(fwrite(data, sizeof data, 1, fp), ==, 1);
+    }
+    fclose(fp);
+}
+
+static void
+merge_fixture_setup(merge_fixture_t *fixture, unsigned in_file_count,
+                    unsigned records)
+{
+    fixture->dir = create_tempdir(NULL, "merge_test", NULL);
+    g_assert_nonnull(fixture->dir);
+
+    fixture->in_file_count = in_file_count;
+    fixture->in_filenames = g_new0(char *, in_file_count + 1);
+    for (unsigned i = 0; i < in_file_count; i++) {
+        char name[32];
+
+        snprintf(name, sizeof name, "in%04u.pcap", i);
+        fixture->in_filenames[i] = g_build_filename(fixture->dir, name, NULL);
+        write_synthetic_pcap(fixture->in_filenames[i], records, i, in_file_count);
+    }
+    fixture->out_filename = g_build_filename(fixture->dir, "out.pcapng", NULL);
+}
+
+static void
+merge_fixture_teardown(merge_fixture_t *fixture)
+{
+    for (unsigned i = 0; i < fixture->in_file_count; i++) {
+        ws_unlink(fixture->in_filenames[i]);
+    }
+    ws_unlink(fixture->out_filename);
+    g_rmdir(fixture->dir);
+
+    g_strfreev(fixture->in_filenames);
+    g_free(fixture->out_filename);
+    g_free(fixture->dir);
+}
+
+static void
+merge_fixture_run(merge_fixture_t *fixture, unsigned read_ahead)
+{
+    merge_result status;
+    int err = 0;
+    char *err_info = NULL;
+    unsigned err_fileno = 0;
+    uint32_t err_framenum = 0;
+
+    status = merge_files(fixture->out_filename, wtap_pcapng_file_type_subtype(),
+                         (const char *const *)fixture->in_filenames,
+                         fixture->in_file_count, false, IDB_MERGE_MODE_ALL_SAME,
+                         0, read_ahead, "merge_test", NULL,
+                         &err, &err_info, &err_fileno, &err_framenum);
+    g_assert_cmpint(status, ==, MERGE_OK);
+    g_free(err_info);
+}
+
+/* Check that the merged file has all the records in chronological order. */
+static void
+merge_fixture_check(merge_fixture_t *fixture, unsigned expected_records)
+{
+    wtap *wth;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    char *err_info = NULL;
+    int64_t data_offset;
+    unsigned count = 0;
+    nstime_t prev = NSTIME_INIT_ZERO;
+
+    wth = wtap_open_offline(fixture->out_filename, WTAP_TYPE_AUTO, &err, &err_info, false);
+    g_assert_nonnull(wth);
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+    while (wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset)) {
+        g_assert_true(rec.presence_flags & WTAP_HAS_TS);
+        g_assert_cmpint(nstime_cmp(&prev, &rec.ts), <=, 0);
+        prev = rec.ts;
+        count++;
+        wtap_rec_reset(&rec);
+    }
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(count, ==, expected_records);
+
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+}
+
+static void
+merge_test_interleaved(void)
+{
+    merge_fixture_t fixture;
+
+    merge_fixture_setup(&fixture, 7, 50);
+    merge_fixture_run(&fixture, 0);
+    merge_fixture_check(&fixture, 7 * 50);
+    merge_fixture_teardown(&fixture);
+}
+
+static void
+merge_test_read_ahead(void)
+{
+    merge_fixture_t fixture;
+
+    /* Fewer slots than records, so the workers have to wait for the merge. */
+    merge_fixture_setup(&fixture, 7, 50);
+    merge_fixture_run(&fixture, 4);
+    merge_fixture_check(&fixture, 7 * 50);
+    merge_fixture_teardown(&fixture);
+}
+
+static void
+merge_test_read_ahead_many_files(void)
+{
+    merge_fixture_t fixture;
+
+    /* Many more files than worker threads. */
+    merge_fixture_setup(&fixture, 100, 5);
+    merge_fixture_run(&fixture, 2);
+    merge_fixture_check(&fixture, 100 * 5);
+    merge_fixture_teardown(&fixture);
+}
+
+static void
+merge_test_single_file(void)
+{
+    merge_fixture_t fixture;
+
+    merge_fixture_setup(&fixture, 1, 10);
+    merge_fixture_run(&fixture, 0);
+    merge_fixture_check(&fixture, 10);
+    merge_fixture_teardown(&fixture);
+}
+
+/*
+ * Merge many small files; the time spent selecting the next record grows
+ * with the number of input files, so this tracks how the merge scales.
+ */
+static void
+merge_test_many_files_perf(void)
+{
+    merge_fixture_t fixture;
+    double elapsed;
+
+    merge_fixture_setup(&fixture, MERGE_PERF_FILES, MERGE_PERF_RECORDS);
+
+    g_test_timer_start();
+    merge_fixture_run(&fixture, 0);
+    elapsed = g_test_timer_elapsed();
+
+    merge_fixture_check(&fixture, MERGE_PERF_FILES * MERGE_PERF_RECORDS);
+    merge_fixture_teardown(&fixture);
+
+    g_test_minimized_result(elapsed, "merged %u files of %u records in %f seconds",
+                            MERGE_PERF_FILES, MERGE_PERF_RECORDS, elapsed);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    ws_log_init("merge_test", NULL);
+
+    g_test_init(&argc, &argv, NULL);
+
+    wtap_init(false);
+
+    g_test_add_func("/merge/interleaved", merge_test_interleaved);
+    g_test_add_func("/merge/read_ahead", merge_test_read_ahead);
+    g_test_add_func("/merge/read_ahead_many_files", merge_test_read_ahead_many_files);
+    g_test_add_func("/merge/single_file", merge_test_single_file);
+
+    if (g_test_perf()) {
+        g_test_add_func("/merge/many_files_perf", merge_test_many_files_perf);
+    }
+
+    ret = g_test_run();
+
+    wtap_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -46,6 +46,9 @@ static bool
 pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
             char **err_info, int64_t *data_offset);
 static bool
+pcapng_read_batch(wtap *wth, wtap_rec_batch *batch, int *err,
+                  char **err_info);
+static bool
 pcapng_seek_read(wtap *wth, int64_t seek_off,
                  wtap_rec *rec, Buffer *buf, int *err, char **err_info);
 static void
@@ -910,7 +913,8 @@ pcapng_process_nflx_custom_option(wtapng_block_t *wblock,
         if (wblock->type == BLOCK_TYPE_CB_COPY) {
             ws_buffer_assure_space(wblock->frame_buffer, length);
             wblock->rec->rec_header.custom_block_header.length = length + 4;
-            memcpy(ws_buffer_start_ptr(wblock->frame_buffer), value, length);
+            memcpy(ws_buffer_end_ptr(wblock->frame_buffer), value, length);
+            ws_buffer_increase_length(wblock->frame_buffer, length);
             memcpy(&temp, value, sizeof(uint64_t));
             temp = GUINT64_FROM_LE(temp);
             wblock->rec->ts.secs = section_info->bblog_offset_tv_sec + temp;
@@ -2140,6 +2144,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     uint64_t ts;
     int pseudo_header_len;
     int fcslen;
+    size_t data_offset;
 
     wblock->block = wtap_block_create(WTAP_BLOCK_PACKET);
 
@@ -2312,7 +2317,9 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     /* Add the time stamp offset. */
     wblock->rec->ts.secs = (time_t)(wblock->rec->ts.secs + iface_info.tsoffset);
 
-    /* "(Enhanced) Packet Block" read capture data */
+    /* "(Enhanced) Packet Block" read capture data, after any data
+       already in the buffer */
+    data_offset = ws_buffer_length(wblock->frame_buffer);
     if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
                                 packet.cap_len - pseudo_header_len, err, err_info))
         return false;
@@ -2358,7 +2365,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     }
 
     pcap_read_post_process(false, iface_info.wtap_encap,
-                           wblock->rec, ws_buffer_start_ptr(wblock->frame_buffer),
+                           wblock->rec, ws_buffer_start_ptr(wblock->frame_buffer) + data_offset,
                            section_info->byte_swapped, fcslen);
 
     /*
@@ -2390,6 +2397,7 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     wtapng_simple_packet_t simple_packet;
     uint32_t padding;
     int pseudo_header_len;
+    size_t data_offset;
 
     /*
      * Is this block long enough to be an SPB?
@@ -2496,7 +2504,9 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh,
 
     memset((void *)&wblock->rec->rec_header.packet_header.pseudo_header, 0, sizeof(union wtap_pseudo_header));
 
-    /* "Simple Packet Block" read capture data */
+    /* "Simple Packet Block" read capture data, after any data already
+       in the buffer */
+    data_offset = ws_buffer_length(wblock->frame_buffer);
     if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
                                 simple_packet.cap_len, err, err_info))
         return false;
@@ -2508,7 +2518,7 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh,
     }
 
     pcap_read_post_process(false, iface_info.wtap_encap,
-                           wblock->rec, ws_buffer_start_ptr(wblock->frame_buffer),
+                           wblock->rec, ws_buffer_start_ptr(wblock->frame_buffer) + data_offset,
                            section_info->byte_swapped, iface_info.fcslen);
 
     /*
@@ -3278,6 +3288,7 @@ static bool
 pcapng_read_systemd_journal_export_block(wtap *wth, FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn _U_, wtapng_block_t *wblock, int *err, char **err_info)
 {
     uint32_t entry_length;
+    size_t data_offset;
     uint64_t rt_ts;
     bool have_ts = false;
 
@@ -3291,6 +3302,7 @@ pcapng_read_systemd_journal_export_block(wtap *wth, FILE_T fh, pcapng_block_head
     entry_length = bh->block_total_length - MIN_BLOCK_SIZE;
 
     /* Includes padding bytes. */
+    data_offset = ws_buffer_length(wblock->frame_buffer);
     if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
                                 entry_length, err, err_info)) {
         return false;
@@ -3300,9 +3312,9 @@ pcapng_read_systemd_journal_export_block(wtap *wth, FILE_T fh, pcapng_block_head
      * We don't have memmem available everywhere, so we get to add space for
      * a trailing \0 for strstr below.
      */
-    ws_buffer_assure_space(wblock->frame_buffer, entry_length+1);
+    ws_buffer_assure_space(wblock->frame_buffer, 1);
 
-    char *buf_ptr = (char *) ws_buffer_start_ptr(wblock->frame_buffer);
+    char *buf_ptr = (char *) ws_buffer_start_ptr(wblock->frame_buffer) + data_offset;
     while (entry_length > 0 && buf_ptr[entry_length-1] == '\0') {
         entry_length--;
     }
@@ -3392,9 +3404,33 @@ pcapng_read_unknown_block(FILE_T fh, pcapng_block_header_t *bh,
     if (block_handlers != NULL &&
         (handler = (block_handler *)g_hash_table_lookup(block_handlers,
                                                         GUINT_TO_POINTER(bh->block_type))) != NULL) {
-        /* Yes - call it to read this block type. */
-        if (!handler->reader(fh, block_read, section_info->byte_swapped, wblock,
-                             err, err_info))
+        Buffer *frame_buffer = wblock->frame_buffer;
+        Buffer handler_buffer;
+        bool ret;
+
+        /*
+         * Yes - call it to read this block type.
+         *
+         * Handlers put the block's data at the start of the buffer;
+         * if the buffer already holds other records, as it does when
+         * reading a batch, give the handler a buffer of its own and
+         * append the data to ours afterwards.
+         */
+        if (ws_buffer_length(frame_buffer) != 0) {
+            ws_buffer_init(&handler_buffer, block_read);
+            wblock->frame_buffer = &handler_buffer;
+        }
+        ret = handler->reader(fh, block_read, section_info->byte_swapped,
+                              wblock, err, err_info);
+        if (wblock->frame_buffer != frame_buffer) {
+            if (ret && !wblock->internal)
+                ws_buffer_append(frame_buffer,
+                                 ws_buffer_start_ptr(&handler_buffer),
+                                 MAX(ws_buffer_length(&handler_buffer), block_read));
+            ws_buffer_free(&handler_buffer);
+            wblock->frame_buffer = frame_buffer;
+        }
+        if (!ret)
             return false;
     } else
 #endif
@@ -4030,6 +4066,7 @@ pcapng_open(wtap *wth, int *err, char **err_info)
     g_array_append_val(pcapng->sections, first_section);
 
     wth->subtype_read = pcapng_read;
+    wth->subtype_read_batch = pcapng_read_batch;
     wth->subtype_seek_read = pcapng_seek_read;
     wth->subtype_close = pcapng_close;
     wth->file_type_subtype = pcapng_file_type_subtype;
@@ -4180,6 +4217,22 @@ pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
     return true;
 }
 
+/* read packets, appending their data to the batch's buffer */
+static bool
+pcapng_read_batch(wtap *wth, wtap_rec_batch *batch, int *err,
+                  char **err_info)
+{
+    wtap_rec *rec;
+
+    while ((rec = wtap_rec_batch_next(wth, batch)) != NULL) {
+        if (!pcapng_read(wth, rec, &batch->buf, err, err_info,
+                         &batch->offsets[batch->num_recs]))
+            return false;
+        batch->num_recs++;
+    }
+    return true;
+}
+
 /* classic wtap: seek to file position and read packet */
 static bool
 pcapng_seek_read(wtap *wth, int64_t seek_off,
@@ -30,6 +30,8 @@ typedef bool (*subtype_read_func)(struct wtap*, wtap_rec *,
                                       Buffer *, int *, char **, int64_t *);
 typedef bool (*subtype_seek_read_func)(struct wtap*, int64_t, wtap_rec *,
                                            Buffer *, int *, char **);
+typedef bool (*subtype_read_batch_func)(struct wtap*, wtap_rec_batch *,
+                                            int *, char **);
 
 /**
  * Struct holding data of the currently read file.
@@ -55,6 +57,7 @@ struct wtap {
 
     subtype_read_func           subtype_read;
     subtype_seek_read_func      subtype_seek_read;
+    subtype_read_batch_func     subtype_read_batch;     /**< NULL if records are read one at a time */
     void                        (*subtype_sequential_close)(struct wtap*);
     void                        (*subtype_close)(struct wtap*);
     int                         file_encap;    /* per-file, for those
@@ -77,6 +80,9 @@ struct wtap {
     wtap_new_ipv6_callback_t    add_new_ipv6;
     wtap_new_secrets_callback_t add_new_secrets;
     GPtrArray                   *fast_seek;
+    int                         batch_err;              /**< Error or EOF that ended the last batch early */
+    char                        *batch_err_info;
+    bool                        batch_ended;            /**< true if batch_err is to be reported */
 };
 
 struct wtap_dumper;
@@ -326,6 +332,16 @@ bool
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, unsigned length, int *err,
     char **err_info);
 
+/*
+ * For subtype_read_batch routines: return the next record of the batch,
+ * initialized as for wtap_read(), or NULL if the batch is full. The
+ * routine must set batch->offsets[batch->num_recs], append the record's
+ * data to batch->buf or point batch->data[batch->num_recs] to data that
+ * lives until the file is closed, and then increment batch->num_recs.
+ */
+wtap_rec *
+wtap_rec_batch_next(wtap *wth, wtap_rec_batch *batch);
+
 /*
  * Implementation of wth->subtype_read that reads the full file contents
  * as a single packet.
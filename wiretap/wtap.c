@@ -1577,6 +1577,7 @@ wtap_close(wtap *wth)
 	g_free(wth->priv);
 
 	g_free(wth->pathname);
+	g_free(wth->batch_err_info);
 
 	if (wth->fast_seek != NULL) {
 		g_ptr_array_foreach(wth->fast_seek, g_fast_seek_item_free, NULL);
@@ -1776,6 +1777,197 @@ wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 	return true;	/* success */
 }
 
+void
+wtap_rec_batch_init(wtap_rec_batch *batch, unsigned max_recs, size_t max_bytes)
+{
+	ws_assert(max_recs > 0);
+
+	batch->max_recs = max_recs;
+	batch->max_bytes = max_bytes;
+	batch->num_recs = 0;
+	batch->recs = g_new(wtap_rec, max_recs);
+	for (unsigned i = 0; i < max_recs; i++)
+		wtap_rec_init(&batch->recs[i]);
+	batch->offsets = g_new(int64_t, max_recs);
+	batch->data = g_new(const uint8_t *, max_recs);
+	batch->data_offsets = g_new(size_t, max_recs);
+	ws_buffer_init(&batch->buf, max_bytes + WTAP_MAX_PACKET_SIZE_STANDARD);
+	ws_buffer_init(&batch->scratch, 0);
+}
+
+void
+wtap_rec_batch_cleanup(wtap_rec_batch *batch)
+{
+	for (unsigned i = 0; i < batch->max_recs; i++)
+		wtap_rec_cleanup(&batch->recs[i]);
+	g_free(batch->recs);
+	g_free(batch->offsets);
+	g_free(batch->data);
+	g_free(batch->data_offsets);
+	ws_buffer_free(&batch->buf);
+	ws_buffer_free(&batch->scratch);
+	batch->recs = NULL;
+	batch->offsets = NULL;
+	batch->data_offsets = NULL;
+	batch->num_recs = 0;
+}
+
+wtap_rec *
+wtap_rec_batch_next(wtap *wth, wtap_rec_batch *batch)
+{
+	wtap_rec *rec;
+
+	if (batch->num_recs == batch->max_recs ||
+	    ws_buffer_length(&batch->buf) >= batch->max_bytes)
+		return NULL;
+
+	rec = &batch->recs[batch->num_recs];
+	wtap_init_rec(wth, rec);
+	batch->data[batch->num_recs] = NULL;
+	batch->data_offsets[batch->num_recs] = ws_buffer_length(&batch->buf);
+	return rec;
+}
+
+/*
+ * The length of the data that a read routine read for a record. Read
+ * routines report it in the record's header, as that's the length that
+ * callers of wtap_read() use, whether or not they also set the length of
+ * the buffer; record types without a length there report it as the
+ * length of the buffer.
+ */
+static size_t
+wtap_rec_data_length(const wtap_rec *rec, Buffer *buf)
+{
+	switch (rec->rec_type) {
+
+	case REC_TYPE_PACKET:
+		return rec->rec_header.packet_header.caplen;
+
+	case REC_TYPE_FT_SPECIFIC_EVENT:
+	case REC_TYPE_FT_SPECIFIC_REPORT:
+		return rec->rec_header.ft_specific_header.record_len;
+
+	case REC_TYPE_SYSCALL:
+		return rec->rec_header.syscall_header.event_filelen;
+
+	case REC_TYPE_SYSTEMD_JOURNAL_EXPORT:
+		return rec->rec_header.systemd_journal_export_header.record_len;
+
+	case REC_TYPE_CUSTOM_BLOCK:
+		return rec->rec_header.custom_block_header.length;
+
+	default:
+		return ws_buffer_length(buf);
+	}
+}
+
+/*
+ * Fill a batch with the file type's read routine, copying the data of
+ * each record into the batch's buffer.
+ */
+static bool
+wtap_read_batch_by_record(wtap *wth, wtap_rec_batch *batch, int *err,
+    char **err_info)
+{
+	wtap_rec *rec;
+	size_t length;
+
+	while ((rec = wtap_rec_batch_next(wth, batch)) != NULL) {
+		ws_buffer_clean(&batch->scratch);
+		if (!wth->subtype_read(wth, rec, &batch->scratch, err, err_info,
+		    &batch->offsets[batch->num_recs]))
+			return false;
+
+		length = wtap_rec_data_length(rec, &batch->scratch);
+		if (length > batch->scratch.allocated - batch->scratch.start) {
+			/*
+			 * The read routine reported more data than it
+			 * put in the buffer.
+			 */
+			*err = WTAP_ERR_INTERNAL;
+			*err_info = ws_strdup_printf("%s: record has %zu bytes of data, but only %zu were read",
+			    wtap_file_type_subtype_name(wth->file_type_subtype),
+			    length, batch->scratch.allocated - batch->scratch.start);
+			return false;
+		}
+		ws_buffer_append(&batch->buf, ws_buffer_start_ptr(&batch->scratch),
+		    length);
+		batch->num_recs++;
+	}
+	return true;
+}
+
+bool
+wtap_read_batch(wtap *wth, wtap_rec_batch *batch, int *err, char **err_info)
+{
+	bool ok;
+
+	/*
+	 * Unreference the blocks of the last batch's records.
+	 */
+	for (unsigned i = 0; i < batch->num_recs; i++)
+		wtap_rec_reset(&batch->recs[i]);
+	batch->num_recs = 0;
+	ws_buffer_clean(&batch->buf);
+
+	if (wth->batch_ended) {
+		/*
+		 * The last batch was cut short; report why.
+		 */
+		*err = wth->batch_err;
+		*err_info = wth->batch_err_info;
+		wth->batch_err_info = NULL;
+		wth->batch_ended = false;
+		return false;
+	}
+
+	*err = 0;
+	*err_info = NULL;
+	if (wth->subtype_read_batch != NULL)
+		ok = wth->subtype_read_batch(wth, batch, err, err_info);
+	else
+		ok = wtap_read_batch_by_record(wth, batch, err, err_info);
+
+	if (!ok) {
+		/*
+		 * As in wtap_read(), check for a deferred error, and
+		 * unreference any block created for the record we
+		 * failed to read.
+		 */
+		if (*err == 0)
+			*err = file_error(wth->fh, err_info);
+		wtap_rec_reset(&batch->recs[batch->num_recs]);
+
+		if (batch->num_recs == 0)
+			return false;	/* failure */
+
+		/*
+		 * Return the records we did read, and report the error
+		 * or EOF on the next call.
+		 */
+		wth->batch_err = *err;
+		wth->batch_err_info = *err_info;
+		wth->batch_ended = true;
+		*err = 0;
+		*err_info = NULL;
+	}
+
+	for (unsigned i = 0; i < batch->num_recs; i++) {
+		/*
+		 * Point to the data of the records read into the buffer,
+		 * now that it's done moving.
+		 */
+		if (batch->data[i] == NULL)
+			batch->data[i] = ws_buffer_start_ptr(&batch->buf) + batch->data_offsets[i];
+		if (batch->recs[i].rec_type == REC_TYPE_PACKET) {
+			ws_assert(batch->recs[i].rec_header.packet_header.pkt_encap != WTAP_ENCAP_PER_PACKET);
+			ws_assert(batch->recs[i].rec_header.packet_header.pkt_encap != WTAP_ENCAP_NONE);
+		}
+	}
+
+	return true;	/* success */
+}
+
 /*
  * Read a given number of bytes from a file into a buffer or, if
  * buf is NULL, just discard them.
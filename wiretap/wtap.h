@@ -1910,6 +1910,65 @@ WS_DLL_PUBLIC
 bool wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
     char **err_info, int64_t *offset);
 
+/**
+ * A batch of records read by wtap_read_batch(), with the data of all
+ * of them in one buffer.
+ */
+typedef struct wtap_rec_batch {
+    unsigned    max_recs;       /**< Maximum number of records in a batch */
+    size_t      max_bytes;      /**< Stop adding records once this much data has been read */
+    unsigned    num_recs;       /**< Number of records read by the last wtap_read_batch() */
+    wtap_rec   *recs;           /**< The records */
+    int64_t    *offsets;        /**< For each record, the offset to pass to wtap_seek_read() */
+    const uint8_t **data;       /**< For each record, its data */
+    size_t     *data_offsets;   /**< For each record read into buf, the offset of its data there */
+    Buffer      buf;            /**< The data of the records, one after the other */
+    Buffer      scratch;        /**< Private; for file types without a batch read routine */
+} wtap_rec_batch;
+
+/**
+ * Initialize a batch of records for wtap_read_batch().
+ *
+ * @param batch The batch.
+ * @param max_recs The most records to read at a time.
+ * @param max_bytes Stop adding records to a batch once it holds this much
+ * data, even if it has fewer than max_recs records.
+ */
+WS_DLL_PUBLIC
+void wtap_rec_batch_init(wtap_rec_batch *batch, unsigned max_recs, size_t max_bytes);
+
+/** Free the records and buffers of a batch. */
+WS_DLL_PUBLIC
+void wtap_rec_batch_cleanup(wtap_rec_batch *batch);
+
+/** Read up to batch->max_recs records from the file into batch, replacing
+ * the records of the previous batch.
+ *
+ * The data of the record batch->recs[i] is at batch->data[i], which
+ * remains valid until the next call or until the file is closed. This
+ * saves the per-record overhead of wtap_read() for callers that go through
+ * many records quickly; pcap and pcapng files are read directly into the
+ * batch, other file types a record at a time. For uncompressed pcap files
+ * that are memory-mapped, batch->data[i] points into the mapping, and the
+ * data isn't copied at all.
+ *
+ * If a read error or the end of the file is reached after at least one
+ * record has been read, the records read so far are returned and the error
+ * or end of file is reported by the next call.
+ *
+ * @param wth a wtap * returned by a call that opened a file for reading.
+ * @param batch a batch initialized with wtap_rec_batch_init().
+ * @param err a positive "errno" value, or a negative number indicating
+ * the type of error, if the read failed; 0 at the end of the file.
+ * @param err_info for some errors, a string giving more details of
+ * the error
+ * @return true if at least one record was read, false on failure or at the
+ * end of the file.
+ */
+WS_DLL_PUBLIC
+bool wtap_read_batch(wtap *wth, wtap_rec_batch *batch, int *err,
+    char **err_info);
+
 /** Read the record at a specified offset in a capture file, filling in
  * *phdr and *buf.
  *
@@ -1960,6 +2019,23 @@ WS_DLL_PUBLIC
 const char *wtap_compression_type_extension(wtap_compression_type compression_type);
 WS_DLL_PUBLIC
 GSList *wtap_get_all_compression_type_extensions_list(void);
+/**
+ * Return true if files with this compression type can be written.
+ */
+WS_DLL_PUBLIC
+bool wtap_can_write_compression_type(wtap_compression_type compression_type);
+/**
+ * Look up a compression type by its name ("gzip", "zstd", "lz4").
+ * Returns WTAP_UNCOMPRESSED if the name is unknown.
+ */
+WS_DLL_PUBLIC
+wtap_compression_type wtap_name_to_compression_type(const char *name);
+/**
+ * Return a list of the names of the compression types that can be
+ * written; free it with g_slist_free(), not the names.
+ */
+WS_DLL_PUBLIC
+GSList *wtap_get_all_output_compression_type_names_list(void);
 
 /*** get various information snippets about the current file ***/
 
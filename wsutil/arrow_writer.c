@@ -0,0 +1,937 @@
+/* arrow_writer.c
+ * Routines for writing tables in the Apache Arrow IPC streaming format.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define WS_LOG_DOMAIN LOG_DOMAIN_WSUTIL
+
+#include <glib.h>
+
+#include "arrow_writer.h"
+#include <string.h>
+
+#include <wsutil/ws_assert.h>
+#include <wsutil/wslog.h>
+
+/*
+ * An Arrow IPC stream is a sequence of messages, each of them a
+ * FlatBuffers-encoded Message table (see Message.fbs and Schema.fbs in the
+ * Arrow format specification) followed by a body holding the buffers it
+ * describes:
+ *
+ *   <0xFFFFFFFF> <int32: metadata length> <metadata> <padding> <body>
+ *
+ * The stream starts with a Schema message, then the dictionaries of the
+ * dictionary-encoded columns, then record batches, each preceded by the
+ * dictionary entries added since the last one, and ends with a zero length.
+ * Everything is little endian and aligned to 8 bytes.
+ */
+
+#define ARROW_CONTINUATION      0xFFFFFFFFU
+#define ARROW_ALIGN             8
+
+/* MetadataVersion */
+#define ARROW_METADATA_V5       4
+
+/* MessageHeader union */
+#define ARROW_MSG_SCHEMA            1
+#define ARROW_MSG_DICTIONARY_BATCH  2
+#define ARROW_MSG_RECORD_BATCH      3
+
+/* Type union */
+#define ARROW_TYPE_INT              2
+#define ARROW_TYPE_FLOATING_POINT   3
+#define ARROW_TYPE_UTF8             5
+#define ARROW_TYPE_BOOL             6
+#define ARROW_TYPE_TIMESTAMP        10
+#define ARROW_TYPE_LIST             12
+#define ARROW_TYPE_FIXED_SIZE_BINARY 15
+#define ARROW_TYPE_DURATION         18
+
+#define ARROW_PRECISION_DOUBLE      2
+#define ARROW_TIME_UNIT_NANOSECOND  3
+
+/* Start a dictionary over once it has this many entries, so that memory
+   use stays bounded with columns of unique strings. */
+#define ARROW_DICT_MAX_LEN          (1 << 20)
+
+/*
+ * A minimal FlatBuffers builder. As in the reference implementation, the
+ * buffer is built back to front, so that objects are written before the
+ * objects referring to them, and offsets, which are unsigned, point
+ * forward. Objects are identified by their distance from the end.
+ */
+#define FB_MAX_FIELDS   8
+
+typedef struct {
+    uint8_t *buf;
+    size_t   cap;
+    size_t   len;       /* bytes in use, at the end of buf */
+    size_t   minalign;
+    size_t   table_start;
+    uint32_t fields[FB_MAX_FIELDS];
+    unsigned nfields;
+} fb_builder;
+
+static void
+fb_init(fb_builder *b)
+{
+    memset(b, 0, sizeof(*b));
+    b->cap = 1024;
+    b->buf = (uint8_t *)g_malloc(b->cap);
+    b->minalign = 1;
+}
+
+static void
+fb_free(fb_builder *b)
+{
+    g_free(b->buf);
+}
+
+static const uint8_t *
+fb_data(fb_builder *b)
+{
+    return b->buf + b->cap - b->len;
+}
+
+static uint8_t *
+fb_alloc(fb_builder *b, size_t n)
+{
+    if (b->cap - b->len < n) {
+        size_t cap = b->cap;
+        uint8_t *buf;
+
+        while (cap - b->len < n) {
+            cap *= 2;
+        }
+        buf = (uint8_t *)g_malloc(cap);
+        memcpy(buf + cap - b->len, fb_data(b), b->len);
+        g_free(b->buf);
+        b->buf = buf;
+        b->cap = cap;
+    }
+    b->len += n;
+    return b->buf + b->cap - b->len;
+}
+
+static void
+fb_put(fb_builder *b, const void *data, size_t n)
+{
+    memcpy(fb_alloc(b, n), data, n);
+}
+
+/* Pad so that the len bytes after the next "extra" ones are aligned. */
+static void
+fb_prep(fb_builder *b, size_t align, size_t extra)
+{
+    size_t pad = (align - ((b->len + extra) % align)) % align;
+
+    if (align > b->minalign) {
+        b->minalign = align;
+    }
+    memset(fb_alloc(b, pad), 0, pad);
+}
+
+static void
+fb_put_u8(fb_builder *b, uint8_t value)
+{
+    fb_put(b, &value, 1);
+}
+
+static void
+fb_put_u16(fb_builder *b, uint16_t value)
+{
+    fb_prep(b, 2, 0);
+    value = GUINT16_TO_LE(value);
+    fb_put(b, &value, 2);
+}
+
+static void
+fb_put_u32(fb_builder *b, uint32_t value)
+{
+    fb_prep(b, 4, 0);
+    value = GUINT32_TO_LE(value);
+    fb_put(b, &value, 4);
+}
+
+static void
+fb_put_i64(fb_builder *b, int64_t value)
+{
+    uint64_t le = GUINT64_TO_LE((uint64_t)value);
+
+    fb_prep(b, 8, 0);
+    fb_put(b, &le, 8);
+}
+
+/* A reference to the object at off. */
+static void
+fb_put_offset(fb_builder *b, uint32_t off)
+{
+    fb_prep(b, 4, 0);
+    fb_put_u32(b, (uint32_t)(b->len + 4 - off));
+}
+
+static uint32_t
+fb_string(fb_builder *b, const char *str)
+{
+    size_t n = strlen(str);
+
+    fb_prep(b, 4, n + 1);
+    fb_put_u8(b, 0);
+    fb_put(b, str, n);
+    fb_put_u32(b, (uint32_t)n);
+    return (uint32_t)b->len;
+}
+
+/* Vectors: start, put the elements last to first, then end. */
+static void
+fb_start_vector(fb_builder *b, size_t elem_size, size_t n, size_t align)
+{
+    fb_prep(b, 4, elem_size * n);
+    fb_prep(b, align, elem_size * n);
+}
+
+static uint32_t
+fb_end_vector(fb_builder *b, size_t n)
+{
+    fb_put_u32(b, (uint32_t)n);
+    return (uint32_t)b->len;
+}
+
+static uint32_t
+fb_offset_vector(fb_builder *b, const uint32_t *offs, size_t n)
+{
+    fb_start_vector(b, 4, n, 4);
+    for (size_t i = n; i > 0; i--) {
+        fb_put_offset(b, offs[i - 1]);
+    }
+    return fb_end_vector(b, n);
+}
+
+/* A vector of structs of two longs, e.g. FieldNode or Buffer. */
+static uint32_t
+fb_pair_vector(fb_builder *b, const int64_t *pairs, size_t n)
+{
+    fb_start_vector(b, 16, n, 8);
+    for (size_t i = n; i > 0; i--) {
+        fb_put_i64(b, pairs[2 * i - 1]);
+        fb_put_i64(b, pairs[2 * i - 2]);
+    }
+    return fb_end_vector(b, n);
+}
+
+/* Tables: start, add the fields by id, then end. Tables can't be nested;
+   their strings, vectors and subtables must be built first. */
+static void
+fb_start_table(fb_builder *b)
+{
+    memset(b->fields, 0, sizeof(b->fields));
+    b->nfields = 0;
+    b->table_start = b->len;
+}
+
+static void
+fb_field_added(fb_builder *b, unsigned id)
+{
+    ws_assert(id < FB_MAX_FIELDS);
+    b->fields[id] = (uint32_t)b->len;
+    if (id >= b->nfields) {
+        b->nfields = id + 1;
+    }
+}
+
+static void
+fb_add_u8(fb_builder *b, unsigned id, uint8_t value)
+{
+    fb_put_u8(b, value);
+    fb_field_added(b, id);
+}
+
+static void
+fb_add_u16(fb_builder *b, unsigned id, uint16_t value)
+{
+    fb_put_u16(b, value);
+    fb_field_added(b, id);
+}
+
+static void
+fb_add_i32(fb_builder *b, unsigned id, int32_t value)
+{
+    fb_put_u32(b, (uint32_t)value);
+    fb_field_added(b, id);
+}
+
+static void
+fb_add_i64(fb_builder *b, unsigned id, int64_t value)
+{
+    fb_put_i64(b, value);
+    fb_field_added(b, id);
+}
+
+static void
+fb_add_offset(fb_builder *b, unsigned id, uint32_t off)
+{
+    fb_put_offset(b, off);
+    fb_field_added(b, id);
+}
+
+static uint32_t
+fb_end_table(fb_builder *b)
+{
+    uint32_t table, vtable;
+    int32_t soffset;
+
+    /* The table starts with a signed offset back to its vtable, which
+       lists where each field is relative to the table. */
+    fb_put_u32(b, 0);
+    table = (uint32_t)b->len;
+    for (unsigned i = b->nfields; i > 0; i--) {
+        fb_put_u16(b, b->fields[i - 1] ? (uint16_t)(table - b->fields[i - 1]) : 0);
+    }
+    fb_put_u16(b, (uint16_t)(table - b->table_start));
+    fb_put_u16(b, (uint16_t)(4 + 2 * b->nfields));
+    vtable = (uint32_t)b->len;
+
+    soffset = GINT32_TO_LE((int32_t)(vtable - table));
+    memcpy(b->buf + b->cap - table, &soffset, 4);
+    return table;
+}
+
+static void
+fb_finish(fb_builder *b, uint32_t root)
+{
+    fb_prep(b, b->minalign > 4 ? b->minalign : 4, 4);
+    fb_put_offset(b, root);
+}
+
+/* **********************************************************************
+ * Columns
+ * ********************************************************************** */
+
+typedef struct {
+    char       *name;
+    arrow_type  type;
+    unsigned    width;      /* bytes per value; dictionary indices for strings */
+    bool        list;
+    unsigned    row_values; /* values appended in the current row */
+    unsigned    null_count;
+    GByteArray *valid;      /* one byte per row */
+    GArray     *offsets;    /* list columns: int32 offset of each row's values */
+    GByteArray *values;
+    /* ARROW_STRING */
+    int64_t     dict_id;
+    GHashTable *dict;       /* string -> index + 1 */
+    unsigned    dict_len;
+    unsigned    dict_written;   /* entries sent to the reader */
+    GArray     *dict_offsets;   /* int32 offsets of the unsent entries */
+    GByteArray *dict_data;
+} arrow_column;
+
+struct arrow_writer {
+    FILE      *fh;
+    unsigned   batch_rows;
+    unsigned   rows;        /* rows in the current batch */
+    GPtrArray *columns;
+    bool       started;     /* schema written */
+    bool       error;
+};
+
+static void
+arrow_column_free(gpointer data)
+{
+    arrow_column *col = (arrow_column *)data;
+
+    g_free(col->name);
+    g_byte_array_free(col->valid, TRUE);
+    if (col->offsets) {
+        g_array_free(col->offsets, TRUE);
+    }
+    g_byte_array_free(col->values, TRUE);
+    if (col->dict) {
+        g_hash_table_destroy(col->dict);
+        g_array_free(col->dict_offsets, TRUE);
+        g_byte_array_free(col->dict_data, TRUE);
+    }
+    g_free(col);
+}
+
+arrow_writer *
+arrow_writer_new(FILE *fh, unsigned batch_rows)
+{
+    arrow_writer *writer = g_new0(arrow_writer, 1);
+
+    writer->fh = fh;
+    writer->batch_rows = batch_rows ? batch_rows : ARROW_WRITER_BATCH_ROWS;
+    writer->columns = g_ptr_array_new_with_free_func(arrow_column_free);
+    return writer;
+}
+
+static void
+arrow_column_reset_offsets(arrow_column *col)
+{
+    int32_t zero = 0;
+
+    g_array_set_size(col->offsets, 0);
+    g_array_append_val(col->offsets, zero);
+}
+
+unsigned
+arrow_writer_add_column(arrow_writer *writer, const char *name, arrow_type type,
+                        unsigned byte_width, bool list)
+{
+    arrow_column *col;
+    int32_t zero = 0;
+
+    ws_assert(!writer->started && writer->rows == 0);
+
+    col = g_new0(arrow_column, 1);
+    col->name = g_strdup(name);
+    col->type = type;
+    col->list = list;
+    switch (type) {
+    case ARROW_INT8:
+    case ARROW_UINT8:
+    case ARROW_BOOL:
+        col->width = 1;
+        break;
+    case ARROW_INT16:
+    case ARROW_UINT16:
+        col->width = 2;
+        break;
+    case ARROW_INT32:
+    case ARROW_UINT32:
+    case ARROW_STRING:
+        col->width = 4;
+        break;
+    case ARROW_INT64:
+    case ARROW_UINT64:
+    case ARROW_DOUBLE:
+    case ARROW_TIMESTAMP:
+    case ARROW_DURATION:
+        col->width = 8;
+        break;
+    case ARROW_FIXED_BINARY:
+        ws_assert(byte_width > 0);
+        col->width = byte_width;
+        break;
+    }
+    col->valid = g_byte_array_new();
+    col->values = g_byte_array_new();
+    if (list) {
+        col->offsets = g_array_new(FALSE, FALSE, sizeof(int32_t));
+        arrow_column_reset_offsets(col);
+    }
+    if (type == ARROW_STRING) {
+        col->dict_id = writer->columns->len;
+        col->dict = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        col->dict_offsets = g_array_new(FALSE, FALSE, sizeof(int32_t));
+        col->dict_data = g_byte_array_new();
+        g_array_append_val(col->dict_offsets, zero);
+    }
+    g_ptr_array_add(writer->columns, col);
+    return writer->columns->len - 1;
+}
+
+/* Append a value of the column's width, given in little endian. */
+static void
+arrow_column_append(arrow_writer *writer, unsigned column, const void *value)
+{
+    arrow_column *col;
+
+    ws_assert(column < writer->columns->len);
+    col = (arrow_column *)g_ptr_array_index(writer->columns, column);
+    if (!col->list && col->row_values > 0) {
+        return;
+    }
+    g_byte_array_append(col->values, (const uint8_t *)value, col->width);
+    col->row_values++;
+}
+
+void
+arrow_writer_append_int(arrow_writer *writer, unsigned column, int64_t value)
+{
+    arrow_writer_append_uint(writer, column, (uint64_t)value);
+}
+
+void
+arrow_writer_append_uint(arrow_writer *writer, unsigned column, uint64_t value)
+{
+    arrow_column *col = (arrow_column *)g_ptr_array_index(writer->columns, column);
+
+    ws_assert(col->width <= 8 && col->type != ARROW_STRING);
+    if (col->type == ARROW_BOOL) {
+        value = value != 0;
+    }
+    /* Little endian, so the low-order bytes come first whatever the width. */
+    value = GUINT64_TO_LE(value);
+    arrow_column_append(writer, column, &value);
+}
+
+void
+arrow_writer_append_double(arrow_writer *writer, unsigned column, double value)
+{
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    bits = GUINT64_TO_LE(bits);
+    arrow_column_append(writer, column, &bits);
+}
+
+void
+arrow_writer_append_bytes(arrow_writer *writer, unsigned column, const uint8_t *bytes)
+{
+    arrow_column_append(writer, column, bytes);
+}
+
+void
+arrow_writer_append_string(arrow_writer *writer, unsigned column, const char *value)
+{
+    arrow_column *col = (arrow_column *)g_ptr_array_index(writer->columns, column);
+    gpointer index;
+    uint32_t le;
+
+    ws_assert(col->type == ARROW_STRING);
+    if (!col->list && col->row_values > 0) {
+        return;
+    }
+    index = g_hash_table_lookup(col->dict, value);
+    if (!index) {
+        int32_t end;
+
+        index = GUINT_TO_POINTER(++col->dict_len);
+        g_hash_table_insert(col->dict, g_strdup(value), index);
+        g_byte_array_append(col->dict_data, (const uint8_t *)value, (unsigned)strlen(value));
+        end = GINT32_TO_LE((int32_t)col->dict_data->len);
+        g_array_append_val(col->dict_offsets, end);
+    }
+    le = GUINT32_TO_LE(GPOINTER_TO_UINT(index) - 1);
+    arrow_column_append(writer, column, &le);
+}
+
+/* **********************************************************************
+ * Messages
+ * ********************************************************************** */
+
+static void
+arrow_write(arrow_writer *writer, const void *data, size_t n)
+{
+    if (n > 0 && fwrite(data, 1, n, writer->fh) != n) {
+        writer->error = true;
+    }
+}
+
+static void
+arrow_write_message(arrow_writer *writer, fb_builder *b, const GByteArray *body)
+{
+    static const uint8_t zeroes[ARROW_ALIGN];
+    uint32_t prefix[2];
+    size_t pad = (ARROW_ALIGN - b->len % ARROW_ALIGN) % ARROW_ALIGN;
+
+    prefix[0] = GUINT32_TO_LE(ARROW_CONTINUATION);
+    prefix[1] = GUINT32_TO_LE((uint32_t)(b->len + pad));
+    arrow_write(writer, prefix, sizeof(prefix));
+    arrow_write(writer, fb_data(b), b->len);
+    arrow_write(writer, zeroes, pad);
+    if (body) {
+        arrow_write(writer, body->data, body->len);
+    }
+}
+
+static uint32_t
+arrow_message(fb_builder *b, uint8_t header_type, uint32_t header, int64_t body_len)
+{
+    fb_start_table(b);
+    fb_add_i64(b, 3, body_len);            /* bodyLength */
+    fb_add_offset(b, 2, header);           /* header */
+    fb_add_u16(b, 0, ARROW_METADATA_V5);   /* version */
+    fb_add_u8(b, 1, header_type);          /* header_type */
+    return fb_end_table(b);
+}
+
+static uint32_t
+arrow_int_type(fb_builder *b, int32_t bit_width, bool is_signed)
+{
+    fb_start_table(b);
+    fb_add_i32(b, 0, bit_width);
+    fb_add_u8(b, 1, is_signed);
+    return fb_end_table(b);
+}
+
+/* The type of the values of a column, as a table of the Type union. */
+static uint32_t
+arrow_value_type(fb_builder *b, const arrow_column *col, uint8_t *type_type)
+{
+    uint32_t tz;
+
+    switch (col->type) {
+    case ARROW_INT8:
+    case ARROW_INT16:
+    case ARROW_INT32:
+    case ARROW_INT64:
+        *type_type = ARROW_TYPE_INT;
+        return arrow_int_type(b, 8 * col->width, true);
+    case ARROW_UINT8:
+    case ARROW_UINT16:
+    case ARROW_UINT32:
+    case ARROW_UINT64:
+        *type_type = ARROW_TYPE_INT;
+        return arrow_int_type(b, 8 * col->width, false);
+    case ARROW_BOOL:
+        *type_type = ARROW_TYPE_BOOL;
+        fb_start_table(b);
+        return fb_end_table(b);
+    case ARROW_DOUBLE:
+        *type_type = ARROW_TYPE_FLOATING_POINT;
+        fb_start_table(b);
+        fb_add_u16(b, 0, ARROW_PRECISION_DOUBLE);
+        return fb_end_table(b);
+    case ARROW_TIMESTAMP:
+        *type_type = ARROW_TYPE_TIMESTAMP;
+        tz = fb_string(b, "UTC");
+        fb_start_table(b);
+        fb_add_offset(b, 1, tz);
+        fb_add_u16(b, 0, ARROW_TIME_UNIT_NANOSECOND);
+        return fb_end_table(b);
+    case ARROW_DURATION:
+        *type_type = ARROW_TYPE_DURATION;
+        fb_start_table(b);
+        fb_add_u16(b, 0, ARROW_TIME_UNIT_NANOSECOND);
+        return fb_end_table(b);
+    case ARROW_FIXED_BINARY:
+        *type_type = ARROW_TYPE_FIXED_SIZE_BINARY;
+        fb_start_table(b);
+        fb_add_i32(b, 0, (int32_t)col->width);
+        return fb_end_table(b);
+    case ARROW_STRING:
+        *type_type = ARROW_TYPE_UTF8;
+        fb_start_table(b);
+        return fb_end_table(b);
+    }
+    ws_assert_not_reached();
+    return 0;
+}
+
+static uint32_t
+arrow_field(fb_builder *b, const char *name, uint8_t type_type, uint32_t type,
+            uint32_t dictionary, const uint32_t *children, size_t nchildren)
+{
+    uint32_t name_off, children_off;
+
+    children_off = fb_offset_vector(b, children, nchildren);
+    name_off = fb_string(b, name);
+    fb_start_table(b);
+    fb_add_offset(b, 0, name_off);          /* name */
+    fb_add_offset(b, 3, type);              /* type */
+    if (dictionary) {
+        fb_add_offset(b, 4, dictionary);    /* dictionary */
+    }
+    fb_add_offset(b, 5, children_off);      /* children */
+    fb_add_u8(b, 1, true);                  /* nullable */
+    fb_add_u8(b, 2, type_type);             /* type_type */
+    return fb_end_table(b);
+}
+
+static uint32_t
+arrow_column_field(fb_builder *b, const arrow_column *col)
+{
+    uint8_t type_type;
+    uint32_t type, dictionary = 0, field;
+
+    type = arrow_value_type(b, col, &type_type);
+    if (col->type == ARROW_STRING) {
+        uint32_t index_type = arrow_int_type(b, 32, true);
+
+        fb_start_table(b);
+        fb_add_i64(b, 0, col->dict_id);         /* id */
+        fb_add_offset(b, 1, index_type);        /* indexType */
+        dictionary = fb_end_table(b);
+    }
+    if (!col->list) {
+        return arrow_field(b, col->name, type_type, type, dictionary, NULL, 0);
+    }
+
+    field = arrow_field(b, "item", type_type, type, dictionary, NULL, 0);
+    fb_start_table(b);
+    type = fb_end_table(b);
+    return arrow_field(b, col->name, ARROW_TYPE_LIST, type, 0, &field, 1);
+}
+
+static void
+arrow_write_schema(arrow_writer *writer)
+{
+    fb_builder b;
+    uint32_t *fields, fields_off, schema;
+
+    fb_init(&b);
+    fields = g_new(uint32_t, writer->columns->len);
+    for (unsigned i = 0; i < writer->columns->len; i++) {
+        fields[i] = arrow_column_field(&b, (arrow_column *)g_ptr_array_index(writer->columns, i));
+    }
+    fields_off = fb_offset_vector(&b, fields, writer->columns->len);
+    g_free(fields);
+
+    fb_start_table(&b);
+    fb_add_offset(&b, 1, fields_off);       /* fields */
+    fb_add_u16(&b, 0, 0);                   /* endianness: Little */
+    schema = fb_end_table(&b);
+
+    fb_finish(&b, arrow_message(&b, ARROW_MSG_SCHEMA, schema, 0));
+    arrow_write_message(writer, &b, NULL);
+    fb_free(&b);
+    writer->started = true;
+}
+
+/* The buffers and field nodes of a record batch being laid out. */
+typedef struct {
+    GByteArray *body;
+    GArray     *nodes;      /* int64 length, null count */
+    GArray     *buffers;    /* int64 offset, length */
+} arrow_batch;
+
+static void
+arrow_batch_init(arrow_batch *batch)
+{
+    batch->body = g_byte_array_new();
+    batch->nodes = g_array_new(FALSE, FALSE, sizeof(int64_t));
+    batch->buffers = g_array_new(FALSE, FALSE, sizeof(int64_t));
+}
+
+static void
+arrow_batch_free(arrow_batch *batch)
+{
+    g_byte_array_free(batch->body, TRUE);
+    g_array_free(batch->nodes, TRUE);
+    g_array_free(batch->buffers, TRUE);
+}
+
+static void
+arrow_batch_node(arrow_batch *batch, int64_t length, int64_t null_count)
+{
+    g_array_append_val(batch->nodes, length);
+    g_array_append_val(batch->nodes, null_count);
+}
+
+static void
+arrow_batch_buffer(arrow_batch *batch, const uint8_t *data, size_t n)
+{
+    static const uint8_t zeroes[ARROW_ALIGN];
+    int64_t offset = batch->body->len, length = (int64_t)n;
+
+    g_array_append_val(batch->buffers, offset);
+    g_array_append_val(batch->buffers, length);
+    if (n > 0) {
+        g_byte_array_append(batch->body, data, (unsigned)n);
+        g_byte_array_append(batch->body, zeroes, (unsigned)((ARROW_ALIGN - n % ARROW_ALIGN) % ARROW_ALIGN));
+    }
+}
+
+/* Add a buffer of bits from one byte per bit. */
+static void
+arrow_batch_bitmap(arrow_batch *batch, const uint8_t *bytes, size_t n)
+{
+    uint8_t *bits = (uint8_t *)g_malloc0((n + 7) / 8);
+
+    for (size_t i = 0; i < n; i++) {
+        if (bytes[i]) {
+            bits[i / 8] |= 1 << (i % 8);
+        }
+    }
+    arrow_batch_buffer(batch, bits, (n + 7) / 8);
+    g_free(bits);
+}
+
+static uint32_t
+arrow_record_batch(fb_builder *b, const arrow_batch *batch, int64_t length)
+{
+    uint32_t nodes, buffers;
+
+    buffers = fb_pair_vector(b, (const int64_t *)(void *)batch->buffers->data, batch->buffers->len / 2);
+    nodes = fb_pair_vector(b, (const int64_t *)(void *)batch->nodes->data, batch->nodes->len / 2);
+    fb_start_table(b);
+    fb_add_i64(b, 0, length);       /* length */
+    fb_add_offset(b, 1, nodes);     /* nodes */
+    fb_add_offset(b, 2, buffers);   /* buffers */
+    return fb_end_table(b);
+}
+
+static void
+arrow_write_batch_message(arrow_writer *writer, const arrow_batch *batch, int64_t length,
+                          const arrow_column *dict_col)
+{
+    fb_builder b;
+    uint32_t record_batch, header;
+
+    fb_init(&b);
+    record_batch = arrow_record_batch(&b, batch, length);
+    if (dict_col) {
+        fb_start_table(&b);
+        fb_add_i64(&b, 0, dict_col->dict_id);           /* id */
+        fb_add_offset(&b, 1, record_batch);             /* data */
+        fb_add_u8(&b, 2, dict_col->dict_written > 0);   /* isDelta */
+        header = fb_end_table(&b);
+        fb_finish(&b, arrow_message(&b, ARROW_MSG_DICTIONARY_BATCH, header, batch->body->len));
+    } else {
+        fb_finish(&b, arrow_message(&b, ARROW_MSG_RECORD_BATCH, record_batch, batch->body->len));
+    }
+    arrow_write_message(writer, &b, batch->body);
+    fb_free(&b);
+}
+
+/* Send the entries added to the dictionary of a column since the last
+   batch, as a delta unless the dictionary was (re)started. */
+static void
+arrow_write_dictionary(arrow_writer *writer, arrow_column *col, bool first_batch)
+{
+    arrow_batch batch;
+    unsigned n = col->dict_len - col->dict_written;
+    int32_t zero = 0;
+
+    if (n == 0 && !first_batch) {
+        return;
+    }
+
+    arrow_batch_init(&batch);
+    arrow_batch_node(&batch, n, 0);
+    arrow_batch_buffer(&batch, NULL, 0);
+    arrow_batch_buffer(&batch, (const uint8_t *)col->dict_offsets->data, (n + 1) * sizeof(int32_t));
+    arrow_batch_buffer(&batch, col->dict_data->data, col->dict_data->len);
+    arrow_write_batch_message(writer, &batch, n, col);
+    arrow_batch_free(&batch);
+
+    col->dict_written = col->dict_len;
+    g_array_set_size(col->dict_offsets, 0);
+    g_array_append_val(col->dict_offsets, zero);
+    g_byte_array_set_size(col->dict_data, 0);
+}
+
+static void
+arrow_write_batch(arrow_writer *writer)
+{
+    arrow_batch batch;
+    arrow_column *col;
+    bool first_batch = !writer->started;
+
+    if (!writer->started) {
+        arrow_write_schema(writer);
+    }
+    if (writer->rows == 0) {
+        return;
+    }
+
+    for (unsigned i = 0; i < writer->columns->len; i++) {
+        col = (arrow_column *)g_ptr_array_index(writer->columns, i);
+        if (col->dict) {
+            arrow_write_dictionary(writer, col, first_batch);
+        }
+    }
+
+    arrow_batch_init(&batch);
+    for (unsigned i = 0; i < writer->columns->len; i++) {
+        unsigned nvalues;
+
+        col = (arrow_column *)g_ptr_array_index(writer->columns, i);
+        nvalues = col->values->len / col->width;
+        arrow_batch_node(&batch, writer->rows, col->null_count);
+        if (col->null_count) {
+            arrow_batch_bitmap(&batch, col->valid->data, writer->rows);
+        } else {
+            arrow_batch_buffer(&batch, NULL, 0);
+        }
+        if (col->list) {
+            arrow_batch_buffer(&batch, (const uint8_t *)col->offsets->data, col->offsets->len * sizeof(int32_t));
+            arrow_batch_node(&batch, nvalues, 0);
+            arrow_batch_buffer(&batch, NULL, 0);
+        }
+        if (col->type == ARROW_BOOL) {
+            arrow_batch_bitmap(&batch, col->values->data, nvalues);
+        } else {
+            arrow_batch_buffer(&batch, col->values->data, col->values->len);
+        }
+    }
+    arrow_write_batch_message(writer, &batch, writer->rows, NULL);
+    arrow_batch_free(&batch);
+
+    for (unsigned i = 0; i < writer->columns->len; i++) {
+        col = (arrow_column *)g_ptr_array_index(writer->columns, i);
+        g_byte_array_set_size(col->valid, 0);
+        g_byte_array_set_size(col->values, 0);
+        col->null_count = 0;
+        if (col->list) {
+            arrow_column_reset_offsets(col);
+        }
+        if (col->dict && col->dict_len >= ARROW_DICT_MAX_LEN) {
+            g_hash_table_remove_all(col->dict);
+            col->dict_len = 0;
+            col->dict_written = 0;
+        }
+    }
+    writer->rows = 0;
+}
+
+void
+arrow_writer_end_row(arrow_writer *writer)
+{
+    static const uint8_t zeroes[16];
+    arrow_column *col;
+    uint8_t valid;
+
+    for (unsigned i = 0; i < writer->columns->len; i++) {
+        col = (arrow_column *)g_ptr_array_index(writer->columns, i);
+        valid = col->row_values > 0;
+        if (!valid) {
+            col->null_count++;
+        }
+        g_byte_array_append(col->valid, &valid, 1);
+        if (col->list) {
+            int32_t end = GINT32_TO_LE((int32_t)(col->values->len / col->width));
+
+            g_array_append_val(col->offsets, end);
+        } else if (!valid) {
+            /* Null slots still take up a value. */
+            for (unsigned n = col->width; n > 0; n -= MIN(n, sizeof(zeroes))) {
+                g_byte_array_append(col->values, zeroes, MIN(n, sizeof(zeroes)));
+            }
+        }
+        col->row_values = 0;
+    }
+
+    if (++writer->rows >= writer->batch_rows) {
+        arrow_write_batch(writer);
+    }
+}
+
+bool
+arrow_writer_finish(arrow_writer *writer)
+{
+    static const uint8_t end_of_stream[8] = { 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0 };
+    bool ok;
+
+    arrow_write_batch(writer);
+    arrow_write(writer, end_of_stream, sizeof(end_of_stream));
+    if (fflush(writer->fh) != 0) {
+        writer->error = true;
+    }
+    ok = !writer->error;
+    g_ptr_array_free(writer->columns, TRUE);
+    g_free(writer);
+    return ok;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,121 @@
+/** @file
+ * Routines for writing tables in the Apache Arrow IPC streaming format.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __ARROW_WRITER_H__
+#define __ARROW_WRITER_H__
+
+#include "ws_symbol_export.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Writes rows of typed columns as an Arrow IPC stream
+ * (https://arrow.apache.org/docs/format/Columnar.html#ipc-streaming-format),
+ * without depending on the Arrow libraries. Rows are buffered and written
+ * as a record batch every batch_rows rows.
+ *
+ * Example:
+ *
+ *  arrow_writer *writer = arrow_writer_new(stdout, 0);
+ *  unsigned number = arrow_writer_add_column(writer, "number", ARROW_UINT32, 0, false);
+ *  unsigned names = arrow_writer_add_column(writer, "names", ARROW_STRING, 0, true);
+ *  arrow_writer_append_uint(writer, number, 1);
+ *  arrow_writer_append_string(writer, names, "a");
+ *  arrow_writer_append_string(writer, names, "b");
+ *  arrow_writer_end_row(writer);
+ *  arrow_writer_end_row(writer);   // number and names are null
+ *  arrow_writer_finish(writer);
+ */
+
+typedef enum {
+    ARROW_INT8,
+    ARROW_INT16,
+    ARROW_INT32,
+    ARROW_INT64,
+    ARROW_UINT8,
+    ARROW_UINT16,
+    ARROW_UINT32,
+    ARROW_UINT64,
+    ARROW_BOOL,
+    ARROW_DOUBLE,
+    ARROW_TIMESTAMP,    /**< nanoseconds since the epoch, UTC */
+    ARROW_DURATION,     /**< nanoseconds */
+    ARROW_FIXED_BINARY, /**< byte_width bytes, e.g. an address */
+    ARROW_STRING        /**< UTF-8, dictionary encoded */
+} arrow_type;
+
+typedef struct arrow_writer arrow_writer;
+
+/** Number of rows in a record batch if 0 is passed to arrow_writer_new(). */
+#define ARROW_WRITER_BATCH_ROWS 65536
+
+/**
+ * Create a writer for fh. The stream is only started once columns have
+ * been added and the first batch is written.
+ */
+WS_DLL_PUBLIC arrow_writer *
+arrow_writer_new(FILE *fh, unsigned batch_rows);
+
+/**
+ * Add a column; all columns must be added before the first row is ended.
+ * byte_width is only used for ARROW_FIXED_BINARY. If list is true, each
+ * row of the column holds all the values appended to it in that row,
+ * otherwise only the first one is kept.
+ *
+ * @return the number of the column, for the append functions.
+ */
+WS_DLL_PUBLIC unsigned
+arrow_writer_add_column(arrow_writer *writer, const char *name, arrow_type type,
+                        unsigned byte_width, bool list);
+
+/** Append to an integer, boolean, timestamp or duration column. */
+WS_DLL_PUBLIC void
+arrow_writer_append_int(arrow_writer *writer, unsigned column, int64_t value);
+
+/** Append to an integer, boolean, timestamp or duration column. */
+WS_DLL_PUBLIC void
+arrow_writer_append_uint(arrow_writer *writer, unsigned column, uint64_t value);
+
+WS_DLL_PUBLIC void
+arrow_writer_append_double(arrow_writer *writer, unsigned column, double value);
+
+/** Append byte_width bytes to an ARROW_FIXED_BINARY column. */
+WS_DLL_PUBLIC void
+arrow_writer_append_bytes(arrow_writer *writer, unsigned column, const uint8_t *bytes);
+
+WS_DLL_PUBLIC void
+arrow_writer_append_string(arrow_writer *writer, unsigned column, const char *value);
+
+/**
+ * End the current row. Columns nothing was appended to in the row are
+ * null in it.
+ */
+WS_DLL_PUBLIC void
+arrow_writer_end_row(arrow_writer *writer);
+
+/**
+ * Write the remaining rows and the end of the stream, and free the writer.
+ *
+ * @return false if writing to the file failed at any point.
+ */
+WS_DLL_PUBLIC bool
+arrow_writer_finish(arrow_writer *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ARROW_WRITER_H__ */
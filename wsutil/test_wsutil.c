@@ -9,6 +9,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <glib.h>
 #include <wsutil/utf8_entities.h>
 #include <wsutil/time_util.h>
@@ -593,6 +594,185 @@ static void test_int64_to_str_back(void)
     g_assert_cmpstr(str, ==, "9223372036854775807");
 }
 
+#include "ws_mempbrk.h"
+#include "wmem/wmem_strutl.h"
+
+static const uint8_t *
+mempbrk_reference(const uint8_t *haystack, size_t haystacklen, const char *needles)
+{
+    for (size_t i = 0; i < haystacklen; i++) {
+        if (haystack[i] != '\0' && strchr(needles, haystack[i]) != NULL)
+            return haystack + i;
+    }
+    return NULL;
+}
+
+static const uint8_t *
+memmem_reference(const uint8_t *haystack, size_t haystacklen,
+                 const uint8_t *needle, size_t needlelen)
+{
+    for (size_t i = 0; i + needlelen <= haystacklen; i++) {
+        if (memcmp(haystack + i, needle, needlelen) == 0)
+            return haystack + i;
+    }
+    return NULL;
+}
+
+/* Fill buf with bytes that are sometimes, but not often, needles. */
+static void
+fill_haystack(GRand *rng, uint8_t *buf, size_t len)
+{
+    switch (g_rand_int_range(rng, 0, 3)) {
+    case 0:
+        for (size_t i = 0; i < len; i++)
+            buf[i] = (uint8_t)g_rand_int_range(rng, 0, 256);
+        break;
+    case 1:
+        for (size_t i = 0; i < len; i++)
+            buf[i] = (uint8_t)g_rand_int_range(rng, 'a', 'd');
+        break;
+    default:
+        for (size_t i = 0; i < len; i++)
+            buf[i] = g_rand_int_range(rng, 0, 50) ? 'x' : "\r\n\"\x80"[g_rand_int_range(rng, 0, 4)];
+        break;
+    }
+}
+
+static void test_mempbrk(void)
+{
+    /* Few needles, many needles, and needles with the top bit set. */
+    static const char *needles[] = {
+        "\r\n", "\"\\", "a", "\x80\xff\x01 ",
+        "0123456789abcdefghijklmnopqrstuvwxyz", "\xc3\x7f\x8f"
+    };
+    GRand *rng = g_rand_new_with_seed(1);
+    uint8_t buf[300];
+    ws_mempbrk_pattern pattern;
+    unsigned char found;
+
+    for (int i = 0; i < 20000; i++) {
+        size_t len = g_rand_int_range(rng, 1, sizeof buf + 1);
+        size_t off = g_rand_int_range(rng, 0, 8) % len;
+        const char *n = needles[g_rand_int_range(rng, 0, G_N_ELEMENTS(needles))];
+        const uint8_t *want, *have;
+
+        fill_haystack(rng, buf, len);
+        ws_mempbrk_compile(&pattern, n);
+        found = 0;
+        want = mempbrk_reference(buf + off, len - off, n);
+        have = ws_mempbrk_exec(buf + off, len - off, &pattern, &found);
+        g_assert_true(have == want);
+        if (want != NULL)
+            g_assert_cmpuint(found, ==, *want);
+    }
+    g_rand_free(rng);
+}
+
+static void test_memmem(void)
+{
+    GRand *rng = g_rand_new_with_seed(1);
+    uint8_t buf[300];
+    uint8_t needle[8];
+
+    for (int i = 0; i < 20000; i++) {
+        size_t len = g_rand_int_range(rng, 1, sizeof buf + 1);
+        size_t needlelen = g_rand_int_range(rng, 1, sizeof needle + 1);
+
+        fill_haystack(rng, buf, len);
+        if (len > needlelen && g_rand_int_range(rng, 0, 2)) {
+            /* A needle that is in the haystack at least once. */
+            memcpy(needle, buf + g_rand_int_range(rng, 0, (gint32)(len - needlelen)), needlelen);
+        } else {
+            for (size_t j = 0; j < needlelen; j++)
+                needle[j] = buf[g_rand_int_range(rng, 0, (gint32)len)];
+        }
+        g_assert_true(ws_memmem(buf, len, needle, needlelen) ==
+                      memmem_reference(buf, len, needle, needlelen));
+    }
+    g_rand_free(rng);
+}
+
+#define SEARCH_BUF_LEN  (1024 * 1024)
+#define SEARCH_LOOP_COUNT 50
+
+/* 1 MB of 200-byte CRLF-terminated lines, as in a text protocol. */
+static uint8_t *
+make_search_buf(void)
+{
+    uint8_t *buf = (uint8_t *)g_malloc(SEARCH_BUF_LEN);
+
+    for (size_t i = 0; i < SEARCH_BUF_LEN; i++) {
+        if (i % 200 == 198)
+            buf[i] = '\r';
+        else if (i % 200 == 199)
+            buf[i] = '\n';
+        else
+            buf[i] = 'a' + i % 23;
+    }
+    return buf;
+}
+
+static double
+mempbrk_lines(const uint8_t *buf, const ws_mempbrk_pattern *pattern)
+{
+    double start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+    const uint8_t *p, *found;
+
+    RESOURCE_USAGE_START;
+    for (int i = 0; i < SEARCH_LOOP_COUNT; i++) {
+        p = buf;
+        while ((found = ws_mempbrk_exec(p, SEARCH_BUF_LEN - (p - buf), pattern, NULL)) != NULL)
+            p = found + 1;
+    }
+    RESOURCE_USAGE_END;
+    return utime_ms + stime_ms;
+}
+
+static void test_mempbrk_perf(void)
+{
+    uint8_t *buf = make_search_buf();
+    ws_mempbrk_pattern pattern, scalar;
+    double ms;
+
+    ws_mempbrk_compile(&pattern, "\r\n");
+    scalar = pattern;
+#ifdef HAVE_SSE4_2
+    scalar.use_sse42 = false;
+#endif
+#ifdef HAVE_AVX2
+    scalar.use_avx2 = false;
+#endif
+
+    ms = mempbrk_lines(buf, &scalar);
+    g_test_message("ws_mempbrk_exec(), scalar: %.3f ms", ms);
+    ms = mempbrk_lines(buf, &pattern);
+    g_test_minimized_result(ms, "ws_mempbrk_exec(): %.3f ms", ms);
+    g_free(buf);
+}
+
+static void test_memmem_perf(void)
+{
+    uint8_t *buf = make_search_buf();
+    static const char needle[] = "Content-Length";
+    double start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    memcpy(buf + SEARCH_BUF_LEN - 100, needle, strlen(needle));
+
+    RESOURCE_USAGE_START;
+    for (int i = 0; i < SEARCH_LOOP_COUNT; i++)
+        g_assert_nonnull(memmem_reference(buf, SEARCH_BUF_LEN, (const uint8_t *)needle, strlen(needle)));
+    RESOURCE_USAGE_END;
+    g_test_message("memcmp() at each offset: %.3f ms", utime_ms + stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (int i = 0; i < SEARCH_LOOP_COUNT; i++)
+        g_assert_nonnull(ws_memmem(buf, SEARCH_BUF_LEN, needle, strlen(needle)));
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "ws_memmem(): u %.3f ms s %.3f ms", utime_ms, stime_ms);
+    g_free(buf);
+}
+
 #include "nstime.h"
 #include "time_util.h"
 
@@ -663,6 +843,133 @@ void test_nstime_from_iso8601(void)
     g_assert_cmpint(result.nsecs, ==, expect.nsecs);
 }
 
+#include "arrow_writer.h"
+
+/* Just enough of a FlatBuffers reader to check the messages written. */
+static uint32_t fb_read_u32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t fb_read_u64(const uint8_t *p)
+{
+    return fb_read_u32(p) | (uint64_t)fb_read_u32(p + 4) << 32;
+}
+
+/* The object an offset at p points to. */
+static const uint8_t *fb_deref(const uint8_t *p)
+{
+    return p + fb_read_u32(p);
+}
+
+/* A field of the table at p, or NULL if it is absent. */
+static const uint8_t *fb_field(const uint8_t *table, unsigned id)
+{
+    const uint8_t *vtable = table - (int32_t)fb_read_u32(table);
+    unsigned vtable_len = vtable[0] | vtable[1] << 8;
+    unsigned off;
+
+    if (4 + 2 * id >= vtable_len)
+        return NULL;
+    off = vtable[4 + 2 * id] | vtable[5 + 2 * id] << 8;
+    return off ? table + off : NULL;
+}
+
+static void fb_assert_string(const uint8_t *str, const char *expect)
+{
+    g_assert_cmpuint(fb_read_u32(str), ==, strlen(expect));
+    g_assert_cmpmem(str + 4, strlen(expect), expect, strlen(expect));
+}
+
+/* Check the framing of the message at *pos and return its header. */
+static const uint8_t *arrow_next_message(const uint8_t *data, size_t len, size_t *pos,
+                                         unsigned header_type)
+{
+    const uint8_t *meta, *message;
+    uint32_t meta_len;
+
+    g_assert_cmpuint(*pos + 8, <=, len);
+    g_assert_cmpuint(fb_read_u32(data + *pos), ==, 0xFFFFFFFF);
+    meta_len = fb_read_u32(data + *pos + 4);
+    g_assert_cmpuint(meta_len % 8, ==, 0);
+    meta = data + *pos + 8;
+    message = fb_deref(meta);
+    g_assert_cmpuint(fb_read_u32(fb_field(message, 0)) & 0xFFFF, ==, 4);  /* V5 */
+    g_assert_cmpuint(*fb_field(message, 1), ==, header_type);
+    *pos += 8 + meta_len + fb_read_u64(fb_field(message, 3));
+    g_assert_cmpuint(*pos, <=, len);
+    return fb_deref(fb_field(message, 2));
+}
+
+static void test_arrow_writer(void)
+{
+    FILE *fh = tmpfile();
+    arrow_writer *writer;
+    unsigned number, names;
+    const uint8_t *schema, *fields, *field, *type, *child, *header, *batch, *nodes;
+    uint8_t *data;
+    size_t len, pos = 0;
+
+    g_assert_nonnull(fh);
+    writer = arrow_writer_new(fh, 0);
+    number = arrow_writer_add_column(writer, "number", ARROW_UINT32, 0, false);
+    names = arrow_writer_add_column(writer, "names", ARROW_STRING, 0, true);
+    arrow_writer_append_uint(writer, number, 1);
+    arrow_writer_append_string(writer, names, "a");
+    arrow_writer_append_string(writer, names, "b");
+    arrow_writer_end_row(writer);
+    arrow_writer_end_row(writer);
+    g_assert_true(arrow_writer_finish(writer));
+
+    len = (size_t)ftell(fh);
+    data = g_malloc(len);
+    rewind(fh);
+    g_assert_cmpuint(fread(data, 1, len, fh), ==, len);
+    fclose(fh);
+
+    /* Schema: a uint32 and a list of dictionary-encoded strings. */
+    schema = arrow_next_message(data, len, &pos, 1);
+    fields = fb_deref(fb_field(schema, 1));
+    g_assert_cmpuint(fb_read_u32(fields), ==, 2);
+
+    field = fb_deref(fields + 4);
+    fb_assert_string(fb_deref(fb_field(field, 0)), "number");
+    g_assert_cmpuint(*fb_field(field, 2), ==, 2);                 /* Int */
+    type = fb_deref(fb_field(field, 3));
+    g_assert_cmpuint(fb_read_u32(fb_field(type, 0)), ==, 32);
+    g_assert_cmpuint(*fb_field(type, 1), ==, 0);
+
+    field = fb_deref(fields + 8);
+    fb_assert_string(fb_deref(fb_field(field, 0)), "names");
+    g_assert_cmpuint(*fb_field(field, 2), ==, 12);                /* List */
+    g_assert_cmpuint(fb_read_u32(fb_deref(fb_field(field, 5))), ==, 1);
+    child = fb_deref(fb_deref(fb_field(field, 5)) + 4);
+    g_assert_cmpuint(*fb_field(child, 2), ==, 5);                 /* Utf8 */
+    g_assert_cmpuint(fb_read_u64(fb_field(fb_deref(fb_field(child, 4)), 0)), ==, 1);
+
+    /* The dictionary of the second column, not a delta. */
+    header = arrow_next_message(data, len, &pos, 2);
+    g_assert_cmpuint(fb_read_u64(fb_field(header, 0)), ==, 1);
+    g_assert_true(fb_field(header, 2) == NULL || *fb_field(header, 2) == 0);
+    batch = fb_deref(fb_field(header, 1));
+    g_assert_cmpuint(fb_read_u64(fb_field(batch, 0)), ==, 2);
+
+    /* Two rows: three field nodes and six buffers. */
+    batch = arrow_next_message(data, len, &pos, 3);
+    g_assert_cmpuint(fb_read_u64(fb_field(batch, 0)), ==, 2);
+    nodes = fb_deref(fb_field(batch, 1));
+    g_assert_cmpuint(fb_read_u32(nodes), ==, 3);
+    nodes += 4;
+    g_assert_cmpuint(fb_read_u64(nodes), ==, 2);          /* number: length */
+    g_assert_cmpuint(fb_read_u64(nodes + 8), ==, 1);      /* number: nulls */
+    g_assert_cmpuint(fb_read_u64(nodes + 32), ==, 2);     /* names: values */
+    g_assert_cmpuint(fb_read_u32(fb_deref(fb_field(batch, 2))), ==, 6);
+
+    g_assert_cmpuint(len - pos, ==, 8);
+    g_assert_cmpmem(data + pos, 8, "\xff\xff\xff\xff\0\0\0\0", 8);
+    g_free(data);
+}
+
 #include "ws_getopt.h"
 
 #define ARGV_MAX 31
@@ -879,8 +1186,18 @@ int main(int argc, char **argv)
     g_test_add_func("/to_str/int64_to_str_back", test_int64_to_str_back);
     g_test_add_func("/to_str/ip_addr_to_str_test1", test_ip_addr_to_str_test1);
 
+    g_test_add_func("/ws_mempbrk/exec", test_mempbrk);
+    g_test_add_func("/ws_memmem/ws_memmem", test_memmem);
+
+    if (g_test_perf()) {
+        g_test_add_func("/ws_mempbrk/exec_perf", test_mempbrk_perf);
+        g_test_add_func("/ws_memmem/ws_memmem_perf", test_memmem_perf);
+    }
+
     g_test_add_func("/nstime/from_iso8601", test_nstime_from_iso8601);
 
+    g_test_add_func("/arrow_writer/stream", test_arrow_writer);
+
     g_test_add_func("/ws_getopt/basic1", test_getopt_long_basic1);
     g_test_add_func("/ws_getopt/basic2", test_getopt_long_basic2);
     g_test_add_func("/ws_getopt/optional1", test_getopt_optional_argument1);
@@ -0,0 +1,250 @@
+/* wmem_allocator_threaded.c
+ * Wireshark Memory Manager Thread-Safe Allocator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "wmem_core.h"
+#include "wmem_allocator.h"
+#include "wmem_allocator_threaded.h"
+
+/* Each thread that allocates from a threaded allocator gets its own arena, a
+ * block allocator that it creates the first time it allocates and that
+ * belongs to the threaded allocator from then on. Allocations are served
+ * from the arena of the calling thread, so threads only contend for a lock
+ * when they free or reallocate memory that another thread allocated. Every
+ * chunk records the arena it came from, so that it can be freed or
+ * reallocated from any thread.
+ *
+ * All of the arenas share the lifetime of the threaded allocator: free_all
+ * frees the memory in all of them, and cleanup destroys them. The caller
+ * must make sure that no other thread is using the allocator at that time,
+ * as with any other wmem_free_all(). */
+
+/* See wmem_allocator_block.c */
+#define WMEM_ALIGN_AMOUNT (2 * sizeof (size_t))
+#define WMEM_ALIGN_SIZE(SIZE) ((~(WMEM_ALIGN_AMOUNT-1)) & \
+        ((SIZE) + (WMEM_ALIGN_AMOUNT-1)))
+
+typedef struct {
+    GMutex            lock;
+    wmem_allocator_t *allocator;
+} wmem_threaded_arena_t;
+
+typedef struct {
+    wmem_threaded_arena_t *arena;
+} wmem_threaded_chunk_t;
+#define WMEM_CHUNK_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_threaded_chunk_t))
+
+#define WMEM_CHUNK_TO_DATA(CHUNK) ((void*)((uint8_t*)(CHUNK) + WMEM_CHUNK_HEADER_SIZE))
+#define WMEM_DATA_TO_CHUNK(DATA) ((wmem_threaded_chunk_t*)((uint8_t*)(DATA) - WMEM_CHUNK_HEADER_SIZE))
+
+typedef struct {
+    GMutex     lock;
+    /* Never reused, so that a thread can't mistake an arena of a destroyed
+     * allocator for one of a new allocator at the same address. */
+    unsigned   id;
+    GPtrArray *arenas;
+} wmem_threaded_allocator_t;
+
+/* The arenas of the calling thread, by allocator ID, with the one looked up
+ * last cached. Entries of destroyed allocators are never looked up again. */
+typedef struct {
+    unsigned               last_id;
+    wmem_threaded_arena_t *last_arena;
+    GHashTable            *arenas;
+} wmem_threaded_thread_t;
+
+static void
+wmem_threaded_thread_free(void *data)
+{
+    wmem_threaded_thread_t *thread = (wmem_threaded_thread_t *)data;
+
+    g_hash_table_destroy(thread->arenas);
+    g_free(thread);
+}
+
+static GPrivate thread_arenas = G_PRIVATE_INIT(wmem_threaded_thread_free);
+static int next_allocator_id = 1;
+
+/* Returns the arena of the calling thread, creating it if necessary. */
+static wmem_threaded_arena_t *
+wmem_threaded_get_arena(wmem_threaded_allocator_t *allocator)
+{
+    wmem_threaded_thread_t *thread;
+    wmem_threaded_arena_t  *arena;
+
+    thread = (wmem_threaded_thread_t *)g_private_get(&thread_arenas);
+    if (G_LIKELY(thread && thread->last_id == allocator->id)) {
+        return thread->last_arena;
+    }
+
+    if (thread == NULL) {
+        thread = g_new0(wmem_threaded_thread_t, 1);
+        thread->arenas = g_hash_table_new(g_direct_hash, g_direct_equal);
+        g_private_set(&thread_arenas, thread);
+    }
+
+    arena = (wmem_threaded_arena_t *)g_hash_table_lookup(thread->arenas,
+            GUINT_TO_POINTER(allocator->id));
+    if (arena == NULL) {
+        arena = g_new(wmem_threaded_arena_t, 1);
+        g_mutex_init(&arena->lock);
+        arena->allocator = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+
+        g_mutex_lock(&allocator->lock);
+        g_ptr_array_add(allocator->arenas, arena);
+        g_mutex_unlock(&allocator->lock);
+
+        g_hash_table_insert(thread->arenas, GUINT_TO_POINTER(allocator->id), arena);
+    }
+
+    thread->last_id    = allocator->id;
+    thread->last_arena = arena;
+
+    return arena;
+}
+
+/* API */
+
+static void *
+wmem_threaded_alloc(void *private_data, const size_t size)
+{
+    wmem_threaded_allocator_t *allocator = (wmem_threaded_allocator_t*) private_data;
+    wmem_threaded_arena_t     *arena;
+    wmem_threaded_chunk_t     *chunk;
+
+    arena = wmem_threaded_get_arena(allocator);
+
+    /* Uncontended unless another thread is freeing memory of this arena. */
+    g_mutex_lock(&arena->lock);
+    chunk = (wmem_threaded_chunk_t *)wmem_alloc(arena->allocator,
+            size + WMEM_CHUNK_HEADER_SIZE);
+    g_mutex_unlock(&arena->lock);
+
+    chunk->arena = arena;
+
+    return WMEM_CHUNK_TO_DATA(chunk);
+}
+
+static void
+wmem_threaded_free(void *private_data _U_, void *ptr)
+{
+    wmem_threaded_chunk_t *chunk = WMEM_DATA_TO_CHUNK(ptr);
+    wmem_threaded_arena_t *arena = chunk->arena;
+
+    g_mutex_lock(&arena->lock);
+    wmem_free(arena->allocator, chunk);
+    g_mutex_unlock(&arena->lock);
+}
+
+static void *
+wmem_threaded_realloc(void *private_data _U_, void *ptr, const size_t size)
+{
+    wmem_threaded_chunk_t *chunk = WMEM_DATA_TO_CHUNK(ptr);
+    wmem_threaded_arena_t *arena = chunk->arena;
+
+    /* The chunk stays in the arena it came from, even if another thread
+     * reallocates it. */
+    g_mutex_lock(&arena->lock);
+    chunk = (wmem_threaded_chunk_t *)wmem_realloc(arena->allocator, chunk,
+            size + WMEM_CHUNK_HEADER_SIZE);
+    g_mutex_unlock(&arena->lock);
+
+    return WMEM_CHUNK_TO_DATA(chunk);
+}
+
+static void
+wmem_threaded_free_all(void *private_data)
+{
+    wmem_threaded_allocator_t *allocator = (wmem_threaded_allocator_t*) private_data;
+    wmem_threaded_arena_t     *arena;
+
+    g_mutex_lock(&allocator->lock);
+    for (unsigned i = 0; i < allocator->arenas->len; i++) {
+        arena = (wmem_threaded_arena_t *)g_ptr_array_index(allocator->arenas, i);
+        g_mutex_lock(&arena->lock);
+        wmem_free_all(arena->allocator);
+        g_mutex_unlock(&arena->lock);
+    }
+    g_mutex_unlock(&allocator->lock);
+}
+
+static void
+wmem_threaded_gc(void *private_data)
+{
+    wmem_threaded_allocator_t *allocator = (wmem_threaded_allocator_t*) private_data;
+    wmem_threaded_arena_t     *arena;
+
+    g_mutex_lock(&allocator->lock);
+    for (unsigned i = 0; i < allocator->arenas->len; i++) {
+        arena = (wmem_threaded_arena_t *)g_ptr_array_index(allocator->arenas, i);
+        g_mutex_lock(&arena->lock);
+        wmem_gc(arena->allocator);
+        g_mutex_unlock(&arena->lock);
+    }
+    g_mutex_unlock(&allocator->lock);
+}
+
+static void
+wmem_threaded_allocator_cleanup(void *private_data)
+{
+    wmem_threaded_allocator_t *allocator = (wmem_threaded_allocator_t*) private_data;
+    wmem_threaded_arena_t     *arena;
+
+    for (unsigned i = 0; i < allocator->arenas->len; i++) {
+        arena = (wmem_threaded_arena_t *)g_ptr_array_index(allocator->arenas, i);
+        wmem_destroy_allocator(arena->allocator);
+        g_mutex_clear(&arena->lock);
+        g_free(arena);
+    }
+    g_ptr_array_free(allocator->arenas, TRUE);
+    g_mutex_clear(&allocator->lock);
+
+    wmem_free(NULL, allocator);
+}
+
+void
+wmem_threaded_allocator_init(wmem_allocator_t *allocator)
+{
+    wmem_threaded_allocator_t *threaded_allocator;
+
+    threaded_allocator = wmem_new(NULL, wmem_threaded_allocator_t);
+
+    allocator->walloc   = &wmem_threaded_alloc;
+    allocator->wrealloc = &wmem_threaded_realloc;
+    allocator->wfree    = &wmem_threaded_free;
+
+    allocator->free_all = &wmem_threaded_free_all;
+    allocator->gc       = &wmem_threaded_gc;
+    allocator->cleanup  = &wmem_threaded_allocator_cleanup;
+
+    allocator->private_data = (void*) threaded_allocator;
+
+    g_mutex_init(&threaded_allocator->lock);
+    threaded_allocator->id     = (unsigned)g_atomic_int_add(&next_allocator_id, 1);
+    threaded_allocator->arenas = g_ptr_array_new();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -22,6 +22,7 @@
 #include "wmem_allocator_block.h"
 #include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_strict.h"
+#include "wmem_allocator_threaded.h"
 
 /* Set according to the WIRESHARK_DEBUG_WMEM_OVERRIDE environment variable in
  * wmem_init. Should not be set again. */
@@ -131,7 +132,9 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     wmem_allocator_t      *allocator;
     wmem_allocator_type_t  real_type;
 
-    if (do_override) {
+    /* The arenas of a threaded allocator are overridden instead; the
+     * allocators that they would be overridden with aren't thread-safe. */
+    if (do_override && type != WMEM_ALLOCATOR_THREADED) {
         real_type = override_type;
     }
     else {
@@ -156,6 +159,9 @@ wmem_allocator_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_THREADED:
+            wmem_threaded_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             break;
@@ -164,6 +170,20 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     return allocator;
 }
 
+void
+wmem_allocator_make_threaded(wmem_allocator_t *allocator)
+{
+    if (allocator->type == WMEM_ALLOCATOR_THREADED) {
+        return;
+    }
+
+    wmem_free_all(allocator);
+    allocator->cleanup(allocator->private_data);
+
+    allocator->type = WMEM_ALLOCATOR_THREADED;
+    wmem_threaded_allocator_init(allocator);
+}
+
 void
 wmem_init(void)
 {
@@ -57,11 +57,16 @@ typedef enum _wmem_allocator_type_t {
                 memory usage via things like canaries and scrubbing freed
                 memory. Valgrind is the better choice on platforms that support
                 it. */
-    WMEM_ALLOCATOR_BLOCK_FAST /**< A block allocator like WMEM_ALLOCATOR_BLOCK
+    WMEM_ALLOCATOR_BLOCK_FAST, /**< A block allocator like WMEM_ALLOCATOR_BLOCK
                 but even faster by tracking absolutely minimal metadata and
                 making 'free' a no-op. Useful only for very short-lived scopes
                 where there's no reason to free individual allocations because
                 the next free_all is always just around the corner. */
+    WMEM_ALLOCATOR_THREADED /**< An allocator that can be used by several
+                threads at once. Each thread allocates from its own
+                WMEM_ALLOCATOR_BLOCK arena, so threads don't contend for
+                a lock unless they free memory that another thread
+                allocated; free_all frees the memory of all of them. */
 } wmem_allocator_type_t;
 
 /** Allocate the requested amount of memory in the given pool.
@@ -202,6 +207,17 @@ WS_DLL_PUBLIC
 wmem_allocator_t *
 wmem_allocator_new(const wmem_allocator_type_t type);
 
+/** Switch the given allocator to WMEM_ALLOCATOR_THREADED, so that several
+ * threads can allocate from it at once from then on. Any memory allocated
+ * with it is freed, as if by wmem_free_all(). The allocator itself and its
+ * callbacks are kept, so it can be switched while others hold on to it.
+ *
+ * @param allocator The allocator to switch.
+ */
+WS_DLL_PUBLIC
+void
+wmem_allocator_make_threaded(wmem_allocator_t *allocator);
+
 /** Initialize the wmem subsystem. This must be called before any other wmem
  * function, usually at the very beginning of your program.
  */
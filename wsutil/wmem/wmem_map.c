@@ -41,6 +41,17 @@ typedef struct _wmem_map_item_t {
     struct _wmem_map_item_t *next;
 } wmem_map_item_t;
 
+/* A slot of a flat map. 'psl' is one more than the distance of the slot from
+ * the one its key hashes to (its probe sequence length), or 0 if the slot is
+ * empty. 'hash' is the full hash of the key, so that growing the table doesn't
+ * need the hash function and most mismatches don't need the equal function. */
+typedef struct _wmem_map_slot_t {
+    uint32_t    hash;
+    uint32_t    psl;
+    const void *key;
+    void       *value;
+} wmem_map_slot_t;
+
 struct _wmem_map_t {
     unsigned count; /* number of items stored */
 
@@ -52,6 +63,10 @@ struct _wmem_map_t {
 
     wmem_map_item_t **table;
 
+    /* Flat maps keep their items in this array of slots instead. */
+    bool flat;
+    wmem_map_slot_t *slots;
+
     GHashFunc  hash_func;
     GEqualFunc eql_func;
 
@@ -76,6 +91,18 @@ struct _wmem_map_t {
 #define HASH(MAP, KEY) \
     ((uint32_t)(((MAP)->hash_func(KEY) * x) >> (32 - (MAP)->capacity)))
 
+/* The same hashing for flat maps, split so that the full hash can be stored
+ * and the home slot derived from it for any capacity. */
+#define FLAT_HASH(MAP, KEY) ((uint32_t)((MAP)->hash_func(KEY) * x))
+#define FLAT_HOME(MAP, HASH) ((size_t)((HASH) >> (32 - (MAP)->capacity)))
+#define FLAT_MASK(MAP) (CAPACITY(MAP) - 1)
+
+/* Flat maps grow when more than 7/8 of the slots are in use. Robin Hood
+ * hashing keeps probe sequences short even that full, and the map must never
+ * fill up entirely, as a probe for a missing key only stops at a slot that is
+ * empty or closer to its home than the key would be. */
+#define FLAT_OVERFULL(MAP) ((MAP)->count > CAPACITY(MAP) - (CAPACITY(MAP) >> 3))
+
 static void
 wmem_map_init_table(wmem_map_t *map)
 {
@@ -98,6 +125,20 @@ wmem_map_new(wmem_allocator_t *allocator,
     map->data_allocator = allocator;
     map->count = 0;
     map->table = NULL;
+    map->flat  = false;
+    map->slots = NULL;
+
+    return map;
+}
+
+wmem_map_t *
+wmem_map_new_flat(wmem_allocator_t *allocator,
+        GHashFunc hash_func, GEqualFunc eql_func)
+{
+    wmem_map_t *map;
+
+    map = wmem_map_new(allocator, hash_func, eql_func);
+    map->flat = true;
 
     return map;
 }
@@ -110,6 +151,7 @@ wmem_map_reset_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event,
 
     map->count = 0;
     map->table = NULL;
+    map->slots = NULL;
 
     if (event == WMEM_CB_DESTROY_EVENT) {
         wmem_unregister_callback(map->metadata_allocator, map->metadata_scope_cb_id);
@@ -144,6 +186,8 @@ wmem_map_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_
     map->data_allocator = data_scope;
     map->count = 0;
     map->table = NULL;
+    map->flat  = false;
+    map->slots = NULL;
 
     map->metadata_scope_cb_id = wmem_register_callback(metadata_scope, wmem_map_destroy_cb, map);
     map->data_scope_cb_id  = wmem_register_callback(data_scope, wmem_map_reset_cb, map);
@@ -151,6 +195,184 @@ wmem_map_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_
     return map;
 }
 
+wmem_map_t *
+wmem_map_new_flat_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_scope,
+        GHashFunc hash_func, GEqualFunc eql_func)
+{
+    wmem_map_t *map;
+
+    map = wmem_map_new_autoreset(metadata_scope, data_scope, hash_func, eql_func);
+    map->flat = true;
+
+    return map;
+}
+
+/* Flat maps use open addressing with Robin Hood hashing and backward shift
+ * deletion: an item is never further from its home slot than the item it
+ * would have to move past is from its own, and removing an item moves the
+ * items after it back, so there are no tombstones. */
+
+static wmem_map_slot_t *
+wmem_map_flat_find(const wmem_map_t *map, const void *key, uint32_t hash)
+{
+    wmem_map_slot_t *slot;
+    size_t           i    = FLAT_HOME(map, hash);
+    size_t           mask = FLAT_MASK(map);
+    uint32_t         psl;
+
+    for (psl = 1; ; psl++) {
+        slot = &map->slots[i];
+        /* the key would have taken this slot over */
+        if (slot->psl < psl) {
+            return NULL;
+        }
+        if (slot->hash == hash && map->eql_func(key, slot->key)) {
+            return slot;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+/* Place a key that isn't in the map yet. */
+static void
+wmem_map_flat_place(wmem_map_t *map, uint32_t hash, const void *key, void *value)
+{
+    wmem_map_slot_t  cur, tmp, *slot;
+    size_t           i    = FLAT_HOME(map, hash);
+    size_t           mask = FLAT_MASK(map);
+
+    cur.hash  = hash;
+    cur.psl   = 1;
+    cur.key   = key;
+    cur.value = value;
+
+    for (;;) {
+        slot = &map->slots[i];
+        if (slot->psl == 0) {
+            *slot = cur;
+            return;
+        }
+        if (slot->psl < cur.psl) {
+            /* take the slot from the item closer to its home, and move on
+             * to place that one */
+            tmp   = *slot;
+            *slot = cur;
+            cur   = tmp;
+        }
+        i = (i + 1) & mask;
+        cur.psl++;
+    }
+}
+
+static void
+wmem_map_flat_erase(wmem_map_t *map, size_t i)
+{
+    size_t mask = FLAT_MASK(map);
+    size_t next = (i + 1) & mask;
+
+    while (map->slots[next].psl > 1) {
+        map->slots[i] = map->slots[next];
+        map->slots[i].psl--;
+        i    = next;
+        next = (next + 1) & mask;
+    }
+    map->slots[i].psl = 0;
+    map->count--;
+}
+
+static void
+wmem_map_flat_grow(wmem_map_t *map)
+{
+    wmem_map_slot_t *old_slots;
+    size_t           old_cap, i;
+
+    old_slots = map->slots;
+    old_cap   = CAPACITY(map);
+
+    map->capacity++;
+    map->slots = wmem_alloc0_array(map->data_allocator, wmem_map_slot_t, CAPACITY(map));
+
+    for (i = 0; i < old_cap; i++) {
+        if (old_slots[i].psl != 0) {
+            wmem_map_flat_place(map, old_slots[i].hash, old_slots[i].key, old_slots[i].value);
+        }
+    }
+
+    wmem_free(map->data_allocator, old_slots);
+}
+
+static void *
+wmem_map_flat_insert(wmem_map_t *map, const void *key, void *value)
+{
+    wmem_map_slot_t *slot;
+    uint32_t         hash;
+    void            *old_val;
+
+    if (map->slots == NULL) {
+        map->count    = 0;
+        map->capacity = WMEM_MAP_DEFAULT_CAPACITY;
+        map->slots    = wmem_alloc0_array(map->data_allocator, wmem_map_slot_t, CAPACITY(map));
+    }
+
+    hash = FLAT_HASH(map, key);
+    slot = wmem_map_flat_find(map, key, hash);
+    if (slot) {
+        old_val     = slot->value;
+        slot->value = value;
+        return old_val;
+    }
+
+    map->count++;
+    if (FLAT_OVERFULL(map)) {
+        wmem_map_flat_grow(map);
+    }
+    wmem_map_flat_place(map, hash, key, value);
+
+    return NULL;
+}
+
+static wmem_map_slot_t *
+wmem_map_flat_lookup(wmem_map_t *map, const void *key)
+{
+    if (map->slots == NULL) {
+        return NULL;
+    }
+
+    return wmem_map_flat_find(map, key, FLAT_HASH(map, key));
+}
+
+static unsigned
+wmem_map_flat_foreach_remove(wmem_map_t *map, GHRFunc foreach_func, void * user_data)
+{
+    size_t   mask, start, i;
+    unsigned deleted = 0;
+
+    if (map->slots == NULL) {
+        return 0;
+    }
+
+    /* Removing an item moves the ones after it back by a slot, up to the next
+     * empty slot. Going round the table from an empty slot means those are
+     * always items that haven't been visited yet. */
+    mask = FLAT_MASK(map);
+    for (start = 0; map->slots[start].psl != 0; start++)
+        ;
+
+    i = (start + 1) & mask;
+    while (i != start) {
+        if (map->slots[i].psl != 0 &&
+                foreach_func((void *)map->slots[i].key, map->slots[i].value, user_data)) {
+            /* the next item, if any, is now in slot i */
+            wmem_map_flat_erase(map, i);
+            deleted++;
+        } else {
+            i = (i + 1) & mask;
+        }
+    }
+
+    return deleted;
+}
+
 static inline void
 wmem_map_grow(wmem_map_t *map)
 {
@@ -189,6 +411,10 @@ wmem_map_insert(wmem_map_t *map, const void *key, void *value)
     wmem_map_item_t **item;
     void *old_val;
 
+    if (map->flat) {
+        return wmem_map_flat_insert(map, key, value);
+    }
+
     /* Make sure we have a table */
     if (map->table == NULL) {
         wmem_map_init_table(map);
@@ -231,6 +457,10 @@ wmem_map_contains(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t *item;
 
+    if (map != NULL && map->flat) {
+        return wmem_map_flat_lookup(map, key) != NULL;
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return false;
@@ -255,6 +485,12 @@ wmem_map_lookup(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t *item;
 
+    if (map != NULL && map->flat) {
+        wmem_map_slot_t *slot = wmem_map_flat_lookup(map, key);
+
+        return slot ? slot->value : NULL;
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return NULL;
@@ -279,6 +515,21 @@ wmem_map_lookup_extended(wmem_map_t *map, const void *key, const void **orig_key
 {
     wmem_map_item_t *item;
 
+    if (map != NULL && map->flat) {
+        wmem_map_slot_t *slot = wmem_map_flat_lookup(map, key);
+
+        if (slot == NULL) {
+            return false;
+        }
+        if (orig_key) {
+            *orig_key = slot->key;
+        }
+        if (value) {
+            *value = slot->value;
+        }
+        return true;
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return false;
@@ -310,6 +561,17 @@ wmem_map_remove(wmem_map_t *map, const void *key)
     wmem_map_item_t **item, *tmp;
     void *value;
 
+    if (map != NULL && map->flat) {
+        wmem_map_slot_t *slot = wmem_map_flat_lookup(map, key);
+
+        if (slot == NULL) {
+            return NULL;
+        }
+        value = slot->value;
+        wmem_map_flat_erase(map, slot - map->slots);
+        return value;
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return NULL;
@@ -341,6 +603,16 @@ wmem_map_steal(wmem_map_t *map, const void *key)
 {
     wmem_map_item_t **item, *tmp;
 
+    if (map != NULL && map->flat) {
+        wmem_map_slot_t *slot = wmem_map_flat_lookup(map, key);
+
+        if (slot == NULL) {
+            return false;
+        }
+        wmem_map_flat_erase(map, slot - map->slots);
+        return true;
+    }
+
     /* Make sure we have map and a table */
     if (map == NULL || map->table == NULL) {
         return false;
@@ -372,7 +644,16 @@ wmem_map_get_keys(wmem_allocator_t *list_allocator, wmem_map_t *map)
     wmem_map_item_t *cur;
     wmem_list_t* list = wmem_list_new(list_allocator);
 
-    if (map->table != NULL) {
+    if (map->flat) {
+        if (map->slots != NULL) {
+            capacity = CAPACITY(map);
+            for (i=0; i<capacity; i++) {
+                if (map->slots[i].psl != 0) {
+                    wmem_list_prepend(list, (void*)map->slots[i].key);
+                }
+            }
+        }
+    } else if (map->table != NULL) {
         capacity = CAPACITY(map);
 
         /* copy all the elements into the list over from table */
@@ -394,6 +675,18 @@ wmem_map_foreach(wmem_map_t *map, GHFunc foreach_func, void * user_data)
     wmem_map_item_t *cur;
     unsigned i;
 
+    if (map != NULL && map->flat) {
+        if (map->slots == NULL) {
+            return;
+        }
+        for (i = 0; i < CAPACITY(map); i++) {
+            if (map->slots[i].psl != 0) {
+                foreach_func((void *)map->slots[i].key, map->slots[i].value, user_data);
+            }
+        }
+        return;
+    }
+
     /* Make sure we have a table */
     if (map == NULL || map->table == NULL) {
         return;
@@ -414,6 +707,10 @@ wmem_map_foreach_remove(wmem_map_t *map, GHRFunc foreach_func, void * user_data)
     wmem_map_item_t **item, *tmp;
     unsigned i, deleted = 0;
 
+    if (map != NULL && map->flat) {
+        return wmem_map_flat_foreach_remove(map, foreach_func, user_data);
+    }
+
     /* Make sure we have a table */
     if (map == NULL || map->table == NULL) {
         return 0;
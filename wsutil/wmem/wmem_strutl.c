@@ -11,11 +11,16 @@
 #define _GNU_SOURCE
 #include "config.h"
 #include "wmem_strutl.h"
+#include "ws_memmem_int.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <errno.h>
 
+#ifdef HAVE_AVX2
+#include <wsutil/ws_cpuid.h>
+#endif
+
 char *
 wmem_strdup(wmem_allocator_t *allocator, const char *src)
 {
@@ -109,20 +114,14 @@ wmem_strdup_vprintf(wmem_allocator_t *allocator, const char *fmt, va_list ap)
     return new_buf;
 }
 
-/* Return the first occurrence of needle in haystack.
- * If not found, return NULL.
- * If either haystack has 0 length, return NULL.
- * If needle has 0 length, return pointer to haystack. */
 const uint8_t *
-ws_memmem(const void *_haystack, size_t haystack_len,
-                const void *_needle, size_t needle_len)
+ws_memmem_portable(const uint8_t *haystack, size_t haystack_len,
+                const uint8_t *needle, size_t needle_len)
 {
 #ifdef HAVE_MEMMEM
-    return memmem(_haystack, haystack_len, _needle, needle_len);
+    return memmem(haystack, haystack_len, needle, needle_len);
 #else
     /* Algorithm copied from GNU's glibc 2.3.2 memmem() under LGPL 2.1+ */
-    const uint8_t *haystack = _haystack;
-    const uint8_t *needle = _needle;
     const uint8_t *begin;
     const uint8_t *const last_possible = haystack + haystack_len - needle_len;
 
@@ -150,6 +149,29 @@ ws_memmem(const void *_haystack, size_t haystack_len,
 #endif /* HAVE_MEMMEM */
 }
 
+/* Return the first occurrence of needle in haystack.
+ * If not found, return NULL.
+ * If either haystack has 0 length, return NULL.
+ * If needle has 0 length, return pointer to haystack. */
+const uint8_t *
+ws_memmem(const void *haystack, size_t haystack_len,
+                const void *needle, size_t needle_len)
+{
+#ifdef HAVE_AVX2
+    /* -1 if we haven't looked yet; looking again in another thread is harmless. */
+    static int use_avx2 = -1;
+
+    if (needle_len >= 2 && haystack_len >= needle_len + 31) {
+        if (use_avx2 < 0)
+            use_avx2 = ws_cpuid_avx2() ? 1 : 0;
+        if (use_avx2)
+            return ws_memmem_avx2(haystack, haystack_len, needle, needle_len);
+    }
+#endif
+
+    return ws_memmem_portable(haystack, haystack_len, needle, needle_len);
+}
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
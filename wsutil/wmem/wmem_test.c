@@ -21,6 +21,7 @@
 #include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_simple.h"
 #include "wmem_allocator_strict.h"
+#include "wmem_allocator_threaded.h"
 
 #include <wsutil/time_util.h>
 
@@ -57,6 +58,9 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_THREADED:
+            wmem_threaded_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             /* This is necessary to squelch MSVC errors; is there
@@ -369,6 +373,187 @@ wmem_test_allocator_strict(void)
     wmem_test_allocator_jumbo(WMEM_ALLOCATOR_STRICT, &wmem_strict_check_canaries);
 }
 
+static void
+wmem_test_allocator_threaded(void)
+{
+    wmem_test_allocator(WMEM_ALLOCATOR_THREADED, NULL,
+            MAX_SIMULTANEOUS_ALLOCS*64);
+    wmem_test_allocator_jumbo(WMEM_ALLOCATOR_THREADED, NULL);
+}
+
+#define STRESS_THREADS      8
+#define STRESS_ROUNDS       4
+#define STRESS_ITERS        10000
+#define STRESS_SHARED_SLOTS 256
+#define STRESS_MAX_SIZE     1024
+
+typedef struct {
+    wmem_allocator_t *allocator;
+    /* Pointers that any thread may free or reallocate, so that memory is
+     * often freed by a thread other than the one that allocated it. */
+    void            **shared;
+    GMutex           *shared_lock;
+    uint32_t          seed;
+} wmem_stress_thread_t;
+
+/* Each chunk starts with its size, and the rest of it is filled with the
+ * low byte of its size, so that a chunk that was handed out twice or
+ * overwritten by the allocator is noticed. */
+static void *
+wmem_stress_fill(void *ptr, uint32_t size)
+{
+    memcpy(ptr, &size, sizeof size);
+    memset((uint8_t *)ptr + sizeof size, size & 0xff, size - sizeof size);
+    return ptr;
+}
+
+static void
+wmem_stress_check(const void *ptr)
+{
+    uint32_t size;
+
+    memcpy(&size, ptr, sizeof size);
+    g_assert_cmpuint(size, >=, sizeof size);
+    g_assert_cmpuint(size, <=, STRESS_MAX_SIZE);
+    for (uint32_t i = sizeof size; i < size; i++) {
+        g_assert_cmpuint(((const uint8_t *)ptr)[i], ==, size & 0xff);
+    }
+}
+
+static void *
+wmem_stress_thread(void *data)
+{
+    wmem_stress_thread_t *args = (wmem_stress_thread_t *)data;
+    GRand *rng = g_rand_new_with_seed(args->seed);
+    void *own[64] = { NULL };
+    void **slot;
+    void *ptr;
+    uint32_t size;
+
+    for (int i = 0; i < STRESS_ITERS; i++) {
+        size = g_rand_int_range(rng, sizeof size, STRESS_MAX_SIZE + 1);
+        if (g_rand_boolean(rng)) {
+            /* Swap a new chunk into a shared slot, and free or grow the
+             * one that was there, whoever allocated it. */
+            void *old;
+
+            ptr = wmem_stress_fill(wmem_alloc(args->allocator, size), size);
+            g_mutex_lock(args->shared_lock);
+            slot = &args->shared[g_rand_int_range(rng, 0, STRESS_SHARED_SLOTS)];
+            old = *slot;
+            *slot = ptr;
+            g_mutex_unlock(args->shared_lock);
+            ptr = old;
+            if (ptr == NULL)
+                continue;
+            wmem_stress_check(ptr);
+            if (g_rand_boolean(rng)) {
+                wmem_free(args->allocator, ptr);
+            } else {
+                ptr = wmem_realloc(args->allocator, ptr, size);
+                wmem_stress_check(wmem_stress_fill(ptr, size));
+                wmem_free(args->allocator, ptr);
+            }
+        } else {
+            slot = &own[g_rand_int_range(rng, 0, G_N_ELEMENTS(own))];
+            if (*slot) {
+                wmem_stress_check(*slot);
+                *slot = wmem_realloc(args->allocator, *slot, size);
+            } else {
+                *slot = wmem_alloc(args->allocator, size);
+            }
+            wmem_stress_fill(*slot, size);
+        }
+    }
+
+    for (unsigned i = 0; i < G_N_ELEMENTS(own); i++) {
+        if (own[i])
+            wmem_stress_check(own[i]);
+    }
+    g_rand_free(rng);
+    return NULL;
+}
+
+static void
+wmem_stress_run(wmem_allocator_t *allocator, int rounds)
+{
+    void *shared[STRESS_SHARED_SLOTS];
+    GMutex shared_lock;
+    wmem_stress_thread_t args[STRESS_THREADS];
+    GThread *threads[STRESS_THREADS];
+
+    g_mutex_init(&shared_lock);
+
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < STRESS_SHARED_SLOTS; i++) {
+            shared[i] = NULL;
+        }
+
+        /* New threads every round, so that arenas outlive the threads
+         * that created them and new ones are added after free_all. */
+        for (int i = 0; i < STRESS_THREADS; i++) {
+            args[i].allocator = allocator;
+            args[i].shared = shared;
+            args[i].shared_lock = &shared_lock;
+            args[i].seed = g_test_rand_int();
+            threads[i] = g_thread_new("wmem stress", wmem_stress_thread, &args[i]);
+        }
+        for (int i = 0; i < STRESS_THREADS; i++) {
+            g_thread_join(threads[i]);
+        }
+
+        for (int i = 0; i < STRESS_SHARED_SLOTS; i++) {
+            if (shared[i])
+                wmem_stress_check(shared[i]);
+        }
+
+        if (round % 2) {
+            wmem_free_all(allocator);
+        }
+        wmem_gc(allocator);
+    }
+
+    g_mutex_clear(&shared_lock);
+}
+
+static void
+wmem_test_allocator_threaded_stress(void)
+{
+    wmem_allocator_t *allocator;
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_THREADED);
+    wmem_stress_run(allocator, STRESS_ROUNDS);
+    wmem_destroy_allocator(allocator);
+}
+
+static void
+wmem_test_allocator_make_threaded(void)
+{
+    bool t = true;
+
+    expected_allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_BLOCK);
+    wmem_register_callback(expected_allocator, &wmem_test_cb, &t);
+    wmem_alloc(expected_allocator, 64);
+
+    /* Switching frees what was allocated, and keeps the callbacks. */
+    expected_event  = WMEM_CB_FREE_EVENT;
+    cb_called_count = 0;
+    wmem_allocator_make_threaded(expected_allocator);
+    g_assert_cmpint(cb_called_count, ==, 1);
+    g_assert_true(expected_allocator->type == WMEM_ALLOCATOR_THREADED);
+
+    wmem_stress_run(expected_allocator, 2);
+
+    cb_called_count = 0;
+    wmem_free_all(expected_allocator);
+    g_assert_cmpint(cb_called_count, ==, 1);
+
+    expected_event  = WMEM_CB_DESTROY_EVENT;
+    cb_called_count = 0;
+    wmem_destroy_allocator(expected_allocator);
+    g_assert_cmpint(cb_called_count, ==, 1);
+}
+
 /* UTILITY TESTING FUNCTIONS (/wmem/utils/) */
 
 static void
@@ -903,8 +1088,13 @@ equal_val_map(void * key _U_, void * val, void * user_data)
     return val == user_data;
 }
 
+typedef wmem_map_t *(*wmem_map_new_func)(wmem_allocator_t *allocator,
+        GHashFunc hash_func, GEqualFunc eql_func);
+typedef wmem_map_t *(*wmem_map_new_autoreset_func)(wmem_allocator_t *metadata_scope,
+        wmem_allocator_t *data_scope, GHashFunc hash_func, GEqualFunc eql_func);
+
 static void
-wmem_test_map(void)
+wmem_test_map_common(wmem_map_new_func map_new, wmem_map_new_autoreset_func map_new_autoreset)
 {
     wmem_allocator_t   *allocator, *extra_allocator;
     wmem_map_t       *map;
@@ -919,7 +1109,7 @@ wmem_test_map(void)
     extra_allocator = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
 
     /* insertion, lookup and removal of simple integer keys */
-    map = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+    map = map_new(allocator, g_direct_hash, g_direct_equal);
     g_assert_true(map);
 
     for (i=0; i<CONTAINER_ITERS; i++) {
@@ -957,7 +1147,7 @@ wmem_test_map(void)
     wmem_free_all(allocator);
 
     /* test auto-reset functionality */
-    map = wmem_map_new_autoreset(allocator, extra_allocator, g_direct_hash, g_direct_equal);
+    map = map_new_autoreset(allocator, extra_allocator, g_direct_hash, g_direct_equal);
     g_assert_true(map);
     for (i=0; i<CONTAINER_ITERS; i++) {
         ret = wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(777777));
@@ -973,7 +1163,7 @@ wmem_test_map(void)
     }
     wmem_free_all(allocator);
 
-    map = wmem_map_new(allocator, wmem_str_hash, g_str_equal);
+    map = map_new(allocator, wmem_str_hash, g_str_equal);
     g_assert_true(map);
 
     /* string keys and for-each */
@@ -991,7 +1181,7 @@ wmem_test_map(void)
     }
 
     /* test foreach */
-    map = wmem_map_new(allocator, wmem_str_hash, g_str_equal);
+    map = map_new(allocator, wmem_str_hash, g_str_equal);
     g_assert_true(map);
     for (i=0; i<CONTAINER_ITERS; i++) {
         str_key = wmem_test_rand_string(allocator, 1, 64);
@@ -1003,7 +1193,7 @@ wmem_test_map(void)
     g_assert_true(wmem_map_size(map) == 0);
 
     /* test size */
-    map = wmem_map_new(allocator, g_direct_hash, g_direct_equal);
+    map = map_new(allocator, g_direct_hash, g_direct_equal);
     g_assert_true(map);
     for (i=0; i<CONTAINER_ITERS; i++) {
         wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
@@ -1015,10 +1205,105 @@ wmem_test_map(void)
     }
     g_assert_true(wmem_map_size(map) == CONTAINER_ITERS/2);
 
+    /* removal while other items are in the map */
+    map = map_new(allocator, g_direct_hash, g_direct_equal);
+    g_assert_true(map);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        wmem_map_insert(map, GINT_TO_POINTER(i), GINT_TO_POINTER(i));
+    }
+    for (i=1; i<CONTAINER_ITERS; i+=2) {
+        ret = wmem_map_remove(map, GINT_TO_POINTER(i));
+        g_assert_true(ret == GINT_TO_POINTER(i));
+    }
+    for (i=0; i<CONTAINER_ITERS; i+=4) {
+        g_assert_true(wmem_map_steal(map, GINT_TO_POINTER(i)));
+    }
+    g_assert_true(wmem_map_size(map) == CONTAINER_ITERS/4);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        ret = wmem_map_lookup(map, GINT_TO_POINTER(i));
+        g_assert_true(ret == ((i % 4 == 2) ? GINT_TO_POINTER(i) : NULL));
+    }
+    g_assert_true(wmem_list_count(wmem_map_get_keys(allocator, map)) == CONTAINER_ITERS/4);
+
     wmem_destroy_allocator(extra_allocator);
     wmem_destroy_allocator(allocator);
 }
 
+static void
+wmem_test_map(void)
+{
+    wmem_test_map_common(wmem_map_new, wmem_map_new_autoreset);
+}
+
+static void
+wmem_test_map_flat(void)
+{
+    wmem_test_map_common(wmem_map_new_flat, wmem_map_new_flat_autoreset);
+}
+
+#define MAP_PERF_ITEMS (1 * 1000 * 1000)
+
+static void
+count_map(void * key _U_, void * val _U_, void * user_data)
+{
+    (*(unsigned *)user_data)++;
+}
+
+static void
+wmem_test_mapperf_run(const char *name, wmem_map_new_func map_new)
+{
+    wmem_allocator_t   *allocator;
+    wmem_map_t         *map;
+    unsigned            i, count;
+    double              start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    /* file scoped maps use a block allocator */
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+    map = map_new(allocator, g_direct_hash, g_direct_equal);
+
+    RESOURCE_USAGE_START;
+    for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+        wmem_map_insert(map, GUINT_TO_POINTER(i), GUINT_TO_POINTER(i));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "%s insert: u %.3f ms s %.3f ms", name, utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 1; i <= MAP_PERF_ITEMS; i++) {
+        g_assert_true(wmem_map_lookup(map, GUINT_TO_POINTER(i)) == GUINT_TO_POINTER(i));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "%s lookup: u %.3f ms s %.3f ms", name, utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = MAP_PERF_ITEMS + 1; i <= 2 * MAP_PERF_ITEMS; i++) {
+        g_assert_true(wmem_map_lookup(map, GUINT_TO_POINTER(i)) == NULL);
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "%s failed lookup: u %.3f ms s %.3f ms", name, utime_ms, stime_ms);
+
+    count = 0;
+    RESOURCE_USAGE_START;
+    wmem_map_foreach(map, count_map, &count);
+    RESOURCE_USAGE_END;
+    g_assert_true(count == MAP_PERF_ITEMS);
+    g_test_minimized_result(utime_ms + stime_ms,
+        "%s iterate: u %.3f ms s %.3f ms", name, utime_ms, stime_ms);
+
+    wmem_destroy_allocator(allocator);
+}
+
+/* NOTE: You have to run "wmem_test -m perf" to run the performance tests. */
+static void
+wmem_test_mapperf(void)
+{
+    wmem_test_mapperf_run("chained map", wmem_map_new);
+    wmem_test_mapperf_run("flat map", wmem_map_new_flat);
+}
+
 static void
 wmem_test_queue(void)
 {
@@ -1456,6 +1741,9 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/allocator/blk_fast",  wmem_test_allocator_block_fast);
     g_test_add_func("/wmem/allocator/simple",    wmem_test_allocator_simple);
     g_test_add_func("/wmem/allocator/strict",    wmem_test_allocator_strict);
+    g_test_add_func("/wmem/allocator/threaded",  wmem_test_allocator_threaded);
+    g_test_add_func("/wmem/allocator/threaded/stress", wmem_test_allocator_threaded_stress);
+    g_test_add_func("/wmem/allocator/threaded/make_threaded", wmem_test_allocator_make_threaded);
     g_test_add_func("/wmem/allocator/callbacks", wmem_test_allocator_callbacks);
 
     g_test_add_func("/wmem/utils/misc",    wmem_test_miscutls);
@@ -1468,6 +1756,10 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/datastruct/array",  wmem_test_array);
     g_test_add_func("/wmem/datastruct/list",   wmem_test_list);
     g_test_add_func("/wmem/datastruct/map",    wmem_test_map);
+    g_test_add_func("/wmem/datastruct/map/flat", wmem_test_map_flat);
+    if (g_test_perf()) {
+        g_test_add_func("/wmem/datastruct/mapperf", wmem_test_mapperf);
+    }
     g_test_add_func("/wmem/datastruct/queue",  wmem_test_queue);
     g_test_add_func("/wmem/datastruct/stack",  wmem_test_stack);
     g_test_add_func("/wmem/datastruct/strbuf", wmem_test_strbuf);
@@ -0,0 +1,87 @@
+/* ws_memmem_avx2.c
+ * Substring search with AVX2 intrinsics
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <immintrin.h>
+#include <string.h>
+
+#include <wsutil/bits_ctz.h>
+
+#include "ws_memmem_int.h"
+
+/*
+ * Everything in this file is compiled for AVX2, so it must only be
+ * called once ws_cpuid_avx2() has said that the CPU supports it.
+ *
+ * For 32 starting positions at a time, compare the first and the last
+ * byte of the needle with the haystack, and only compare the rest of the
+ * needle at the positions where both match. See Wojciech Muła, "SIMD-
+ * friendly algorithms for substring searching".
+ *
+ * Data such as long runs of the same byte can make that match at nearly
+ * every position, so after too many false candidates we finish with
+ * ws_memmem_portable(), which doesn't go quadratic.
+ */
+
+const uint8_t *
+ws_memmem_avx2(const uint8_t *haystack, size_t haystack_len,
+                const uint8_t *needle, size_t needle_len)
+{
+    const __m256i first = _mm256_set1_epi8((char)needle[0]);
+    const __m256i last = _mm256_set1_epi8((char)needle[needle_len - 1]);
+    /* Number of starting positions. */
+    size_t positions = haystack_len - needle_len + 1;
+    size_t false_candidates = 0;
+    size_t i;
+
+    for (i = 0; i + 32 <= positions; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(haystack + i + needle_len - 1));
+        uint32_t candidates = (uint32_t)_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                 _mm256_cmpeq_epi8(last, block_last)));
+
+        while (candidates) {
+            const uint8_t *p = haystack + i + ws_ctz(candidates);
+
+            if (memcmp(p + 1, needle + 1, needle_len - 2) == 0)
+                return p;
+            candidates &= candidates - 1;
+            false_candidates++;
+        }
+        if (false_candidates > 64 + i / 8) {
+            i += 32;
+            break;
+        }
+    }
+
+    /* The remaining positions start at i. */
+    if (i >= positions)
+        return NULL;
+    return ws_memmem_portable(haystack + i, haystack_len - i, needle, needle_len);
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
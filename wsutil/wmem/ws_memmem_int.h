@@ -0,0 +1,56 @@
+/** @file
+ *
+ * Definitions for the substring search internals
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_MEMMEM_INT_H__
+#define __WS_MEMMEM_INT_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ws_symbol_export.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* ws_memmem() without any SIMD code. */
+WS_DLL_LOCAL
+const uint8_t *
+ws_memmem_portable(const uint8_t *haystack, size_t haystack_len,
+                const uint8_t *needle, size_t needle_len);
+
+#ifdef HAVE_AVX2
+/* ws_memmem() with AVX2 code; needle_len must be at least 2 and
+ * haystack_len at least needle_len + 31. */
+WS_DLL_LOCAL
+const uint8_t *
+ws_memmem_avx2(const uint8_t *haystack, size_t haystack_len,
+                const uint8_t *needle, size_t needle_len);
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_MEMMEM_INT_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
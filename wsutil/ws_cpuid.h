@@ -47,6 +47,8 @@
  * on Windows anyway, so the answer is probably "no".
  */
 #if defined(_M_IX86) || defined(_M_X64)
+#include <immintrin.h>
+
 static bool
 ws_cpuid(uint32_t *CPUInfo, uint32_t selector)
 {
@@ -57,6 +59,13 @@ ws_cpuid(uint32_t *CPUInfo, uint32_t selector)
 	/* XXX, how to check if it's supported on MSVC? just in case clear all flags above */
 	return true;
 }
+
+/* Only called if ws_cpuid() succeeded and reported OSXSAVE. */
+static inline uint64_t
+ws_xgetbv0(void)
+{
+	return _xgetbv(0);
+}
 #else /* not x86 */
 static bool
 ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
@@ -64,6 +73,12 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
 	/* Not x86, so no cpuid instruction */
 	return false;
 }
+
+static inline uint64_t
+ws_xgetbv0(void)
+{
+	return 0;
+}
 #endif
 
 #elif defined(__GNUC__)  /* GCC/clang */
@@ -81,6 +96,16 @@ ws_cpuid(uint32_t *CPUInfo, int selector)
 							"c" (0));
 	return true;
 }
+
+/* Only called if ws_cpuid() succeeded and reported OSXSAVE. */
+static inline uint64_t
+ws_xgetbv0(void)
+{
+	uint32_t eax, edx;
+
+	__asm__ __volatile__("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+	return ((uint64_t)edx << 32) | eax;
+}
 #elif defined(__i386__)
 static bool
 ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
@@ -110,6 +135,12 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
 	 */
 	return false;
 }
+
+static inline uint64_t
+ws_xgetbv0(void)
+{
+	return 0;
+}
 #else /* not x86 */
 static bool
 ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
@@ -117,6 +148,12 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
 	/* Not x86, so no cpuid instruction */
 	return false;
 }
+
+static inline uint64_t
+ws_xgetbv0(void)
+{
+	return 0;
+}
 #endif
 
 #else /* Other compilers */
@@ -126,6 +163,12 @@ ws_cpuid(uint32_t *CPUInfo _U_, int selector _U_)
 {
 	return false;
 }
+
+static inline uint64_t
+ws_xgetbv0(void)
+{
+	return 0;
+}
 #endif
 
 static int
@@ -139,3 +182,29 @@ ws_cpuid_sse42(void)
 	/* in ECX bit 20 toggled on */
 	return (CPUInfo[2] & (1 << 20));
 }
+
+static inline int
+ws_cpuid_avx2(void)
+{
+	uint32_t CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 0) || CPUInfo[0] < 7)
+		return 0;
+
+	if (!ws_cpuid(CPUInfo, 1))
+		return 0;
+
+	/* in ECX bits 27 (OSXSAVE) and 28 (AVX) toggled on */
+	if ((CPUInfo[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28)))
+		return 0;
+
+	/* The OS must save the XMM and YMM registers (XCR0 bits 1 and 2) */
+	if ((ws_xgetbv0() & 0x6) != 0x6)
+		return 0;
+
+	if (!ws_cpuid(CPUInfo, 7))
+		return 0;
+
+	/* in EBX bit 5 toggled on */
+	return (CPUInfo[1] & (1 << 5));
+}
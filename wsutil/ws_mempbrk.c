@@ -25,6 +25,10 @@
 #include "ws_mempbrk.h"
 #include "ws_mempbrk_int.h"
 
+#ifdef HAVE_AVX2
+#include "ws_cpuid.h"
+#endif
+
 #include <string.h>
 
 void
@@ -33,13 +37,32 @@ ws_mempbrk_compile(ws_mempbrk_pattern* pattern, const char *needles)
     const char *n = needles;
     memset(pattern->patt, 0, 256);
     while (*n) {
-        pattern->patt[(int)*n] = 1;
+        pattern->patt[(uint8_t)*n] = 1;
         n++;
     }
 
 #ifdef HAVE_SSE4_2
     ws_mempbrk_sse42_compile(pattern, needles);
 #endif
+
+#ifdef HAVE_AVX2
+    pattern->use_avx2 = ws_cpuid_avx2();
+    pattern->num_needles = 0;
+    if (strlen(needles) <= sizeof pattern->needles) {
+        pattern->num_needles = (uint8_t)strlen(needles);
+        memcpy(pattern->needles, needles, pattern->num_needles);
+    }
+    memset(pattern->nibble_lo, 0, sizeof pattern->nibble_lo);
+    memset(pattern->nibble_hi, 0, sizeof pattern->nibble_hi);
+    for (n = needles; *n; n++) {
+        uint8_t c = (uint8_t)*n;
+
+        if (c < 0x80)
+            pattern->nibble_lo[c & 0x0f] |= 1 << (c >> 4);
+        else
+            pattern->nibble_hi[c & 0x0f] |= 1 << ((c >> 4) - 8);
+    }
+#endif
 }
 
 
@@ -64,6 +87,10 @@ ws_mempbrk_portable_exec(const uint8_t* haystack, size_t haystacklen, const ws_m
 WS_DLL_PUBLIC const uint8_t *
 ws_mempbrk_exec(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, unsigned char *found_needle)
 {
+#ifdef HAVE_AVX2
+    if (haystacklen >= 32 && pattern->use_avx2)
+        return ws_mempbrk_avx2_exec(haystack, haystacklen, pattern, found_needle);
+#endif
 #ifdef HAVE_SSE4_2
     if (haystacklen >= 16 && pattern->use_sse42)
         return ws_mempbrk_sse42_exec(haystack, haystacklen, pattern, found_needle);
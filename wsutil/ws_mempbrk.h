@@ -24,6 +24,16 @@ typedef struct {
     bool use_sse42;
     __m128i mask;
 #endif
+#ifdef HAVE_AVX2
+    bool use_avx2;
+    /* The needles, if there are no more than 4, else 0 of them. */
+    uint8_t num_needles;
+    uint8_t needles[4];
+    /* Bit n of nibble_lo[i] is set if 0x(n)(i) is a needle, for n < 8,
+       and of nibble_hi[i] if 0x(n+8)(i) is. */
+    uint8_t nibble_lo[16];
+    uint8_t nibble_hi[16];
+#endif
 } ws_mempbrk_pattern;
 
 /** Compile the pattern for the needles to find using ws_mempbrk_exec().
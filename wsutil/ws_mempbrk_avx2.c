@@ -0,0 +1,148 @@
+/* ws_mempbrk_avx2.c
+ * Scanning for any of a set of bytes with AVX2 intrinsics
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <immintrin.h>
+#include <string.h>
+
+#include "ws_mempbrk.h"
+#include "ws_mempbrk_int.h"
+#include "bits_ctz.h"
+
+/*
+ * Everything in this file is compiled for AVX2, so it must only be
+ * called once ws_cpuid_avx2() has said that the CPU supports it.
+ *
+ * With up to 4 needles, 32 bytes at a time are compared with each of
+ * them. Otherwise, the needles are a 256-bit set, indexed by the low
+ * nibble of a byte (a row) and its high nibble (a bit in the row).
+ * vpshufb looks up the row of each of 32 bytes at once, in nibble_lo for
+ * high nibbles 0-7 and nibble_hi for 8-15, and the bit for the high
+ * nibble; the byte is a needle if the bit is set in the row. This is the
+ * "shufti" matcher of Hyperscan, with one bit per high nibble instead of
+ * per bucket.
+ */
+
+/* Bit n of the result is set if p[n] is one of the 4 needles. */
+static inline uint32_t
+few_in_block(const uint8_t *p, __m256i n0, __m256i n1, __m256i n2, __m256i n3)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i eq01 = _mm256_or_si256(_mm256_cmpeq_epi8(v, n0), _mm256_cmpeq_epi8(v, n1));
+    __m256i eq23 = _mm256_or_si256(_mm256_cmpeq_epi8(v, n2), _mm256_cmpeq_epi8(v, n3));
+
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(eq01, eq23));
+}
+
+/* Bit n of the result is set if p[n] is in the set. */
+static inline uint32_t
+set_in_block(const uint8_t *p, __m256i rows_lo, __m256i rows_hi, __m256i bits)
+{
+    const __m256i top = _mm256_set1_epi8((char)0x80);
+    const __m256i seven = _mm256_set1_epi8(0x07);
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    /* vpshufb gives 0 for indices with the top bit set, so each byte
+       picks its row from only one of the tables. */
+    __m256i row = _mm256_or_si256(_mm256_shuffle_epi8(rows_lo, v),
+                                  _mm256_shuffle_epi8(rows_hi, _mm256_xor_si256(v, top)));
+    __m256i bit = _mm256_shuffle_epi8(bits,
+                                      _mm256_and_si256(_mm256_srli_epi16(v, 4), seven));
+    __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), _mm256_setzero_si256());
+
+    return ~(uint32_t)_mm256_movemask_epi8(miss);
+}
+
+/*
+ * Scan haystacklen >= 32 bytes, 32 at a time; the last block overlaps the
+ * one before it, with the bytes already looked at masked out. The vectors
+ * are local to each function so that they stay in registers.
+ */
+#define MEMPBRK_AVX2_SCAN(found_in_block) \
+    do { \
+        uint32_t found; \
+        size_t i; \
+        for (i = 0; i + 32 <= haystacklen; i += 32) { \
+            found = found_in_block(haystack + i); \
+            if (found) \
+                return haystack + i + ws_ctz(found); \
+        } \
+        if (i < haystacklen) { \
+            found = found_in_block(haystack + haystacklen - 32); \
+            found &= ~(uint32_t)0 << (32 - (haystacklen - i)); \
+            if (found) \
+                return haystack + haystacklen - 32 + ws_ctz(found); \
+        } \
+        return NULL; \
+    } while (0)
+
+static const uint8_t *
+mempbrk_avx2_few(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern)
+{
+    /* Repeat the first needle if there are fewer than 4. */
+    const uint8_t *n = pattern->needles;
+    uint8_t num = pattern->num_needles;
+    const __m256i n0 = _mm256_set1_epi8((char)n[0]);
+    const __m256i n1 = _mm256_set1_epi8((char)n[num > 1 ? 1 : 0]);
+    const __m256i n2 = _mm256_set1_epi8((char)n[num > 2 ? 2 : 0]);
+    const __m256i n3 = _mm256_set1_epi8((char)n[num > 3 ? 3 : 0]);
+
+#define FOUND_IN_BLOCK(p) few_in_block(p, n0, n1, n2, n3)
+    MEMPBRK_AVX2_SCAN(FOUND_IN_BLOCK);
+#undef FOUND_IN_BLOCK
+}
+
+static const uint8_t *
+mempbrk_avx2_set(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern)
+{
+    const __m256i rows_lo = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)pattern->nibble_lo));
+    const __m256i rows_hi = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)pattern->nibble_hi));
+    const __m256i bits = _mm256_setr_epi8(
+            1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128,
+            1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128);
+
+#define FOUND_IN_BLOCK(p) set_in_block(p, rows_lo, rows_hi, bits)
+    MEMPBRK_AVX2_SCAN(FOUND_IN_BLOCK);
+#undef FOUND_IN_BLOCK
+}
+
+const uint8_t *
+ws_mempbrk_avx2_exec(const uint8_t* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, unsigned char *found_needle)
+{
+    const uint8_t *result;
+
+    if (pattern->num_needles > 0)
+        result = mempbrk_avx2_few(haystack, haystacklen, pattern);
+    else
+        result = mempbrk_avx2_set(haystack, haystacklen, pattern);
+
+    if (result && found_needle)
+        *found_needle = *result;
+    return result;
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */